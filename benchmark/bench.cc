@@ -0,0 +1,154 @@
+// Runs the cases registered by the *_bench.cc files and reports time per call, GFLOP/s and GB/s,
+// optionally compared with a baseline saved by an earlier run.
+//
+//   ./bench [--filter SUBSTRING] [--min-time SECONDS] [--save FILE] [--baseline FILE] [--tolerance FRACTION] [--list]
+//
+// Each case is repeated until --min-time (default 0.2 s) has elapsed, at least 3 times, and the fastest
+// call is reported. With --baseline, the ratio baseline time / current time is printed (above 1 is
+// faster), cases slower by more than --tolerance (default 0.1) are marked, and the exit status is 1 if
+// there are any. The exit status is also 1 if a case registered with bench::Expect is slower than
+// required relative to its reference case.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+volatile double bench::sink_value = 0;
+
+static double
+timeCase(const bench::Case& c, double minTime)
+    {
+    using clock = std::chrono::steady_clock;
+    c.run(); // warm up caches and allocations
+    double best = 1e300, total = 0;
+    for(int rep = 0; rep < 3 || total < minTime; ++rep)
+        {
+        auto t0 = clock::now();
+        c.run();
+        double t = std::chrono::duration<double>(clock::now()-t0).count();
+        best = std::min(best,t);
+        total += t;
+        }
+    return best;
+    }
+
+static std::map<std::string,double>
+readBaseline(const std::string& file)
+    {
+    std::map<std::string,double> base;
+    std::ifstream in(file);
+    if(!in)
+        {
+        cerr << "cannot read baseline " << file << endl;
+        std::exit(2);
+        }
+    std::string line;
+    while(std::getline(in,line))
+        {
+        if(line.empty() || line[0] == '#') continue;
+        std::istringstream s(line);
+        std::string name;
+        double t;
+        if(s >> name >> t) base[name] = t;
+        }
+    return base;
+    }
+
+int
+main(int argc, char* argv[])
+    {
+    std::string filter, save, baseline;
+    double minTime = 0.2, tolerance = 0.1;
+    bool list = false;
+    for(int a = 1; a < argc; ++a)
+        {
+        auto arg = [&]() -> const char*
+            {
+            if(a+1 == argc) { cerr << argv[a] << " needs an argument" << endl; std::exit(2); }
+            return argv[++a];
+            };
+        if(!std::strcmp(argv[a],"--filter")) filter = arg();
+        else if(!std::strcmp(argv[a],"--min-time")) minTime = std::atof(arg());
+        else if(!std::strcmp(argv[a],"--save")) save = arg();
+        else if(!std::strcmp(argv[a],"--baseline")) baseline = arg();
+        else if(!std::strcmp(argv[a],"--tolerance")) tolerance = std::atof(arg());
+        else if(!std::strcmp(argv[a],"--list")) list = true;
+        else
+            {
+            cerr << "usage: " << argv[0] << " [--filter SUBSTRING] [--min-time SECONDS] [--save FILE]"
+                 << " [--baseline FILE] [--tolerance FRACTION] [--list]" << endl;
+            return 2;
+            }
+        }
+
+    std::map<std::string,double> base;
+    if(!baseline.empty()) base = readBaseline(baseline);
+
+    std::ofstream out;
+    if(!save.empty())
+        {
+        out.open(save);
+        if(!out) { cerr << "cannot write " << save << endl; return 2; }
+        out << "# btas benchmark baseline: case, seconds per call\n";
+        }
+
+    std::printf("%-40s %12s %10s %10s%s\n","case","ms/call","GFLOP/s","GB/s",base.empty() ? "" : "   vs base");
+    int regressions = 0;
+    std::map<std::string,double> gflops;
+    for(auto& make : bench::makers())
+        {
+        // cases are made one file at a time, so only one set of operands is allocated
+        std::vector<bench::Case> cases;
+        make(cases);
+        for(auto& c : cases)
+            {
+            if(c.name.find(filter) == std::string::npos) continue;
+            if(list) { cout << c.name << endl; continue; }
+
+            const double t = timeCase(c,minTime);
+            std::printf("%-40s %12.4f ",c.name.c_str(),1e3*t);
+            if(c.flops > 0) std::printf("%10.3f ",1e-9*c.flops/t); else std::printf("%10s ","-");
+            if(c.flops > 0) gflops[c.name] = 1e-9*c.flops/t;
+            if(c.bytes > 0) std::printf("%10.3f",1e-9*c.bytes/t); else std::printf("%10s","-");
+            auto b = base.find(c.name);
+            if(b != base.end())
+                {
+                const double ratio = b->second/t;
+                const bool slower = t > b->second*(1+tolerance);
+                regressions += slower;
+                std::printf("   x%.3f%s",ratio,slower ? "  SLOWER" : "");
+                }
+            std::printf("\n");
+            std::fflush(stdout);
+            if(out) out << c.name << " " << t << "\n";
+            }
+        }
+
+    if(!base.empty())
+        std::printf("%d case(s) slower than the baseline by more than %g%%\n",regressions,100*tolerance);
+
+    int failed = 0;
+    for(const auto& e : bench::expectations())
+        {
+        auto x = gflops.find(e.name), r = gflops.find(e.reference);
+        if(x == gflops.end() || r == gflops.end()) continue;
+        const bool ok = x->second >= e.ratio*r->second;
+        failed += !ok;
+        std::printf("%s reaches x%.3f of %s, expected at least x%g%s\n",e.name.c_str(),x->second/r->second,
+                    e.reference.c_str(),e.ratio,ok ? "" : "  FAILED");
+        }
+    return (regressions || failed) ? 1 : 0;
+    }
@@ -0,0 +1,73 @@
+#ifndef __BTAS_BENCHMARK_BENCH_H
+#define __BTAS_BENCHMARK_BENCH_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+// A timed kernel and the work it does per call, from which GFLOP/s and GB/s are reported.
+// Operands are set up when the case is made and owned by the run function.
+struct Case
+    {
+    std::string name;          // unique, without whitespace; used as key in baseline files
+    double flops;              // floating point operations per call, 0 if not meaningful
+    double bytes;              // bytes read plus bytes written per call
+    std::function<void()> run;
+    };
+
+using Maker = std::function<void(std::vector<Case>&)>;
+
+inline std::vector<Maker>&
+makers()
+    {
+    static std::vector<Maker> m;
+    return m;
+    }
+
+// adds the cases made by a function, at static initialization of a benchmark file:
+// static bench::Register reg([](std::vector<bench::Case>& cases) { ... });
+struct Register
+    {
+    Register(Maker f) { makers().push_back(f); }
+    };
+
+// a case expected to reach at least ratio times the GFLOP/s of a reference case
+struct Expectation
+    {
+    std::string name;
+    std::string reference;
+    double ratio;
+    };
+
+inline std::vector<Expectation>&
+expectations()
+    {
+    static std::vector<Expectation> e;
+    return e;
+    }
+
+// adds an expectation, checked after a run in which both cases were timed:
+// static bench::Expect expect("gemm/sNN/512x512x512", "gemm/dNN/512x512x512", 1.0);
+struct Expect
+    {
+    Expect(const std::string& name, const std::string& reference, double ratio)
+        {
+        expectations().push_back(Expectation{name,reference,ratio});
+        }
+    };
+
+// written by sink(), defined once in bench.cc
+extern volatile double sink_value;
+
+// keeps the result of a reduction alive
+inline void
+sink(double x)
+    {
+    sink_value = x;
+    }
+
+} // namespace bench
+
+#endif
@@ -0,0 +1,37 @@
+#include <map>
+#include <vector>
+
+#include "contract_bench.h"
+#include "btas/generic/contract.h"
+
+using namespace btas;
+
+static void
+run(const Tensor<double>& A, const varray<int>& aA, const Tensor<double>& B, const varray<int>& aB,
+    Tensor<double>& C, const varray<int>& aC)
+    {
+    contract(1.0,A,aA,B,aB,0.0,C,aC);
+    }
+
+static bench::Register reg([](std::vector<bench::Case>& cases)
+    {
+    enum {a,b,c,d,e,f};
+
+    // contract() on the default row-major Tensor: plain matrix products, products that need
+    // a permutation of an operand or of the result, and typical tensor network contractions
+    const std::map<int,long> ext = {{a,40},{b,48},{c,36},{d,44},{e,32},{f,28}};
+    const std::vector<Pattern> dense =
+        {
+        {"mm_ab_bc",                {a,b},     {b,c},     {a,c}},
+        {"mm_ba_bc",                {b,a},     {b,c},     {a,c}},
+        {"mm_ab_cb",                {a,b},     {c,b},     {a,c}},
+        {"mode_abc_bd_adc",         {a,b,c},   {b,d},     {a,d,c}},
+        {"mode_abc_dc_abd",         {a,b,c},   {d,c},     {a,b,d}},
+        {"perm_abc_db_dca",         {a,b,c},   {d,b},     {d,c,a}},
+        {"r4_abcd_cdef_abef",       {a,b,c,d}, {c,d,e,f}, {a,b,e,f}},
+        {"r4_abcd_becf_adef",       {a,b,c,d}, {b,e,c,f}, {a,d,e,f}},
+        {"dmrg_abc_bde_acde",       {a,b,c},   {b,d,e},   {a,c,d,e}},
+        {"outer_ab_cd_abcd",        {a,b},     {c,d},     {a,b,c,d}},
+        };
+    for(auto& p : dense) addContract<Tensor<double>>(cases,"contract",run,p,ext);
+    });
@@ -0,0 +1,59 @@
+#ifndef __BTAS_BENCHMARK_CONTRACT_BENCH_H
+#define __BTAS_BENCHMARK_CONTRACT_BENCH_H
+
+#include <cmath>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "btas/tensor.h"
+
+// one contraction C(aC) = A(aA) * B(aB)
+struct Pattern
+    {
+    std::string name;
+    std::vector<int> aA, aB, aC;
+    };
+
+// C = A * B by a contraction kernel taking the annotations as varray<int>
+template <class _Tensor>
+using ContractKernel = void (*)(const _Tensor&, const btas::varray<int>&, const _Tensor&, const btas::varray<int>&,
+                                _Tensor&, const btas::varray<int>&);
+
+// case "prefix/name" timing run(A,aA,B,aB,C,aC); the extent of each label is given once in ext
+template <class _Tensor>
+static void
+addContract(std::vector<bench::Case>& cases, const std::string& prefix, ContractKernel<_Tensor> run,
+            const Pattern& p, const std::map<int,long>& ext)
+    {
+    auto A = std::make_shared<_Tensor>(), B = std::make_shared<_Tensor>(), C = std::make_shared<_Tensor>();
+    btas::varray<long> eA(p.aA.size()), eB(p.aB.size()), eC(p.aC.size());
+    for(size_t d = 0; d < p.aA.size(); ++d) eA[d] = ext.at(p.aA[d]);
+    for(size_t d = 0; d < p.aB.size(); ++d) eB[d] = ext.at(p.aB[d]);
+    for(size_t d = 0; d < p.aC.size(); ++d) eC[d] = ext.at(p.aC[d]);
+    A->resize(eA);
+    B->resize(eB);
+    C->resize(eC);
+    A->generate([](){ static double v = 0; v += 0.37; return std::sin(v); });
+    B->generate([](){ static double v = 0; v += 0.61; return std::cos(v); });
+    C->fill(0.0);
+
+    // every label is summed over or free, so the product of all extents is the number of multiply-adds
+    std::map<int,long> used;
+    for(auto x : p.aA) used[x] = ext.at(x);
+    for(auto x : p.aB) used[x] = ext.at(x);
+    double fma = 1;
+    for(auto& u : used) fma *= u.second;
+
+    const btas::varray<int> aA(p.aA.begin(),p.aA.end()), aB(p.aB.begin(),p.aB.end()), aC(p.aC.begin(),p.aC.end());
+    bench::Case c;
+    c.name = prefix + "/" + p.name;
+    c.flops = 2*fma;
+    c.bytes = sizeof(double)*(A->size()+B->size()+C->size());
+    c.run = [=](){ run(*A,aA,*B,aB,*C,aC); };
+    cases.push_back(c);
+    }
+
+#endif
@@ -0,0 +1,54 @@
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "btas/generic/gemm_impl.h"
+
+using namespace btas;
+
+// C(M,N) = A * B on row-major data through the iterator interface of gemm_impl.h,
+// which goes to CBLAS with -D_HAS_CBLAS and to the built-in blocked kernel otherwise
+template <typename _T>
+static void
+addGemm(std::vector<bench::Case>& cases, const std::string& name, CBLAS_TRANSPOSE transA, CBLAS_TRANSPOSE transB,
+        unsigned long M, unsigned long N, unsigned long K)
+    {
+    auto A = std::make_shared<std::vector<_T>>(M*K), B = std::make_shared<std::vector<_T>>(K*N);
+    auto C = std::make_shared<std::vector<_T>>(M*N,_T(0));
+    for(size_t i = 0; i < A->size(); ++i) (*A)[i] = std::sin(0.37*i);
+    for(size_t i = 0; i < B->size(); ++i) (*B)[i] = std::cos(0.61*i);
+    const unsigned long LDA = transA == CblasNoTrans ? K : M;
+    const unsigned long LDB = transB == CblasNoTrans ? N : K;
+
+    bench::Case c;
+    c.name = "gemm/" + name + "/" + std::to_string(M) + "x" + std::to_string(N) + "x" + std::to_string(K);
+    c.flops = 2.0*M*N*K;
+    c.bytes = sizeof(_T)*(M*K+K*N+M*N);
+    c.run = [=]()
+        {
+        gemm(CblasRowMajor,transA,transB,M,N,K,_T(1),A->data(),LDA,B->data(),LDB,_T(0),C->data(),N);
+        };
+    cases.push_back(c);
+    }
+
+static bench::Register reg([](std::vector<bench::Case>& cases)
+    {
+    // square
+    for(unsigned long n : {64,256,512})
+        addGemm<double>(cases,"dNN",CblasNoTrans,CblasNoTrans,n,n,n);
+    addGemm<double>(cases,"dTN",CblasTrans,CblasNoTrans,512,512,512);
+    addGemm<double>(cases,"dNT",CblasNoTrans,CblasTrans,512,512,512);
+    addGemm<float>(cases,"sNN",CblasNoTrans,CblasNoTrans,512,512,512);
+
+    // tall-skinny: long M with narrow N and K, and the inner-product shape with long K
+    addGemm<double>(cases,"dNN",CblasNoTrans,CblasNoTrans,65536,16,16);
+    addGemm<double>(cases,"dNN",CblasNoTrans,CblasNoTrans,16384,64,64);
+    addGemm<double>(cases,"dNN",CblasNoTrans,CblasNoTrans,16,16,65536);
+    addGemm<double>(cases,"dTN",CblasTrans,CblasNoTrans,64,64,16384);
+    addGemm<double>(cases,"dNN",CblasNoTrans,CblasNoTrans,64,16384,64);
+    });
+
+// twice as many floats fit in a vector register, so float must be at least as fast as double
+static bench::Expect expectFloat("gemm/sNN/512x512x512","gemm/dNN/512x512x512",1.0);
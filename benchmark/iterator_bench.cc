@@ -0,0 +1,83 @@
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "btas/tensor.h"
+#include "btas/tensorview.h"
+
+using namespace btas;
+
+static bench::Case
+makeCase(const std::string& name, double size, std::function<void()> run)
+    {
+    bench::Case c;
+    c.name = name;
+    c.flops = 0;
+    c.bytes = sizeof(double)*size;
+    c.run = run;
+    return c;
+    }
+
+static bench::Register reg([](std::vector<bench::Case>& cases)
+    {
+    // each case sums the 2 M elements of a rank-3 tensor
+    const long n0 = 64, n1 = 128, n2 = 256;
+    auto T = std::make_shared<Tensor<double>>(n0,n1,n2);
+    T->generate([](){ static double v = 0; return v += 1; });
+    const double size = T->size();
+
+    cases.push_back(makeCase("iterate/tensor",size,[=]()
+        {
+        double s = 0;
+        for(auto x : *T) s += x;
+        bench::sink(s);
+        }));
+
+    cases.push_back(makeCase("access/tensor_ijk",size,[=]()
+        {
+        const Tensor<double>& X = *T;
+        double s = 0;
+        for(long i = 0; i < n0; ++i)
+        for(long j = 0; j < n1; ++j)
+        for(long k = 0; k < n2; ++k)
+            s += X(i,j,k);
+        bench::sink(s);
+        }));
+
+    cases.push_back(makeCase("access/tensor_range_index",size,[=]()
+        {
+        const Tensor<double>& X = *T;
+        double s = 0;
+        for(const auto& i : X.range()) s += X(i);
+        bench::sink(s);
+        }));
+
+    // TensorViewIterator over the same elements in storage order, and transposed
+    using View = TensorView<double,DEFAULT::range,const Tensor<double>::storage_type>;
+    auto V = std::make_shared<View>(T->range(),T->storage());
+    auto W = std::make_shared<View>(permute(T->range(),{2,1,0}),T->storage());
+
+    cases.push_back(makeCase("iterate/view",size,[=]()
+        {
+        double s = 0;
+        for(auto x : *V) s += x;
+        bench::sink(s);
+        }));
+
+    cases.push_back(makeCase("iterate/view_permuted",size,[=]()
+        {
+        double s = 0;
+        for(auto x : *W) s += x;
+        bench::sink(s);
+        }));
+
+    cases.push_back(makeCase("access/view_range_index",size,[=]()
+        {
+        const View& X = *W;
+        double s = 0;
+        for(const auto& i : X.range()) s += X(i);
+        bench::sink(s);
+        }));
+    });
@@ -0,0 +1,43 @@
+#include <map>
+#include <vector>
+
+#include "contract_bench.h"
+#include "btas/optimize/contract.h"
+
+using namespace btas;
+
+using CTensor = Tensor<double,RangeNd<CblasColMajor>>;
+
+static void
+run(const CTensor& A, const varray<int>& aA, const CTensor& B, const varray<int>& aB,
+    CTensor& C, const varray<int>& aC)
+    {
+    contract_colmajor(1.0,A,aA,B,aB,0.0,C,aC);
+    }
+
+static bench::Register reg([](std::vector<bench::Case>& cases)
+    {
+    enum {a,b,c,d,e,f};
+
+    // every pattern of the btas/optimize/contract.h unit test, on column-major tensors
+    const std::map<int,long> cext = {{a,40},{b,48},{c,36},{d,24},{e,32},{f,28}};
+    const std::vector<Pattern> colmajor =
+        {
+        {"ab_bc_ac",                {a,b},       {b,c},     {a,c}},
+        {"ba_cb_ca",                {b,a},       {c,b},     {c,a}},
+        {"abc_bd_adc",              {a,b,c},     {b,d},     {a,d,c}},
+        {"abc_dc_abd",              {a,b,c},     {d,c},     {a,b,d}},
+        {"abc_adc_bd",              {a,b,c},     {a,d,c},   {b,d}},
+        {"abcd_cde_abe",            {a,b,c,d},   {c,d,e},   {a,b,e}},
+        {"abcd_bcef_adef",          {a,b,c,d},   {b,c,e,f}, {a,d,e,f}},
+        {"abcde_dbf_afce",          {a,b,c,d,e}, {d,b,f},   {a,f,c,e}},
+        {"abcd_db_ca",              {a,b,c,d},   {d,b},     {c,a}},
+        };
+    // rank-5 operands are kept to a few MB by shrinking their extents
+    for(auto& p : colmajor)
+        {
+        auto x = cext;
+        if(p.aA.size() == 5) x = {{a,16},{b,20},{c,12},{d,24},{e,12},{f,20}};
+        addContract<CTensor>(cases,"contract_colmajor",run,p,x);
+        }
+    });
@@ -0,0 +1,32 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "btas/tensor.h"
+#include "btas/generic/permute.h"
+
+using namespace btas;
+
+static bench::Register reg([](std::vector<bench::Case>& cases)
+    {
+    // all 24 permutations of a rank-4 tensor of about 6 MB, with distinct extents so that
+    // no two permutations have the same memory access pattern
+    auto X = std::make_shared<Tensor<double>>(24,28,32,36);
+    auto Y = std::make_shared<Tensor<double>>();
+    X->generate([](){ static double v = 0; return v += 1; });
+
+    varray<size_t> p = {0,1,2,3};
+    do
+        {
+        bench::Case c;
+        c.name = "permute/rank4/";
+        for(auto i : p) c.name += std::to_string(i);
+        c.flops = 0;
+        c.bytes = 2*sizeof(double)*X->size();
+        c.run = [=](){ permute(*X,p,*Y); };
+        cases.push_back(c);
+        }
+    while(std::next_permutation(p.begin(),p.end()));
+    });
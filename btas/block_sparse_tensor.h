@@ -0,0 +1,217 @@
+#ifndef __BTAS_BLOCK_SPARSE_TENSOR_H
+#define __BTAS_BLOCK_SPARSE_TENSOR_H 1
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <map>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <btas/tensor.h>
+#include <btas/generic/numeric_type.h>
+
+namespace btas {
+
+  /// Index of a block-sparse tensor: a list of sectors, each labeled by an Abelian quantum number
+  /// and of some dimension, and a direction, +1 (incoming) or -1 (outgoing)
+
+  /// \tparam _Q quantum number type: its default value is the zero, it must provide \c +, unary \c - and \c ==
+  template <typename _Q = int>
+  class QNIndex {
+    public:
+      typedef _Q qn_type;
+      typedef std::pair<_Q, std::size_t> sector_type;  ///< quantum number and dimension of a sector
+
+      QNIndex() : dir_(1) { }
+
+      QNIndex(const std::vector<sector_type>& sectors, int dir = 1) : sectors_(sectors), dir_(dir) {
+        init();
+      }
+
+      QNIndex(std::initializer_list<sector_type> sectors, int dir = 1) : sectors_(sectors), dir_(dir) {
+        init();
+      }
+
+      /// \return +1 for an incoming index, -1 for an outgoing one
+      int dir() const { return dir_; }
+
+      std::size_t nsectors() const { return sectors_.size(); }
+
+      const _Q& qn(std::size_t s) const { return sectors_[s].first; }
+
+      /// \return dimension of sector \c s
+      std::size_t extent(std::size_t s) const { return sectors_[s].second; }
+
+      /// \return position of the first element of sector \c s in the dense index
+      std::size_t offset(std::size_t s) const { return offset_[s]; }
+
+      /// \return dimension of the dense index, the sum of all sector dimensions
+      std::size_t extent() const { return offset_.empty() ? 0 : offset_.back() + sectors_.back().second; }
+
+      /// \return the quantum number of sector \c s times the direction
+      _Q charge(std::size_t s) const { return dir_ > 0 ? qn(s) : -qn(s); }
+
+      /// \return this index with the opposite direction
+      QNIndex conj() const { return QNIndex(sectors_, -dir_); }
+
+      /// \return true if \c x has the same sectors, regardless of the direction
+      bool same_sectors(const QNIndex& x) const {
+        if (sectors_.size() != x.sectors_.size()) return false;
+        for (std::size_t s = 0; s != sectors_.size(); ++s)
+          if (!(sectors_[s].first == x.sectors_[s].first) || sectors_[s].second != x.sectors_[s].second) return false;
+        return true;
+      }
+
+      bool operator== (const QNIndex& x) const { return dir_ == x.dir_ && same_sectors(x); }
+      bool operator!= (const QNIndex& x) const { return !(*this == x); }
+
+    private:
+      void init() {
+        offset_.resize(sectors_.size());
+        std::size_t o = 0;
+        for (std::size_t s = 0; s != sectors_.size(); ++s) {
+          offset_[s] = o;
+          o += sectors_[s].second;
+        }
+      }
+
+      std::vector<sector_type> sectors_;
+      std::vector<std::size_t> offset_;
+      int dir_;
+  };
+
+  /// Tensor with Abelian symmetry, stored as dense blocks keyed by one sector of each index
+
+  /// Only the blocks whose sectors satisfy the selection rule, i.e. the sum of the charges
+  /// (see QNIndex::charge) equals the flux of the tensor, can be stored; blocks not stored are zero.
+  /// \tparam _T element type
+  /// \tparam _Q quantum number type, see QNIndex
+  /// \tparam _Tensor type of the dense blocks
+  template <typename _T, typename _Q = int, class _Tensor = btas::Tensor<_T>>
+  class BlockSparseTensor {
+    public:
+      typedef _T value_type;
+      typedef _Q qn_type;
+      typedef QNIndex<_Q> qn_index_type;
+      typedef _Tensor block_type;
+      typedef std::vector<std::size_t> block_key;  ///< sector of each index
+      typedef std::map<block_key, block_type> block_map;
+      typedef typename block_map::iterator iterator;
+      typedef typename block_map::const_iterator const_iterator;
+
+      BlockSparseTensor() : flux_() { }
+
+      explicit
+      BlockSparseTensor(const std::vector<qn_index_type>& indices, const _Q& flux = _Q()) : indices_(indices), flux_(flux) { }
+
+      BlockSparseTensor(std::initializer_list<qn_index_type> indices, const _Q& flux = _Q()) : indices_(indices), flux_(flux) { }
+
+      std::size_t rank() const { return indices_.size(); }
+
+      const qn_index_type& index(std::size_t d) const { return indices_[d]; }
+
+      const std::vector<qn_index_type>& indices() const { return indices_; }
+
+      const _Q& flux() const { return flux_; }
+
+      /// \return number of stored blocks
+      std::size_t nblocks() const { return blocks_.size(); }
+
+      /// \return number of stored elements
+      std::size_t size() const {
+        std::size_t n = 0;
+        for (const auto& b : blocks_) n += b.second.size();
+        return n;
+      }
+
+      /// \return true if block \c key satisfies the selection rule
+      bool allowed(const block_key& key) const {
+        if (key.size() != rank()) return false;
+        _Q q = _Q();
+        for (std::size_t d = 0; d != rank(); ++d) {
+          if (key[d] >= indices_[d].nsectors()) return false;
+          q = q + indices_[d].charge(key[d]);
+        }
+        return q == flux_;
+      }
+
+      /// \return pointer to block \c key , null if it is not stored
+      block_type* find(const block_key& key) {
+        auto b = blocks_.find(key);
+        return b == blocks_.end() ? nullptr : &b->second;
+      }
+
+      const block_type* find(const block_key& key) const {
+        auto b = blocks_.find(key);
+        return b == blocks_.end() ? nullptr : &b->second;
+      }
+
+      /// \return block \c key , stored as zeros first if it was not stored
+      /// \throw std::logic_error if the block violates the selection rule
+      block_type& block(const block_key& key) {
+        auto b = blocks_.find(key);
+        if (b != blocks_.end()) return b->second;
+        if (!allowed(key)) throw std::logic_error("BlockSparseTensor: block violates the selection rule");
+        std::vector<std::size_t> extent(rank());
+        for (std::size_t d = 0; d != rank(); ++d) extent[d] = indices_[d].extent(key[d]);
+        block_type& x = blocks_[key];
+        x.resize(extent);
+        x.fill(NumericType<value_type>::zero());
+        return x;
+      }
+
+      /// stores all blocks allowed by the selection rule, the new ones as zeros
+      void allocate() {
+        if (rank() == 0) return;
+        block_key key(rank(), 0);
+        for (std::size_t d = 0; d != rank(); ++d)
+          if (indices_[d].nsectors() == 0) return;
+        while (true) {
+          if (allowed(key)) block(key);
+          std::size_t d = rank();
+          while (d > 0 && ++key[d-1] == indices_[d-1].nsectors()) key[--d] = 0;
+          if (d == 0) break;
+        }
+      }
+
+      /// drops all blocks, i.e. sets the tensor to zero
+      void clear() { blocks_.clear(); }
+
+      /// sets all stored elements to \c val
+      void fill(const value_type& val) {
+        for (auto& b : blocks_) b.second.fill(val);
+      }
+
+      iterator begin() { return blocks_.begin(); }
+      iterator end() { return blocks_.end(); }
+      const_iterator begin() const { return blocks_.begin(); }
+      const_iterator end() const { return blocks_.end(); }
+
+      /// \return the dense tensor, with the sectors of each index in order and zeros outside the stored blocks
+      block_type dense() const {
+        std::vector<std::size_t> extent(rank());
+        for (std::size_t d = 0; d != rank(); ++d) extent[d] = indices_[d].extent();
+        block_type x;
+        x.resize(extent);
+        x.fill(NumericType<value_type>::zero());
+        std::vector<long> index(rank());
+        for (const auto& b : blocks_) {
+          for (const auto& i : b.second.range()) {
+            for (std::size_t d = 0; d != rank(); ++d) index[d] = i[d] + indices_[d].offset(b.first[d]);
+            x(index) = b.second(i);
+          }
+        }
+        return x;
+      }
+
+    private:
+      std::vector<qn_index_type> indices_;
+      _Q flux_;
+      block_map blocks_;
+  };
+
+} // namespace btas
+
+#endif // __BTAS_BLOCK_SPARSE_TENSOR_H
@@ -14,14 +14,26 @@
 
 #include <btas/range.h>
 #include <btas/varray/varray.h>
+#include <btas/varray/allocators.h>
 
 namespace btas {
 
 namespace DEFAULT {
 
-/// default storage class
+/// storage class that is 64-byte aligned, first touched in parallel, and whose elements are not value-initialized;
+/// opt in per tensor, e.g. Tensor<double, Range, DEFAULT::aligned_storage<double>>, or for all tensors by defining
+/// BTAS_DEFAULT_ALIGNED_STORAGE
+template<typename _T>
+using aligned_storage = std::vector<_T, btas::aligned_allocator<_T>>;
+
+/// default storage class, whose elements are value-initialized (i.e. zero) unless BTAS_DEFAULT_ALIGNED_STORAGE is defined
+#ifdef BTAS_DEFAULT_ALIGNED_STORAGE
+template<typename _T>
+using storage = aligned_storage<_T>;
+#else
 template<typename _T>
 using storage = std::vector<_T>;
+#endif
 
 /// default range type
 using range = btas::Range;
@@ -0,0 +1,86 @@
+#ifndef __BTAS_DIAGONAL_TENSOR_H
+#define __BTAS_DIAGONAL_TENSOR_H 1
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#include <btas/tensor.h>
+#include <btas/generic/numeric_type.h>
+
+namespace btas {
+
+  /// Diagonal tensor, \f$ D(i_1,\ldots,i_r) = d(i) \f$ if all \f$ i_k = i \f$ and zero otherwise
+
+  /// Only the diagonal is stored, or a single value for a (scaled) identity, so that contract() with
+  /// a DiagonalTensor costs as much as a pass over the other operand, see contract_diagonal.h
+  /// \tparam _T element type
+  template <typename _T>
+  class DiagonalTensor {
+    public:
+      typedef _T value_type;
+
+      DiagonalTensor() : extent_(0), rank_(2), constant_(false) { }
+
+      /// diagonal tensor of rank \c rank whose diagonal are the elements of \c d ,
+      /// e.g. a \c std::vector or a rank-1 Tensor or TensorView such as diag(T)
+      template <class _Container,
+                class = typename std::enable_if<!std::is_integral<_Container>::value>::type>
+      explicit
+      DiagonalTensor(const _Container& d, std::size_t rank = 2) :
+        values_(std::begin(d), std::end(d)), extent_(values_.size()), rank_(rank), constant_(false) { }
+
+      DiagonalTensor(std::initializer_list<value_type> d, std::size_t rank = 2) :
+        values_(d), extent_(values_.size()), rank_(rank), constant_(false) { }
+
+      /// \return \c scale times the identity of \c rank indices of extent \c n
+      static DiagonalTensor identity(std::size_t n, const value_type& scale = NumericType<value_type>::one(), std::size_t rank = 2) {
+        DiagonalTensor x;
+        x.values_.assign(1, scale);
+        x.extent_ = n;
+        x.rank_ = rank;
+        x.constant_ = true;
+        return x;
+      }
+
+      std::size_t rank() const { return rank_; }
+
+      /// \return the extent of every index
+      std::size_t extent() const { return extent_; }
+
+      /// \return true if all diagonal elements are the same, i.e. this is a scaled identity
+      bool is_identity() const { return constant_; }
+
+      /// \return the i-th diagonal element
+      value_type value(std::size_t i) const { return constant_ ? values_[0] : values_[i]; }
+
+      /// \return the stored diagonal, a single element for a scaled identity
+      const std::vector<value_type>& values() const { return values_; }
+
+      /// \return the dense tensor
+      template <class _Tensor = btas::Tensor<_T>>
+      _Tensor dense() const {
+        _Tensor x;
+        x.resize(std::vector<std::size_t>(rank_, extent_));
+        x.fill(NumericType<value_type>::zero());
+        std::vector<long> index(rank_);
+        for (std::size_t i = 0; i != extent_; ++i) {
+          std::fill(index.begin(), index.end(), static_cast<long>(i));
+          x(index) = value(i);
+        }
+        return x;
+      }
+
+    private:
+      std::vector<value_type> values_;
+      std::size_t extent_;
+      std::size_t rank_;
+      bool constant_;
+  };
+
+} // namespace btas
+
+#endif // __BTAS_DIAGONAL_TENSOR_H
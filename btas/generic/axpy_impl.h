@@ -11,6 +11,9 @@
 
 #include <btas/generic/numeric_type.h>
 #include <btas/generic/tensor_iterator_wrapper.h>
+#include <btas/generic/simd.h>
+#include <btas/util/parallel.h>
+#include <btas/generic/strided_view.h>
 
 namespace btas {
 
@@ -71,7 +74,59 @@ template<> struct axpy_impl<true>
    {
       cblas_zaxpy(Nsize, &alpha, itrX, incX, itrY, incY);
    }
+#else
+   static void call (
+      const unsigned long& Nsize,
+      const float& alpha,
+      const float* itrX, const typename std::iterator_traits<float*>::difference_type& incX,
+            float* itrY, const typename std::iterator_traits<float*>::difference_type& incY)
+   {
+      if (incX == 1 && incY == 1) parallel_for(Nsize, elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) { simd::axpy(i1-i0, alpha, itrX+i0, itrY+i0); });
+      else call<float, const float*, float*>(Nsize, alpha, itrX, incX, itrY, incY);
+   }
+
+   static void call (
+      const unsigned long& Nsize,
+      const double& alpha,
+      const double* itrX, const typename std::iterator_traits<double*>::difference_type& incX,
+            double* itrY, const typename std::iterator_traits<double*>::difference_type& incY)
+   {
+      if (incX == 1 && incY == 1) parallel_for(Nsize, elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) { simd::axpy(i1-i0, alpha, itrX+i0, itrY+i0); });
+      else call<double, const double*, double*>(Nsize, alpha, itrX, incX, itrY, incY);
+   }
+
+   static void call (
+      const unsigned long& Nsize,
+      const std::complex<float>& alpha,
+      const std::complex<float>* itrX, const typename std::iterator_traits<std::complex<float>*>::difference_type& incX,
+            std::complex<float>* itrY, const typename std::iterator_traits<std::complex<float>*>::difference_type& incY)
+   {
+      if (incX == 1 && incY == 1) parallel_for(Nsize, elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) { simd::axpy(i1-i0, alpha, itrX+i0, itrY+i0); });
+      else call<std::complex<float>, const std::complex<float>*, std::complex<float>*>(Nsize, alpha, itrX, incX, itrY, incY);
+   }
+
+   static void call (
+      const unsigned long& Nsize,
+      const std::complex<double>& alpha,
+      const std::complex<double>* itrX, const typename std::iterator_traits<std::complex<double>*>::difference_type& incX,
+            std::complex<double>* itrY, const typename std::iterator_traits<std::complex<double>*>::difference_type& incY)
+   {
+      if (incX == 1 && incY == 1) parallel_for(Nsize, elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) { simd::axpy(i1-i0, alpha, itrX+i0, itrY+i0); });
+      else call<std::complex<double>, const std::complex<double>*, std::complex<double>*>(Nsize, alpha, itrX, incX, itrY, incY);
+   }
 #endif
+
+   /// 16-bit data (half, bfloat16) are updated in float
+   template<class _Format>
+   static void call (
+      const unsigned long& Nsize,
+      const float& alpha,
+      const reduced_float<_Format>* itrX, const typename std::iterator_traits<reduced_float<_Format>*>::difference_type& incX,
+            reduced_float<_Format>* itrY, const typename std::iterator_traits<reduced_float<_Format>*>::difference_type& incY)
+   {
+      if (incX == 1 && incY == 1) parallel_for(Nsize, elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) { for (unsigned long i = i0; i < i1; ++i) itrY[i] = static_cast<float>(itrY[i]) + alpha * static_cast<float>(itrX[i]); });
+      else call<float, const reduced_float<_Format>*, reduced_float<_Format>*>(Nsize, alpha, itrX, incX, itrY, incY);
+   }
 };
 
 /// Case that alpha is multiplied recursively by AXPY
@@ -110,12 +165,66 @@ void axpy (
    static_assert(std::is_same<typename __traits_Y::iterator_category, std::random_access_iterator_tag>::value, "iterator Y must be a random access iterator");
 
    typedef typename __traits_X::value_type __value_X;
-   typedef typename std::conditional<std::is_convertible<_T, __value_X>::value, __value_X, _T>::type __alpha;
+   typedef typename std::conditional<std::is_convertible<_T, __value_X>::value, typename accumulate_type<__value_X>::type, _T>::type __alpha;
    axpy_impl<std::is_convertible<_T, __value_X>::value>::call(Nsize, static_cast<__alpha>(alpha), itrX, incX, itrY, incY);
 }
 
 //  ================================================================================================
 
+/// AXPY of tensors in one call, Y being resized to X if empty
+template<bool _View> struct axpy_tensor_impl
+{
+   template<typename _T, class _TensorX, class _TensorY>
+   static void call (const _T& alpha, const _TensorX& X, _TensorY& Y)
+   {
+      typedef typename _TensorX::value_type value_type;
+
+      if (X.empty())
+      {
+         Y.clear();
+         return;
+      }
+
+      if (Y.empty())
+      {
+         Y.resize(btas::extent(X));
+         NumericType<value_type>::fill(std::begin(Y), std::end(Y), NumericType<value_type>::zero());
+      }
+      else
+      {
+         assert( range(X) == range(Y) );
+      }
+
+      auto itrX = tbegin(X);
+      auto itrY = tbegin(Y);
+
+      axpy (X.size(), alpha, itrX, 1, itrY, 1);
+   }
+};
+
+/// AXPY of tensors of which one is a view, block by block through the strides of their ranges;
+/// Y must have the extents of X
+template<> struct axpy_tensor_impl<true>
+{
+   template<typename _T, class _TensorX, class _TensorY>
+   static void call (const _T& alpha, const _TensorX& X, _TensorY& Y)
+   {
+      const auto extX = extent(X);
+      const auto extY = extent(Y);
+      assert( std::equal(std::begin(extX), std::end(extX), std::begin(extY)) );
+      (void)extY;
+      if (X.empty()) return;
+
+      auto ptrX = strided_data(X);
+      auto ptrY = strided_data(Y);
+      impl::for_each_strided_block(extX, X.range().ordinal().stride(), Y.range().ordinal().stride(),
+                                   [&](long oX, long oY, unsigned long n, long incX, long incY)
+      {
+         axpy (n, alpha, ptrX+oX, incX, ptrY+oY, incY);
+      });
+   }
+};
+
 /// Convenient wrapper to call BLAS AXPY from tensor objects
 template<
    typename _T,
@@ -133,26 +242,7 @@ void axpy (
    typedef typename _TensorX::value_type value_type;
    static_assert(std::is_same<value_type, typename _TensorY::value_type>::value, "value type of Y must be the same as that of X");
 
-   if (X.empty())
-   {
-      Y.clear();
-      return;
-   }
-
-   if (Y.empty())
-   {
-      Y.resize(btas::extent(X));
-      NumericType<value_type>::fill(std::begin(Y), std::end(Y), NumericType<value_type>::zero());
-   }
-   else
-   {
-      assert( range(X) == range(Y) );
-   }
-
-   auto itrX = std::begin(X);
-   auto itrY = std::begin(Y);
-
-   axpy (X.size(), alpha, itrX, 1, itrY, 1);
+   axpy_tensor_impl<is_strided_view<_TensorX>::value || is_strided_view<_TensorY>::value>::call(alpha, X, Y);
 }
 
 } // namespace btas
@@ -2,6 +2,8 @@
 #define __BTAS_CONTRACT_H
 
 #include <algorithm>
+#include <cassert>
+#include <vector>
 
 #include <btas/types.h>
 #include <btas/tensor_traits.h>
@@ -13,10 +15,186 @@
 #include <btas/generic/ger_impl.h>
 #include <btas/generic/gemm_impl.h>
 #include <btas/generic/permute.h>
+#include <btas/generic/contract_strided.h>
 #include <btas/util/optional_ptr.h>
+#include <btas/util/profile.h>
 
 namespace btas {
 
+namespace impl {
+
+/// Permutations of A, B and C that make the Hadamard indices H the slowest, i.e. (H,M,K) x (H,K,N) -> (H,M,N)
+/// in row-major storage and (M,K,H) x (K,N,H) -> (M,N,H) in column-major storage; free and Hadamard indices are
+/// in the order of C, contracted indices in the order of A
+template<class _AnnotationA, class _AnnotationB, class _AnnotationC, typename _Index>
+void hadamard_permutations (
+   const CBLAS_ORDER& order,
+   const _AnnotationA& aA, const _AnnotationB& aB, const _AnnotationC& aC,
+   btas::varray<_Index>& pA, btas::varray<_Index>& pB, btas::varray<_Index>& pC)
+{
+   std::vector<_Index> h, m, k, n;
+   for(auto itrC = std::begin(aC); itrC != std::end(aC); ++itrC)
+   {
+      const bool inA = std::find(std::begin(aA), std::end(aA), *itrC) != std::end(aA);
+      const bool inB = std::find(std::begin(aB), std::end(aB), *itrC) != std::end(aB);
+      if(inA && inB) h.push_back(*itrC);
+      else if(inA)   m.push_back(*itrC);
+      else           n.push_back(*itrC);
+   }
+   for(auto itrA = std::begin(aA); itrA != std::end(aA); ++itrA)
+   {
+      if(std::find(std::begin(aC), std::end(aC), *itrA) == std::end(aC)) k.push_back(*itrA);
+   }
+   pA = btas::varray<_Index>(h.size()+m.size()+k.size());
+   pB = btas::varray<_Index>(h.size()+k.size()+n.size());
+   pC = btas::varray<_Index>(h.size()+m.size()+n.size());
+   if(order == CblasRowMajor)
+   {
+      std::copy(k.begin(), k.end(), std::copy(m.begin(), m.end(), std::copy(h.begin(), h.end(), pA.begin())));
+      std::copy(n.begin(), n.end(), std::copy(k.begin(), k.end(), std::copy(h.begin(), h.end(), pB.begin())));
+      std::copy(n.begin(), n.end(), std::copy(m.begin(), m.end(), std::copy(h.begin(), h.end(), pC.begin())));
+   }
+   else
+   {
+      std::copy(h.begin(), h.end(), std::copy(k.begin(), k.end(), std::copy(m.begin(), m.end(), pA.begin())));
+      std::copy(h.begin(), h.end(), std::copy(n.begin(), n.end(), std::copy(k.begin(), k.end(), pB.begin())));
+      std::copy(h.begin(), h.end(), std::copy(n.begin(), n.end(), std::copy(m.begin(), m.end(), pC.begin())));
+   }
+}
+
+/// Contracts A, B and C permuted by hadamard_permutations with one GEMM per Hadamard index, which takes
+/// any value type the generic GEMM does (e.g. half and bfloat16, summed in float)
+template<typename _T, class _TensorA, class _TensorB, class _TensorC, typename _Index>
+void hadamard_gemm_loop (
+   const CBLAS_ORDER& order,
+   const _T& alpha,
+   const _TensorA& A, const btas::varray<_Index>& aA,
+   const _TensorB& B, const btas::varray<_Index>& aB,
+   const _T& beta,
+         _TensorC& C, const btas::varray<_Index>& aC)
+{
+   unsigned long H = 1, M = 1, N = 1, K = 1;
+   for(size_t i = 0; i < aC.size(); ++i)
+   {
+      const bool inA = std::find(aA.begin(), aA.end(), aC[i]) != aA.end();
+      const bool inB = std::find(aB.begin(), aB.end(), aC[i]) != aB.end();
+      const unsigned long e = extent(C)[i];
+      if(inA && inB) H *= e;
+      else if(inA)   M *= e;
+      else           N *= e;
+   }
+   for(size_t i = 0; i < aA.size(); ++i)
+   {
+      if(std::find(aC.begin(), aC.end(), aA[i]) == aC.end()) K *= extent(A)[i];
+   }
+   if(H*M*N == 0) return;
+
+   auto ptrA = strided_data(A);
+   auto ptrB = strided_data(B);
+   auto ptrC = strided_data(C);
+   const bool row = (order == CblasRowMajor);
+   for(unsigned long h = 0; h < H; ++h)
+   {
+      gemm(order, CblasNoTrans, CblasNoTrans, M, N, K,
+           alpha, ptrA + h*M*K, row ? K : M, ptrB + h*K*N, row ? N : K, beta, ptrC + h*M*N, row ? N : M);
+   }
+}
+
+/// Contracts tensors that share Hadamard indices by permuting them with hadamard_permutations into
+/// temporaries of type _TensorA, _TensorB and _TensorC
+template<typename _T, class _TensorA, class _AnnotationA, class _TensorB, class _AnnotationB, class _TensorC, class _AnnotationC, class _Kernel>
+void contract_hadamard_permuted (
+   const _T& alpha,
+   const _TensorA& A, const _AnnotationA& aA,
+   const _TensorB& B, const _AnnotationB& aB,
+   const _T& beta,
+         _TensorC& C, const _AnnotationC& aC,
+   _Kernel kernel)
+{
+   typedef typename _TensorC::value_type value_type;
+   const CBLAS_ORDER order = boxtensor_storage_order<_TensorC>::value == boxtensor_storage_order<_TensorC>::row_major ?
+                             CblasRowMajor : CblasColMajor;
+   typedef typename std::decay<decltype(*std::begin(aA))>::type index_type;
+   btas::varray<index_type> __permute_indexA, __permute_indexB, __permute_indexC;
+   hadamard_permutations(order, aA, aB, aC, __permute_indexA, __permute_indexB, __permute_indexC);
+
+   _TensorA __A;
+   _TensorB __B;
+   _TensorC __C;
+   permute(A, aA, __A, __permute_indexA);
+   permute(B, aB, __B, __permute_indexB);
+   if(!C.empty())
+   {
+      permute(C, aC, __C, __permute_indexC);
+   }
+   else
+   {
+      btas::varray<unsigned long> ext(__permute_indexC.size());
+      for(size_t i = 0; i < ext.size(); ++i)
+      {
+         const auto a = std::find(__permute_indexA.begin(), __permute_indexA.end(), __permute_indexC[i]);
+         ext[i] = (a != __permute_indexA.end()) ? extent(__A)[a-__permute_indexA.begin()]
+                                                : extent(__B)[std::find(__permute_indexB.begin(), __permute_indexB.end(), __permute_indexC[i])-__permute_indexB.begin()];
+      }
+      __C.resize(ext);
+      NumericType<value_type>::fill(std::begin(__C), std::end(__C), NumericType<value_type>::zero());
+   }
+   kernel(order, alpha, __A, __permute_indexA, __B, __permute_indexB, beta, __C, __permute_indexC);
+   permute(__C, __permute_indexC, C, aC);
+}
+
+} // namespace impl
+
+/// Contracts tensors that share Hadamard indices, i.e. indices of A, B and C alike: one GEMM per Hadamard index
+/// after permuting them to be the slowest, for value types without a strided GEMM (e.g. half)
+template<bool _Strided> struct contract_hadamard_dispatch
+{
+   template<typename _T, class _TensorA, class _AnnotationA, class _TensorB, class _AnnotationB, class _TensorC, class _AnnotationC>
+   static void call (
+      const _T& alpha,
+      const _TensorA& A, const _AnnotationA& aA,
+      const _TensorB& B, const _AnnotationB& aB,
+      const _T& beta,
+            _TensorC& C, const _AnnotationC& aC)
+   {
+      static_assert(std::is_same<typename _TensorA::value_type, typename _TensorB::value_type>::value &&
+                    std::is_same<typename _TensorA::value_type, typename _TensorC::value_type>::value,
+                    "Hadamard contraction requires A, B and C of the same value type");
+      typedef typename std::decay<decltype(*std::begin(aA))>::type index_type;
+      impl::contract_hadamard_permuted(alpha, A, aA, B, aB, beta, C, aC,
+         [](const CBLAS_ORDER& order, const _T& a, const _TensorA& pA, const btas::varray<index_type>& iA,
+            const _TensorB& pB, const btas::varray<index_type>& iB, const _T& b, _TensorC& pC, const btas::varray<index_type>& iC)
+         {
+            impl::hadamard_gemm_loop(order, a, pA, iA, pB, iB, b, pC, iC);
+         });
+   }
+};
+
+/// Contracts tensors that share Hadamard indices as a batch of GEMMs, in place if their strides allow it
+template<> struct contract_hadamard_dispatch<true>
+{
+   template<typename _T, class _TensorA, class _AnnotationA, class _TensorB, class _AnnotationB, class _TensorC, class _AnnotationC>
+   static void call (
+      const _T& alpha,
+      const _TensorA& A, const _AnnotationA& aA,
+      const _TensorB& B, const _AnnotationB& aB,
+      const _T& beta,
+            _TensorC& C, const _AnnotationC& aC)
+   {
+      if(contract_strided_dispatch<true>::call(alpha, A, aA, B, aB, beta, C, aC)) return;
+
+      typedef typename std::decay<decltype(*std::begin(aA))>::type index_type;
+      impl::contract_hadamard_permuted(alpha, A, aA, B, aB, beta, C, aC,
+         [](const CBLAS_ORDER& order, const _T& a, const _TensorA& pA, const btas::varray<index_type>& iA,
+            const _TensorB& pB, const btas::varray<index_type>& iB, const _T& b, _TensorC& pC, const btas::varray<index_type>& iC)
+         {
+            // the Hadamard indices are the slowest, so that the plan only fails for batches too small to loop over
+            if(!contract_strided_dispatch<true>::call(a, pA, iA, pB, iB, b, pC, iC))
+               impl::hadamard_gemm_loop(order, a, pA, iA, pB, iB, b, pC, iC);
+         });
+   }
+};
+
 /// contract tensors; for example, Cijk = \sum_{m,p} Aimp * Bmjpk
 ///
 /// Synopsis:
@@ -32,6 +210,8 @@ namespace btas {
 ///
 /// NOTE: in case of TArray, this performs many unuse instances of gemv and gemm depend on tensor rank
 ///
+/// The phases of each call are timed when profiling is enabled, see btas/util/profile.h
+///
 template<
    typename _T,
    class _TensorA, class _TensorB, class _TensorC,
@@ -42,7 +222,8 @@ template<
       is_boxtensor<_TensorC>::value &
       is_container<_AnnotationA>::value &
       is_container<_AnnotationB>::value &
-      is_container<_AnnotationC>::value
+      is_container<_AnnotationC>::value &
+      not (is_strided_view<_TensorA>::value | is_strided_view<_TensorB>::value | is_strided_view<_TensorC>::value)
    >::type
 >
 void contract(
@@ -52,6 +233,8 @@ void contract(
    const _T& beta,
          _TensorC& C, const _AnnotationC& aC)
 {
+   contract_profile __profile(beta, A, aA, B, aB, C, aC);
+
    // check index A
    auto __sort_indexA = _AnnotationA{aA};
    std::sort(std::begin(__sort_indexA), std::end(__sort_indexA));
@@ -67,6 +250,18 @@ void contract(
    std::sort(std::begin(__sort_indexC), std::end(__sort_indexC));
    assert(std::unique(std::begin(__sort_indexC), std::end(__sort_indexC)) == std::end(__sort_indexC));
 
+   // indices of A, B and C alike make a batched GEMM
+   for(auto itrC = std::begin(aC); itrC != std::end(aC); ++itrC)
+   {
+      if(std::binary_search(std::begin(__sort_indexA), std::end(__sort_indexA), *itrC) &&
+         std::binary_search(std::begin(__sort_indexB), std::end(__sort_indexB), *itrC))
+      {
+         __profile.phase(contract_phase::kernel);
+         contract_hadamard_dispatch<is_contract_strided_call<_TensorA, _TensorB, _TensorC>::value>::call(alpha, A, aA, B, aB, beta, C, aC);
+         return;
+      }
+   }
+
    typedef btas::varray<size_t> Permutation;
 
    // permute index A
@@ -121,11 +316,19 @@ void contract(
    std::sort(std::begin(__sort_permute_indexC), std::end(__sort_permute_indexC));
    assert(std::equal(std::begin(__sort_permute_indexC), std::end(__sort_permute_indexC), std::begin(__sort_indexC)));
 
+   // contract in place if the index groups can be addressed by (a loop of) GEMMs through leading dimensions
+   __profile.phase(contract_phase::kernel);
+   if(contract_strided_dispatch<is_contract_strided_call<_TensorA, _TensorB, _TensorC>::value>::call(alpha, A, aA, B, aB, beta, C, aC))
+   {
+      return;
+   }
+
    optional_ptr<const _TensorA> __refA;
    __refA.set_external(&A);
    // permute A if necessary
    if(!std::equal(std::begin(aA), std::end(aA), std::begin(__permute_indexA)))
    {
+      __profile.phase(contract_phase::permute_A);
       __refA.set_managed(new _TensorA());
       permute(A, aA, const_cast<_TensorA&>(*__refA), __permute_indexA);
    }
@@ -135,6 +338,7 @@ void contract(
    // permute B if necessary
    if(!std::equal(std::begin(aB), std::end(aB), std::begin(__permute_indexB)))
    {
+      __profile.phase(contract_phase::permute_B);
       __refB.set_managed(new _TensorB());
       permute(B, aB, const_cast<_TensorB&>(*__refB), __permute_indexB);
    }
@@ -155,19 +359,23 @@ void contract(
    // permute C if necessary
    if(!std::equal(std::begin(aC), std::end(aC), std::begin(__permute_indexC)))
    {
+      __profile.phase(contract_phase::permute_C);
       __refC.set_managed(new _TensorC());
       permute(C, aC, *__refC, __permute_indexC);
       __C_to_permute = true;
    }
 
    // call BLAS functions
+   if(k != 0) __profile.phase(contract_phase::kernel);
    if(rank(A) == k && rank(B) == k)
    {
       assert(false); // dot should be called instead
    }
    else if(k == 0)
    {
+      __profile.phase(contract_phase::scale);
       scal(beta, *__refC);
+      __profile.phase(contract_phase::kernel);
       ger (alpha, *__refA, *__refB, *__refC);
    }
    else if(rank(A) == k)
@@ -186,10 +394,163 @@ void contract(
    // permute back
    if(__C_to_permute)
    {
+      __profile.phase(contract_phase::permute_back);
       permute(*__refC, __permute_indexC, C, aC);
    }
 }
 
+/// contract tensors of which some are views, e.g. slices made by Tensor::slice()
+///
+/// Views are read and written in place through the strides of their ranges by (loops of) GEMMs with leading
+/// dimensions, as Tensors are, see contract_strided.h; only if their index groups cannot be laid out that way
+/// are they copied to Tensors, contracted as above, and C copied back. C cannot be resized if it is a view.
+template<
+   typename _T,
+   class _TensorA, class _TensorB, class _TensorC,
+   class _AnnotationA, class _AnnotationB, class _AnnotationC
+>
+typename std::enable_if<
+   is_boxtensor<_TensorA>::value &
+   is_boxtensor<_TensorB>::value &
+   is_boxtensor<_TensorC>::value &
+   is_container<_AnnotationA>::value &
+   is_container<_AnnotationB>::value &
+   is_container<_AnnotationC>::value &
+   (is_strided_view<_TensorA>::value | is_strided_view<_TensorB>::value | is_strided_view<_TensorC>::value)
+>::type
+contract(
+   const _T& alpha,
+   const _TensorA& A, const _AnnotationA& aA,
+   const _TensorB& B, const _AnnotationB& aB,
+   const _T& beta,
+         _TensorC& C, const _AnnotationC& aC)
+{
+   assert(!(is_strided_view<_TensorC>::value && C.empty()));
+
+   if(contract_strided_dispatch<is_contract_strided_call<_TensorA, _TensorB, _TensorC>::value>::call(alpha, A, aA, B, aB, beta, C, aC))
+   {
+      return;
+   }
+
+   auto&& __A = impl::dense_operand(A);
+   auto&& __B = impl::dense_operand(B);
+   typename std::conditional<is_strided_view<_TensorC>::value, typename impl::dense_type<_TensorC>::type, _TensorC&>::type __C = C;
+   contract(alpha, __A, aA, __B, aB, beta, __C, aC);
+   impl::dense_copy_back(__C, C);
+}
+
+/// GEMM of tensors of which some are views, as a contraction of their row and column indices (see above)
+template<
+   typename _T,
+   class _TensorA, class _TensorB, class _TensorC
+>
+typename std::enable_if<
+   is_boxtensor<_TensorA>::value &
+   is_boxtensor<_TensorB>::value &
+   is_boxtensor<_TensorC>::value &
+   std::is_same<typename _TensorA::value_type, typename _TensorB::value_type>::value &
+   std::is_same<typename _TensorA::value_type, typename _TensorC::value_type>::value &
+   (is_strided_view<_TensorA>::value | is_strided_view<_TensorB>::value | is_strided_view<_TensorC>::value)
+>::type
+gemm (
+   const CBLAS_TRANSPOSE& transA,
+   const CBLAS_TRANSPOSE& transB,
+   const _T& alpha,
+   const _TensorA& A,
+   const _TensorB& B,
+   const _T& beta,
+         _TensorC& C)
+{
+   if (A.empty() || B.empty()) return;
+   assert(C.rank() != 0);
+
+   // a contraction cannot conjugate, the views are copied
+   if (transA == CblasConjTrans || transB == CblasConjTrans)
+   {
+      typename std::conditional<is_strided_view<_TensorC>::value, typename impl::dense_type<_TensorC>::type, _TensorC&>::type __C = C;
+      gemm(transA, transB, alpha, impl::dense_operand(A), impl::dense_operand(B), beta, __C);
+      impl::dense_copy_back(__C, C);
+      return;
+   }
+
+   const size_type rankA = rank(A);
+   const size_type rankB = rank(B);
+   const size_type rankC = rank(C);
+   const size_type K = (rankA+rankB-rankC)/2; assert((rankA+rankB-rankC) % 2 == 0);
+   const size_type M = rankA-K;
+   const size_type N = rankB-K;
+
+   // rows of C are 0, ..., M-1, columns M, ..., M+N-1, the contracted indices follow
+   btas::varray<size_type> aA(rankA), aB(rankB), aC(rankC);
+   for (size_type i = 0; i < M; ++i)
+   {
+      aC[i] = i;
+      aA[transA == CblasNoTrans ? i : K+i] = i;
+   }
+   for (size_type j = 0; j < N; ++j)
+   {
+      aC[M+j] = M+j;
+      aB[transB == CblasNoTrans ? K+j : j] = M+j;
+   }
+   for (size_type k = 0; k < K; ++k)
+   {
+      aA[transA == CblasNoTrans ? M+k : k] = M+N+k;
+      aB[transB == CblasNoTrans ? k : N+k] = M+N+k;
+   }
+   contract(alpha, A, aA, B, aB, beta, C, aC);
+}
+
+/// GEMV of tensors of which some are views, as a contraction (see above)
+template<
+   typename _T,
+   class _TensorA, class _TensorX, class _TensorY
+>
+typename std::enable_if<
+   is_boxtensor<_TensorA>::value &
+   is_boxtensor<_TensorX>::value &
+   is_boxtensor<_TensorY>::value &
+   (is_strided_view<_TensorA>::value | is_strided_view<_TensorX>::value | is_strided_view<_TensorY>::value)
+>::type
+gemv (
+   const CBLAS_TRANSPOSE& transA,
+   const _T& alpha,
+   const _TensorA& A,
+   const _TensorX& X,
+   const _T& beta,
+         _TensorY& Y)
+{
+   if (A.empty() || X.empty())
+   {
+      scal(beta, Y);
+      return;
+   }
+
+   // a contraction cannot conjugate, the views are copied
+   if (transA == CblasConjTrans)
+   {
+      typename std::conditional<is_strided_view<_TensorY>::value, typename impl::dense_type<_TensorY>::type, _TensorY&>::type __Y = Y;
+      gemv(transA, alpha, impl::dense_operand(A), impl::dense_operand(X), beta, __Y);
+      impl::dense_copy_back(__Y, Y);
+      return;
+   }
+
+   // indices of Y are 0, ..., rank(Y)-1, those of X follow
+   const size_type rankX = rank(X);
+   const size_type rankY = rank(A)-rankX;
+   btas::varray<size_type> aA(rankX+rankY), aX(rankX), aY(rankY);
+   for (size_type i = 0; i < rankY; ++i)
+   {
+      aY[i] = i;
+      aA[transA == CblasNoTrans ? i : rankX+i] = i;
+   }
+   for (size_type j = 0; j < rankX; ++j)
+   {
+      aX[j] = rankY+j;
+      aA[transA == CblasNoTrans ? rankY+j : j] = rankY+j;
+   }
+   contract(alpha, A, aA, X, aX, beta, Y, aY);
+}
+
 template<
    typename _T,
    class _TensorA, class _TensorB, class _TensorC,
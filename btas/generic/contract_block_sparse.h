@@ -0,0 +1,138 @@
+#ifndef __BTAS_CONTRACT_BLOCK_SPARSE_H
+#define __BTAS_CONTRACT_BLOCK_SPARSE_H 1
+
+#include <algorithm>
+#include <initializer_list>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+#include <btas/types.h>
+#include <btas/index_traits.h>
+#include <btas/block_sparse_tensor.h>
+#include <btas/generic/scal_impl.h>
+#include <btas/generic/contract.h>
+
+namespace btas {
+
+/// Contracts block-sparse tensors, C = alpha * A * B + beta * C, with the annotations of the dense contract().
+///
+/// Only pairs of stored blocks of A and B whose sectors agree on all contracted indices are multiplied,
+/// each by the dense contract(). A contracted index must have the same sectors in A and B and opposite
+/// directions; Hadamard indices are not supported. If C has no indices, it takes the free indices of
+/// A and B and the flux A.flux() + B.flux(); otherwise these must be what it has.
+template<
+   typename _T,
+   typename _V, typename _Q, class _Tensor,
+   class _AnnotationA, class _AnnotationB, class _AnnotationC,
+   class = typename std::enable_if<
+      is_container<_AnnotationA>::value &
+      is_container<_AnnotationB>::value &
+      is_container<_AnnotationC>::value
+   >::type
+>
+void contract(
+   const _T& alpha,
+   const BlockSparseTensor<_V, _Q, _Tensor>& A, const _AnnotationA& aA,
+   const BlockSparseTensor<_V, _Q, _Tensor>& B, const _AnnotationB& aB,
+   const _T& beta,
+         BlockSparseTensor<_V, _Q, _Tensor>& C, const _AnnotationC& aC)
+{
+   typedef BlockSparseTensor<_V, _Q, _Tensor> tensor_type;
+   typedef typename tensor_type::block_key block_key;
+   assert(A.rank() == static_cast<size_type>(std::distance(std::begin(aA), std::end(aA))));
+   assert(B.rank() == static_cast<size_type>(std::distance(std::begin(aB), std::end(aB))));
+
+   // contracted indices, as positions in A and in B
+   std::vector<size_type> kA, kB;
+   for(auto itrA = std::begin(aA); itrA != std::end(aA); ++itrA)
+   {
+      auto itrB = std::find(std::begin(aB), std::end(aB), *itrA);
+      if(itrB == std::end(aB)) continue;
+      if(std::find(std::begin(aC), std::end(aC), *itrA) != std::end(aC))
+         throw std::logic_error("contract: Hadamard indices of block-sparse tensors are not supported");
+      const size_type pA = std::distance(std::begin(aA), itrA);
+      const size_type pB = std::distance(std::begin(aB), itrB);
+      if(!A.index(pA).same_sectors(B.index(pB)) || A.index(pA).dir() == B.index(pB).dir())
+         throw std::logic_error("contract: contracted indices of block-sparse tensors must have the same sectors and opposite directions");
+      kA.push_back(pA);
+      kB.push_back(pB);
+   }
+
+   // where each index of C comes from: position in A, or in B if fromA is false
+   std::vector<size_type> src;
+   std::vector<bool> fromA;
+   std::vector<typename tensor_type::qn_index_type> indexC;
+   for(auto itrC = std::begin(aC); itrC != std::end(aC); ++itrC)
+   {
+      const size_type pA = std::distance(std::begin(aA), std::find(std::begin(aA), std::end(aA), *itrC));
+      if(pA != A.rank())
+      {
+         src.push_back(pA); fromA.push_back(true); indexC.push_back(A.index(pA));
+         continue;
+      }
+      const size_type pB = std::distance(std::begin(aB), std::find(std::begin(aB), std::end(aB), *itrC));
+      if(pB == B.rank()) throw std::logic_error("contract: index of C is in neither A nor B");
+      src.push_back(pB); fromA.push_back(false); indexC.push_back(B.index(pB));
+   }
+   if(indexC.size() + 2*kA.size() != A.rank() + B.rank())
+      throw std::logic_error("contract: every index of A and B must be contracted or be an index of C");
+
+   const _Q flux = A.flux() + B.flux();
+   if(C.rank() == 0 && C.nblocks() == 0)
+      C = tensor_type(indexC, flux);
+   else if(C.indices() != indexC || !(C.flux() == flux))
+      throw std::logic_error("contract: C does not have the indices and flux of the product of A and B");
+
+   if(beta == static_cast<_T>(0))
+      C.clear();
+   else if(beta != static_cast<_T>(1))
+      for(auto& c : C) scal(beta, c.second);
+
+   // blocks of B by the sectors of their contracted indices
+   std::multimap<block_key, const typename tensor_type::const_iterator::value_type*> blocksB;
+   block_key k(kB.size());
+   for(const auto& b : B)
+   {
+      for(size_type i = 0; i != kB.size(); ++i) k[i] = b.first[kB[i]];
+      blocksB.emplace(k, &b);
+   }
+
+   const _V one = NumericType<_V>::one();
+   block_key keyC(indexC.size());
+   for(const auto& a : A)
+   {
+      for(size_type i = 0; i != kA.size(); ++i) k[i] = a.first[kA[i]];
+      const auto range = blocksB.equal_range(k);
+      for(auto itrB = range.first; itrB != range.second; ++itrB)
+      {
+         const auto& b = *itrB->second;
+         for(size_type c = 0; c != keyC.size(); ++c) keyC[c] = fromA[c] ? a.first[src[c]] : b.first[src[c]];
+         contract(static_cast<_V>(alpha), a.second, aA, b.second, aB, one, C.block(keyC), aC);
+      }
+   }
+}
+
+template<
+   typename _T,
+   typename _V, typename _Q, class _Tensor,
+   typename _UA, typename _UB, typename _UC
+>
+void contract(
+   const _T& alpha,
+   const BlockSparseTensor<_V, _Q, _Tensor>& A, std::initializer_list<_UA> aA,
+   const BlockSparseTensor<_V, _Q, _Tensor>& B, std::initializer_list<_UB> aB,
+   const _T& beta,
+         BlockSparseTensor<_V, _Q, _Tensor>& C, std::initializer_list<_UC> aC)
+{
+    contract(alpha,
+             A, btas::varray<_UA>(aA),
+             B, btas::varray<_UB>(aB),
+             beta,
+             C, btas::varray<_UC>(aC)
+            );
+}
+
+} // namespace btas
+
+#endif // __BTAS_CONTRACT_BLOCK_SPARSE_H
@@ -0,0 +1,251 @@
+#ifndef __BTAS_CONTRACT_DIAGONAL_H
+#define __BTAS_CONTRACT_DIAGONAL_H 1
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#include <btas/types.h>
+#include <btas/index_traits.h>
+#include <btas/tensor_traits.h>
+#include <btas/diagonal_tensor.h>
+#include <btas/generic/numeric_type.h>
+#include <btas/generic/scal_impl.h>
+
+namespace btas {
+
+namespace impl {
+
+/// One loop of a contraction with a diagonal tensor: extent and strides in B, C and the diagonal
+struct diagonal_loop {
+   std::int64_t extent;
+   std::int64_t strideB;
+   std::int64_t strideC;
+   std::int64_t strideD;
+};
+
+/// C = alpha * D * B + beta * C for diagonal D and dense B and C
+///
+/// All indices of D take the same value i, so the indices of B and C that are labeled by D are tied
+/// into a single loop over i, whose strides in B and C are the sums of theirs; every other index of B
+/// must be an index of C. The contraction is then one pass over the elements of B on the diagonal,
+/// each scaled by d(i) and added to C, with no GEMM and no dense D.
+template<typename _T, class _Diagonal, class _TensorB, class _TensorC, class _AnnotationD, class _AnnotationB, class _AnnotationC>
+void contract_diagonal(
+   const _T& alpha,
+   const _Diagonal& D, const _AnnotationD& aD,
+   const _TensorB& B, const _AnnotationB& aB,
+   const _T& beta,
+         _TensorC& C, const _AnnotationC& aC)
+{
+   typedef typename _TensorC::value_type value_type;
+   assert(D.rank() == static_cast<size_type>(std::distance(std::begin(aD), std::end(aD))));
+   const size_type rB = B.rank();
+   const size_type rC = std::distance(std::begin(aC), std::end(aC));
+   auto inD = [&](size_type c) { return std::find(std::begin(aD), std::end(aD), aC[c]) != std::end(aD); };
+
+   // B indices labeled by D must have its extent
+   for(size_type d = 0; d != rB; ++d)
+      if(std::find(std::begin(aD), std::end(aD), aB[d]) != std::end(aD) && B.range().extent(d) != D.extent())
+         throw std::logic_error("contract: index of B and diagonal index have different extents");
+
+   if(C.empty())
+   {
+      std::vector<size_type> extent(rC);
+      for(size_type c = 0; c != rC; ++c)
+      {
+         const size_type pB = std::distance(std::begin(aB), std::find(std::begin(aB), std::end(aB), aC[c]));
+         if(pB != rB)
+            extent[c] = B.range().extent(pB);
+         else if(inD(c))
+            extent[c] = D.extent();
+         else
+            throw std::logic_error("contract: index of C is in neither A nor B");
+      }
+      C.resize(extent);
+      C.fill(NumericType<value_type>::zero());
+   }
+   else
+   {
+      if(C.rank() != rC)
+         throw std::logic_error("contract: C does not have the rank of its annotation");
+      // the strides of C are combined with those of B and the length of the diagonal, so its extents must match
+      for(size_type c = 0; c != rC; ++c)
+      {
+         const size_type pB = std::distance(std::begin(aB), std::find(std::begin(aB), std::end(aB), aC[c]));
+         if(pB == rB && !inD(c))
+            throw std::logic_error("contract: index of C is in neither A nor B");
+         if(inD(c) && C.range().extent(c) != D.extent())
+            throw std::logic_error("contract: index of C and diagonal index have different extents");
+         if(pB != rB && C.range().extent(c) != B.range().extent(pB))
+            throw std::logic_error("contract: index of C and index of B have different extents");
+      }
+      if(beta == static_cast<_T>(0))
+         C.fill(NumericType<value_type>::zero());
+      else if(beta != static_cast<_T>(1))
+         scal(beta, C);
+   }
+
+   const auto& strideB = B.range().ordinal().stride();
+   const auto& strideC = C.range().ordinal().stride();
+
+   // the loop over the diagonal, then one loop per other index of B
+   std::vector<diagonal_loop> loops(1, diagonal_loop{static_cast<std::int64_t>(D.extent()), 0, 0, D.is_identity() ? 0 : 1});
+   for(size_type c = 0; c != rC; ++c)
+      if(inD(c)) loops[0].strideC += strideC[c];
+   for(size_type d = 0; d != rB; ++d)
+   {
+      if(std::find(std::begin(aD), std::end(aD), aB[d]) != std::end(aD))
+      {
+         loops[0].strideB += strideB[d];
+         continue;
+      }
+      const size_type pC = std::distance(std::begin(aC), std::find(std::begin(aC), std::end(aC), aB[d]));
+      if(pC == rC) throw std::logic_error("contract: index of B is in neither A nor C");
+      loops.push_back(diagonal_loop{static_cast<std::int64_t>(B.range().extent(d)), static_cast<std::int64_t>(strideB[d]), static_cast<std::int64_t>(strideC[pC]), 0});
+   }
+   for(const auto& l : loops)
+      if(l.extent == 0) return;
+
+   // innermost loop over the smallest stride of B, to stream through it
+   std::stable_sort(loops.begin(), loops.end(), [](const diagonal_loop& x, const diagonal_loop& y) { return x.strideB > y.strideB; });
+   const diagonal_loop inner = loops.back();
+   loops.pop_back();
+
+   const value_type* b = B.data();
+   value_type* c = C.data();
+   const value_type* dv = D.values().data();
+   const value_type a = static_cast<value_type>(alpha);
+   std::vector<std::int64_t> index(loops.size(), 0);
+   std::int64_t ob = 0, oc = 0, od = 0;
+   while(true)
+   {
+      if(inner.strideD == 0)
+      {
+         const value_type s = a * dv[od];
+         if(inner.strideB == 1 && inner.strideC == 1)
+            for(std::int64_t k = 0; k != inner.extent; ++k) c[oc + k] += s * b[ob + k];
+         else
+            for(std::int64_t k = 0; k != inner.extent; ++k) c[oc + k * inner.strideC] += s * b[ob + k * inner.strideB];
+      }
+      else
+      {
+         for(std::int64_t k = 0; k != inner.extent; ++k)
+            c[oc + k * inner.strideC] += a * dv[od + k] * b[ob + k * inner.strideB];
+      }
+
+      // next element of the outer loops
+      size_type l = loops.size();
+      for(; l != 0; --l)
+      {
+         const diagonal_loop& x = loops[l-1];
+         ob += x.strideB; oc += x.strideC; od += x.strideD;
+         if(++index[l-1] != x.extent) break;
+         ob -= x.extent * x.strideB; oc -= x.extent * x.strideC; od -= x.extent * x.strideD;
+         index[l-1] = 0;
+      }
+      if(l == 0) break;
+   }
+}
+
+} // namespace impl
+
+/// Contracts a diagonal tensor, e.g. a matrix of singular values or a scaled identity, with a dense one,
+/// C = alpha * D * B + beta * C, with the annotations of the dense contract()
+///
+/// This costs one pass over the elements of B, i.e. it is a scaling of the indices of B labeled by D
+/// (a scaled copy for an identity), and neither D nor a permuted B is made. Indices of D may also be
+/// indices of C (Hadamard indices) or of neither, which sums over them.
+/// B and C must have contiguous storage. If C is empty, it takes the extents of its indices in D and B.
+template<
+   typename _T,
+   typename _V, class _TensorB, class _TensorC,
+   class _AnnotationD, class _AnnotationB, class _AnnotationC,
+   class = typename std::enable_if<
+      has_data<_TensorB>::value &
+      has_data<_TensorC>::value &
+      is_container<_AnnotationD>::value &
+      is_container<_AnnotationB>::value &
+      is_container<_AnnotationC>::value
+   >::type
+>
+void contract(
+   const _T& alpha,
+   const DiagonalTensor<_V>& D, const _AnnotationD& aD,
+   const _TensorB& B, const _AnnotationB& aB,
+   const _T& beta,
+         _TensorC& C, const _AnnotationC& aC)
+{
+   impl::contract_diagonal(alpha, D, aD, B, aB, beta, C, aC);
+}
+
+/// Contracts a dense tensor with a diagonal one, C = alpha * A * D + beta * C, see above
+template<
+   typename _T,
+   class _TensorA, typename _V, class _TensorC,
+   class _AnnotationA, class _AnnotationD, class _AnnotationC,
+   class = typename std::enable_if<
+      has_data<_TensorA>::value &
+      has_data<_TensorC>::value &
+      is_container<_AnnotationA>::value &
+      is_container<_AnnotationD>::value &
+      is_container<_AnnotationC>::value
+   >::type
+>
+void contract(
+   const _T& alpha,
+   const _TensorA& A, const _AnnotationA& aA,
+   const DiagonalTensor<_V>& D, const _AnnotationD& aD,
+   const _T& beta,
+         _TensorC& C, const _AnnotationC& aC)
+{
+   impl::contract_diagonal(alpha, D, aD, A, aA, beta, C, aC);
+}
+
+template<
+   typename _T,
+   typename _V, class _TensorB, class _TensorC,
+   typename _UD, typename _UB, typename _UC
+>
+void contract(
+   const _T& alpha,
+   const DiagonalTensor<_V>& D, std::initializer_list<_UD> aD,
+   const _TensorB& B, std::initializer_list<_UB> aB,
+   const _T& beta,
+         _TensorC& C, std::initializer_list<_UC> aC)
+{
+    contract(alpha,
+             D, btas::varray<_UD>(aD),
+             B, btas::varray<_UB>(aB),
+             beta,
+             C, btas::varray<_UC>(aC)
+            );
+}
+
+template<
+   typename _T,
+   class _TensorA, typename _V, class _TensorC,
+   typename _UA, typename _UD, typename _UC
+>
+void contract(
+   const _T& alpha,
+   const _TensorA& A, std::initializer_list<_UA> aA,
+   const DiagonalTensor<_V>& D, std::initializer_list<_UD> aD,
+   const _T& beta,
+         _TensorC& C, std::initializer_list<_UC> aC)
+{
+    contract(alpha,
+             A, btas::varray<_UA>(aA),
+             D, btas::varray<_UD>(aD),
+             beta,
+             C, btas::varray<_UC>(aC)
+            );
+}
+
+} // namespace btas
+
+#endif // __BTAS_CONTRACT_DIAGONAL_H
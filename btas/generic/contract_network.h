@@ -0,0 +1,447 @@
+#ifndef __BTAS_CONTRACT_NETWORK_H
+#define __BTAS_CONTRACT_NETWORK_H 1
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <btas/types.h>
+#include <btas/tensor_traits.h>
+#include <btas/varray/varray.h>
+
+#include <btas/generic/scal_impl.h>
+#include <btas/generic/axpy_impl.h>
+#include <btas/generic/permute.h>
+#include <btas/generic/contract.h>
+
+namespace btas {
+
+/// Pairwise contraction order of a tensor network
+///
+/// Operands are numbered in order of appearance: the n input tensors are 0 ... n-1,
+/// and the intermediate produced by step s is n+s. The last step produces the result.
+struct contraction_path
+{
+   /// operands contracted by each step
+   std::vector<std::pair<size_t, size_t>> steps;
+   /// multiply-adds summed over all steps
+   double flops = 0;
+   /// number of elements of the largest intermediate, not counting the result
+   double peak_size = 0;
+};
+
+/// how contraction_path is searched for
+enum contraction_path_method
+{
+   path_auto,    ///< optimal up to path_optimal_max_tensors tensors, greedy beyond
+   path_optimal, ///< dynamic programming over all subsets of tensors, minimizes flops
+   path_greedy   ///< repeatedly contracts the pair whose result grows the least
+};
+
+/// largest network searched exhaustively by path_auto
+const size_t path_optimal_max_tensors = 10;
+
+namespace impl {
+
+/// Index sets of a tensor network as bit masks over the distinct indices
+struct network_indices
+{
+   std::vector<uint64_t> tensor; //!< indices of each input tensor
+   uint64_t output = 0;          //!< indices of the result
+   std::vector<double> extent;   //!< extent of each distinct index
+
+   /// \return number of elements of a tensor with indices m
+   double size (uint64_t m) const
+   {
+      double s = 1;
+      for (size_t i = 0; m; ++i, m >>= 1)
+         if (m & 1) s *= extent[i];
+      return s;
+   }
+};
+
+/// Maps the annotations of a network on bit masks and checks that every index either
+/// connects two tensors or connects one tensor to the result
+template<class _Extents, class _Annotation>
+network_indices make_network_indices (
+   const std::vector<_Extents>& extents,
+   const std::vector<_Annotation>& annotations,
+   const _Annotation& aC)
+{
+   typedef typename std::decay<decltype(*std::begin(aC))>::type label_type;
+   std::vector<label_type> labels;
+   network_indices net;
+   auto id = [&](const label_type& x) -> size_t
+   {
+      const size_t i = std::distance(labels.begin(), std::find(labels.begin(), labels.end(), x));
+      if (i == labels.size())
+      {
+         labels.push_back(x);
+         net.extent.push_back(0);
+      }
+      assert(labels.size() <= 64);
+      return i;
+   };
+
+   std::vector<size_t> count;
+   for (size_t t = 0; t < annotations.size(); ++t)
+   {
+      uint64_t m = 0;
+      auto ext = std::begin(extents[t]);
+      for (auto x = std::begin(annotations[t]); x != std::end(annotations[t]); ++x, ++ext)
+      {
+         const size_t i = id(*x);
+         assert(net.extent[i] == 0 || net.extent[i] == *ext);
+         net.extent[i] = *ext;
+         m |= (uint64_t(1) << i);
+         count.resize(labels.size(), 0);
+         ++count[i];
+      }
+      net.tensor.push_back(m);
+   }
+   for (auto x = std::begin(aC); x != std::end(aC); ++x)
+   {
+      const size_t i = id(*x);
+      assert(i < count.size());
+      net.output |= (uint64_t(1) << i);
+      ++count[i];
+   }
+   for (size_t i = 0; i < count.size(); ++i)
+   {
+      // an index shared by more than two tensors, or summed over within a single tensor, is not supported
+      assert(count[i] == 2);
+   }
+   return net;
+}
+
+/// Optimal order by dynamic programming over subsets of tensors, O(3^n)
+/// intermediates larger than memory_limit elements (if nonzero) are not considered
+inline contraction_path optimal_contraction_path (const network_indices& net, const double& memory_limit)
+{
+   const size_t n = net.tensor.size();
+   const uint64_t full = (uint64_t(1) << n) - 1;
+   const double inf = std::numeric_limits<double>::infinity();
+
+   std::vector<uint64_t> idx(full+1, 0);
+   for (uint64_t s = 1; s <= full; ++s)
+   {
+      const uint64_t low = s & (~s+1);
+      size_t t = 0;
+      while ((uint64_t(1) << t) != low) ++t;
+      idx[s] = idx[s ^ low] | net.tensor[t];
+   }
+   // indices of the intermediate of subset s: those still shared with the rest of the network or the result
+   auto kept = [&](const uint64_t& s) { return idx[s] & (idx[full ^ s] | net.output); };
+
+   std::vector<double> cost(full+1, inf), peak(full+1, 0);
+   std::vector<uint64_t> split(full+1, 0);
+   for (size_t t = 0; t < n; ++t) cost[uint64_t(1) << t] = 0;
+
+   for (uint64_t s = 1; s <= full; ++s)
+   {
+      if ((s & (s-1)) == 0) continue;
+      const double size = net.size(kept(s));
+      if (s != full && memory_limit > 0 && size > memory_limit) continue;
+      // each unordered split once: the lowest tensor of s stays in s1
+      const uint64_t low = s & (~s+1);
+      for (uint64_t s1 = (s-1) & s; s1; s1 = (s1-1) & s)
+      {
+         if (!(s1 & low)) continue;
+         const uint64_t s2 = s ^ s1;
+         if (cost[s1] == inf || cost[s2] == inf) continue;
+         const double c = cost[s1] + cost[s2] + net.size(kept(s1) | kept(s2));
+         const double p = std::max(std::max(peak[s1], peak[s2]), s == full ? 0 : size);
+         if (c < cost[s] || (c == cost[s] && p < peak[s]))
+         {
+            cost[s] = c;
+            peak[s] = p;
+            split[s] = s1;
+         }
+      }
+   }
+
+   contraction_path path;
+   if (cost[full] == inf) return path;
+   path.flops = cost[full];
+   path.peak_size = peak[full];
+
+   // emit steps children first, numbering intermediates in order of creation
+   std::function<size_t(uint64_t)> emit = [&](const uint64_t& s) -> size_t
+   {
+      if ((s & (s-1)) == 0)
+      {
+         size_t t = 0;
+         while ((uint64_t(1) << t) != s) ++t;
+         return t;
+      }
+      const size_t a = emit(split[s]);
+      const size_t b = emit(s ^ split[s]);
+      path.steps.push_back(std::make_pair(a, b));
+      return n + path.steps.size() - 1;
+   };
+   if (n > 1) emit(full);
+   return path;
+}
+
+/// Greedy order: contracts the pair of operands sharing an index whose result grows the least
+/// (result size minus operand sizes), ties broken by flops; outer products only when nothing is shared
+inline contraction_path greedy_contraction_path (const network_indices& net, const double& memory_limit)
+{
+   const size_t n = net.tensor.size();
+   std::vector<std::pair<size_t, uint64_t>> live;
+   for (size_t t = 0; t < n; ++t) live.push_back(std::make_pair(t, net.tensor[t]));
+
+   contraction_path path;
+   while (live.size() > 1)
+   {
+      size_t ba = 0, bb = 1;
+      bool bshared = false, bfits = false;
+      double bcost = 0, bflops = 0;
+      uint64_t bmask = 0;
+      for (size_t a = 0; a < live.size(); ++a)
+      for (size_t b = a+1; b < live.size(); ++b)
+      {
+         uint64_t rest = net.output;
+         for (size_t c = 0; c < live.size(); ++c)
+            if (c != a && c != b) rest |= live[c].second;
+         const uint64_t ma = live[a].second, mb = live[b].second;
+         const uint64_t mask = (ma | mb) & rest;
+         const bool shared = (ma & mb) != 0;
+         const double size = net.size(mask);
+         const bool fits = live.size() == 2 || memory_limit <= 0 || size <= memory_limit;
+         const double cost = size - net.size(ma) - net.size(mb);
+         const double flops = net.size(ma | mb);
+         const bool better = (a == 0 && b == 1) ||
+            std::make_tuple(fits, shared, -cost, -flops) > std::make_tuple(bfits, bshared, -bcost, -bflops);
+         if (better)
+         {
+            ba = a; bb = b; bshared = shared; bfits = fits; bcost = cost; bflops = flops; bmask = mask;
+         }
+      }
+      path.steps.push_back(std::make_pair(live[ba].first, live[bb].first));
+      path.flops += bflops;
+      if (live.size() > 2) path.peak_size = std::max(path.peak_size, net.size(bmask));
+      live.erase(live.begin()+bb);
+      live[ba] = std::make_pair(n + path.steps.size() - 1, bmask);
+   }
+   return path;
+}
+
+} // namespace impl
+
+/// Finds a pairwise contraction order of the network C(aC) = prod_t tensor_t(annotations_t)
+/// \param extents extents of each tensor, in the order of its annotation
+/// \param memory_limit largest allowed intermediate in elements, 0 for no limit
+template<class _Extents, class _Annotation>
+contraction_path find_contraction_path (
+   const std::vector<_Extents>& extents,
+   const std::vector<_Annotation>& annotations,
+   const _Annotation& aC,
+   const contraction_path_method& method = path_auto,
+   const double& memory_limit = 0)
+{
+   assert(extents.size() == annotations.size() && !extents.empty());
+   const impl::network_indices net = impl::make_network_indices(extents, annotations, aC);
+   const bool optimal = method == path_optimal || (method == path_auto && extents.size() <= path_optimal_max_tensors);
+   if (optimal)
+   {
+      contraction_path path = impl::optimal_contraction_path(net, memory_limit);
+      // no order satisfies the memory limit
+      if (extents.size() > 1 && path.steps.empty()) path = impl::greedy_contraction_path(net, memory_limit);
+      return path;
+   }
+   return impl::greedy_contraction_path(net, memory_limit);
+}
+
+/// contract a network of tensors along a given path, C(aC) = alpha * prod_t tensor_t(annotations_t) + beta * C(aC)
+///
+/// Each step keeps the indices of its first operand, then those of its second, that are still needed;
+/// intermediates are stored in buffers that are reused once their operands are consumed.
+template<
+   typename _T,
+   class _Tensor,
+   class _Annotation,
+   class = typename std::enable_if<is_boxtensor<_Tensor>::value && is_container<_Annotation>::value>::type
+>
+void contract_network (
+   const _T& alpha,
+   const std::vector<const _Tensor*>& tensors,
+   const std::vector<_Annotation>& annotations,
+   const _T& beta,
+         _Tensor& C, const _Annotation& aC,
+   const contraction_path& path)
+{
+   typedef typename _Tensor::value_type value_type;
+   const size_t n = tensors.size();
+   assert(n == annotations.size() && n > 0 && path.steps.size() == n-1);
+
+   if (n == 1)
+   {
+      if (C.empty())
+      {
+         permute(*tensors[0], annotations[0], C, aC);
+         scal(static_cast<value_type>(alpha), C);
+      }
+      else
+      {
+         _Tensor T;
+         permute(*tensors[0], annotations[0], T, aC);
+         scal(static_cast<value_type>(beta), C);
+         axpy(static_cast<value_type>(alpha), T, C);
+      }
+      return;
+   }
+
+   // operands by number, and the buffer each intermediate lives in
+   std::vector<const _Tensor*> operand(tensors);
+   std::vector<_Annotation> annotation(annotations);
+   std::vector<long> owner(n, -1);
+
+   std::vector<std::unique_ptr<_Tensor>> buffer;
+   std::vector<size_t> capacity;
+   std::vector<size_t> free;
+
+   for (size_t s = 0; s < path.steps.size(); ++s)
+   {
+      const size_t a = path.steps[s].first;
+      const size_t b = path.steps[s].second;
+      assert(a < operand.size() && b < operand.size() && operand[a] && operand[b]);
+      const _Tensor& X = *operand[a];
+      const _Tensor& Y = *operand[b];
+      const _Annotation& aX = annotation[a];
+      const _Annotation& aY = annotation[b];
+
+      if (s+1 == path.steps.size())
+      {
+         contract(alpha, X, aX, Y, aY, beta, C, aC);
+         break;
+      }
+
+      // indices of X and Y still needed by the remaining operands or the result
+      auto needed = [&](const typename std::decay<decltype(*std::begin(aX))>::type& x)
+      {
+         if (std::find(std::begin(aC), std::end(aC), x) != std::end(aC)) return true;
+         for (size_t o = 0; o < operand.size(); ++o)
+            if (o != a && o != b && operand[o] && std::find(std::begin(annotation[o]), std::end(annotation[o]), x) != std::end(annotation[o])) return true;
+         return false;
+      };
+      btas::varray<size_t> extZ;
+      std::vector<typename std::decay<decltype(*std::begin(aX))>::type> labels;
+      const auto extX = extent(X);
+      const auto extY = extent(Y);
+      for (auto x = std::begin(aX); x != std::end(aX); ++x)
+         if (needed(*x)) labels.push_back(*x);
+      for (auto y = std::begin(aY); y != std::end(aY); ++y)
+         if (needed(*y) && std::find(std::begin(aX), std::end(aX), *y) == std::end(aX)) labels.push_back(*y);
+      _Annotation aZ(labels.size());
+      std::copy(labels.begin(), labels.end(), std::begin(aZ));
+      resize(extZ, labels.size());
+      size_t volume = 1;
+      for (size_t i = 0; i < labels.size(); ++i)
+      {
+         auto x = std::find(std::begin(aX), std::end(aX), labels[i]);
+         extZ[i] = (x != std::end(aX)) ? extX[std::distance(std::begin(aX), x)]
+                                       : extY[std::distance(std::begin(aY), std::find(std::begin(aY), std::end(aY), labels[i]))];
+         volume *= extZ[i];
+      }
+
+      // smallest free buffer that is large enough, otherwise the largest one, otherwise a new one
+      long pick = -1;
+      for (size_t f = 0; f < free.size(); ++f)
+      {
+         const size_t c = capacity[free[f]];
+         if (pick < 0) { pick = f; continue; }
+         const size_t cp = capacity[free[pick]];
+         if (c >= volume ? (cp < volume || c < cp) : (cp < volume && c > cp)) pick = f;
+      }
+      size_t z;
+      if (pick >= 0)
+      {
+         z = free[pick];
+         free.erase(free.begin()+pick);
+      }
+      else
+      {
+         z = buffer.size();
+         buffer.emplace_back(new _Tensor());
+         capacity.push_back(0);
+      }
+      _Tensor& Z = *buffer[z];
+      Z.resize(extZ);
+      capacity[z] = std::max(capacity[z], volume);
+
+      // beta = 0 overwrites whatever a reused buffer holds
+      contract(NumericType<value_type>::one(), X, aX, Y, aY, NumericType<value_type>::zero(), Z, aZ);
+
+      // X and Y are consumed
+      for (size_t o : {a, b})
+      {
+         if (owner[o] >= 0) free.push_back(owner[o]);
+         operand[o] = nullptr;
+      }
+      operand.push_back(&Z);
+      annotation.push_back(aZ);
+      owner.push_back(z);
+   }
+}
+
+/// contract a network of tensors, C(aC) = alpha * prod_t tensor_t(annotations_t) + beta * C(aC),
+/// along a contraction order found by find_contraction_path
+template<
+   typename _T,
+   class _Tensor,
+   class _Annotation,
+   class = typename std::enable_if<is_boxtensor<_Tensor>::value && is_container<_Annotation>::value>::type
+>
+void contract_network (
+   const _T& alpha,
+   const std::vector<const _Tensor*>& tensors,
+   const std::vector<_Annotation>& annotations,
+   const _T& beta,
+         _Tensor& C, const _Annotation& aC,
+   const contraction_path_method& method = path_auto,
+   const double& memory_limit = 0)
+{
+   std::vector<decltype(extent(*tensors[0]))> extents;
+   for (auto t : tensors) extents.push_back(extent(*t));
+   contract_network(alpha, tensors, annotations, beta, C, aC, find_contraction_path(extents, annotations, aC, method, memory_limit));
+}
+
+/// contract a network of tensors; for example, for Dil = \sum_{j,k} Aij * Bjk * Ckl
+///
+/// enum {i,j,k,l};
+///
+/// contract_network(1.0, {&A, &B, &C}, {{i,j}, {j,k}, {k,l}}, 0.0, D, {i,l});
+///
+template<
+   typename _T,
+   class _Tensor,
+   typename _U,
+   class = typename std::enable_if<is_boxtensor<_Tensor>::value>::type
+>
+void contract_network (
+   const _T& alpha,
+   std::initializer_list<const _Tensor*> tensors,
+   std::initializer_list<std::initializer_list<_U>> annotations,
+   const _T& beta,
+         _Tensor& C, std::initializer_list<_U> aC,
+   const contraction_path_method& method = path_auto,
+   const double& memory_limit = 0)
+{
+   std::vector<btas::varray<_U>> a;
+   for (auto x : annotations) a.push_back(btas::varray<_U>(x));
+   contract_network(alpha, std::vector<const _Tensor*>(tensors), a, beta, C, btas::varray<_U>(aC), method, memory_limit);
+}
+
+} // namespace btas
+
+#endif // __BTAS_CONTRACT_NETWORK_H
@@ -0,0 +1,425 @@
+#ifndef __BTAS_CONTRACT_SPARSE_H
+#define __BTAS_CONTRACT_SPARSE_H 1
+
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <btas/types.h>
+#include <btas/index_traits.h>
+#include <btas/sparse_tensor.h>
+#include <btas/generic/numeric_type.h>
+#include <btas/generic/scal_impl.h>
+
+namespace btas {
+
+namespace impl {
+
+/// position of \c label in annotation \c a , the size of \c a if it is not there
+template<class _Annotation, typename _Label>
+size_type annotation_position(const _Annotation& a, const _Label& label)
+{
+   return std::distance(std::begin(a), std::find(std::begin(a), std::end(a), label));
+}
+
+/// Maps the ordinals of the elements of a contiguous range to weighted sums of their local coordinates,
+/// \f$ \sum_d (i_d - lobound_d) \, w_d \f$; with the strides of another tensor as weights this is the offset
+/// of the matching element there
+class ordinal_remap {
+public:
+   template<class _Range>
+   ordinal_remap(const _Range& range, const std::vector<std::int64_t>& weight) : weight_(weight)
+   {
+      const auto& stride = range.ordinal().stride();
+      for(size_type d = 0; d != weight_.size(); ++d)
+      {
+         stride_.push_back(stride[d]);
+         extent_.push_back(range.extent(d));
+      }
+   }
+
+   std::int64_t operator() (std::int64_t o) const
+   {
+      std::int64_t r = 0;
+      for(size_type d = 0; d != weight_.size(); ++d)
+         if(weight_[d] != 0) r += (o / stride_[d]) % extent_[d] * weight_[d];
+      return r;
+   }
+
+private:
+   std::vector<std::int64_t> stride_;
+   std::vector<std::int64_t> extent_;
+   std::vector<std::int64_t> weight_;
+};
+
+/// Sets up the dense result of a sparse contraction: if it is empty, resizes it to the extents of its
+/// indices in \c A or \c B and zeroes it, otherwise checks its rank and extents and scales it by \c beta
+template<typename _T, class _TensorA, class _TensorB, class _TensorC, class _AnnotationA, class _AnnotationB, class _AnnotationC>
+void contract_sparse_init(
+   const _TensorA& A, const _AnnotationA& aA,
+   const _TensorB& B, const _AnnotationB& aB,
+   const _T& beta,
+         _TensorC& C, const _AnnotationC& aC)
+{
+   typedef typename _TensorC::value_type value_type;
+   if(C.empty())
+   {
+      std::vector<size_type> extent;
+      for(auto itrC = std::begin(aC); itrC != std::end(aC); ++itrC)
+      {
+         const size_type pA = annotation_position(aA, *itrC);
+         const size_type pB = annotation_position(aB, *itrC);
+         if(pA != A.rank())
+            extent.push_back(A.range().extent(pA));
+         else if(pB != B.rank())
+            extent.push_back(B.range().extent(pB));
+         else
+            throw std::logic_error("contract: index of C is in neither A nor B");
+      }
+      C.resize(extent);
+      C.fill(NumericType<value_type>::zero());
+   }
+   else
+   {
+      if(C.rank() != static_cast<size_type>(std::distance(std::begin(aC), std::end(aC))))
+         throw std::logic_error("contract: C does not have the rank of its annotation");
+      size_type c = 0;
+      for(auto itrC = std::begin(aC); itrC != std::end(aC); ++itrC, ++c)
+      {
+         const size_type pA = annotation_position(aA, *itrC);
+         const size_type pB = annotation_position(aB, *itrC);
+         if(pA == A.rank() && pB == B.rank())
+            throw std::logic_error("contract: index of C is in neither A nor B");
+         if((pA != A.rank() && C.range().extent(c) != A.range().extent(pA)) ||
+            (pB != B.rank() && C.range().extent(c) != B.range().extent(pB)))
+            throw std::logic_error("contract: index of C has a different extent in A or B");
+      }
+      if(beta == static_cast<_T>(0))
+         C.fill(NumericType<value_type>::zero());
+      else if(beta != static_cast<_T>(1))
+         scal(beta, C);
+   }
+}
+
+/// C = alpha * A * B + C for sparse A and dense B and C, in O(nnz(A) * (elements of B per contracted index))
+///
+/// Each nonzero of A adds a multiple of the slice of B at its contracted indices to the slice of C at its
+/// free indices, the offsets of both slices are found by remapping its ordinal with the strides of B and C.
+template<typename _T, class _SparseA, class _TensorB, class _TensorC, class _AnnotationA, class _AnnotationB, class _AnnotationC>
+void contract_sparse_dense(
+   const _T& alpha,
+   const _SparseA& A, const _AnnotationA& aA,
+   const _TensorB& B, const _AnnotationB& aB,
+         _TensorC& C, const _AnnotationC& aC)
+{
+   typedef typename _TensorC::value_type value_type;
+   const size_type rA = A.rank();
+   const size_type rB = B.rank();
+   const size_type rC = C.rank();
+   const auto& strideB = B.range().ordinal().stride();
+   const auto& strideC = C.range().ordinal().stride();
+
+   // each index of A addresses B if it is contracted, C if it is free, and both if it is a Hadamard index
+   std::vector<std::int64_t> wB(rA, 0), wC(rA, 0);
+   for(size_type d = 0; d != rA; ++d)
+   {
+      const size_type pB = annotation_position(aB, aA[d]);
+      const size_type pC = annotation_position(aC, aA[d]);
+      if(pB == rB && pC == rC) throw std::logic_error("contract: index of A is in neither B nor C");
+      if(pB != rB) wB[d] = strideB[pB];
+      if(pC != rC) wC[d] = strideC[pC];
+   }
+
+   // offsets in B and C of the elements of the slice over the indices of B that are not in A
+   std::vector<std::int64_t> offB(1, 0), offC(1, 0);
+   for(size_type d = 0; d != rB; ++d)
+   {
+      if(annotation_position(aA, aB[d]) != rA) continue;
+      const size_type pC = annotation_position(aC, aB[d]);
+      if(pC == rC) throw std::logic_error("contract: index of B is in neither A nor C");
+      const size_type n = offB.size();
+      const std::int64_t extent = B.range().extent(d);
+      offB.resize(n * extent);
+      offC.resize(n * extent);
+      for(std::int64_t i = extent - 1; i >= 0; --i)
+         for(size_type j = 0; j != n; ++j)
+         {
+            offB[i * n + j] = offB[j] + i * strideB[d];
+            offC[i * n + j] = offC[j] + i * strideC[pC];
+         }
+   }
+   // visit the slice in the storage order of B, then check if it is contiguous in both B and C
+   const size_type nslice = offB.size();
+   std::vector<std::pair<std::int64_t, std::int64_t>> off(nslice);
+   for(size_type j = 0; j != nslice; ++j) off[j] = std::make_pair(offB[j], offC[j]);
+   std::sort(off.begin(), off.end());
+   bool unit = true;
+   for(size_type j = 0; j != nslice; ++j)
+   {
+      offB[j] = off[j].first;
+      offC[j] = off[j].second;
+      unit = unit && offB[j] == static_cast<std::int64_t>(j) && offC[j] == static_cast<std::int64_t>(j);
+   }
+
+   const ordinal_remap toB(A.range(), wB), toC(A.range(), wC);
+   const value_type* b = B.data();
+   value_type* c = C.data();
+   for(size_type n = 0; n != A.nnz(); ++n)
+   {
+      const value_type a = static_cast<value_type>(alpha) * A.value(n);
+      const value_type* bn = b + toB(A.ordinal(n));
+      value_type* cn = c + toC(A.ordinal(n));
+      if(unit)
+      {
+         for(size_type j = 0; j != nslice; ++j) cn[j] += a * bn[j];
+      }
+      else
+      {
+         for(size_type j = 0; j != nslice; ++j) cn[offC[j]] += a * bn[offB[j]];
+      }
+   }
+}
+
+} // namespace impl
+
+/// Contracts an element-sparse tensor with a dense one, C = alpha * A * B + beta * C,
+/// with the annotations of the dense contract()
+///
+/// The cost is proportional to the number of nonzeros of A times the number of elements of B
+/// per value of the indices it shares with A, independent of the zeros of A.
+/// B and C must have contiguous storage. If C is empty, it takes the extents of its indices in A and B.
+template<
+   typename _T,
+   typename _V, class _Range, class _TensorB, class _TensorC,
+   class _AnnotationA, class _AnnotationB, class _AnnotationC,
+   class = typename std::enable_if<
+      has_data<_TensorB>::value &
+      has_data<_TensorC>::value &
+      is_container<_AnnotationA>::value &
+      is_container<_AnnotationB>::value &
+      is_container<_AnnotationC>::value
+   >::type
+>
+void contract(
+   const _T& alpha,
+   const SparseTensor<_V, _Range>& A, const _AnnotationA& aA,
+   const _TensorB& B, const _AnnotationB& aB,
+   const _T& beta,
+         _TensorC& C, const _AnnotationC& aC)
+{
+   impl::contract_sparse_init(A, aA, B, aB, beta, C, aC);
+   impl::contract_sparse_dense(alpha, A, aA, B, aB, C, aC);
+}
+
+/// Contracts a dense tensor with an element-sparse one, C = alpha * A * B + beta * C, see above
+template<
+   typename _T,
+   class _TensorA, typename _V, class _Range, class _TensorC,
+   class _AnnotationA, class _AnnotationB, class _AnnotationC,
+   class = typename std::enable_if<
+      has_data<_TensorA>::value &
+      has_data<_TensorC>::value &
+      is_container<_AnnotationA>::value &
+      is_container<_AnnotationB>::value &
+      is_container<_AnnotationC>::value
+   >::type
+>
+void contract(
+   const _T& alpha,
+   const _TensorA& A, const _AnnotationA& aA,
+   const SparseTensor<_V, _Range>& B, const _AnnotationB& aB,
+   const _T& beta,
+         _TensorC& C, const _AnnotationC& aC)
+{
+   impl::contract_sparse_init(A, aA, B, aB, beta, C, aC);
+   impl::contract_sparse_dense(alpha, B, aB, A, aA, C, aC);
+}
+
+/// Contracts element-sparse tensors, C = alpha * A * B + beta * C, with the annotations of the dense contract()
+///
+/// The nonzeros of B are sorted by their contracted indices, then each nonzero of A is multiplied by those
+/// of B with the same contracted indices: the cost is proportional to the number of such pairs.
+/// If C has rank 0, it takes the extents of its indices in A and B; the result is compressed.
+template<
+   typename _T,
+   typename _V, class _Range,
+   class _AnnotationA, class _AnnotationB, class _AnnotationC,
+   class = typename std::enable_if<
+      is_container<_AnnotationA>::value &
+      is_container<_AnnotationB>::value &
+      is_container<_AnnotationC>::value
+   >::type
+>
+void contract(
+   const _T& alpha,
+   const SparseTensor<_V, _Range>& A, const _AnnotationA& aA,
+   const SparseTensor<_V, _Range>& B, const _AnnotationB& aB,
+   const _T& beta,
+         SparseTensor<_V, _Range>& C, const _AnnotationC& aC)
+{
+   typedef SparseTensor<_V, _Range> tensor_type;
+   typedef typename tensor_type::ordinal_type ordinal_type;
+   const size_type rA = A.rank();
+   const size_type rB = B.rank();
+   const size_type rC = std::distance(std::begin(aC), std::end(aC));
+
+   if(C.rank() == 0 && rC != 0)
+   {
+      std::vector<size_type> extent;
+      for(auto itrC = std::begin(aC); itrC != std::end(aC); ++itrC)
+      {
+         const size_type pA = impl::annotation_position(aA, *itrC);
+         const size_type pB = impl::annotation_position(aB, *itrC);
+         if(pA != rA)
+            extent.push_back(A.range().extent(pA));
+         else if(pB != rB)
+            extent.push_back(B.range().extent(pB));
+         else
+            throw std::logic_error("contract: index of C is in neither A nor B");
+      }
+      C = tensor_type(_Range(extent));
+   }
+   else
+   {
+      if(C.rank() != rC)
+         throw std::logic_error("contract: C does not have the rank of its annotation");
+      size_type c = 0;
+      for(auto itrC = std::begin(aC); itrC != std::end(aC); ++itrC, ++c)
+      {
+         const size_type pA = impl::annotation_position(aA, *itrC);
+         const size_type pB = impl::annotation_position(aB, *itrC);
+         if(pA == rA && pB == rB)
+            throw std::logic_error("contract: index of C is in neither A nor B");
+         if((pA != rA && C.range().extent(c) != A.range().extent(pA)) ||
+            (pB != rB && C.range().extent(c) != B.range().extent(pB)))
+            throw std::logic_error("contract: index of C has a different extent in A or B");
+      }
+   }
+   const auto& strideC = C.range().ordinal().stride();
+
+   // key: the contracted indices of a nonzero, numbered in the order of A; free and Hadamard
+   // indices map to C, a Hadamard index through A only
+   std::vector<std::int64_t> kA(rA, 0), kB(rB, 0), cA(rA, 0), cB(rB, 0);
+   std::int64_t nkey = 1;
+   for(size_type d = 0; d != rA; ++d)
+   {
+      const size_type pB = impl::annotation_position(aB, aA[d]);
+      const size_type pC = impl::annotation_position(aC, aA[d]);
+      if(pB == rB && pC == rC) throw std::logic_error("contract: index of A is in neither B nor C");
+      if(pC != rC) cA[d] = strideC[pC];
+      if(pB != rB)
+      {
+         if(A.range().extent(d) != B.range().extent(pB))
+            throw std::logic_error("contract: contracted indices of A and B have different extents");
+         kA[d] = nkey;
+         kB[pB] = nkey;
+         nkey *= A.range().extent(d);
+      }
+   }
+   for(size_type d = 0; d != rB; ++d)
+   {
+      if(impl::annotation_position(aA, aB[d]) != rA) continue;
+      const size_type pC = impl::annotation_position(aC, aB[d]);
+      if(pC == rC) throw std::logic_error("contract: index of B is in neither A nor C");
+      cB[d] = strideC[pC];
+   }
+
+   const impl::ordinal_remap keyA(A.range(), kA), keyB(B.range(), kB), toCA(A.range(), cA), toCB(B.range(), cB);
+
+   // (key, offset in C, value) of the nonzeros of B, sorted by key
+   struct entry { std::int64_t key; ordinal_type c; _V v; };
+   std::vector<entry> entriesB;
+   entriesB.reserve(B.nnz());
+   for(size_type n = 0; n != B.nnz(); ++n)
+      entriesB.push_back(entry{keyB(B.ordinal(n)), toCB(B.ordinal(n)), B.value(n)});
+   std::sort(entriesB.begin(), entriesB.end(), [](const entry& x, const entry& y) { return x.key < y.key; });
+
+   std::unordered_map<ordinal_type, _V> acc;
+   if(beta != static_cast<_T>(0))
+      for(size_type n = 0; n != C.nnz(); ++n)
+         acc[C.ordinal(n)] += static_cast<_V>(beta) * C.value(n);
+
+   for(size_type n = 0; n != A.nnz(); ++n)
+   {
+      const std::int64_t key = keyA(A.ordinal(n));
+      const ordinal_type c = toCA(A.ordinal(n));
+      const _V a = static_cast<_V>(alpha) * A.value(n);
+      auto first = std::lower_bound(entriesB.begin(), entriesB.end(), key,
+                                    [](const entry& x, std::int64_t k) { return x.key < k; });
+      for(; first != entriesB.end() && first->key == key; ++first)
+         acc[c + first->c] += a * first->v;
+   }
+
+   C.clear();
+   for(const auto& x : acc) C.insert_ordinal(x.first, x.second);
+   C.compress();
+}
+
+template<
+   typename _T,
+   typename _V, class _Range, class _TensorB, class _TensorC,
+   typename _UA, typename _UB, typename _UC
+>
+void contract(
+   const _T& alpha,
+   const SparseTensor<_V, _Range>& A, std::initializer_list<_UA> aA,
+   const _TensorB& B, std::initializer_list<_UB> aB,
+   const _T& beta,
+         _TensorC& C, std::initializer_list<_UC> aC)
+{
+    contract(alpha,
+             A, btas::varray<_UA>(aA),
+             B, btas::varray<_UB>(aB),
+             beta,
+             C, btas::varray<_UC>(aC)
+            );
+}
+
+template<
+   typename _T,
+   class _TensorA, typename _V, class _Range, class _TensorC,
+   typename _UA, typename _UB, typename _UC
+>
+void contract(
+   const _T& alpha,
+   const _TensorA& A, std::initializer_list<_UA> aA,
+   const SparseTensor<_V, _Range>& B, std::initializer_list<_UB> aB,
+   const _T& beta,
+         _TensorC& C, std::initializer_list<_UC> aC)
+{
+    contract(alpha,
+             A, btas::varray<_UA>(aA),
+             B, btas::varray<_UB>(aB),
+             beta,
+             C, btas::varray<_UC>(aC)
+            );
+}
+
+template<
+   typename _T,
+   typename _V, class _Range,
+   typename _UA, typename _UB, typename _UC
+>
+void contract(
+   const _T& alpha,
+   const SparseTensor<_V, _Range>& A, std::initializer_list<_UA> aA,
+   const SparseTensor<_V, _Range>& B, std::initializer_list<_UB> aB,
+   const _T& beta,
+         SparseTensor<_V, _Range>& C, std::initializer_list<_UC> aC)
+{
+    contract(alpha,
+             A, btas::varray<_UA>(aA),
+             B, btas::varray<_UB>(aB),
+             beta,
+             C, btas::varray<_UC>(aC)
+            );
+}
+
+} // namespace btas
+
+#endif // __BTAS_CONTRACT_SPARSE_H
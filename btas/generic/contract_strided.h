@@ -0,0 +1,453 @@
+#ifndef __BTAS_CONTRACT_STRIDED_H
+#define __BTAS_CONTRACT_STRIDED_H 1
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#include <btas/types.h>
+#include <btas/tensor_traits.h>
+#include <btas/generic/numeric_type.h>
+#include <btas/generic/gemm_impl.h>
+#include <btas/generic/gemm_batch.h>
+#include <btas/generic/strided_view.h>
+#include <btas/util/parallel.h>
+
+namespace btas {
+
+namespace impl {
+
+/// Contraction C = alpha * A * B + beta * C mapped onto row-major GEMMs addressing A, B and C in place,
+/// possibly looped over free indices that cannot be fused into the GEMM dimensions
+struct strided_gemm_plan
+{
+   /// if true, the GEMM computes C^T = B^T * A^T, i.e. the roles of A and B are exchanged
+   bool swap;
+   CBLAS_TRANSPOSE transA;
+   CBLAS_TRANSPOSE transB;
+   unsigned long M, N, K;
+   unsigned long LDA, LDB, LDC;
+   /// extents of the loop indices and their strides in A, B and C
+   std::vector<unsigned long> loop_extent;
+   std::vector<long> loop_strideA;
+   std::vector<long> loop_strideB;
+   std::vector<long> loop_strideC;
+   /// extents of the contracted loop indices and their strides in A and B, summed into the same C
+   std::vector<unsigned long> sum_extent;
+   std::vector<long> sum_strideA;
+   std::vector<long> sum_strideB;
+};
+
+/// below this many multiply-adds per GEMM, looping over small GEMMs costs more than permuting the operands
+const unsigned long strided_gemm_min_volume = 4096;
+
+/// Fuses a group of indices of one tensor into a single dimension
+/// \param pos positions of the group's indices in the tensor, slowest first
+/// \return false if the indices are not laid out as one block with a single stride
+template<class _Extent, class _Stride>
+bool fuse_index_group (
+   const std::vector<size_t>& pos,
+   const _Extent& extent,
+   const _Stride& stride,
+   unsigned long& size,
+   long& st)
+{
+   size = 1;
+   st = 0;
+   for (auto p = pos.rbegin(); p != pos.rend(); ++p)
+   {
+      const unsigned long e = extent[*p];
+      const long s = stride[*p];
+      if (e == 1) continue;
+      if (s <= 0) return false;
+      if (size == 1)
+         st = s;
+      else if (s != st*static_cast<long>(size))
+         return false;
+      size *= e;
+   }
+   return true;
+}
+
+/// Orders an index group slowest first in the tensor that fixes the layout of its fused dimension,
+/// whatever the storage order; the positions of the same indices in the other tensor follow
+template<class _Stride>
+void sort_index_group (
+   std::vector<size_t>& pos,
+   std::vector<size_t>& other,
+   const _Stride& stride)
+{
+   std::vector<size_t> order(pos.size());
+   for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+   std::stable_sort(order.begin(), order.end(), [&](const size_t& x, const size_t& y)
+   {
+      return std::labs(stride[pos[x]]) > std::labs(stride[pos[y]]);
+   });
+   std::vector<size_t> p(pos), o(other);
+   for (size_t i = 0; i < order.size(); ++i)
+   {
+      pos[i]   = p[order[i]];
+      other[i] = o[order[i]];
+   }
+}
+
+/// Finds the transpose flag and leading dimension of a (rows x cols) row-major GEMM operand,
+/// element (r, c) being at r * srow + c * scol
+inline bool strided_gemm_operand (
+   const unsigned long& rows,
+   const unsigned long& cols,
+   const long& srow,
+   const long& scol,
+   CBLAS_TRANSPOSE& trans,
+   unsigned long& ld)
+{
+   if (cols == 1 || scol == 1)
+   {
+      trans = CblasNoTrans;
+      ld = (rows == 1) ? std::max(cols, 1ul) : srow;
+      if (ld >= std::max(cols, 1ul)) return true;
+   }
+   if (rows == 1 || srow == 1)
+   {
+      trans = CblasTrans;
+      ld = (cols == 1) ? std::max(rows, 1ul) : scol;
+      if (ld >= std::max(rows, 1ul)) return true;
+   }
+   return false;
+}
+
+/// Builds a strided_gemm_plan for C(aC) = A(aA) * B(aB)
+/// free indices of A and B are fused in the order of their strides in C, contracted indices in the order of their strides in A;
+/// the slowest free and contracted indices are peeled off into loops until the rest can be fused,
+/// Hadamard indices (those of A, B and C alike) are always looped over
+/// \param min_volume smallest GEMM (M*N*K) worth looping over, rather than permuting the operands
+/// \return false if the contraction cannot be done without permuting (or if it is not worth it)
+template<class _ExtentA, class _StrideA, class _AnnotationA,
+         class _ExtentB, class _StrideB, class _AnnotationB,
+         class _ExtentC, class _StrideC, class _AnnotationC>
+bool make_strided_gemm_plan (
+   const _ExtentA& extA, const _StrideA& strA, const _AnnotationA& aA,
+   const _ExtentB& extB, const _StrideB& strB, const _AnnotationB& aB,
+   const _ExtentC& extC, const _StrideC& strC, const _AnnotationC& aC,
+   strided_gemm_plan& plan,
+   const unsigned long& min_volume = strided_gemm_min_volume)
+{
+   const size_t rA = std::distance(std::begin(aA), std::end(aA));
+   const size_t rB = std::distance(std::begin(aB), std::end(aB));
+   const size_t rC = std::distance(std::begin(aC), std::end(aC));
+
+   // positions of the index groups in each tensor
+   std::vector<size_t> mA, mC, nB, nC, kA, kB, hA, hB, hC;
+   for (size_t c = 0; c < rC; ++c)
+   {
+      const auto x = *(std::begin(aC)+c);
+      const size_t a = std::distance(std::begin(aA), std::find(std::begin(aA), std::end(aA), x));
+      const size_t b = std::distance(std::begin(aB), std::find(std::begin(aB), std::end(aB), x));
+      if (a < rA && b < rB) { hA.push_back(a); hB.push_back(b); hC.push_back(c); }
+      else if (a < rA) { mA.push_back(a); mC.push_back(c); }
+      else if (b < rB) { nB.push_back(b); nC.push_back(c); }
+      else return false;
+   }
+   for (size_t a = 0; a < rA; ++a)
+   {
+      const auto x = *(std::begin(aA)+a);
+      if (std::find(std::begin(aC), std::end(aC), x) != std::end(aC)) continue;
+      const size_t b = std::distance(std::begin(aB), std::find(std::begin(aB), std::end(aB), x));
+      if (b == rB) return false; // index to be summed over A alone
+      kA.push_back(a);
+      kB.push_back(b);
+   }
+   if (hA.size() + mA.size() + kA.size() != rA || hB.size() + nB.size() + kB.size() != rB) return false;
+   sort_index_group(mC, mA, strC);
+   sort_index_group(nC, nB, strC);
+   sort_index_group(kA, kB, strA);
+
+   // peel the fewest leading indices of each group that leave fusible groups
+   unsigned long K = 1;
+   long skA = 0, skB = 0;
+   size_t pk = 0;
+   for (; pk <= kA.size(); ++pk)
+   {
+      unsigned long Kb;
+      const std::vector<size_t> ia(kA.begin()+pk, kA.end()), ib(kB.begin()+pk, kB.end());
+      if (fuse_index_group(ia, extA, strA, K, skA) && fuse_index_group(ib, extB, strB, Kb, skB)) break;
+   }
+
+   unsigned long M = 1, N = 1;
+   long smA = 0, smC = 0, snB = 0, snC = 0;
+   size_t pm = 0, pn = 0;
+   for (; pm <= mA.size(); ++pm)
+   {
+      unsigned long Mc;
+      const std::vector<size_t> ia(mA.begin()+pm, mA.end()), ic(mC.begin()+pm, mC.end());
+      if (fuse_index_group(ia, extA, strA, M, smA) && fuse_index_group(ic, extC, strC, Mc, smC)) break;
+   }
+   for (; pn <= nB.size(); ++pn)
+   {
+      unsigned long Nc;
+      const std::vector<size_t> ib(nB.begin()+pn, nB.end()), ic(nC.begin()+pn, nC.end());
+      if (fuse_index_group(ib, extB, strB, N, snB) && fuse_index_group(ic, extC, strC, Nc, snC)) break;
+   }
+
+   // Hadamard indices are always looped over, they make a batch of GEMMs
+   plan.loop_extent.clear();
+   plan.loop_strideA.clear();
+   plan.loop_strideB.clear();
+   plan.loop_strideC.clear();
+   for (size_t i = 0; i < hC.size(); ++i)
+   {
+      plan.loop_extent.push_back(extC[hC[i]]);
+      plan.loop_strideA.push_back(strA[hA[i]]);
+      plan.loop_strideB.push_back(strB[hB[i]]);
+      plan.loop_strideC.push_back(strC[hC[i]]);
+   }
+   unsigned long nloop = 1;
+   for (size_t i = 0; i < pm; ++i)
+   {
+      plan.loop_extent.push_back(extA[mA[i]]);
+      plan.loop_strideA.push_back(strA[mA[i]]);
+      plan.loop_strideB.push_back(0);
+      plan.loop_strideC.push_back(strC[mC[i]]);
+      nloop *= extA[mA[i]];
+   }
+   for (size_t i = 0; i < pn; ++i)
+   {
+      plan.loop_extent.push_back(extB[nB[i]]);
+      plan.loop_strideA.push_back(0);
+      plan.loop_strideB.push_back(strB[nB[i]]);
+      plan.loop_strideC.push_back(strC[nC[i]]);
+      nloop *= extB[nB[i]];
+   }
+
+   plan.sum_extent.clear();
+   plan.sum_strideA.clear();
+   plan.sum_strideB.clear();
+   for (size_t i = 0; i < pk; ++i)
+   {
+      plan.sum_extent.push_back(extA[kA[i]]);
+      plan.sum_strideA.push_back(strA[kA[i]]);
+      plan.sum_strideB.push_back(strB[kB[i]]);
+      nloop *= extA[kA[i]];
+   }
+   if (nloop > 1 && M*N*K < min_volume) return false;
+
+   // C is either row-major in (M,N), or row-major in (N,M) in which case C^T = B^T * A^T is computed
+   CBLAS_TRANSPOSE tC;
+   if (!strided_gemm_operand(M, N, smC, snC, tC, plan.LDC)) return false;
+   plan.swap = (tC != CblasNoTrans);
+   if (!plan.swap)
+   {
+      plan.M = M; plan.N = N; plan.K = K;
+      return strided_gemm_operand(M, K, smA, skA, plan.transA, plan.LDA) &&
+             strided_gemm_operand(K, N, skB, snB, plan.transB, plan.LDB);
+   }
+   else
+   {
+      plan.M = N; plan.N = M; plan.K = K;
+      return strided_gemm_operand(N, K, snB, skB, plan.transA, plan.LDA) &&
+             strided_gemm_operand(K, M, skA, smA, plan.transB, plan.LDB);
+   }
+}
+
+/// Runs a strided_gemm_plan on pointers to the first elements of A, B and C
+/// if there are at least as many GEMMs in the loop as threads, the loop is split between threads,
+/// otherwise the GEMMs are called one after the other and each is threaded;
+/// the GEMMs of the contracted loop write to the same C and always run one after the other
+template<typename _T>
+void strided_gemm (
+   const strided_gemm_plan& plan,
+   const _T& alpha,
+   const _T* A,
+   const _T* B,
+   const _T& beta,
+         _T* C)
+{
+   const size_t nl = plan.loop_extent.size();
+   unsigned long nloop = 1;
+   for (size_t l = 0; l < nl; ++l) nloop *= plan.loop_extent[l];
+   const size_t ns = plan.sum_extent.size();
+   unsigned long nsum = 1;
+   for (size_t l = 0; l < ns; ++l) nsum *= plan.sum_extent[l];
+
+   // a single loop with uniform strides is a batched GEMM
+   if (nl == 1 && ns == 0)
+   {
+      if (!plan.swap)
+         gemm_batch(CblasRowMajor, plan.transA, plan.transB, plan.M, plan.N, plan.K,
+                    alpha, A, plan.LDA, plan.loop_strideA[0], B, plan.LDB, plan.loop_strideB[0],
+                    beta, C, plan.LDC, plan.loop_strideC[0], nloop);
+      else
+         gemm_batch(CblasRowMajor, plan.transA, plan.transB, plan.M, plan.N, plan.K,
+                    alpha, B, plan.LDA, plan.loop_strideB[0], A, plan.LDB, plan.loop_strideA[0],
+                    beta, C, plan.LDC, plan.loop_strideC[0], nloop);
+      return;
+   }
+
+   // GEMMs [first, last) of the loop, in the order of the loop indices
+   auto gemms = [&](unsigned long first, unsigned long last)
+   {
+      std::vector<unsigned long> idx(nl, 0);
+      long oA = 0, oB = 0, oC = 0;
+      for (long l = static_cast<long>(nl)-1, r = first; l >= 0; --l)
+      {
+         idx[l] = r % plan.loop_extent[l];
+         r /= plan.loop_extent[l];
+         oA += plan.loop_strideA[l]*static_cast<long>(idx[l]);
+         oB += plan.loop_strideB[l]*static_cast<long>(idx[l]);
+         oC += plan.loop_strideC[l]*static_cast<long>(idx[l]);
+      }
+      std::vector<unsigned long> sdx(ns, 0);
+      for (unsigned long i = first; i < last; ++i)
+      {
+         long sA = 0, sB = 0;
+         for (unsigned long j = 0; j < nsum; ++j)
+         {
+            const _T b = (j == 0) ? beta : NumericType<_T>::one();
+            if (!plan.swap)
+               gemm_sized(plan.transA, plan.transB, plan.M, plan.N, plan.K,
+                          alpha, A+oA+sA, plan.LDA, B+oB+sB, plan.LDB, b, C+oC, plan.LDC);
+            else
+               gemm_sized(plan.transA, plan.transB, plan.M, plan.N, plan.K,
+                          alpha, B+oB+sB, plan.LDA, A+oA+sA, plan.LDB, b, C+oC, plan.LDC);
+
+            for (long l = static_cast<long>(ns)-1; l >= 0; --l)
+            {
+               sA += plan.sum_strideA[l];
+               sB += plan.sum_strideB[l];
+               if (++sdx[l] < plan.sum_extent[l]) break;
+               const long e = plan.sum_extent[l];
+               sA -= plan.sum_strideA[l]*e;
+               sB -= plan.sum_strideB[l]*e;
+               sdx[l] = 0;
+            }
+         }
+
+         for (long l = static_cast<long>(nl)-1; l >= 0; --l)
+         {
+            oA += plan.loop_strideA[l];
+            oB += plan.loop_strideB[l];
+            oC += plan.loop_strideC[l];
+            if (++idx[l] < plan.loop_extent[l]) break;
+            const long e = plan.loop_extent[l];
+            oA -= plan.loop_strideA[l]*e;
+            oB -= plan.loop_strideB[l]*e;
+            oC -= plan.loop_strideC[l]*e;
+            idx[l] = 0;
+         }
+      }
+   };
+
+   if (nloop >= parallel_width() && gemm_sized_loop_parallel(plan.M*plan.N*plan.K))
+      parallel_for(nloop, 1, gemms);
+   else
+      gemms(0, nloop);
+}
+
+} // namespace impl
+
+/// test whether a contraction of these tensors can be done in place by strided GEMMs,
+/// i.e. all three are Tensors or views of Tensors (see has_strided_data) of the same float, double or complex type
+template<class _TensorA, class _TensorB, class _TensorC>
+struct is_contract_strided_call {
+   static constexpr const bool value =
+      has_strided_data<_TensorA>::value && has_strided_data<_TensorB>::value && has_strided_data<_TensorC>::value &&
+      std::is_same<typename _TensorA::value_type, typename _TensorB::value_type>::value &&
+      std::is_same<typename _TensorA::value_type, typename _TensorC::value_type>::value &&
+      is_gemm_blocked_type<typename _TensorA::value_type>::value;
+};
+
+/// Contracts without permuting A, B or C if the index groups allow it
+template<bool _Strided> struct contract_strided_dispatch
+{
+   template<typename _T, class _TensorA, class _AnnotationA, class _TensorB, class _AnnotationB, class _TensorC, class _AnnotationC>
+   static bool call (
+      const _T&, const _TensorA&, const _AnnotationA&, const _TensorB&, const _AnnotationB&,
+      const _T&, _TensorC&, const _AnnotationC&)
+   {
+      return false;
+   }
+};
+
+template<> struct contract_strided_dispatch<true>
+{
+   /// A, B and C are addressed through the strides of their ranges, so they may be views (e.g. slices) as well,
+   /// which are then contracted without copying; C is made from A and B if it is empty, unless it is a view
+   template<typename _T, class _TensorA, class _AnnotationA, class _TensorB, class _AnnotationB, class _TensorC, class _AnnotationC>
+   static bool call (
+      const _T& alpha,
+      const _TensorA& A, const _AnnotationA& aA,
+      const _TensorB& B, const _AnnotationB& aB,
+      const _T& beta,
+            _TensorC& C, const _AnnotationC& aC)
+   {
+      typedef typename _TensorC::value_type value_type;
+      if (aC.size() == 0) return false;
+
+      impl::strided_gemm_plan plan;
+
+      const auto extA = extent(A);
+      const auto extB = extent(B);
+
+      if (C.empty())
+      {
+         if (!make_result(A, aA, B, aB, C, aC, plan, std::integral_constant<bool, has_data<_TensorC>::value>())) return false;
+      }
+      else if (!impl::make_strided_gemm_plan(extA, A.range().ordinal().stride(), aA,
+                                             extB, B.range().ordinal().stride(), aB,
+                                             extent(C), C.range().ordinal().stride(), aC, plan)) return false;
+
+      if (C.size() == 0) return true;
+      impl::strided_gemm(plan, static_cast<value_type>(alpha), strided_data(A), strided_data(B), static_cast<value_type>(beta), strided_data(C));
+      return true;
+   }
+
+private:
+
+   /// shape of C from A and B
+   template<class _TensorA, class _AnnotationA, class _TensorB, class _AnnotationB, class _TensorC, class _AnnotationC>
+   static bool make_result (
+      const _TensorA& A, const _AnnotationA& aA,
+      const _TensorB& B, const _AnnotationB& aB,
+            _TensorC& C, const _AnnotationC& aC,
+      impl::strided_gemm_plan& plan,
+      std::true_type)
+   {
+      typedef typename _TensorC::value_type value_type;
+      const auto extA = extent(A);
+      const auto extB = extent(B);
+      btas::varray<size_t> extC(aC.size());
+      for (size_t c = 0; c < aC.size(); ++c)
+      {
+         const auto x = *(std::begin(aC)+c);
+         auto a = std::find(std::begin(aA), std::end(aA), x);
+         if (a != std::end(aA))
+            extC[c] = extA[std::distance(std::begin(aA), a)];
+         else
+            extC[c] = extB[std::distance(std::begin(aB), std::find(std::begin(aB), std::end(aB), x))];
+      }
+      _TensorC Ctmp;
+      Ctmp.resize(extC);
+      if (!impl::make_strided_gemm_plan(extA, A.range().ordinal().stride(), aA,
+                                        extB, B.range().ordinal().stride(), aB,
+                                        extC, Ctmp.range().ordinal().stride(), aC, plan)) return false;
+      std::fill(Ctmp.data(), Ctmp.data()+Ctmp.size(), NumericType<value_type>::zero());
+      C = std::move(Ctmp);
+      return true;
+   }
+
+   /// a view cannot be resized
+   template<class _TensorA, class _AnnotationA, class _TensorB, class _AnnotationB, class _TensorC, class _AnnotationC>
+   static bool make_result (
+      const _TensorA&, const _AnnotationA&, const _TensorB&, const _AnnotationB&, _TensorC&, const _AnnotationC&,
+      impl::strided_gemm_plan&, std::false_type)
+   {
+      return false;
+   }
+};
+
+} // namespace btas
+
+#endif // __BTAS_CONTRACT_STRIDED_H
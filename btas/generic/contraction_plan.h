@@ -0,0 +1,353 @@
+#ifndef __BTAS_CONTRACTION_PLAN_H
+#define __BTAS_CONTRACTION_PLAN_H 1
+
+#include <algorithm>
+#include <cassert>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include <btas/types.h>
+#include <btas/tensor_traits.h>
+#include <btas/varray/varray.h>
+
+#include <btas/generic/numeric_type.h>
+#include <btas/generic/transpose.h>
+#include <btas/generic/contract_strided.h>
+#include <btas/generic/contract.h>
+
+namespace btas {
+
+/// Precomputed contraction C = alpha * A * B + beta * C for fixed annotations and shapes
+///
+/// Synopsis:
+/// enum {i,j,k,l};
+///
+/// ContractionPlan<Tensor<double>> plan(A, {i,k,l}, B, {l,j,k}, {i,j});
+/// for (...) plan(1.0, A, B, 0.0, C);
+///
+/// The constructor classifies the indices once, decides which of A, B and C are permuted
+/// (the cheapest choice that leaves the contraction to strided GEMMs, see contract_strided.h)
+/// and allocates the workspace of the permuted operands. Executing the plan then costs the
+/// transposes of those operands and the GEMM calls only.
+///
+/// Tensors passed to operator() must have the extents and the layout of the tensors the plan was
+/// built from; C may also be empty, in which case it is resized.
+/// A plan owns its workspace, so one plan must not be executed by several threads at once.
+///
+/// Tensors that cannot be addressed by pointer, or of types without a blocked GEMM, are contracted
+/// by contract() on each call.
+template<class _TensorA, class _TensorB = _TensorA, class _TensorC = _TensorA>
+class ContractionPlan
+{
+public:
+
+   typedef typename _TensorC::value_type value_type;
+
+   typedef std::vector<size_t> extent_type;
+
+   ContractionPlan () : strided_(false), permuteA_(false), permuteB_(false), permuteC_(false) { }
+
+   template<class _AnnotationA, class _AnnotationB, class _AnnotationC,
+            class = typename std::enable_if<
+               is_container<_AnnotationA>::value &
+               is_container<_AnnotationB>::value &
+               is_container<_AnnotationC>::value
+            >::type>
+   ContractionPlan (
+      const _TensorA& A, const _AnnotationA& aA,
+      const _TensorB& B, const _AnnotationB& aB,
+                         const _AnnotationC& aC)
+   : strided_(false), permuteA_(false), permuteB_(false), permuteC_(false)
+   {
+      init(A, aA, B, aB, aC);
+   }
+
+   template<typename _UA, typename _UB, typename _UC>
+   ContractionPlan (
+      const _TensorA& A, std::initializer_list<_UA> aA,
+      const _TensorB& B, std::initializer_list<_UB> aB,
+                         std::initializer_list<_UC> aC)
+   : strided_(false), permuteA_(false), permuteB_(false), permuteC_(false)
+   {
+      init(A, btas::varray<_UA>(aA), B, btas::varray<_UB>(aB), btas::varray<_UC>(aC));
+   }
+
+   /// C = alpha * A * B + beta * C
+   template<typename _T>
+   void operator() (
+      const _T& alpha,
+      const _TensorA& A,
+      const _TensorB& B,
+      const _T& beta,
+            _TensorC& C)
+   {
+      assert(std::equal(std::begin(extA_), std::end(extA_), std::begin(extent(A))));
+      assert(std::equal(std::begin(extB_), std::end(extB_), std::begin(extent(B))));
+      execute(alpha, A, B, beta, C, std::integral_constant<bool, is_contract_strided_call<_TensorA, _TensorB, _TensorC>::value>());
+   }
+
+   /// \return extents of C, in the order of its annotation
+   const extent_type& extent_C () const { return extC_; }
+
+   /// \return true if executing the plan calls strided GEMMs, false if it calls contract()
+   bool strided () const { return strided_; }
+
+   /// \return true if A is permuted into the workspace before the GEMMs
+   bool permutes_A () const { return permuteA_; }
+
+   /// \return true if B is permuted into the workspace before the GEMMs
+   bool permutes_B () const { return permuteB_; }
+
+   /// \return true if the GEMMs write to the workspace, which is permuted into C afterwards
+   bool permutes_C () const { return permuteC_; }
+
+private:
+
+   /// operand of the strided GEMMs, either the tensor itself or its permuted copy in the workspace
+   struct operand
+   {
+      extent_type extent;        //!< extents in the order of the annotation
+      std::vector<long> stride;  //!< strides in the order of the annotation
+      extent_type annotation;    //!< index ids
+   };
+
+   template<class _AnnotationA, class _AnnotationB, class _AnnotationC>
+   void init (
+      const _TensorA& A, const _AnnotationA& aA,
+      const _TensorB& B, const _AnnotationB& aB,
+                         const _AnnotationC& aC)
+   {
+      const size_t rA = std::distance(std::begin(aA), std::end(aA));
+      const size_t rB = std::distance(std::begin(aB), std::end(aB));
+      const size_t rC = std::distance(std::begin(aC), std::end(aC));
+
+      // number the indices in order of appearance in A then B
+      typedef typename std::decay<decltype(*std::begin(aA))>::type label_type;
+      std::vector<label_type> labels(std::begin(aA), std::end(aA));
+      for (auto b = std::begin(aB); b != std::end(aB); ++b)
+         if (std::find(labels.begin(), labels.end(), *b) == labels.end()) labels.push_back(*b);
+      auto id = [&](const label_type& x) -> size_t
+      {
+         return std::distance(labels.begin(), std::find(labels.begin(), labels.end(), x));
+      };
+
+      aA_.resize(rA);
+      aB_.resize(rB);
+      aC_.resize(rC);
+      std::transform(std::begin(aA), std::end(aA), aA_.begin(), id);
+      std::transform(std::begin(aB), std::end(aB), aB_.begin(), id);
+      std::transform(std::begin(aC), std::end(aC), aC_.begin(), id);
+      assert(distinct(aA_) && distinct(aB_) && distinct(aC_));
+
+      extA_.resize(rA);
+      extB_.resize(rB);
+      extC_.resize(rC);
+      const auto eA = extent(A);
+      const auto eB = extent(B);
+      std::copy(std::begin(eA), std::end(eA), extA_.begin());
+      std::copy(std::begin(eB), std::end(eB), extB_.begin());
+
+      // index ids -> extents, and canonical orders (M, K) x (K, N) -> (M, N),
+      // the free indices M and N in the order of C and the contracted indices K in the order of A
+      std::vector<size_t> ext(labels.size());
+      std::vector<int> where(labels.size(), 0); // bit 0 : in A, bit 1 : in B, bit 2 : in C
+      for (size_t a = 0; a < rA; ++a) { ext[aA_[a]] = extA_[a]; where[aA_[a]] |= 1; }
+      for (size_t b = 0; b < rB; ++b) { assert(!(where[aB_[b]] & 1) || ext[aB_[b]] == extB_[b]); ext[aB_[b]] = extB_[b]; where[aB_[b]] |= 2; }
+      for (size_t c = 0; c < rC; ++c)
+      {
+         assert(aC_[c] < labels.size()); // index of C must appear in A or B
+         extC_[c] = ext[aC_[c]];
+         where[aC_[c]] |= 4;
+      }
+
+      extent_type cA, cB, cC;
+      for (size_t c = 0; c < rC; ++c) if (where[aC_[c]] == 5) { cA.push_back(aC_[c]); cC.push_back(aC_[c]); }
+      for (size_t a = 0; a < rA; ++a) if (where[aA_[a]] == 3) { cA.push_back(aA_[a]); cB.push_back(aA_[a]); }
+      for (size_t c = 0; c < rC; ++c) if (where[aC_[c]] == 6) { cB.push_back(aC_[c]); cC.push_back(aC_[c]); }
+      // every index is either free in one operand or contracted between A and B (no Hadamard or trace indices)
+      assert(cA.size() == rA && cB.size() == rB && cC.size() == rC);
+
+      plan(A, B, ext, cA, cB, cC, std::integral_constant<bool, is_contract_strided_call<_TensorA, _TensorB, _TensorC>::value>());
+   }
+
+   static bool distinct (extent_type x)
+   {
+      std::sort(x.begin(), x.end());
+      return std::adjacent_find(x.begin(), x.end()) == x.end();
+   }
+
+   template<class _Range>
+   static operand make_operand (const _Range& r, const extent_type& extX, const extent_type& aX)
+   {
+      operand op;
+      op.extent = extX;
+      op.annotation = aX;
+      const auto& s = r.ordinal().stride();
+      op.stride.assign(std::begin(s), std::end(s));
+      return op;
+   }
+
+   /// X in the canonical order cX, laid out as a default tensor of that shape
+   template<class _Tensor>
+   static operand make_permuted (const std::vector<size_t>& ext, const extent_type& cX)
+   {
+      extent_type e(cX.size());
+      for (size_t i = 0; i < cX.size(); ++i) e[i] = ext[cX[i]];
+      return make_operand(typename _Tensor::range_type(e), e, cX);
+   }
+
+   static double volume (const extent_type& e)
+   {
+      double v = 1;
+      for (auto x : e) v *= x;
+      return v;
+   }
+
+   /// strides of X (annotated aX) in the order of the annotation cX
+   static std::vector<long> permuted_stride (const operand& X, const extent_type& cX)
+   {
+      std::vector<long> s(cX.size());
+      for (size_t i = 0; i < cX.size(); ++i)
+         s[i] = X.stride[std::distance(X.annotation.begin(), std::find(X.annotation.begin(), X.annotation.end(), cX[i]))];
+      return s;
+   }
+
+   /// chooses the operands to permute, strided tensors
+   void plan (
+      const _TensorA& A, const _TensorB& B, const std::vector<size_t>& ext,
+      const extent_type& cA, const extent_type& cB, const extent_type& cC, std::true_type)
+   {
+      if (aC_.size() == 0) return;
+
+      const operand oA = make_operand(A.range(), extA_, aA_);
+      const operand oB = make_operand(B.range(), extB_, aB_);
+      const operand oC = make_operand(typename _TensorC::range_type(extC_), extC_, aC_);
+      const operand pA = make_permuted<_TensorA>(ext, cA);
+      const operand pB = make_permuted<_TensorB>(ext, cB);
+      const operand pC = make_permuted<_TensorC>(ext, cC);
+
+      // try every subset of {A, B, C} to permute, C counting twice as it is permuted there and back
+      double best = std::numeric_limits<double>::max();
+      int choice = -1;
+      for (int mask = 0; mask < 8; ++mask)
+      {
+         const double cost = ((mask & 1) ? volume(extA_) : 0.0) + ((mask & 2) ? volume(extB_) : 0.0) + ((mask & 4) ? 2.0*volume(extC_) : 0.0);
+         if (cost >= best) continue;
+         const operand& xA = (mask & 1) ? pA : oA;
+         const operand& xB = (mask & 2) ? pB : oB;
+         const operand& xC = (mask & 4) ? pC : oC;
+         impl::strided_gemm_plan p;
+         if (impl::make_strided_gemm_plan(xA.extent, xA.stride, xA.annotation,
+                                          xB.extent, xB.stride, xB.annotation,
+                                          xC.extent, xC.stride, xC.annotation, p))
+         {
+            best = cost;
+            choice = mask;
+            gemm_ = p;
+         }
+      }
+      if (choice < 0) return;
+
+      strided_ = true;
+      permuteA_ = choice & 1;
+      permuteB_ = choice & 2;
+      permuteC_ = choice & 4;
+      if (permuteA_) { workA_.resize(pA.extent); pextA_ = pA.extent; pstrA_ = permuted_stride(oA, cA); wstrA_ = pA.stride; }
+      if (permuteB_) { workB_.resize(pB.extent); pextB_ = pB.extent; pstrB_ = permuted_stride(oB, cB); wstrB_ = pB.stride; }
+      if (permuteC_) { workC_.resize(pC.extent); pextC_ = pC.extent; pstrC_ = permuted_stride(oC, cC); wstrC_ = pC.stride; }
+   }
+
+   /// tensors without pointer access are left to contract()
+   void plan (
+      const _TensorA&, const _TensorB&, const std::vector<size_t>&,
+      const extent_type&, const extent_type&, const extent_type&, std::false_type)
+   { }
+
+   template<typename _T>
+   void execute (
+      const _T& alpha,
+      const _TensorA& A,
+      const _TensorB& B,
+      const _T& beta,
+            _TensorC& C,
+      std::true_type)
+   {
+      if (!strided_)
+      {
+         contract(alpha, A, aA_, B, aB_, beta, C, aC_);
+         return;
+      }
+
+      if (C.empty())
+      {
+         C.resize(extC_);
+         std::fill(C.data(), C.data()+C.size(), NumericType<value_type>::zero());
+      }
+      assert(std::equal(std::begin(extC_), std::end(extC_), std::begin(extent(C))));
+      if (C.size() == 0) return;
+
+      const value_type* a = A.data();
+      const value_type* b = B.data();
+            value_type* c = C.data();
+      if (permuteA_)
+      {
+         impl::transpose(pextA_, a, pstrA_, workA_.data(), wstrA_);
+         a = workA_.data();
+      }
+      if (permuteB_)
+      {
+         impl::transpose(pextB_, b, pstrB_, workB_.data(), wstrB_);
+         b = workB_.data();
+      }
+      if (permuteC_)
+      {
+         if (beta != NumericType<_T>::zero()) impl::transpose(pextC_, c, pstrC_, workC_.data(), wstrC_);
+         c = workC_.data();
+      }
+
+      impl::strided_gemm(gemm_, static_cast<value_type>(alpha), a, b, static_cast<value_type>(beta), c);
+
+      if (permuteC_)
+      {
+         impl::transpose(pextC_, const_cast<const value_type*>(c), wstrC_, C.data(), pstrC_);
+      }
+   }
+
+   template<typename _T>
+   void execute (
+      const _T& alpha,
+      const _TensorA& A,
+      const _TensorB& B,
+      const _T& beta,
+            _TensorC& C,
+      std::false_type)
+   {
+      contract(alpha, A, aA_, B, aB_, beta, C, aC_);
+   }
+
+   bool strided_;  //!< true if the contraction is done by gemm_
+   bool permuteA_;
+   bool permuteB_;
+   bool permuteC_;
+
+   extent_type aA_, aB_, aC_;    //!< annotations, as ids of the indices
+   extent_type extA_, extB_, extC_;
+
+   impl::strided_gemm_plan gemm_;
+
+   /// permuted operands : extents in canonical order, strides of the tensor and of the workspace in that order
+   extent_type pextA_, pextB_, pextC_;
+   std::vector<long> pstrA_, pstrB_, pstrC_;
+   std::vector<long> wstrA_, wstrB_, wstrC_;
+
+   _TensorA workA_;
+   _TensorB workB_;
+   _TensorC workC_;
+};
+
+} // namespace btas
+
+#endif // __BTAS_CONTRACTION_PLAN_H
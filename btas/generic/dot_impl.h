@@ -10,6 +10,8 @@
 
 #include <btas/generic/numeric_type.h>
 #include <btas/generic/tensor_iterator_wrapper.h>
+#include <btas/generic/simd.h>
+#include <btas/util/parallel.h>
 
 namespace btas {
 
@@ -26,6 +28,8 @@ template<> struct __dot_result_type<std::complex<float>> { typedef std::complex<
 
 template<> struct __dot_result_type<std::complex<double>> { typedef std::complex<double> type; };
 
+template<class _Format> struct __dot_result_type<reduced_float<_Format>> { typedef float type; };
+
 //  ================================================================================================
 
 /// Dot with conjugation for general case
@@ -81,6 +85,7 @@ struct dotc_impl<float>
 #ifdef _HAS_CBLAS
       return cblas_sdot(Nsize, itrX, incX, itrY, incY);
 #else
+      if (incX == 1 && incY == 1) return parallel_sum<return_type>(Nsize, elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) { return simd::dot(i1-i0, itrX+i0, itrY+i0); });
       return_type val = (*itrX) * (*itrY);
       itrX += incX;
       itrY += incY;
@@ -106,6 +111,7 @@ struct dotc_impl<double>
 #ifdef _HAS_CBLAS
       return cblas_ddot(Nsize, itrX, incX, itrY, incY);
 #else
+      if (incX == 1 && incY == 1) return parallel_sum<return_type>(Nsize, elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) { return simd::dot(i1-i0, itrX+i0, itrY+i0); });
       int count = 1;
       return_type val = (*itrX) * (*itrY);
       itrX += incX;
@@ -133,6 +139,7 @@ struct dotc_impl<std::complex<float>>
 #ifdef _HAS_CBLAS
       cblas_cdotc_sub(Nsize, itrX, incX, itrY, incY, &val);
 #else
+      if (incX == 1 && incY == 1) return parallel_sum<return_type>(Nsize, elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) { return simd::dotc(i1-i0, itrX+i0, itrY+i0); });
       val = std::conj(*itrX) * (*itrY);
       itrX += incX;
       itrY += incY;
@@ -159,6 +166,7 @@ struct dotu_impl<std::complex<float>>
 #ifdef _HAS_CBLAS
       cblas_cdotu_sub(Nsize, itrX, incX, itrY, incY, &val);
 #else
+      if (incX == 1 && incY == 1) return parallel_sum<return_type>(Nsize, elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) { return simd::dotu(i1-i0, itrX+i0, itrY+i0); });
       val = (*itrX) * (*itrY);
       itrX += incX;
       itrY += incY;
@@ -185,6 +193,7 @@ struct dotc_impl<std::complex<double>>
 #ifdef _HAS_CBLAS
       cblas_zdotc_sub(Nsize, itrX, incX, itrY, incY, &val);
 #else
+      if (incX == 1 && incY == 1) return parallel_sum<return_type>(Nsize, elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) { return simd::dotc(i1-i0, itrX+i0, itrY+i0); });
       val = std::conj(*itrX) * (*itrY);
       itrX += incX;
       itrY += incY;
@@ -211,6 +220,7 @@ struct dotu_impl<std::complex<double>>
 #ifdef _HAS_CBLAS
       cblas_zdotu_sub(Nsize, itrX, incX, itrY, incY, &val);
 #else
+      if (incX == 1 && incY == 1) return parallel_sum<return_type>(Nsize, elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) { return simd::dotu(i1-i0, itrX+i0, itrY+i0); });
       val = (*itrX) * (*itrY);
       itrX += incX;
       itrY += incY;
@@ -223,6 +233,56 @@ struct dotu_impl<std::complex<double>>
    }
 };
 
+/// Dot of 16-bit data (half, bfloat16): elements are widened and summed in float
+template<class _Format>
+struct dotc_impl<reduced_float<_Format>>
+{
+   typedef float return_type;
+
+   template<class _IteratorX, class _IteratorY>
+   static return_type call (
+      const unsigned long& Nsize,
+            _IteratorX itrX, const typename std::iterator_traits<_IteratorX>::difference_type& incX,
+            _IteratorY itrY, const typename std::iterator_traits<_IteratorY>::difference_type& incY)
+   {
+      return call(Nsize, itrX, incX, itrY, incY, std::integral_constant<bool, std::is_pointer<_IteratorX>::value && std::is_pointer<_IteratorY>::value>());
+   }
+
+private:
+
+   /// contiguous data are summed in parallel
+   template<class _IteratorX, class _IteratorY>
+   static return_type call (
+      const unsigned long& Nsize,
+            _IteratorX itrX, const typename std::iterator_traits<_IteratorX>::difference_type& incX,
+            _IteratorY itrY, const typename std::iterator_traits<_IteratorY>::difference_type& incY,
+            std::true_type)
+   {
+      if (incX != 1 || incY != 1) return call(Nsize, itrX, incX, itrY, incY, std::false_type());
+      return parallel_sum<return_type>(Nsize, elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1)
+      {
+         return_type val = 0;
+         for (unsigned long i = i0; i < i1; ++i) val += static_cast<float>(itrX[i]) * static_cast<float>(itrY[i]);
+         return val;
+      });
+   }
+
+   template<class _IteratorX, class _IteratorY>
+   static return_type call (
+      const unsigned long& Nsize,
+            _IteratorX itrX, const typename std::iterator_traits<_IteratorX>::difference_type& incX,
+            _IteratorY itrY, const typename std::iterator_traits<_IteratorY>::difference_type& incY,
+            std::false_type)
+   {
+      return_type val = 0;
+      for (unsigned long i = 0; i < Nsize; ++i, itrX += incX, itrY += incY)
+      {
+         val += static_cast<float>(*itrX) * static_cast<float>(*itrY);
+      }
+      return val;
+   }
+};
+
 //  ================================================================================================
 
 /// Generic implementation of BLAS DOT in terms of C++ iterator
@@ -0,0 +1,922 @@
+#ifndef __BTAS_FACTORIZE_H
+#define __BTAS_FACTORIZE_H 1
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <btas/types.h>
+#include <btas/tensor.h>
+#include <btas/tensor_traits.h>
+#include <btas/generic/numeric_type.h>
+#include <btas/generic/gemm_impl.h>
+#include <btas/generic/permute.h>
+
+#ifdef _HAS_CBLAS
+extern "C" {
+void sgesdd_(const char*, const int*, const int*, float*, const int*, float*, float*, const int*, float*, const int*,
+             float*, const int*, int*, int*);
+void dgesdd_(const char*, const int*, const int*, double*, const int*, double*, double*, const int*, double*, const int*,
+             double*, const int*, int*, int*);
+void cgesdd_(const char*, const int*, const int*, std::complex<float>*, const int*, float*, std::complex<float>*, const int*,
+             std::complex<float>*, const int*, std::complex<float>*, const int*, float*, int*, int*);
+void zgesdd_(const char*, const int*, const int*, std::complex<double>*, const int*, double*, std::complex<double>*, const int*,
+             std::complex<double>*, const int*, std::complex<double>*, const int*, double*, int*, int*);
+void sgelqf_(const int*, const int*, float*, const int*, float*, float*, const int*, int*);
+void dgelqf_(const int*, const int*, double*, const int*, double*, double*, const int*, int*);
+void cgelqf_(const int*, const int*, std::complex<float>*, const int*, std::complex<float>*, std::complex<float>*, const int*, int*);
+void zgelqf_(const int*, const int*, std::complex<double>*, const int*, std::complex<double>*, std::complex<double>*, const int*, int*);
+void sorglq_(const int*, const int*, const int*, float*, const int*, const float*, float*, const int*, int*);
+void dorglq_(const int*, const int*, const int*, double*, const int*, const double*, double*, const int*, int*);
+void cunglq_(const int*, const int*, const int*, std::complex<float>*, const int*, const std::complex<float>*, std::complex<float>*, const int*, int*);
+void zunglq_(const int*, const int*, const int*, std::complex<double>*, const int*, const std::complex<double>*, std::complex<double>*, const int*, int*);
+void ssyevd_(const char*, const char*, const int*, float*, const int*, float*, float*, const int*, int*, const int*, int*);
+void dsyevd_(const char*, const char*, const int*, double*, const int*, double*, double*, const int*, int*, const int*, int*);
+void cheevd_(const char*, const char*, const int*, std::complex<float>*, const int*, float*, std::complex<float>*, const int*,
+             float*, const int*, int*, const int*, int*);
+void zheevd_(const char*, const char*, const int*, std::complex<double>*, const int*, double*, std::complex<double>*, const int*,
+             double*, const int*, int*, const int*, int*);
+}
+#endif // _HAS_CBLAS
+
+namespace btas {
+
+namespace impl {
+
+template<typename _T> struct real_type { typedef _T type; };
+template<typename _T> struct real_type<std::complex<_T>> { typedef _T type; };
+
+template<typename _T> _T real_part(const _T& x) { return x; }
+template<typename _T> _T real_part(const std::complex<_T>& x) { return x.real(); }
+
+template<typename _T> _T abs2(const _T& x) { return x * x; }
+template<typename _T> _T abs2(const std::complex<_T>& x) { return x.real() * x.real() + x.imag() * x.imag(); }
+
+/// \return x / |x|, 1 if x is zero
+template<typename _T> _T phase(const _T& x)
+{
+   const auto a = std::abs(x);
+   return a == 0 ? NumericType<_T>::one() : x / a;
+}
+
+/// draws a standard normal number, with independent real and imaginary parts for complex \c _T
+template<typename _T, class _Generator>
+_T random_normal(_Generator& gen, std::false_type)
+{
+   std::normal_distribution<_T> dist;
+   return dist(gen);
+}
+
+template<typename _T, class _Generator>
+_T random_normal(_Generator& gen, std::true_type)
+{
+   std::normal_distribution<typename _T::value_type> dist;
+   const typename _T::value_type re = dist(gen);
+   return _T(re, dist(gen));
+}
+
+//  ================================================================================================
+
+/// Built-in factorizations of row-major matrices, used without LAPACK
+///
+/// Every function overwrites its input \c a . With k = min(m,n), the thin factors are
+/// u (m x k), s (k), vt (k x n) of the SVD, q (m x k) and r (k x n) of the QR decomposition.
+template<typename _T>
+struct factorize_generic
+{
+   typedef typename real_type<_T>::type real_type;
+
+   /// A = u * diag(s) * vt, s descending, by one-sided Jacobi rotations of the rows of A or of A^H
+   static void svd(size_type m, size_type n, _T* a, real_type* s, _T* u, _T* vt)
+   {
+      const size_type k = std::min(m, n);
+      if(k == 0) return;
+      const bool trans = m > n;
+      const size_type p = trans ? n : m;
+      const size_type q = trans ? m : n;
+
+      // x (p x q) = A, or A^H, so that p <= q; w accumulates the rotations, x = w * x0
+      std::vector<_T> x(p*q), w(p*p, NumericType<_T>::zero());
+      if(trans)
+      {
+         for(size_type i = 0; i != m; ++i)
+            for(size_type j = 0; j != n; ++j) x[j*q+i] = impl::conj(a[i*n+j]);
+      }
+      else
+         std::copy(a, a + m*n, x.begin());
+      for(size_type i = 0; i != p; ++i) w[i*p+i] = NumericType<_T>::one();
+
+      jacobi_rows(p, q, x.data(), p, w.data());
+
+      // rows of x are sigma_i * v_i^H and x0 = w^H * x
+      std::vector<real_type> norm(p);
+      for(size_type i = 0; i != p; ++i)
+      {
+         real_type ss = 0;
+         for(size_type j = 0; j != q; ++j) ss += abs2(x[i*q+j]);
+         norm[i] = std::sqrt(ss);
+      }
+      std::vector<size_type> order(p);
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(), [&](size_type i, size_type j) { return norm[i] > norm[j]; });
+
+      std::vector<_T> vh(k*q);
+      std::vector<bool> valid(k);
+      for(size_type r = 0; r != k; ++r)
+      {
+         const size_type i = order[r];
+         s[r] = norm[i];
+         valid[r] = norm[i] > std::numeric_limits<real_type>::min();
+         if(valid[r])
+            for(size_type j = 0; j != q; ++j) vh[r*q+j] = x[i*q+j] / norm[i];
+      }
+      complete_rows(k, q, vh.data(), valid);
+
+      for(size_type r = 0; r != k; ++r)
+      {
+         const size_type i = order[r];
+         if(trans)
+         {
+            // A = x0^H = vh^H * s * w
+            for(size_type j = 0; j != m; ++j) u[j*k+r] = impl::conj(vh[r*q+j]);
+            for(size_type j = 0; j != n; ++j) vt[r*n+j] = w[i*p+j];
+         }
+         else
+         {
+            for(size_type j = 0; j != m; ++j) u[j*k+r] = impl::conj(w[i*p+j]);
+            for(size_type j = 0; j != n; ++j) vt[r*n+j] = vh[r*q+j];
+         }
+      }
+   }
+
+   /// A = q * r, r upper triangular, by Householder reflections
+   static void qr(size_type m, size_type n, _T* a, _T* q, _T* r)
+   {
+      const size_type k = std::min(m, n);
+      std::vector<std::vector<_T>> v(k);
+      std::vector<real_type> vnorm2(k, 0);
+      std::vector<_T> d(n);
+      for(size_type j = 0; j != k; ++j)
+      {
+         real_type ss = 0;
+         for(size_type i = j; i != m; ++i) ss += abs2(a[i*n+j]);
+         if(ss == 0) continue;
+         const _T alpha = -phase(a[j*n+j]) * static_cast<_T>(std::sqrt(ss));
+         v[j].assign(m-j, NumericType<_T>::zero());
+         for(size_type i = j; i != m; ++i) v[j][i-j] = a[i*n+j];
+         v[j][0] -= alpha;
+         for(const auto& x : v[j]) vnorm2[j] += abs2(x);
+         reflect(m-j, n-j, v[j].data(), vnorm2[j], a + j*n + j, n, d.data());
+         a[j*n+j] = alpha;
+         for(size_type i = j+1; i != m; ++i) a[i*n+j] = NumericType<_T>::zero();
+      }
+      for(size_type i = 0; i != k; ++i)
+         for(size_type j = 0; j != n; ++j) r[i*n+j] = j < i ? NumericType<_T>::zero() : a[i*n+j];
+
+      // q = H_0 * ... * H_{k-1} * I
+      std::fill(q, q + m*k, NumericType<_T>::zero());
+      for(size_type i = 0; i != k; ++i) q[i*k+i] = NumericType<_T>::one();
+      for(size_type j = k; j-- != 0; )
+         if(vnorm2[j] != 0) reflect(m-j, k-j, v[j].data(), vnorm2[j], q + j*k + j, k, d.data());
+   }
+
+   /// A = v * diag(w) * v^H for Hermitian A, w ascending, by cyclic Jacobi rotations
+   static void eigh(size_type n, _T* a, real_type* w, _T* v)
+   {
+      const real_type eps = std::numeric_limits<real_type>::epsilon();
+      std::vector<_T> z(n*n, NumericType<_T>::zero());
+      for(size_type i = 0; i != n; ++i) z[i*n+i] = NumericType<_T>::one();
+      real_type frob = 0;
+      for(size_type i = 0; i != n*n; ++i) frob += abs2(a[i]);
+
+      for(int sweep = 0; sweep != 100; ++sweep)
+      {
+         real_type off = 0;
+         for(size_type i = 0; i != n; ++i)
+            for(size_type j = i+1; j != n; ++j) off += abs2(a[i*n+j]);
+         if(off <= eps * eps * frob) break;
+
+         for(size_type p = 0; p != n; ++p)
+            for(size_type q = p+1; q != n; ++q)
+            {
+               const real_type apq = std::abs(a[p*n+q]);
+               if(apq == 0) continue;
+               // make a(p,q) real by a phase on index q, then rotate in the (p,q) plane
+               const _T ph = impl::conj(phase(a[p*n+q]));
+               for(size_type i = 0; i != n; ++i) { a[i*n+q] *= ph; z[i*n+q] *= ph; }
+               for(size_type i = 0; i != n; ++i) a[q*n+i] *= impl::conj(ph);
+               const real_type theta = (real_part(a[q*n+q]) - real_part(a[p*n+p])) / (2 * apq);
+               const real_type t = (theta >= 0 ? 1 : -1) / (std::abs(theta) + std::sqrt(theta*theta + 1));
+               const real_type c = 1 / std::sqrt(t*t + 1);
+               const real_type s = t * c;
+               for(size_type i = 0; i != n; ++i)
+               {
+                  const _T aip = a[i*n+p], aiq = a[i*n+q];
+                  a[i*n+p] = c*aip - s*aiq;
+                  a[i*n+q] = s*aip + c*aiq;
+                  const _T zip = z[i*n+p], ziq = z[i*n+q];
+                  z[i*n+p] = c*zip - s*ziq;
+                  z[i*n+q] = s*zip + c*ziq;
+               }
+               for(size_type i = 0; i != n; ++i)
+               {
+                  const _T api = a[p*n+i], aqi = a[q*n+i];
+                  a[p*n+i] = c*api - s*aqi;
+                  a[q*n+i] = s*api + c*aqi;
+               }
+               a[p*n+q] = a[q*n+p] = NumericType<_T>::zero();
+            }
+      }
+
+      std::vector<size_type> order(n);
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(), [&](size_type i, size_type j) { return real_part(a[i*n+i]) < real_part(a[j*n+j]); });
+      for(size_type r = 0; r != n; ++r)
+      {
+         w[r] = real_part(a[order[r]*n+order[r]]);
+         for(size_type i = 0; i != n; ++i) v[i*n+r] = z[i*n+order[r]];
+      }
+   }
+
+private:
+
+   /// orthogonalizes the p rows of x (p x q) by rotations, applied to the rows of w (p x nw) as well
+   static void jacobi_rows(size_type p, size_type q, _T* x, size_type nw, _T* w)
+   {
+      const real_type eps = std::numeric_limits<real_type>::epsilon();
+      for(int sweep = 0; sweep != 100; ++sweep)
+      {
+         bool rotated = false;
+         for(size_type i = 0; i + 1 < p; ++i)
+            for(size_type j = i+1; j != p; ++j)
+            {
+               _T* xi = x + i*q;
+               _T* xj = x + j*q;
+               real_type alpha = 0, beta = 0;
+               _T gamma = NumericType<_T>::zero();
+               for(size_type l = 0; l != q; ++l)
+               {
+                  alpha += abs2(xi[l]);
+                  beta  += abs2(xj[l]);
+                  gamma += xi[l] * impl::conj(xj[l]);
+               }
+               const real_type g = std::abs(gamma);
+               if(g == 0 || g <= eps * std::sqrt(alpha * beta)) continue;
+               rotated = true;
+               const _T ph = gamma / g;
+               const real_type zeta = (beta - alpha) / (2 * g);
+               const real_type t = (zeta >= 0 ? 1 : -1) / (std::abs(zeta) + std::sqrt(1 + zeta*zeta));
+               const real_type c = 1 / std::sqrt(1 + t*t);
+               const real_type s = c * t;
+               rotate(q, xi, xj, ph, c, s);
+               rotate(nw, w + i*nw, w + j*nw, ph, c, s);
+            }
+         if(!rotated) break;
+      }
+   }
+
+   /// (x, y) <- (c*x - s*ph*y, s*x + c*ph*y)
+   static void rotate(size_type n, _T* x, _T* y, const _T& ph, real_type c, real_type s)
+   {
+      for(size_type l = 0; l != n; ++l)
+      {
+         const _T xl = x[l], yl = ph * y[l];
+         x[l] = c*xl - s*yl;
+         y[l] = s*xl + c*yl;
+      }
+   }
+
+   /// replaces the rows of x (k x q) that are not valid by unit vectors orthogonal to all other rows
+   static void complete_rows(size_type k, size_type q, _T* x, std::vector<bool>& valid)
+   {
+      size_type e = 0;
+      for(size_type r = 0; r != k; ++r)
+      {
+         if(valid[r]) continue;
+         _T* xr = x + r*q;
+         for(; e != q && !valid[r]; ++e)
+         {
+            std::fill(xr, xr + q, NumericType<_T>::zero());
+            xr[e] = NumericType<_T>::one();
+            for(int pass = 0; pass != 2; ++pass)
+               for(size_type t = 0; t != k; ++t)
+               {
+                  if(t == r || !valid[t]) continue;
+                  _T dot = NumericType<_T>::zero();
+                  for(size_type l = 0; l != q; ++l) dot += impl::conj(x[t*q+l]) * xr[l];
+                  for(size_type l = 0; l != q; ++l) xr[l] -= dot * x[t*q+l];
+               }
+            real_type ss = 0;
+            for(size_type l = 0; l != q; ++l) ss += abs2(xr[l]);
+            if(ss > 0.25)
+            {
+               const real_type norm = std::sqrt(ss);
+               for(size_type l = 0; l != q; ++l) xr[l] /= norm;
+               valid[r] = true;
+            }
+         }
+      }
+   }
+
+   /// applies I - 2 v v^H / |v|^2 to the m x n block at x with leading dimension ldx; d is n workspace
+   static void reflect(size_type m, size_type n, const _T* v, real_type vnorm2, _T* x, size_type ldx, _T* d)
+   {
+      std::fill(d, d + n, NumericType<_T>::zero());
+      for(size_type i = 0; i != m; ++i)
+      {
+         const _T vi = impl::conj(v[i]);
+         for(size_type j = 0; j != n; ++j) d[j] += vi * x[i*ldx+j];
+      }
+      const real_type f = 2 / vnorm2;
+      for(size_type i = 0; i != m; ++i)
+      {
+         const _T vi = f * v[i];
+         for(size_type j = 0; j != n; ++j) x[i*ldx+j] -= vi * d[j];
+      }
+   }
+};
+
+#ifdef _HAS_CBLAS
+
+/// LAPACK routines for value type _T, called on the row-major matrices as column-major transposes
+template<typename _T> struct lapack { };
+
+#define BTAS_LAPACK_REAL(T, P)                                                                                   \
+template<> struct lapack<T>                                                                                      \
+{                                                                                                                \
+   static void gesdd(int m, int n, T* a, int lda, T* s, T* u, int ldu, T* vt, int ldvt, int* info)             \
+   {                                                                                                             \
+      const char jobz = 'S';                                                                                     \
+      const int lwork_query = -1;                                                                                \
+      std::vector<int> iwork(8 * std::max(1, std::min(m, n)));                                                   \
+      T wsize;                                                                                                   \
+      P##gesdd_(&jobz, &m, &n, a, &lda, s, u, &ldu, vt, &ldvt, &wsize, &lwork_query, iwork.data(), info);       \
+      const int lwork = static_cast<int>(wsize);                                                                 \
+      std::vector<T> work(std::max(1, lwork));                                                                   \
+      P##gesdd_(&jobz, &m, &n, a, &lda, s, u, &ldu, vt, &ldvt, work.data(), &lwork, iwork.data(), info);        \
+   }                                                                                                             \
+   static void gelqf(int m, int n, T* a, int lda, T* tau, int* info)                                             \
+   {                                                                                                             \
+      const int lwork_query = -1;                                                                                \
+      T wsize;                                                                                                   \
+      P##gelqf_(&m, &n, a, &lda, tau, &wsize, &lwork_query, info);                                             \
+      const int lwork = static_cast<int>(wsize);                                                                 \
+      std::vector<T> work(std::max(1, lwork));                                                                   \
+      P##gelqf_(&m, &n, a, &lda, tau, work.data(), &lwork, info);                                              \
+   }                                                                                                             \
+   static void unglq(int m, int n, int k, T* a, int lda, const T* tau, int* info)                               \
+   {                                                                                                             \
+      const int lwork_query = -1;                                                                                \
+      T wsize;                                                                                                   \
+      P##orglq_(&m, &n, &k, a, &lda, tau, &wsize, &lwork_query, info);                                          \
+      const int lwork = static_cast<int>(wsize);                                                                 \
+      std::vector<T> work(std::max(1, lwork));                                                                   \
+      P##orglq_(&m, &n, &k, a, &lda, tau, work.data(), &lwork, info);                                           \
+   }                                                                                                             \
+   static void heevd(int n, T* a, int lda, T* w, int* info)                                                      \
+   {                                                                                                             \
+      const char jobz = 'V', uplo = 'U';                                                                         \
+      const int query = -1;                                                                                      \
+      T wsize;                                                                                                   \
+      int isize;                                                                                                 \
+      P##syevd_(&jobz, &uplo, &n, a, &lda, w, &wsize, &query, &isize, &query, info);                            \
+      const int lwork = static_cast<int>(wsize), liwork = isize;                                                 \
+      std::vector<T> work(std::max(1, lwork));                                                                   \
+      std::vector<int> iwork(std::max(1, liwork));                                                               \
+      P##syevd_(&jobz, &uplo, &n, a, &lda, w, work.data(), &lwork, iwork.data(), &liwork, info);                \
+   }                                                                                                             \
+};
+
+#define BTAS_LAPACK_COMPLEX(T, P)                                                                                \
+template<> struct lapack<std::complex<T>>                                                                        \
+{                                                                                                                \
+   typedef std::complex<T> C;                                                                                    \
+   static void gesdd(int m, int n, C* a, int lda, T* s, C* u, int ldu, C* vt, int ldvt, int* info)             \
+   {                                                                                                             \
+      const char jobz = 'S';                                                                                     \
+      const int lwork_query = -1;                                                                                \
+      const int mn = std::max(1, std::min(m, n)), mx = std::max(m, n);                                           \
+      std::vector<int> iwork(8 * mn);                                                                            \
+      std::vector<T> rwork(mn * std::max(5 * mn + 7, 2 * mx + 2 * mn + 1));                                      \
+      C wsize;                                                                                                   \
+      P##gesdd_(&jobz, &m, &n, a, &lda, s, u, &ldu, vt, &ldvt, &wsize, &lwork_query, rwork.data(), iwork.data(), info); \
+      const int lwork = static_cast<int>(wsize.real());                                                          \
+      std::vector<C> work(std::max(1, lwork));                                                                   \
+      P##gesdd_(&jobz, &m, &n, a, &lda, s, u, &ldu, vt, &ldvt, work.data(), &lwork, rwork.data(), iwork.data(), info); \
+   }                                                                                                             \
+   static void gelqf(int m, int n, C* a, int lda, C* tau, int* info)                                             \
+   {                                                                                                             \
+      const int lwork_query = -1;                                                                                \
+      C wsize;                                                                                                   \
+      P##gelqf_(&m, &n, a, &lda, tau, &wsize, &lwork_query, info);                                             \
+      const int lwork = static_cast<int>(wsize.real());                                                          \
+      std::vector<C> work(std::max(1, lwork));                                                                   \
+      P##gelqf_(&m, &n, a, &lda, tau, work.data(), &lwork, info);                                              \
+   }                                                                                                             \
+   static void unglq(int m, int n, int k, C* a, int lda, const C* tau, int* info)                               \
+   {                                                                                                             \
+      const int lwork_query = -1;                                                                                \
+      C wsize;                                                                                                   \
+      P##unglq_(&m, &n, &k, a, &lda, tau, &wsize, &lwork_query, info);                                          \
+      const int lwork = static_cast<int>(wsize.real());                                                          \
+      std::vector<C> work(std::max(1, lwork));                                                                   \
+      P##unglq_(&m, &n, &k, a, &lda, tau, work.data(), &lwork, info);                                           \
+   }                                                                                                             \
+   static void heevd(int n, C* a, int lda, T* w, int* info)                                                      \
+   {                                                                                                             \
+      const char jobz = 'V', uplo = 'U';                                                                         \
+      const int query = -1;                                                                                      \
+      C wsize;                                                                                                   \
+      T rsize;                                                                                                   \
+      int isize;                                                                                                 \
+      P##heevd_(&jobz, &uplo, &n, a, &lda, w, &wsize, &query, &rsize, &query, &isize, &query, info);            \
+      const int lwork = static_cast<int>(wsize.real()), lrwork = static_cast<int>(rsize), liwork = isize;        \
+      std::vector<C> work(std::max(1, lwork));                                                                   \
+      std::vector<T> rwork(std::max(1, lrwork));                                                                 \
+      std::vector<int> iwork(std::max(1, liwork));                                                               \
+      P##heevd_(&jobz, &uplo, &n, a, &lda, w, work.data(), &lwork, rwork.data(), &lrwork, iwork.data(), &liwork, info); \
+   }                                                                                                             \
+};
+
+BTAS_LAPACK_REAL(float, s)
+BTAS_LAPACK_REAL(double, d)
+BTAS_LAPACK_COMPLEX(float, c)
+BTAS_LAPACK_COMPLEX(double, z)
+
+#undef BTAS_LAPACK_REAL
+#undef BTAS_LAPACK_COMPLEX
+
+/// LAPACK factorizations of row-major matrices, with the interface of factorize_generic
+///
+/// A row-major matrix is the column-major storage of its transpose, so each routine factorizes A^T
+/// and reads the factors of A off those of A^T in place: the SVD of A^T gives vt and u directly,
+/// the LQ decomposition of A^T gives q and r, and the eigenvectors of A^T = impl::conj(A) give those of A.
+template<typename _T>
+struct factorize_lapack
+{
+   typedef typename real_type<_T>::type real_type;
+
+   static void svd(size_type m, size_type n, _T* a, real_type* s, _T* u, _T* vt)
+   {
+      const int k = std::min(m, n);
+      if(k == 0) return;
+      int info = 0;
+      lapack<_T>::gesdd(n, m, a, n, s, vt, n, u, k, &info);
+      if(info != 0) throw std::runtime_error("svd: LAPACK gesdd failed");
+   }
+
+   static void qr(size_type m, size_type n, _T* a, _T* q, _T* r)
+   {
+      const size_type k = std::min(m, n);
+      if(k == 0) return;
+      // the LQ decomposition A^T = L * Q' gives r = L^T, the upper triangle in place, and q = Q'^T
+      std::vector<_T> tau(k);
+      int info = 0;
+      lapack<_T>::gelqf(n, m, a, n, tau.data(), &info);
+      if(info != 0) throw std::runtime_error("qr: LAPACK gelqf failed");
+      for(size_type i = 0; i != k; ++i)
+         for(size_type j = 0; j != n; ++j) r[i*n+j] = j < i ? NumericType<_T>::zero() : a[i*n+j];
+      lapack<_T>::unglq(k, m, k, a, n, tau.data(), &info);
+      if(info != 0) throw std::runtime_error("qr: LAPACK unglq failed");
+      for(size_type i = 0; i != m; ++i)
+         std::copy(a + i*n, a + i*n + k, q + i*k);
+   }
+
+   static void eigh(size_type n, _T* a, real_type* w, _T* v)
+   {
+      if(n == 0) return;
+      int info = 0;
+      lapack<_T>::heevd(n, a, n, w, &info);
+      if(info != 0) throw std::runtime_error("eigh: LAPACK heevd failed");
+      for(size_type i = 0; i != n; ++i)
+         for(size_type j = 0; j != n; ++j) v[i*n+j] = impl::conj(a[j*n+i]);
+   }
+};
+
+#endif // _HAS_CBLAS
+
+/// Matrix factorizations for value type \c _T : LAPACK if available, built-in otherwise
+template<typename _T>
+struct factorize_matrix : public factorize_generic<_T> { };
+
+#ifdef _HAS_CBLAS
+template<> struct factorize_matrix<float> : public factorize_lapack<float> { };
+template<> struct factorize_matrix<double> : public factorize_lapack<double> { };
+template<> struct factorize_matrix<std::complex<float>> : public factorize_lapack<std::complex<float>> { };
+template<> struct factorize_matrix<std::complex<double>> : public factorize_lapack<std::complex<double>> { };
+#endif // _HAS_CBLAS
+
+//  ================================================================================================
+
+/// Split of the indices of a tensor A into the row indices of a left factor X(rows..., bond)
+/// and the column indices of a right factor Y(bond, cols...), in the orders of aX and aY
+template<typename _Label>
+struct factor_split
+{
+   std::vector<size_type> rows;      ///< positions in A of the row indices
+   std::vector<size_type> cols;      ///< positions in A of the column indices
+   std::vector<size_type> extentX;   ///< extents of the row indices
+   std::vector<size_type> extentY;   ///< extents of the column indices
+   std::vector<_Label> labelsX;      ///< row labels and the bond label
+   std::vector<_Label> labelsY;      ///< the bond label and column labels
+   size_type m = 1;
+   size_type n = 1;
+
+   template<class _Tensor, class _AnnotationA, class _AnnotationX, class _AnnotationY>
+   factor_split(const _Tensor& A, const _AnnotationA& aA, const _AnnotationX& aX, const _AnnotationY& aY)
+   {
+      const size_type rA = std::distance(std::begin(aA), std::end(aA));
+      assert(A.rank() == rA);
+      std::vector<bool> used(rA, false);
+      bool has_bond = false;
+      _Label bond = _Label();
+      auto split = [&](const _Label& l, std::vector<size_type>& pos, std::vector<size_type>& extent, std::vector<_Label>& labels, size_type& size)
+      {
+         const size_type p = std::distance(std::begin(aA), std::find(std::begin(aA), std::end(aA), l));
+         if(p == rA)
+         {
+            if(has_bond && !(l == bond)) throw std::logic_error("factorize: factors must share exactly one index that is not an index of A");
+            has_bond = true;
+            bond = l;
+            return;
+         }
+         if(used[p]) throw std::logic_error("factorize: an index of A is in both factors");
+         used[p] = true;
+         pos.push_back(p);
+         extent.push_back(A.range().extent(p));
+         labels.push_back(l);
+         size *= A.range().extent(p);
+      };
+      for(auto itr = std::begin(aX); itr != std::end(aX); ++itr) split(*itr, rows, extentX, labelsX, m);
+      const bool bondX = has_bond;
+      for(auto itr = std::begin(aY); itr != std::end(aY); ++itr) split(*itr, cols, extentY, labelsY, n);
+      if(!bondX || std::find(std::begin(aY), std::end(aY), bond) == std::end(aY))
+         throw std::logic_error("factorize: factors must share exactly one index that is not an index of A");
+      if(std::find(used.begin(), used.end(), false) != used.end())
+         throw std::logic_error("factorize: every index of A must be in one of the factors");
+      labelsX.push_back(bond);
+      labelsY.insert(labelsY.begin(), bond);
+   }
+
+   /// \return the row-major m x n matrix of A, as a Tensor
+   template<class _Tensor>
+   Tensor<typename _Tensor::value_type> matrix(const _Tensor& A) const
+   {
+      // index d of the matrix is index p[d] of A
+      btas::varray<size_type> p(rows.size() + cols.size());
+      std::copy(rows.begin(), rows.end(), std::begin(p));
+      std::copy(cols.begin(), cols.end(), std::begin(p) + rows.size());
+      Tensor<typename _Tensor::value_type> M;
+      permute(A, p, M);
+      return M;
+   }
+
+   /// X = the row-major m x k matrix x, with the indices in the order of aX
+   template<typename _T, class _TensorX, class _AnnotationX>
+   void left(const std::vector<_T>& x, size_type k, _TensorX& X, const _AnnotationX& aX) const
+   {
+      std::vector<size_type> extent(extentX);
+      extent.push_back(k);
+      factor(x, extent, labelsX, X, aX);
+   }
+
+   /// Y = the row-major k x n matrix y, with the indices in the order of aY
+   template<typename _T, class _TensorY, class _AnnotationY>
+   void right(const std::vector<_T>& y, size_type k, _TensorY& Y, const _AnnotationY& aY) const
+   {
+      std::vector<size_type> extent(1, k);
+      extent.insert(extent.end(), extentY.begin(), extentY.end());
+      factor(y, extent, labelsY, Y, aY);
+   }
+
+private:
+   template<typename _T, class _TensorX, class _AnnotationX>
+   static void factor(const std::vector<_T>& x, const std::vector<size_type>& extent, const std::vector<_Label>& labels,
+                      _TensorX& X, const _AnnotationX& aX)
+   {
+      Tensor<_T> T(Range(extent), typename Tensor<_T>::storage_type(x.begin(), x.end()));
+      btas::varray<size_type> p(labels.size());
+      auto itr = std::begin(aX);
+      for(size_type i = 0; i != labels.size(); ++i, ++itr)
+         p[i] = std::distance(labels.begin(), std::find(labels.begin(), labels.end(), *itr));
+      permute(T, p, X);
+   }
+};
+
+template<class _Annotation>
+using annotation_label_t = typename std::decay<decltype(*std::begin(std::declval<_Annotation>()))>::type;
+
+/// S = the rank-1 tensor of the first k elements of s
+template<typename _T, class _TensorS>
+void vector_tensor(const std::vector<_T>& s, size_type k, _TensorS& S)
+{
+   S.resize(std::vector<size_type>(1, k));
+   std::copy(s.begin(), s.begin() + k, std::begin(S));
+}
+
+/// the first k columns of the row-major m x l matrix u
+template<typename _T>
+std::vector<_T> leading_columns(const std::vector<_T>& u, size_type m, size_type l, size_type k)
+{
+   if(k == l) return u;
+   std::vector<_T> x(m*k);
+   for(size_type i = 0; i != m; ++i) std::copy(u.begin() + i*l, u.begin() + i*l + k, x.begin() + i*k);
+   return x;
+}
+
+} // namespace impl
+
+//  ================================================================================================
+
+/// Cutoffs of a truncated SVD
+struct svd_truncation
+{
+   /// largest relative truncation error: the discarded singular values satisfy
+   /// sum(s_discarded^2) <= tolerance^2 * sum(s^2)
+   double tolerance;
+   /// largest number of singular values kept
+   size_type max_rank;
+
+   svd_truncation(double tol = 0.0, size_type rank = std::numeric_limits<size_type>::max()) : tolerance(tol), max_rank(rank) { }
+};
+
+/// Parameters of randomized_svd()
+struct randomized_svd_options
+{
+   size_type oversampling;       ///< extra random vectors beyond the requested rank
+   size_type power_iterations;   ///< passes of (A A^H) applied to sharpen the spectrum
+   std::uint64_t seed;           ///< seed of the random test matrix
+
+   randomized_svd_options(size_type over = 10, size_type iterations = 2, std::uint64_t s = 42) :
+      oversampling(over), power_iterations(iterations), seed(s) { }
+};
+
+/// QR decomposition of a tensor, A = Q * R, with the annotations of contract()
+///
+/// The indices of A are split by the annotations of the factors: Q(aQ) has the indices of A in aQ
+/// and R(aR) those in aR, and both have one more index, the bond, labeled the same in aQ and aR.
+/// The bond has extent min(m,n), m and n being the sizes of the two groups of indices of A.
+/// The matricized R is upper triangular and Q has orthonormal columns.
+/// Calls LAPACK on the matricized A if \c _HAS_CBLAS is defined, a built-in Householder QR otherwise.
+template<
+   class _TensorA, class _TensorQ, class _TensorR,
+   class _AnnotationA, class _AnnotationQ, class _AnnotationR,
+   class = typename std::enable_if<
+      is_boxtensor<_TensorA>::value &
+      is_container<_AnnotationA>::value &
+      is_container<_AnnotationQ>::value &
+      is_container<_AnnotationR>::value
+   >::type
+>
+void qr(const _TensorA& A, const _AnnotationA& aA,
+              _TensorQ& Q, const _AnnotationQ& aQ,
+              _TensorR& R, const _AnnotationR& aR)
+{
+   typedef typename _TensorA::value_type value_type;
+   const impl::factor_split<impl::annotation_label_t<_AnnotationA>> split(A, aA, aQ, aR);
+   const size_type m = split.m, n = split.n, k = std::min(m, n);
+   auto M = split.matrix(A);
+   std::vector<value_type> q(m*k), r(k*n);
+   impl::factorize_matrix<value_type>::qr(m, n, M.data(), q.data(), r.data());
+   split.left(q, k, Q, aQ);
+   split.right(r, k, R, aR);
+}
+
+/// Truncated SVD of a tensor, A ~ U * diag(S) * V, see svd()
+///
+/// Keeps the fewest singular values that meet \c trunc.tolerance , at most \c trunc.max_rank of them
+/// (and at least one, unless A is empty).
+/// \return the discarded weight, the sum of the squares of the discarded singular values
+template<
+   class _TensorA, class _TensorU, class _TensorS, class _TensorV,
+   class _AnnotationA, class _AnnotationU, class _AnnotationV,
+   class = typename std::enable_if<
+      is_boxtensor<_TensorA>::value &
+      is_container<_AnnotationA>::value &
+      is_container<_AnnotationU>::value &
+      is_container<_AnnotationV>::value
+   >::type
+>
+double truncated_svd(const _TensorA& A, const _AnnotationA& aA,
+                           _TensorU& U, const _AnnotationU& aU,
+                           _TensorS& S,
+                           _TensorV& V, const _AnnotationV& aV,
+                     const svd_truncation& trunc)
+{
+   typedef typename _TensorA::value_type value_type;
+   typedef typename impl::real_type<value_type>::type real_type;
+   const impl::factor_split<impl::annotation_label_t<_AnnotationA>> split(A, aA, aU, aV);
+   const size_type m = split.m, n = split.n, l = std::min(m, n);
+   auto M = split.matrix(A);
+   std::vector<real_type> s(l);
+   std::vector<value_type> u(m*l), vt(l*n);
+   impl::factorize_matrix<value_type>::svd(m, n, M.data(), s.data(), u.data(), vt.data());
+
+   // keep k singular values: the discarded weight is the sum of the squares of the rest
+   double total = 0.0;
+   for(auto x : s) total += static_cast<double>(x) * x;
+   const double cutoff = trunc.tolerance * trunc.tolerance * total;
+   size_type k = l;
+   double discarded = 0.0;
+   while(k > 1 && discarded + static_cast<double>(s[k-1]) * s[k-1] <= cutoff)
+   {
+      --k;
+      discarded += static_cast<double>(s[k]) * s[k];
+   }
+   for(; k > std::max<size_type>(trunc.max_rank, 1); --k)
+      discarded += static_cast<double>(s[k-1]) * s[k-1];
+   vt.resize(k*n);
+
+   impl::vector_tensor(s, k, S);
+   split.left(impl::leading_columns(u, m, l, k), k, U, aU);
+   split.right(vt, k, V, aV);
+   return discarded;
+}
+
+/// Thin SVD of a tensor, A = U * diag(S) * V, with the index split of qr()
+///
+/// S is resized to the min(m,n) singular values, in descending order, and the bond index of U and V
+/// runs over them. U has orthonormal columns and V orthonormal rows (as matrices).
+/// Calls LAPACK gesdd on the matricized A if \c _HAS_CBLAS is defined, a built-in one-sided Jacobi SVD otherwise.
+template<
+   class _TensorA, class _TensorU, class _TensorS, class _TensorV,
+   class _AnnotationA, class _AnnotationU, class _AnnotationV,
+   class = typename std::enable_if<
+      is_boxtensor<_TensorA>::value &
+      is_container<_AnnotationA>::value &
+      is_container<_AnnotationU>::value &
+      is_container<_AnnotationV>::value
+   >::type
+>
+void svd(const _TensorA& A, const _AnnotationA& aA,
+               _TensorU& U, const _AnnotationU& aU,
+               _TensorS& S,
+               _TensorV& V, const _AnnotationV& aV)
+{
+   truncated_svd(A, aA, U, aU, S, V, aV, svd_truncation());
+}
+
+/// Randomized SVD of a tensor of (numerical) rank about \c rank , A ~ U * diag(S) * V, see svd()
+///
+/// Finds the range of A from its product with a Gaussian test matrix of rank + oversampling columns,
+/// sharpened by power iterations, then computes the SVD of A projected onto that range; costs
+/// O(m n (rank + oversampling)) instead of O(m n min(m,n)). Keeps \c rank singular values.
+template<
+   class _TensorA, class _TensorU, class _TensorS, class _TensorV,
+   class _AnnotationA, class _AnnotationU, class _AnnotationV,
+   class = typename std::enable_if<
+      is_boxtensor<_TensorA>::value &
+      is_container<_AnnotationA>::value &
+      is_container<_AnnotationU>::value &
+      is_container<_AnnotationV>::value
+   >::type
+>
+void randomized_svd(const _TensorA& A, const _AnnotationA& aA,
+                          _TensorU& U, const _AnnotationU& aU,
+                          _TensorS& S,
+                          _TensorV& V, const _AnnotationV& aV,
+                          size_type rank,
+                    const randomized_svd_options& options = randomized_svd_options())
+{
+   typedef typename _TensorA::value_type value_type;
+   typedef typename impl::real_type<value_type>::type real_type;
+   typedef impl::factorize_matrix<value_type> factorize;
+   const impl::factor_split<impl::annotation_label_t<_AnnotationA>> split(A, aA, aU, aV);
+   const size_type m = split.m, n = split.n;
+   const size_type l = std::min(rank + options.oversampling, std::min(m, n));
+   const size_type k = std::min(rank, l);
+   const value_type one = NumericType<value_type>::one(), zero = NumericType<value_type>::zero();
+   const CBLAS_TRANSPOSE adjoint = std::is_same<value_type, real_type>::value ? CblasTrans : CblasConjTrans;
+   auto M = split.matrix(A);
+   const value_type* a = M.data();
+
+   std::mt19937_64 gen(options.seed);
+   std::vector<value_type> omega(n*l);
+   for(auto& x : omega) x = impl::random_normal<value_type>(gen, std::integral_constant<bool, !std::is_same<value_type, real_type>::value>());
+
+   // y = A * omega, orthonormalized into q after each pass of A A^H
+   std::vector<value_type> y(m*l), q(m*l), z(n*l), qz(n*l), r(l*std::max(l, n));
+   gemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, m, l, n, one, a, n, omega.data(), l, zero, y.data(), l);
+   for(size_type it = 0; it != options.power_iterations; ++it)
+   {
+      factorize::qr(m, l, y.data(), q.data(), r.data());
+      gemm(CblasRowMajor, adjoint, CblasNoTrans, n, l, m, one, a, n, q.data(), l, zero, z.data(), l);
+      factorize::qr(n, l, z.data(), qz.data(), r.data());
+      gemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, m, l, n, one, a, n, qz.data(), l, zero, y.data(), l);
+   }
+   factorize::qr(m, l, y.data(), q.data(), r.data());
+
+   // B = q^H * A = ub * s * vt, so that A ~ (q * ub) * s * vt
+   std::vector<value_type> b(l*n), ub(l*l), vt(l*n), u(m*l);
+   std::vector<real_type> s(l);
+   gemm(CblasRowMajor, adjoint, CblasNoTrans, l, n, m, one, q.data(), l, a, n, zero, b.data(), n);
+   factorize::svd(l, n, b.data(), s.data(), ub.data(), vt.data());
+   gemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, m, l, l, one, q.data(), l, ub.data(), l, zero, u.data(), l);
+   vt.resize(k*n);
+
+   impl::vector_tensor(s, k, S);
+   split.left(impl::leading_columns(u, m, l, k), k, U, aU);
+   split.right(vt, k, V, aV);
+}
+
+/// Eigendecomposition of a Hermitian tensor, A = V * diag(W) * V^H, with the annotations of contract()
+///
+/// The indices of A in aV are the rows of the matricized A, the other indices of A its columns, which
+/// must have the same extents; aV has one more index, labeling the eigenvalues W, in ascending order.
+/// Calls LAPACK syevd/heevd if \c _HAS_CBLAS is defined, built-in Jacobi rotations otherwise.
+template<
+   class _TensorA, class _TensorW, class _TensorV,
+   class _AnnotationA, class _AnnotationV,
+   class = typename std::enable_if<
+      is_boxtensor<_TensorA>::value &
+      is_container<_AnnotationA>::value &
+      is_container<_AnnotationV>::value
+   >::type
+>
+void eigh(const _TensorA& A, const _AnnotationA& aA,
+                _TensorW& W,
+                _TensorV& V, const _AnnotationV& aV)
+{
+   typedef typename _TensorA::value_type value_type;
+   typedef typename impl::real_type<value_type>::type real_type;
+   typedef impl::annotation_label_t<_AnnotationA> label_type;
+
+   // the columns of A, with the eigenvalue label, make a right factor so that the split can be reused
+   std::vector<label_type> aC;
+   for(auto itr = std::begin(aV); itr != std::end(aV); ++itr)
+      if(std::find(std::begin(aA), std::end(aA), *itr) == std::end(aA)) aC.push_back(*itr);
+   for(auto itr = std::begin(aA); itr != std::end(aA); ++itr)
+      if(std::find(std::begin(aV), std::end(aV), *itr) == std::end(aV)) aC.push_back(*itr);
+   const impl::factor_split<label_type> split(A, aA, aV, aC);
+   if(split.m != split.n) throw std::logic_error("eigh: rows and columns of A must have the same size");
+   const size_type n = split.n;
+   auto M = split.matrix(A);
+   std::vector<real_type> w(n);
+   std::vector<value_type> v(n*n);
+   impl::factorize_matrix<value_type>::eigh(n, M.data(), w.data(), v.data());
+
+   impl::vector_tensor(w, n, W);
+   split.left(v, n, V, aV);
+}
+
+//  ================================================================================================
+
+template<class _TensorA, class _TensorQ, class _TensorR, typename _UA, typename _UQ, typename _UR>
+void qr(const _TensorA& A, std::initializer_list<_UA> aA,
+              _TensorQ& Q, std::initializer_list<_UQ> aQ,
+              _TensorR& R, std::initializer_list<_UR> aR)
+{
+   qr(A, btas::varray<_UA>(aA), Q, btas::varray<_UQ>(aQ), R, btas::varray<_UR>(aR));
+}
+
+template<class _TensorA, class _TensorU, class _TensorS, class _TensorV, typename _UA, typename _UU, typename _UV>
+void svd(const _TensorA& A, std::initializer_list<_UA> aA,
+               _TensorU& U, std::initializer_list<_UU> aU,
+               _TensorS& S,
+               _TensorV& V, std::initializer_list<_UV> aV)
+{
+   svd(A, btas::varray<_UA>(aA), U, btas::varray<_UU>(aU), S, V, btas::varray<_UV>(aV));
+}
+
+template<class _TensorA, class _TensorU, class _TensorS, class _TensorV, typename _UA, typename _UU, typename _UV>
+double truncated_svd(const _TensorA& A, std::initializer_list<_UA> aA,
+                           _TensorU& U, std::initializer_list<_UU> aU,
+                           _TensorS& S,
+                           _TensorV& V, std::initializer_list<_UV> aV,
+                     const svd_truncation& trunc)
+{
+   return truncated_svd(A, btas::varray<_UA>(aA), U, btas::varray<_UU>(aU), S, V, btas::varray<_UV>(aV), trunc);
+}
+
+template<class _TensorA, class _TensorU, class _TensorS, class _TensorV, typename _UA, typename _UU, typename _UV>
+void randomized_svd(const _TensorA& A, std::initializer_list<_UA> aA,
+                          _TensorU& U, std::initializer_list<_UU> aU,
+                          _TensorS& S,
+                          _TensorV& V, std::initializer_list<_UV> aV,
+                          size_type rank,
+                    const randomized_svd_options& options = randomized_svd_options())
+{
+   randomized_svd(A, btas::varray<_UA>(aA), U, btas::varray<_UU>(aU), S, V, btas::varray<_UV>(aV), rank, options);
+}
+
+template<class _TensorA, class _TensorW, class _TensorV, typename _UA, typename _UV>
+void eigh(const _TensorA& A, std::initializer_list<_UA> aA,
+                _TensorW& W,
+                _TensorV& V, std::initializer_list<_UV> aV)
+{
+   eigh(A, btas::varray<_UA>(aA), W, V, btas::varray<_UV>(aV));
+}
+
+} // namespace btas
+
+#endif // __BTAS_FACTORIZE_H
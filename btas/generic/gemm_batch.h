@@ -0,0 +1,286 @@
+#ifndef __BTAS_GEMM_BATCH_H
+#define __BTAS_GEMM_BATCH_H 1
+
+#include <algorithm>
+#include <cassert>
+
+#include <btas/types.h>
+#include <btas/generic/numeric_type.h>
+#include <btas/generic/gemm_impl.h>
+#include <btas/util/parallel.h>
+
+namespace btas {
+
+/// GEMMs of at most this many multiply-adds are computed by a plain loop nest,
+/// for them the dispatch and packing of the blocked kernel cost more than they save
+const unsigned long gemm_small_max_volume = 4096;
+
+namespace impl {
+
+/// Row-major C = alpha * op(A) * op(B) + beta * C computed directly on the operands, meant for small matrices
+template<typename _T>
+void gemm_small (
+   const CBLAS_TRANSPOSE& transA,
+   const CBLAS_TRANSPOSE& transB,
+   const unsigned long& Msize,
+   const unsigned long& Nsize,
+   const unsigned long& Ksize,
+   const _T& alpha,
+   const _T* itrA,
+   const unsigned long& LDA,
+   const _T* itrB,
+   const unsigned long& LDB,
+   const _T& beta,
+         _T* itrC,
+   const unsigned long& LDC)
+{
+   // element (i,k) of op(A) is at itrA[i*rA + k*cA], element (k,j) of op(B) at itrB[k*rB + j*cB]
+   const unsigned long rA = (transA == CblasNoTrans) ? LDA : 1;
+   const unsigned long cA = (transA == CblasNoTrans) ? 1 : LDA;
+   const unsigned long rB = (transB == CblasNoTrans) ? LDB : 1;
+   const unsigned long cB = (transB == CblasNoTrans) ? 1 : LDB;
+   const bool conjA = (transA == CblasConjTrans);
+   const bool conjB = (transB == CblasConjTrans);
+
+   for (unsigned long i = 0; i < Msize; ++i)
+   {
+      _T* c = itrC + i*LDC;
+      if (beta == NumericType<_T>::zero())
+         std::fill(c, c+Nsize, NumericType<_T>::zero());
+      else if (beta != NumericType<_T>::one())
+         for (unsigned long j = 0; j < Nsize; ++j) c[j] *= beta;
+
+      for (unsigned long k = 0; k < Ksize; ++k)
+      {
+         const _T aik = itrA[i*rA + k*cA];
+         const _T a = alpha * (conjA ? impl::conj(aik) : aik);
+         const _T* b = itrB + k*rB;
+         if (cB == 1)
+            for (unsigned long j = 0; j < Nsize; ++j) impl::madd(c[j], a, b[j]);
+         else if (!conjB)
+            for (unsigned long j = 0; j < Nsize; ++j) impl::madd(c[j], a, b[j*cB]);
+         else
+            for (unsigned long j = 0; j < Nsize; ++j) impl::madd(c[j], a, impl::conj(b[j*cB]));
+      }
+   }
+}
+
+/// Row-major GEMM on pointers, by gemm_small if it is small enough and by gemm_impl otherwise
+template<typename _T>
+void gemm_sized (
+   const CBLAS_TRANSPOSE& transA,
+   const CBLAS_TRANSPOSE& transB,
+   const unsigned long& Msize,
+   const unsigned long& Nsize,
+   const unsigned long& Ksize,
+   const _T& alpha,
+   const _T* itrA,
+   const unsigned long& LDA,
+   const _T* itrB,
+   const unsigned long& LDB,
+   const _T& beta,
+         _T* itrC,
+   const unsigned long& LDC)
+{
+   if (Msize*Nsize*Ksize <= gemm_small_max_volume)
+      gemm_small(transA, transB, Msize, Nsize, Ksize, alpha, itrA, LDA, itrB, LDB, beta, itrC, LDC);
+   else
+      gemm_impl<true>::call(CblasRowMajor, transA, transB, Msize, Nsize, Ksize, alpha, itrA, LDA, itrB, LDB, beta, itrC, LDC);
+}
+
+/// \return true if a loop over gemm_sized calls of this volume may be split between threads; loops over
+/// BLAS calls only if set_parallel_blas_loops(true) was called
+inline bool gemm_sized_loop_parallel (const unsigned long& volume)
+{
+#ifdef _HAS_CBLAS
+   return volume <= gemm_small_max_volume || get_parallel_blas_loops();
+#else
+   return true;
+#endif
+}
+
+} // namespace impl
+
+template<bool _Finalize> struct gemm_batch_impl { };
+
+template<> struct gemm_batch_impl<true>
+{
+   /// batch of GEMMs of the same shape, the b-th operands start at itrA + b*strideA, itrB + b*strideB and itrC + b*strideC
+   template<typename _T>
+   static void call (
+      const CBLAS_ORDER& order,
+      const CBLAS_TRANSPOSE& transA,
+      const CBLAS_TRANSPOSE& transB,
+      const unsigned long& Msize,
+      const unsigned long& Nsize,
+      const unsigned long& Ksize,
+      const _T& alpha,
+      const _T* itrA,
+      const unsigned long& LDA,
+      const long& strideA,
+      const _T* itrB,
+      const unsigned long& LDB,
+      const long& strideB,
+      const _T& beta,
+            _T* itrC,
+      const unsigned long& LDC,
+      const long& strideC,
+      const unsigned long& batch)
+   {
+      // For column-major order, recall this as C^T = B^T * A^T in row-major order
+      if (order == CblasColMajor)
+      {
+         gemm_batch_impl<true>::call(CblasRowMajor, transB, transA, Nsize, Msize, Ksize,
+                                     alpha, itrB, LDB, strideB, itrA, LDA, strideA, beta, itrC, LDC, strideC, batch);
+         return;
+      }
+
+      const unsigned long volume = std::max(Msize*Nsize*Ksize, 1ul);
+      auto gemms = [&](unsigned long first, unsigned long last)
+      {
+         for (unsigned long b = first; b < last; ++b)
+            impl::gemm_sized(transA, transB, Msize, Nsize, Ksize,
+                             alpha, itrA+b*strideA, LDA, itrB+b*strideB, LDB, beta, itrC+b*strideC, LDC);
+      };
+
+      // small GEMMs, or at least one per thread: split the batch, otherwise thread each GEMM
+      if (volume <= gemm_small_max_volume)
+         parallel_for(batch, std::max(elementwise_parallel_grain/volume, 1ul), gemms);
+      else if (batch >= parallel_width() && impl::gemm_sized_loop_parallel(volume))
+         parallel_for(batch, 1, gemms);
+      else
+         gemms(0, batch);
+   }
+
+#if defined(_HAS_CBLAS) && defined(_HAS_INTEL_MKL)
+
+   static void call (
+      const CBLAS_ORDER& order,
+      const CBLAS_TRANSPOSE& transA,
+      const CBLAS_TRANSPOSE& transB,
+      const unsigned long& Msize,
+      const unsigned long& Nsize,
+      const unsigned long& Ksize,
+      const float& alpha,
+      const float* itrA,
+      const unsigned long& LDA,
+      const long& strideA,
+      const float* itrB,
+      const unsigned long& LDB,
+      const long& strideB,
+      const float& beta,
+            float* itrC,
+      const unsigned long& LDC,
+      const long& strideC,
+      const unsigned long& batch)
+   {
+      cblas_sgemm_batch_strided(order, transA, transB, Msize, Nsize, Ksize,
+                                alpha, itrA, LDA, strideA, itrB, LDB, strideB, beta, itrC, LDC, strideC, batch);
+   }
+
+   static void call (
+      const CBLAS_ORDER& order,
+      const CBLAS_TRANSPOSE& transA,
+      const CBLAS_TRANSPOSE& transB,
+      const unsigned long& Msize,
+      const unsigned long& Nsize,
+      const unsigned long& Ksize,
+      const double& alpha,
+      const double* itrA,
+      const unsigned long& LDA,
+      const long& strideA,
+      const double* itrB,
+      const unsigned long& LDB,
+      const long& strideB,
+      const double& beta,
+            double* itrC,
+      const unsigned long& LDC,
+      const long& strideC,
+      const unsigned long& batch)
+   {
+      cblas_dgemm_batch_strided(order, transA, transB, Msize, Nsize, Ksize,
+                                alpha, itrA, LDA, strideA, itrB, LDB, strideB, beta, itrC, LDC, strideC, batch);
+   }
+
+   static void call (
+      const CBLAS_ORDER& order,
+      const CBLAS_TRANSPOSE& transA,
+      const CBLAS_TRANSPOSE& transB,
+      const unsigned long& Msize,
+      const unsigned long& Nsize,
+      const unsigned long& Ksize,
+      const std::complex<float>& alpha,
+      const std::complex<float>* itrA,
+      const unsigned long& LDA,
+      const long& strideA,
+      const std::complex<float>* itrB,
+      const unsigned long& LDB,
+      const long& strideB,
+      const std::complex<float>& beta,
+            std::complex<float>* itrC,
+      const unsigned long& LDC,
+      const long& strideC,
+      const unsigned long& batch)
+   {
+      cblas_cgemm_batch_strided(order, transA, transB, Msize, Nsize, Ksize,
+                                &alpha, itrA, LDA, strideA, itrB, LDB, strideB, &beta, itrC, LDC, strideC, batch);
+   }
+
+   static void call (
+      const CBLAS_ORDER& order,
+      const CBLAS_TRANSPOSE& transA,
+      const CBLAS_TRANSPOSE& transB,
+      const unsigned long& Msize,
+      const unsigned long& Nsize,
+      const unsigned long& Ksize,
+      const std::complex<double>& alpha,
+      const std::complex<double>* itrA,
+      const unsigned long& LDA,
+      const long& strideA,
+      const std::complex<double>* itrB,
+      const unsigned long& LDB,
+      const long& strideB,
+      const std::complex<double>& beta,
+            std::complex<double>* itrC,
+      const unsigned long& LDC,
+      const long& strideC,
+      const unsigned long& batch)
+   {
+      cblas_zgemm_batch_strided(order, transA, transB, Msize, Nsize, Ksize,
+                                &alpha, itrA, LDA, strideA, itrB, LDB, strideB, &beta, itrC, LDC, strideC, batch);
+   }
+
+#endif // _HAS_CBLAS && _HAS_INTEL_MKL
+
+};
+
+/// Batched GEMM with uniform strides, C_b = alpha * op(A_b) * op(B_b) + beta * C_b for b < batch,
+/// where A_b starts at A + b*strideA, B_b at B + b*strideB and C_b at C + b*strideC
+template<typename _T>
+void gemm_batch (
+   const CBLAS_ORDER& order,
+   const CBLAS_TRANSPOSE& transA,
+   const CBLAS_TRANSPOSE& transB,
+   const unsigned long& Msize,
+   const unsigned long& Nsize,
+   const unsigned long& Ksize,
+   const _T& alpha,
+   const _T* A,
+   const unsigned long& LDA,
+   const long& strideA,
+   const _T* B,
+   const unsigned long& LDB,
+   const long& strideB,
+   const _T& beta,
+         _T* C,
+   const unsigned long& LDC,
+   const long& strideC,
+   const unsigned long& batch)
+{
+   gemm_batch_impl<true>::call(order, transA, transB, Msize, Nsize, Ksize,
+                               alpha, A, LDA, strideA, B, LDB, strideB, beta, C, LDC, strideC, batch);
+}
+
+} // namespace btas
+
+#endif // __BTAS_GEMM_BATCH_H
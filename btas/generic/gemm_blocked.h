@@ -0,0 +1,403 @@
+#ifndef __BTAS_GEMM_BLOCKED_H
+#define __BTAS_GEMM_BLOCKED_H 1
+
+#include <algorithm>
+#include <complex>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include <btas/types.h>
+#include <btas/generic/numeric_type.h>
+#include <btas/generic/simd.h>
+#include <btas/util/parallel.h>
+
+namespace btas {
+
+namespace impl {
+    template<typename T> T conj(const T& t) { return t; }
+    template<typename T> std::complex<T> conj(const std::complex<T>& t) { return std::conj(t); }
+
+    /// c += a * b
+    template<typename T> void madd(T& c, const T& a, const T& b) { c += a * b; }
+
+    /// c += a * b, without the NaN/Inf recovery of std::complex::operator*
+    template<typename T> void madd(std::complex<T>& c, const std::complex<T>& a, const std::complex<T>& b)
+    {
+       c = std::complex<T>(c.real() + a.real()*b.real() - a.imag()*b.imag(),
+                           c.imag() + a.real()*b.imag() + a.imag()*b.real());
+    }
+}
+
+//  ================================================================================================
+
+/// Blocking parameters of the packed GEMM kernel
+/// MR x NR is the micro-tile of C held in registers, for float and double 2*MR vector registers with AVX2,
+/// so NR must be a multiple of the widest vector (16 floats or 8 doubles with AVX-512),
+/// KC x NR panels of B are meant to stay in L1, MC x KC blocks of A in L2 and KC x NC panels of B in L3
+template<typename _T> struct gemm_blocking { };
+
+template<> struct gemm_blocking<float>
+{
+   static const unsigned long MR =    6;
+   static const unsigned long NR =   16;
+   static const unsigned long KC =  256;
+   static const unsigned long MC =  144;
+   static const unsigned long NC = 4096;
+};
+
+template<> struct gemm_blocking<double>
+{
+   static const unsigned long MR =    6;
+   static const unsigned long NR =    8;
+   static const unsigned long KC =  256;
+   static const unsigned long MC =   96;
+   static const unsigned long NC = 4096;
+};
+
+template<> struct gemm_blocking<std::complex<float>>
+{
+   static const unsigned long MR =    4;
+   static const unsigned long NR =    4;
+   static const unsigned long KC =  192;
+   static const unsigned long MC =   96;
+   static const unsigned long NC = 2048;
+};
+
+template<> struct gemm_blocking<std::complex<double>>
+{
+   static const unsigned long MR =    2;
+   static const unsigned long NR =    4;
+   static const unsigned long KC =  128;
+   static const unsigned long MC =   64;
+   static const unsigned long NC = 2048;
+};
+
+/// below this many multiply-adds the packed GEMM kernel runs on the calling thread only
+const unsigned long gemm_parallel_min_volume = 1ul << 18;
+
+/// test whether _T is handled by the packed GEMM kernel
+template<typename _T>
+struct is_gemm_blocked_type {
+   static constexpr const bool value = std::is_same<_T, float>::value ||
+                                       std::is_same<_T, double>::value ||
+                                       std::is_same<_T, std::complex<float>>::value ||
+                                       std::is_same<_T, std::complex<double>>::value;
+};
+
+namespace impl {
+
+/// Packs mc x kc block of op(A) into row panels of height MR, zero-padded to a multiple of MR,
+/// converting the elements to the type of the buffer;
+/// panel p holds op(A)(p*MR+r, k) at [p*MR*kc + k*MR + r]
+template<unsigned long MR, typename _T, typename _S>
+void gemm_pack_a (
+   const CBLAS_TRANSPOSE& transA,
+   const unsigned long& mc,
+   const unsigned long& kc,
+   const _S* A,
+   const unsigned long& LDA,
+         _T* buf)
+{
+   for (unsigned long ip = 0; ip < mc; ip += MR)
+   {
+      const unsigned long mr = std::min(MR, mc-ip);
+      if (transA == CblasNoTrans)
+      {
+         for (unsigned long k = 0; k < kc; ++k, buf += MR)
+         {
+            unsigned long r = 0;
+            for (; r < mr; ++r) buf[r] = A[(ip+r)*LDA+k];
+            for (; r < MR; ++r) buf[r] = NumericType<_T>::zero();
+         }
+      }
+      else
+      {
+         const bool cj = (transA == CblasConjTrans);
+         for (unsigned long k = 0; k < kc; ++k, buf += MR)
+         {
+            const _S* a = A + k*LDA + ip;
+            unsigned long r = 0;
+            if (cj) for (; r < mr; ++r) buf[r] = impl::conj(a[r]);
+            else    for (; r < mr; ++r) buf[r] = a[r];
+            for (; r < MR; ++r) buf[r] = NumericType<_T>::zero();
+         }
+      }
+   }
+}
+
+/// Packs kc x nc panel of op(B) into column panels of width NR, zero-padded to a multiple of NR,
+/// converting the elements to the type of the buffer;
+/// panel q holds op(B)(k, q*NR+c) at [q*NR*kc + k*NR + c]
+template<unsigned long NR, typename _T, typename _S>
+void gemm_pack_b (
+   const CBLAS_TRANSPOSE& transB,
+   const unsigned long& kc,
+   const unsigned long& nc,
+   const _S* B,
+   const unsigned long& LDB,
+         _T* buf)
+{
+   for (unsigned long jp = 0; jp < nc; jp += NR)
+   {
+      const unsigned long nr = std::min(NR, nc-jp);
+      if (transB == CblasNoTrans)
+      {
+         for (unsigned long k = 0; k < kc; ++k, buf += NR)
+         {
+            const _S* b = B + k*LDB + jp;
+            unsigned long c = 0;
+            for (; c < nr; ++c) buf[c] = b[c];
+            for (; c < NR; ++c) buf[c] = NumericType<_T>::zero();
+         }
+      }
+      else
+      {
+         const bool cj = (transB == CblasConjTrans);
+         for (unsigned long k = 0; k < kc; ++k, buf += NR)
+         {
+            unsigned long c = 0;
+            if (cj) for (; c < nr; ++c) buf[c] = impl::conj(B[(jp+c)*LDB+k]);
+            else    for (; c < nr; ++c) buf[c] = B[(jp+c)*LDB+k];
+            for (; c < NR; ++c) buf[c] = NumericType<_T>::zero();
+         }
+      }
+   }
+}
+
+/// Register micro-kernel: C[0:mr, 0:nr] += alpha * Ap * Bp
+/// Ap is a packed MR x kc panel and Bp a packed kc x NR panel, C is row-major with leading dimension LDC
+template<unsigned long MR, unsigned long NR, typename _T>
+void gemm_micro_kernel (
+   const unsigned long& kc,
+   const _T& alpha,
+   const _T* Ap,
+   const _T* Bp,
+         _T* C,
+   const unsigned long& LDC,
+   const unsigned long& mr,
+   const unsigned long& nr)
+{
+   if (simd::gemm_tile<MR, NR>(kc, alpha, Ap, Bp, C, LDC, mr, nr)) return;
+
+   // otherwise real tiles are done in column strips of 32 bytes, whose MR x NS accumulators the compiler
+   // can keep in the 16 vector registers of SSE2
+   const unsigned long NS = (std::is_arithmetic<_T>::value && NR % (32/sizeof(_T)) == 0) ? 32/sizeof(_T) : NR;
+   for (unsigned long js = 0; js < nr; js += NS)
+   {
+      _T ab[MR*NS];
+      std::fill(ab, ab+MR*NS, NumericType<_T>::zero());
+
+      const _T* a = Ap;
+      const _T* b = Bp + js;
+      for (unsigned long k = 0; k < kc; ++k, a += MR, b += NR)
+      {
+         for (unsigned long i = 0; i < MR; ++i)
+         {
+            const _T ai = a[i];
+            for (unsigned long j = 0; j < NS; ++j)
+            {
+               madd(ab[i*NS+j], ai, b[j]);
+            }
+         }
+      }
+
+      _T* c = C + js;
+      for (unsigned long i = 0; i < mr; ++i, c += LDC)
+      {
+         for (unsigned long j = 0; j < std::min(NS, nr-js); ++j)
+         {
+            madd(c[j], alpha, ab[i*NS+j]);
+         }
+      }
+   }
+}
+
+/// Cache-blocked GEMM on contiguous row-major data,
+/// C = alpha * op(A) * op(B) + beta * C, op being one of NoTrans, Trans or ConjTrans;
+/// A and B may be stored in another type than C, to which they are converted as they are packed
+template<typename _T, typename _S,
+         class = typename std::enable_if<!is_reduced_float<_T>::value>::type>
+void gemm_blocked (
+   const CBLAS_TRANSPOSE& transA,
+   const CBLAS_TRANSPOSE& transB,
+   const unsigned long& Msize,
+   const unsigned long& Nsize,
+   const unsigned long& Ksize,
+   const _T& alpha,
+   const _S* A,
+   const unsigned long& LDA,
+   const _S* B,
+   const unsigned long& LDB,
+   const _T& beta,
+         _T* C,
+   const unsigned long& LDC)
+{
+   const unsigned long MR = gemm_blocking<_T>::MR;
+   const unsigned long NR = gemm_blocking<_T>::NR;
+   const unsigned long KC = gemm_blocking<_T>::KC;
+   const unsigned long MC = gemm_blocking<_T>::MC;
+   const unsigned long NC = gemm_blocking<_T>::NC;
+
+   if (Msize == 0 || Nsize == 0) return;
+
+   // small products are not worth waking up the thread pool
+   const unsigned long grain = (Msize*Nsize*Ksize >= gemm_parallel_min_volume) ? 1 : std::numeric_limits<unsigned long>::max();
+
+   // C is not read if beta is zero, as in BLAS
+   if (beta == NumericType<_T>::zero())
+   {
+      parallel_for(Msize, grain, [&](unsigned long i0, unsigned long i1)
+      {
+         for (unsigned long i = i0; i < i1; ++i)
+            std::fill(C+i*LDC, C+i*LDC+Nsize, NumericType<_T>::zero());
+      });
+   }
+   else if (beta != NumericType<_T>::one())
+   {
+      parallel_for(Msize, grain, [&](unsigned long i0, unsigned long i1)
+      {
+         for (unsigned long i = i0; i < i1; ++i)
+            for (unsigned long j = 0; j < Nsize; ++j) C[i*LDC+j] *= beta;
+      });
+   }
+
+   if (Ksize == 0 || alpha == NumericType<_T>::zero()) return;
+
+   const unsigned long kcmax = std::min(KC, Ksize);
+   const unsigned long mcmax = std::min(MC, Msize);
+   const unsigned long ncmax = std::min(NC, Nsize);
+   const unsigned long Asize = kcmax * ((mcmax+MR-1)/MR) * MR;
+   std::vector<_T> Abuf(Asize);
+   std::vector<_T> Bbuf(kcmax * ((ncmax+NR-1)/NR) * NR);
+
+   // blocks of MC rows are shared out between threads if there are enough of them,
+   // otherwise each block is split by NR-wide column panels
+   const unsigned long nic = (Msize+MC-1)/MC;
+   const bool split_rows = (nic >= parallel_width());
+
+   for (unsigned long jc = 0; jc < Nsize; jc += NC)
+   {
+      const unsigned long nc = std::min(NC, Nsize-jc);
+      const unsigned long njr = (nc+NR-1)/NR;
+      for (unsigned long pc = 0; pc < Ksize; pc += KC)
+      {
+         const unsigned long kc = std::min(KC, Ksize-pc);
+         const _S* Bblk = (transB == CblasNoTrans) ? B + pc*LDB + jc : B + jc*LDB + pc;
+         parallel_for(njr, grain, [&](unsigned long q0, unsigned long q1)
+         {
+            const unsigned long j0 = q0*NR;
+            gemm_pack_b<NR>(transB, kc, std::min(q1*NR, nc)-j0, (transB == CblasNoTrans) ? Bblk + j0 : Bblk + j0*LDB, LDB, Bbuf.data()+j0*kc);
+         });
+
+         // C[ic:ic+mc, jc+jr] += alpha * op(A)[ic:ic+mc, pc:pc+kc] * op(B)[pc:pc+kc, jc+jr] for the column panels [q0, q1)
+         auto macro_kernel = [&](const unsigned long& ic, const _T* Ap, const unsigned long& q0, const unsigned long& q1)
+         {
+            const unsigned long mc = std::min(MC, Msize-ic);
+            for (unsigned long jr = q0*NR; jr < std::min(q1*NR, nc); jr += NR)
+            {
+               const unsigned long nr = std::min(NR, nc-jr);
+               for (unsigned long ir = 0; ir < mc; ir += MR)
+               {
+                  const unsigned long mr = std::min(MR, mc-ir);
+                  gemm_micro_kernel<MR, NR>(kc, alpha, Ap+ir*kc, Bbuf.data()+jr*kc,
+                                            C+(ic+ir)*LDC+jc+jr, LDC, mr, nr);
+               }
+            }
+         };
+         auto pack_a = [&](const unsigned long& ic, _T* Ap)
+         {
+            const _S* Ablk = (transA == CblasNoTrans) ? A + ic*LDA + pc : A + pc*LDA + ic;
+            gemm_pack_a<MR>(transA, std::min(MC, Msize-ic), kc, Ablk, LDA, Ap);
+         };
+
+         if (split_rows)
+         {
+            parallel_for(nic, grain, [&](unsigned long b0, unsigned long b1)
+            {
+               std::vector<_T> Ab;
+               _T* Ap = Abuf.data();
+               if (b0 != 0) { Ab.resize(Asize); Ap = Ab.data(); }
+               for (unsigned long b = b0; b < b1; ++b)
+               {
+                  pack_a(b*MC, Ap);
+                  macro_kernel(b*MC, Ap, 0, njr);
+               }
+            });
+         }
+         else
+         {
+            for (unsigned long ic = 0; ic < Msize; ic += MC)
+            {
+               pack_a(ic, Abuf.data());
+               parallel_for(njr, grain, [&](unsigned long q0, unsigned long q1)
+               {
+                  macro_kernel(ic, Abuf.data(), q0, q1);
+               });
+            }
+         }
+      }
+   }
+}
+
+/// elements of the float copy of C made by GEMM on 16-bit data, rounded down to blocks of MC rows but at least one
+const unsigned long gemm_widened_buffer = 1ul << 20;
+
+/// Cache-blocked GEMM on 16-bit data (half, bfloat16), C = alpha * op(A) * op(B) + beta * C in float:
+/// op(A) and op(B) are widened as they are packed, and each block of rows of C is copied into a float
+/// buffer, updated by the float kernel over all of K and rounded back once
+template<typename _T, typename _S,
+         class = typename std::enable_if<is_reduced_float<_S>::value>::type>
+void gemm_blocked (
+   const CBLAS_TRANSPOSE& transA,
+   const CBLAS_TRANSPOSE& transB,
+   const unsigned long& Msize,
+   const unsigned long& Nsize,
+   const unsigned long& Ksize,
+   const _T& alpha,
+   const _S* A,
+   const unsigned long& LDA,
+   const _S* B,
+   const unsigned long& LDB,
+   const _T& beta,
+         _S* C,
+   const unsigned long& LDC)
+{
+   typedef typename accumulate_type<_S>::type value_type;
+   if (Msize == 0 || Nsize == 0) return;
+
+   const value_type a = static_cast<value_type>(alpha);
+   const value_type b = static_cast<value_type>(beta);
+   const unsigned long MC = gemm_blocking<value_type>::MC;
+   const unsigned long rows = std::min(Msize, std::max(MC, gemm_widened_buffer / Nsize / MC * MC));
+   std::vector<value_type> Cbuf(rows * Nsize);
+   const unsigned long grain = (rows*Nsize >= 2*elementwise_parallel_grain) ? std::max(elementwise_parallel_grain / Nsize, 1ul)
+                                                                           : std::numeric_limits<unsigned long>::max();
+
+   for (unsigned long i0 = 0; i0 < Msize; i0 += rows)
+   {
+      const unsigned long mb = std::min(rows, Msize-i0);
+      _S* Ci = C + i0*LDC;
+      if (b != NumericType<value_type>::zero())
+      {
+         parallel_for(mb, grain, [&](unsigned long r0, unsigned long r1)
+         {
+            for (unsigned long i = r0; i < r1; ++i)
+               std::copy(Ci+i*LDC, Ci+i*LDC+Nsize, Cbuf.data()+i*Nsize);
+         });
+      }
+      gemm_blocked(transA, transB, mb, Nsize, Ksize, a, (transA == CblasNoTrans) ? A + i0*LDA : A + i0, LDA,
+                   B, LDB, b, Cbuf.data(), Nsize);
+      parallel_for(mb, grain, [&](unsigned long r0, unsigned long r1)
+      {
+         for (unsigned long i = r0; i < r1; ++i)
+            std::copy(Cbuf.data()+i*Nsize, Cbuf.data()+(i+1)*Nsize, Ci+i*LDC);
+      });
+   }
+}
+
+} // namespace impl
+
+} // namespace btas
+
+#endif // __BTAS_GEMM_BLOCKED_H
@@ -14,13 +14,62 @@
 #include <btas/generic/tensor_iterator_wrapper.h>
 
 #include <btas/generic/scal_impl.h>
+#include <btas/generic/gemm_blocked.h>
+#include <btas/generic/strided_view.h>
 
 namespace btas {
 
-namespace impl {
-    template<typename T> T conj(const T& t) { return t; }
-    template<typename T> std::complex<T> conj(const std::complex<T>& t) { return std::conj(t); }
-}
+/// test whether GEMM on these iterators can be done by the packed kernel, i.e. they are bare pointers to float, double or complex
+/// and the scalars are of that type, or to a 16-bit type (half, bfloat16) and the scalars are of that type or float
+template<typename _T, class _IteratorA, class _IteratorB, class _IteratorC>
+struct is_gemm_blocked_call {
+   typedef typename std::iterator_traits<_IteratorC>::value_type value_type;
+   static constexpr const bool value =
+      std::is_pointer<_IteratorA>::value && std::is_pointer<_IteratorB>::value && std::is_pointer<_IteratorC>::value &&
+      std::is_same<typename std::remove_cv<typename std::iterator_traits<_IteratorA>::value_type>::type, value_type>::value &&
+      std::is_same<typename std::remove_cv<typename std::iterator_traits<_IteratorB>::value_type>::type, value_type>::value &&
+      not std::is_const<typename std::remove_pointer<_IteratorC>::type>::value &&
+      ((is_gemm_blocked_type<_T>::value && std::is_same<value_type, _T>::value) ||
+       (is_reduced_float<value_type>::value && (std::is_same<value_type, _T>::value ||
+                                                std::is_same<typename accumulate_type<value_type>::type, _T>::value)));
+};
+
+/// Redirects to the packed kernel if the iterators allow it
+template<bool _Blocked> struct gemm_blocked_dispatch
+{
+   template<typename _T, class _IteratorA, class _IteratorB, class _IteratorC>
+   static bool call (
+      const CBLAS_TRANSPOSE&, const CBLAS_TRANSPOSE&,
+      const unsigned long&, const unsigned long&, const unsigned long&,
+      const _T&, _IteratorA, const unsigned long&, _IteratorB, const unsigned long&,
+      const _T&, _IteratorC, const unsigned long&)
+   {
+      return false;
+   }
+};
+
+template<> struct gemm_blocked_dispatch<true>
+{
+   template<typename _T, typename _S>
+   static bool call (
+      const CBLAS_TRANSPOSE& transA,
+      const CBLAS_TRANSPOSE& transB,
+      const unsigned long& Msize,
+      const unsigned long& Nsize,
+      const unsigned long& Ksize,
+      const _T& alpha,
+      const _S* itrA,
+      const unsigned long& LDA,
+      const _S* itrB,
+      const unsigned long& LDB,
+      const _T& beta,
+            _S* itrC,
+      const unsigned long& LDC)
+   {
+      impl::gemm_blocked(transA, transB, Msize, Nsize, Ksize, alpha, itrA, LDA, itrB, LDB, beta, itrC, LDC);
+      return true;
+   }
+};
 
 template<bool _Finalize> struct gemm_impl { };
 
@@ -52,6 +101,13 @@ template<> struct gemm_impl<true>
          return;
       }
 
+      // contiguous float, double and complex data go to the cache-blocked kernel
+      if (gemm_blocked_dispatch<is_gemm_blocked_call<_T, _IteratorA, _IteratorB, _IteratorC>::value>::call(
+            transA, transB, Msize, Nsize, Ksize, alpha, itrA, LDA, itrB, LDB, beta, itrC, LDC))
+      {
+         return;
+      }
+
       if (beta != NumericType<_T>::one())
       {
          scal (Msize*Nsize, beta, itrC, 1);
@@ -464,7 +520,11 @@ void gemm (
    static_assert(std::is_same<typename __traits_C::iterator_category, std::random_access_iterator_tag>::value,
                  "iterator C must be a random access iterator");
 
-   gemm_impl<std::is_same<value_type, _T>::value>::call(order, transA, transB, Msize, Nsize, Ksize, alpha, itrA, LDA, itrB, LDB, beta, itrC, LDC);
+   // 16-bit data are multiplied by scalars in float, the type its kernels compute in
+   typedef typename std::conditional<is_reduced_float<value_type>::value && std::is_arithmetic<_T>::value,
+                                     typename accumulate_type<value_type>::type, _T>::type __scalar;
+   gemm_impl<std::is_same<value_type, _T>::value || is_reduced_float<value_type>::value>::call(
+      order, transA, transB, Msize, Nsize, Ksize, static_cast<__scalar>(alpha), itrA, LDA, itrB, LDB, static_cast<__scalar>(beta), itrC, LDC);
 }
 
 //  ================================================================================================
@@ -477,6 +537,7 @@ void gemm (
 /// \param b input tensor
 /// \param beta scalar value to be multiplied to \param c
 /// \param c output tensor which can be empty tensor but needs to have rank info
+/// GEMM of views (e.g. slices) is in btas/generic/contract.h
 template<
    typename _T,
    class _TensorA, class _TensorB, class _TensorC,
@@ -485,7 +546,8 @@ template<
       is_boxtensor<_TensorB>::value &
       is_boxtensor<_TensorC>::value &
       std::is_same<typename _TensorA::value_type, typename _TensorB::value_type>::value &
-      std::is_same<typename _TensorA::value_type, typename _TensorC::value_type>::value
+      std::is_same<typename _TensorA::value_type, typename _TensorC::value_type>::value &
+      not (is_strided_view<_TensorA>::value | is_strided_view<_TensorB>::value | is_strided_view<_TensorC>::value)
    >::type
 >
 void gemm (
@@ -613,9 +675,9 @@ void gemm (
         NumericType<value_type>::fill(std::begin(C), std::end(C), NumericType<value_type>::zero());
    }
 
-   auto itrA = std::begin(A);
-   auto itrB = std::begin(B);
-   auto itrC = std::begin(C);
+   auto itrA = tbegin(A);
+   auto itrB = tbegin(B);
+   auto itrC = tbegin(C);
 
    gemm (order, transA, transB, Msize, Nsize, Ksize, alpha, itrA, LDA, itrB, LDB, beta, itrC, LDC);
 }
@@ -13,6 +13,8 @@
 #include <btas/generic/tensor_iterator_wrapper.h>
 
 #include <btas/generic/scal_impl.h>
+#include <btas/generic/gemm_blocked.h>
+#include <btas/generic/strided_view.h>
 
 namespace btas {
 
@@ -170,6 +172,38 @@ template<> struct gemv_impl<true>
 
 #endif // _HAS_CBLAS
 
+   /// 16-bit data (half, bfloat16) are multiplied by the packed GEMM kernel as a product with one column,
+   /// so that each element of Y is summed in float
+   template<class _Format>
+   static void call (
+      const CBLAS_ORDER& order,
+      const CBLAS_TRANSPOSE& transA,
+      const unsigned long& Msize,
+      const unsigned long& Nsize,
+      const float& alpha,
+      const reduced_float<_Format>* itrA,
+      const unsigned long& LDA,
+      const reduced_float<_Format>* itrX,
+      const typename std::iterator_traits<reduced_float<_Format>*>::difference_type& incX,
+      const float& beta,
+            reduced_float<_Format>* itrY,
+      const typename std::iterator_traits<reduced_float<_Format>*>::difference_type& incY)
+   {
+      if (incX < 1 || incY < 1)
+      {
+         call<float, const reduced_float<_Format>*, const reduced_float<_Format>*, reduced_float<_Format>*>(
+            order, transA, Msize, Nsize, alpha, itrA, LDA, itrX, incX, beta, itrY, incY);
+         return;
+      }
+      // a column-major matrix is the transpose of a row-major one
+      const bool trans = (transA != CblasNoTrans) == (order == CblasRowMajor);
+      const unsigned long rows = (order == CblasRowMajor) ? Msize : Nsize;
+      const unsigned long cols = (order == CblasRowMajor) ? Nsize : Msize;
+      if (trans)
+         impl::gemm_blocked(CblasTrans, CblasNoTrans, cols, 1ul, rows, alpha, itrA, LDA, itrX, incX, beta, itrY, incY);
+      else
+         impl::gemm_blocked(CblasNoTrans, CblasNoTrans, rows, 1ul, cols, alpha, itrA, LDA, itrX, incX, beta, itrY, incY);
+   }
 };
 
 template<> struct gemv_impl<false>
@@ -282,7 +316,10 @@ void gemv (
    static_assert(std::is_same<typename __traits_Y::iterator_category, std::random_access_iterator_tag>::value,
                  "iterator Y must be a random access iterator");
 
-   gemv_impl<std::is_same<value_type, _T>::value>::call(order, transA, Msize, Nsize, alpha, itrA, LDA, itrX, incX, beta, itrY, incY);
+   typedef typename std::conditional<is_reduced_float<value_type>::value && std::is_arithmetic<_T>::value,
+                                     typename accumulate_type<value_type>::type, _T>::type __scalar;
+   gemv_impl<std::is_same<value_type, _T>::value || is_reduced_float<value_type>::value>::call(
+      order, transA, Msize, Nsize, static_cast<__scalar>(alpha), itrA, LDA, itrX, incX, static_cast<__scalar>(beta), itrY, incY);
 }
 
 //  ================================================================================================
@@ -296,13 +333,15 @@ void gemv (
 /// \param beta scalar value to be multiplied to Y
 /// \param Y output tensor which can be empty tensor but needs to have rank info (= size of shape).
 /// Iterator is assumed to be consecutive (or, random_access_iterator) , thus e.g. iterator to map doesn't work.
+/// GEMV of views (e.g. slices) is in btas/generic/contract.h
 template<
    typename _T,
    class _TensorA, class _TensorX, class _TensorY,
    class = typename std::enable_if<
       is_boxtensor<_TensorA>::value &
       is_boxtensor<_TensorX>::value &
-      is_boxtensor<_TensorY>::value
+      is_boxtensor<_TensorY>::value &
+      not (is_strided_view<_TensorA>::value | is_strided_view<_TensorX>::value | is_strided_view<_TensorY>::value)
    >::type
 >
 void gemv (
@@ -380,9 +419,9 @@ void gemv (
       assert(std::equal(std::begin(extentY), std::end(extentY), std::begin(extent(Y))));
    }
 
-   auto itrA = std::begin(A);
-   auto itrX = std::begin(X);
-   auto itrY = std::begin(Y);
+   auto itrA = tbegin(A);
+   auto itrX = tbegin(X);
+   auto itrY = tbegin(Y);
 
    gemv (order, transA, Msize, Nsize, alpha, itrA, LDA, itrX, 1, beta, itrY, 1);
 }
@@ -208,7 +208,10 @@ void ger (
    static_assert(std::is_same<typename __traits_A::iterator_category, std::random_access_iterator_tag>::value,
                  "iterator A must be a random access iterator");
 
-   ger_impl<std::is_same<value_type, _T>::value>::call(order, Msize, Nsize, alpha, itrX, incX, itrY, incY, itrA, LDA);
+   typedef typename std::conditional<is_reduced_float<value_type>::value && std::is_arithmetic<_T>::value,
+                                     typename accumulate_type<value_type>::type, _T>::type __scalar;
+   ger_impl<std::is_same<value_type, _T>::value || is_reduced_float<value_type>::value>::call(
+      order, Msize, Nsize, static_cast<__scalar>(alpha), itrX, incX, itrY, incY, itrA, LDA);
 }
 
 //  ================================================================================================
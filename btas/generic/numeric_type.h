@@ -6,6 +6,8 @@
 #include <iterator>
 #include <type_traits>
 
+#include <btas/half.h>
+
 namespace btas {
 
 /// Numeric value functions
@@ -137,6 +139,32 @@ template <> struct NumericType<std::complex<double>>
    }
 };
 
+/// 16-bit real number (half, bfloat16), scaled in float
+template <class _Format> struct NumericType<reduced_float<_Format>>
+{
+   /// \return 0
+   static reduced_float<_Format> zero () { return reduced_float<_Format>(); }
+   /// \return 1
+   static reduced_float<_Format> one  () { return reduced_float<_Format>(1.0f); }
+
+   template<class _Iterator>
+   static void fill(_Iterator first, _Iterator last, const reduced_float<_Format>& val)
+   {
+      static_assert(std::is_convertible<reduced_float<_Format>, typename std::iterator_traits<_Iterator>::value_type>::value, "Value type is not convertible");
+      std::fill(first, last, val);
+   }
+
+   template<class _Iterator>
+   static void scal(_Iterator first, _Iterator last, const float& val)
+   {
+      while (first != last)
+      {
+         (*first) *= val;
+         ++first;
+      }
+   }
+};
+
 }; // namespace btas
 
 #endif // __BTAS_NUMERIC_TYPE_H
@@ -4,9 +4,11 @@
 #include <algorithm>
 #include <iterator>
 #include <type_traits>
+#include <vector>
 
 #include <btas/types.h>
 #include <btas/util/resize.h>
+#include <btas/generic/transpose.h>
 
 #include <btas/tensor.h>
 #include <btas/tensor_traits.h>
@@ -14,7 +16,48 @@
 
 namespace btas {
 
+  template<bool _HasData>
+  struct permute_impl
+  {
+    /// element-wise permute, for tensors without contiguous storage
+    template<class _TensorX, typename _Permutation, class _TensorY>
+    static void call(const _TensorX& X, const _Permutation& p, _TensorY& Y) {
+      const auto n = rank(p);
+      auto j = Y.range().lobound();
+      auto itrX = std::begin(X);
+      auto itrY = std::begin(Y);
+      for (auto i : X.range()) {
+        for (size_t d = 0; d < n; ++d) j[d] = i[p[d]];
+        *(itrY + Y.range().ordinal(j)) = *itrX;
+        ++itrX;
+      }
+    }
+  };
+
+  template<>
+  struct permute_impl<true>
+  {
+    /// blocked permute through the strides of X and Y, see impl::transpose
+    template<class _TensorX, typename _Permutation, class _TensorY>
+    static void call(const _TensorX& X, const _Permutation& p, _TensorY& Y) {
+      const auto n = rank(p);
+      const auto& strideX = X.range().ordinal().stride();
+      const auto lbX = X.range().lobound();
+      const auto ubX = X.range().upbound();
+      std::vector<unsigned long> extent(n);
+      std::vector<long> strideXp(n);
+      for (size_t d = 0; d < n; ++d) {
+        extent[d] = ubX[p[d]] - lbX[p[d]];
+        strideXp[d] = strideX[p[d]];
+      }
+      impl::transpose(extent, X.data(), strideXp, Y.data(), Y.range().ordinal().stride());
+    }
+  };
+
   /// permute \c X using permutation \c p, write result to \c Y
+
+  /// \c Y is resized to the permuted range of \c X with the default (contiguous) layout,
+  /// so that Y(i[p[0]], i[p[1]], ...) = X(i[0], i[1], ...)
   template<class _TensorX, typename _Permutation, class _TensorY,
            class = typename std::enable_if<is_boxtensor<_TensorX>::value &&
                                            is_index<_Permutation>::value &&
@@ -22,13 +65,10 @@ namespace btas {
                                           >::type
           >
   void permute(const _TensorX& X, const _Permutation& p, _TensorY& Y) {
-    Y.resize(permute(X.range(), p));
-    auto itrX = std::begin(X);
-    auto itrY = std::begin(Y);
-    for (auto i : X.range()) {
-      *(itrY + Y.range().ordinal(i)) = *itrX;
-      ++itrX;
-    }
+    const auto prange = permute(X.range(), p);
+    Y.resize(typename _TensorY::range_type(prange.lobound(), prange.upbound()));
+    if (Y.size() == 0) return;
+    permute_impl<has_data<_TensorX>::value && has_data<_TensorY>::value>::call(X, p, Y);
   }
 
   /// permute \c X using permutation \c p, write result to \c Y
@@ -10,6 +10,9 @@
 
 #include <btas/generic/numeric_type.h>
 #include <btas/generic/tensor_iterator_wrapper.h>
+#include <btas/generic/simd.h>
+#include <btas/util/parallel.h>
+#include <btas/generic/strided_view.h>
 
 namespace btas {
 
@@ -65,7 +68,54 @@ template<> struct scal_impl<true>
    {
       cblas_zscal(Nsize, &alpha, itrX, incX);
    }
+#else
+   static void call (
+      const unsigned long& Nsize,
+      const float& alpha,
+            float* itrX, const typename std::iterator_traits<float*>::difference_type& incX)
+   {
+      if (incX == 1) parallel_for(Nsize, elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) { simd::scal(i1-i0, alpha, itrX+i0); });
+      else call<float, float*>(Nsize, alpha, itrX, incX);
+   }
+
+   static void call (
+      const unsigned long& Nsize,
+      const double& alpha,
+            double* itrX, const typename std::iterator_traits<double*>::difference_type& incX)
+   {
+      if (incX == 1) parallel_for(Nsize, elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) { simd::scal(i1-i0, alpha, itrX+i0); });
+      else call<double, double*>(Nsize, alpha, itrX, incX);
+   }
+
+   static void call (
+      const unsigned long& Nsize,
+      const std::complex<float>& alpha,
+            std::complex<float>* itrX, const typename std::iterator_traits<std::complex<float>*>::difference_type& incX)
+   {
+      if (incX == 1) parallel_for(Nsize, elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) { simd::scal(i1-i0, alpha, itrX+i0); });
+      else call<std::complex<float>, std::complex<float>*>(Nsize, alpha, itrX, incX);
+   }
+
+   static void call (
+      const unsigned long& Nsize,
+      const std::complex<double>& alpha,
+            std::complex<double>* itrX, const typename std::iterator_traits<std::complex<double>*>::difference_type& incX)
+   {
+      if (incX == 1) parallel_for(Nsize, elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) { simd::scal(i1-i0, alpha, itrX+i0); });
+      else call<std::complex<double>, std::complex<double>*>(Nsize, alpha, itrX, incX);
+   }
 #endif
+
+   /// 16-bit data (half, bfloat16) are scaled in float
+   template<class _Format>
+   static void call (
+      const unsigned long& Nsize,
+      const float& alpha,
+            reduced_float<_Format>* itrX, const typename std::iterator_traits<reduced_float<_Format>*>::difference_type& incX)
+   {
+      if (incX == 1) parallel_for(Nsize, elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) { for (unsigned long i = i0; i < i1; ++i) itrX[i] = alpha * static_cast<float>(itrX[i]); });
+      else call<float, reduced_float<_Format>*>(Nsize, alpha, itrX, incX);
+   }
 };
 
 /// Case that alpha is multiplied recursively by SCAL
@@ -85,6 +135,40 @@ template<> struct scal_impl<false>
    }
 };
 
+/// Scaling by zero writes zeros, whatever the elements held (e.g. NaN from uninitialized storage),
+/// so that beta == 0 in GEMM, GEMV and contract overwrites the output as in BLAS
+template<bool _Finalize> struct scal_zero
+{
+   template<typename _T, class _IteratorX>
+   static bool call (const unsigned long&, const _T&, _IteratorX, const typename std::iterator_traits<_IteratorX>::difference_type&)
+   {
+      return false;
+   }
+};
+
+template<> struct scal_zero<true>
+{
+   template<typename _T, class _IteratorX>
+   static bool call (
+      const unsigned long& Nsize,
+      const _T& alpha,
+            _IteratorX itrX, const typename std::iterator_traits<_IteratorX>::difference_type& incX)
+   {
+      typedef typename std::iterator_traits<_IteratorX>::value_type value_type;
+      if (alpha != NumericType<_T>::zero()) return false;
+      const value_type zero = static_cast<value_type>(alpha);
+      if (incX == 1)
+      {
+         parallel_for(Nsize, elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) { std::fill(itrX+i0, itrX+i1, zero); });
+      }
+      else
+      {
+         for (unsigned long i = 0; i < Nsize; ++i, itrX += incX) *itrX = zero;
+      }
+      return true;
+   }
+};
+
 //  ================================================================================================
 
 /// Generic implementation of BLAS SCAL in terms of C++ iterator
@@ -99,12 +183,38 @@ void scal (
    static_assert(std::is_same<typename __traits_X::iterator_category, std::random_access_iterator_tag>::value, "iterator X must be a random access iterator");
 
    typedef typename __traits_X::value_type __value_X;
-   typedef typename std::conditional<std::is_convertible<_T, __value_X>::value, __value_X, _T>::type __alpha;
+   typedef typename std::conditional<std::is_convertible<_T, __value_X>::value, typename accumulate_type<__value_X>::type, _T>::type __alpha;
+   if (scal_zero<std::is_convertible<_T, __value_X>::value>::call(Nsize, static_cast<__alpha>(alpha), itrX, incX)) return;
    scal_impl<std::is_convertible<_T, __value_X>::value>::call(Nsize, static_cast<__alpha>(alpha), itrX, incX);
 }
 
 //  ================================================================================================
 
+/// Scales the elements of a tensor in one call, or those of a view block by block through the strides of its range
+template<bool _View> struct scal_tensor_impl
+{
+   template<typename _T, class _TensorX>
+   static void call (const _T& alpha, _TensorX& X)
+   {
+      auto itrX = tbegin(X);
+      scal (X.size(), alpha, itrX, 1);
+   }
+};
+
+template<> struct scal_tensor_impl<true>
+{
+   template<typename _T, class _TensorX>
+   static void call (const _T& alpha, _TensorX& X)
+   {
+      auto ptrX = strided_data(X);
+      const auto& stride = X.range().ordinal().stride();
+      impl::for_each_strided_block(extent(X), stride, stride, [&](long oX, long, unsigned long n, long incX, long)
+      {
+         scal (n, alpha, ptrX+oX, incX);
+      });
+   }
+};
+
 /// Convenient wrapper to call BLAS SCAL from tensor objects
 template<
    typename _T,
@@ -122,9 +232,7 @@ void scal (
       return;
    }
 
-   auto itrX = std::begin(X);
-
-   scal (X.size(), alpha, itrX, 1);
+   scal_tensor_impl<is_strided_view<_TensorX>::value>::call(alpha, X);
 }
 
 } // namespace btas
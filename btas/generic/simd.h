@@ -0,0 +1,448 @@
+#ifndef __BTAS_SIMD_H
+#define __BTAS_SIMD_H 1
+
+#include <complex>
+#include <type_traits>
+
+//
+//  Vectorized level-1 kernels for contiguous float, double and complex data,
+//  and the register tile of the packed GEMM kernel for float and double.
+//  On x86 the instruction set (AVX-512F, AVX2+FMA) is chosen at run time;
+//  on AArch64 NEON is always available. Define _NO_SIMD to disable.
+//
+
+#if !defined(_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define _HAS_SIMD_X86 1
+#include <immintrin.h>
+#elif !defined(_NO_SIMD) && defined(__aarch64__) && defined(__ARM_NEON)
+#define _HAS_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace btas {
+
+namespace simd {
+
+/// instruction sets used by the level-1 kernels
+enum isa_type { isa_none, isa_neon, isa_avx2, isa_avx512 };
+
+/// \return best instruction set supported by this CPU
+inline isa_type detect_isa ()
+{
+#if defined(_HAS_SIMD_X86)
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("avx512f")) return isa_avx512;
+   if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return isa_avx2;
+   return isa_none;
+#elif defined(_HAS_SIMD_NEON)
+   return isa_neon;
+#else
+   return isa_none;
+#endif
+}
+
+/// \return instruction set used by the level-1 kernels, detected once
+inline isa_type isa ()
+{
+   static const isa_type value = detect_isa();
+   return value;
+}
+
+//
+//  Kernels are written once in terms of a vector traits class vec<T>, which provides
+//  reg (register type), width (number of T per register), load, store, set1, zero, add, mul,
+//  fmadd(a,b,c) = a*b+c and swap_pairs (exchanges real and imaginary parts of interleaved complex numbers),
+//  and are stamped out in each namespace that defines vec<T> with the matching target attribute.
+//  Complex kernels work on the interleaved real array of length 2n.
+//
+
+#define BTAS_SIMD_LEVEL1_KERNELS(_TARGET) \
+\
+/* x *= alpha */ \
+template<typename T> _TARGET \
+void scal (const unsigned long n, const T alpha, T* x) \
+{ \
+   typedef vec<T> V; \
+   const unsigned long W = V::width; \
+   const typename V::reg va = V::set1(alpha); \
+   unsigned long i = 0; \
+   for (; i + W <= n; i += W) V::store(x+i, V::mul(V::load(x+i), va)); \
+   for (; i < n; ++i) x[i] *= alpha; \
+} \
+\
+/* y += alpha * x */ \
+template<typename T> _TARGET \
+void axpy (const unsigned long n, const T alpha, const T* x, T* y) \
+{ \
+   typedef vec<T> V; \
+   const unsigned long W = V::width; \
+   const typename V::reg va = V::set1(alpha); \
+   unsigned long i = 0; \
+   for (; i + W <= n; i += W) V::store(y+i, V::fmadd(va, V::load(x+i), V::load(y+i))); \
+   for (; i < n; ++i) y[i] += alpha * x[i]; \
+} \
+\
+/* sum_i x_i * y_i */ \
+template<typename T> _TARGET \
+T dot (const unsigned long n, const T* x, const T* y) \
+{ \
+   typedef vec<T> V; \
+   const unsigned long W = V::width; \
+   typename V::reg acc0 = V::zero(); \
+   typename V::reg acc1 = V::zero(); \
+   unsigned long i = 0; \
+   for (; i + 2*W <= n; i += 2*W) \
+   { \
+      acc0 = V::fmadd(V::load(x+i),   V::load(y+i),   acc0); \
+      acc1 = V::fmadd(V::load(x+i+W), V::load(y+i+W), acc1); \
+   } \
+   for (; i + W <= n; i += W) acc0 = V::fmadd(V::load(x+i), V::load(y+i), acc0); \
+   T buf[W]; \
+   V::store(buf, V::add(acc0, acc1)); \
+   T val = 0; \
+   for (unsigned long j = 0; j < W; ++j) val += buf[j]; \
+   for (; i < n; ++i) val += x[i] * y[i]; \
+   return val; \
+} \
+\
+/* {ar,ai,ar,ai,...} */ \
+template<typename T> _TARGET \
+typename vec<T>::reg pairs (const T re, const T im) \
+{ \
+   T buf[vec<T>::width]; \
+   for (unsigned long j = 0; j < vec<T>::width; j += 2) { buf[j] = re; buf[j+1] = im; } \
+   return vec<T>::load(buf); \
+} \
+\
+/* x *= alpha, x complex */ \
+template<typename T> _TARGET \
+void scal_c (const unsigned long n, const T ar, const T ai, T* x) \
+{ \
+   typedef vec<T> V; \
+   const unsigned long W = V::width; \
+   const typename V::reg va = V::set1(ar); \
+   const typename V::reg vb = pairs<T>(-ai, ai); \
+   unsigned long i = 0; \
+   for (; i + W <= 2*n; i += W) \
+   { \
+      const typename V::reg v = V::load(x+i); \
+      V::store(x+i, V::fmadd(V::swap_pairs(v), vb, V::mul(v, va))); \
+   } \
+   for (; i < 2*n; i += 2) \
+   { \
+      const T xr = x[i]; \
+      x[i]   = ar*xr - ai*x[i+1]; \
+      x[i+1] = ar*x[i+1] + ai*xr; \
+   } \
+} \
+\
+/* y += alpha * x, x and y complex */ \
+template<typename T> _TARGET \
+void axpy_c (const unsigned long n, const T ar, const T ai, const T* x, T* y) \
+{ \
+   typedef vec<T> V; \
+   const unsigned long W = V::width; \
+   const typename V::reg va = V::set1(ar); \
+   const typename V::reg vb = pairs<T>(-ai, ai); \
+   unsigned long i = 0; \
+   for (; i + W <= 2*n; i += W) \
+   { \
+      const typename V::reg v = V::load(x+i); \
+      V::store(y+i, V::fmadd(V::swap_pairs(v), vb, V::fmadd(v, va, V::load(y+i)))); \
+   } \
+   for (; i < 2*n; i += 2) \
+   { \
+      y[i]   += ar*x[i] - ai*x[i+1]; \
+      y[i+1] += ar*x[i+1] + ai*x[i]; \
+   } \
+} \
+\
+/* sum_i op(x_i) * y_i, x and y complex, op = conj if conjx */ \
+template<typename T> _TARGET \
+std::complex<T> dot_c (const unsigned long n, const T* x, const T* y, const bool conjx) \
+{ \
+   typedef vec<T> V; \
+   const unsigned long W = V::width; \
+   typename V::reg acc0 = V::zero(); /* {xr*yr, xi*yi} */ \
+   typename V::reg acc1 = V::zero(); /* {xr*yi, xi*yr} */ \
+   unsigned long i = 0; \
+   for (; i + W <= 2*n; i += W) \
+   { \
+      const typename V::reg vx = V::load(x+i); \
+      const typename V::reg vy = V::load(y+i); \
+      acc0 = V::fmadd(vx, vy, acc0); \
+      acc1 = V::fmadd(vx, V::swap_pairs(vy), acc1); \
+   } \
+   T buf0[W], buf1[W]; \
+   V::store(buf0, acc0); \
+   V::store(buf1, acc1); \
+   T rr = 0, ii = 0, ri = 0, ir = 0; \
+   for (unsigned long j = 0; j < W; j += 2) \
+   { \
+      rr += buf0[j]; ii += buf0[j+1]; \
+      ri += buf1[j]; ir += buf1[j+1]; \
+   } \
+   for (; i < 2*n; i += 2) \
+   { \
+      rr += x[i]*y[i];   ii += x[i+1]*y[i+1]; \
+      ri += x[i]*y[i+1]; ir += x[i+1]*y[i]; \
+   } \
+   return conjx ? std::complex<T>(rr + ii, ri - ir) : std::complex<T>(rr - ii, ri + ir); \
+} \
+\
+/* C[0:mr,0:nr] += alpha * Ap * Bp for a packed MR x kc panel Ap and kc x NR panel Bp, */ \
+/* with the MR x NR tile of Ap * Bp held in MR*NR/width registers */ \
+template<unsigned long MR, unsigned long NR, typename T> _TARGET \
+bool gemm_tile (const unsigned long kc, const T alpha, const T* Ap, const T* Bp, T* C, const unsigned long LDC, \
+                const unsigned long mr, const unsigned long nr) \
+{ \
+   typedef vec<T> V; \
+   const unsigned long W = V::width; \
+   static_assert(NR % V::width == 0, "gemm_tile: NR must be a multiple of the vector width"); \
+   typename V::reg ab[MR][NR/V::width]; \
+   for (unsigned long i = 0; i < MR; ++i) \
+      for (unsigned long j = 0; j < NR/W; ++j) ab[i][j] = V::zero(); \
+   for (unsigned long k = 0; k < kc; ++k, Ap += MR, Bp += NR) \
+   { \
+      typename V::reg b[NR/V::width]; \
+      for (unsigned long j = 0; j < NR/W; ++j) b[j] = V::load(Bp + j*W); \
+      for (unsigned long i = 0; i < MR; ++i) \
+      { \
+         const typename V::reg a = V::set1(Ap[i]); \
+         for (unsigned long j = 0; j < NR/W; ++j) ab[i][j] = V::fmadd(a, b[j], ab[i][j]); \
+      } \
+   } \
+   const typename V::reg va = V::set1(alpha); \
+   if (mr == MR && nr == NR) \
+   { \
+      for (unsigned long i = 0; i < MR; ++i, C += LDC) \
+         for (unsigned long j = 0; j < NR/W; ++j) V::store(C + j*W, V::fmadd(va, ab[i][j], V::load(C + j*W))); \
+   } \
+   else \
+   { \
+      T buf[MR*NR]; \
+      for (unsigned long i = 0; i < MR; ++i) \
+         for (unsigned long j = 0; j < NR/W; ++j) V::store(buf + i*NR + j*W, ab[i][j]); \
+      for (unsigned long i = 0; i < mr; ++i, C += LDC) \
+         for (unsigned long j = 0; j < nr; ++j) C[j] += alpha * buf[i*NR+j]; \
+   } \
+   return true; \
+}
+
+#if defined(_HAS_SIMD_X86)
+
+#define BTAS_SIMD_AVX2 __attribute__((target("avx2,fma")))
+#define BTAS_SIMD_AVX2_INLINE __attribute__((always_inline, target("avx2,fma"))) inline
+
+namespace avx2 {
+
+template<typename T> struct vec { };
+
+template<> struct vec<float>
+{
+   typedef __m256 reg;
+   static const unsigned long width = 8;
+   static BTAS_SIMD_AVX2_INLINE reg load (const float* p) { return _mm256_loadu_ps(p); }
+   static BTAS_SIMD_AVX2_INLINE void store (float* p, reg v) { _mm256_storeu_ps(p, v); }
+   static BTAS_SIMD_AVX2_INLINE reg set1 (float a) { return _mm256_set1_ps(a); }
+   static BTAS_SIMD_AVX2_INLINE reg zero () { return _mm256_setzero_ps(); }
+   static BTAS_SIMD_AVX2_INLINE reg add (reg a, reg b) { return _mm256_add_ps(a, b); }
+   static BTAS_SIMD_AVX2_INLINE reg mul (reg a, reg b) { return _mm256_mul_ps(a, b); }
+   static BTAS_SIMD_AVX2_INLINE reg fmadd (reg a, reg b, reg c) { return _mm256_fmadd_ps(a, b, c); }
+   static BTAS_SIMD_AVX2_INLINE reg swap_pairs (reg a) { return _mm256_permute_ps(a, 0xB1); }
+};
+
+template<> struct vec<double>
+{
+   typedef __m256d reg;
+   static const unsigned long width = 4;
+   static BTAS_SIMD_AVX2_INLINE reg load (const double* p) { return _mm256_loadu_pd(p); }
+   static BTAS_SIMD_AVX2_INLINE void store (double* p, reg v) { _mm256_storeu_pd(p, v); }
+   static BTAS_SIMD_AVX2_INLINE reg set1 (double a) { return _mm256_set1_pd(a); }
+   static BTAS_SIMD_AVX2_INLINE reg zero () { return _mm256_setzero_pd(); }
+   static BTAS_SIMD_AVX2_INLINE reg add (reg a, reg b) { return _mm256_add_pd(a, b); }
+   static BTAS_SIMD_AVX2_INLINE reg mul (reg a, reg b) { return _mm256_mul_pd(a, b); }
+   static BTAS_SIMD_AVX2_INLINE reg fmadd (reg a, reg b, reg c) { return _mm256_fmadd_pd(a, b, c); }
+   static BTAS_SIMD_AVX2_INLINE reg swap_pairs (reg a) { return _mm256_permute_pd(a, 0x5); }
+};
+
+BTAS_SIMD_LEVEL1_KERNELS(BTAS_SIMD_AVX2)
+
+} // namespace avx2
+
+#define BTAS_SIMD_AVX512 __attribute__((target("avx512f")))
+#define BTAS_SIMD_AVX512_INLINE __attribute__((always_inline, target("avx512f"))) inline
+
+namespace avx512 {
+
+template<typename T> struct vec { };
+
+template<> struct vec<float>
+{
+   typedef __m512 reg;
+   static const unsigned long width = 16;
+   static BTAS_SIMD_AVX512_INLINE reg load (const float* p) { return _mm512_loadu_ps(p); }
+   static BTAS_SIMD_AVX512_INLINE void store (float* p, reg v) { _mm512_storeu_ps(p, v); }
+   static BTAS_SIMD_AVX512_INLINE reg set1 (float a) { return _mm512_set1_ps(a); }
+   static BTAS_SIMD_AVX512_INLINE reg zero () { return _mm512_setzero_ps(); }
+   static BTAS_SIMD_AVX512_INLINE reg add (reg a, reg b) { return _mm512_add_ps(a, b); }
+   static BTAS_SIMD_AVX512_INLINE reg mul (reg a, reg b) { return _mm512_mul_ps(a, b); }
+   static BTAS_SIMD_AVX512_INLINE reg fmadd (reg a, reg b, reg c) { return _mm512_fmadd_ps(a, b, c); }
+   static BTAS_SIMD_AVX512_INLINE reg swap_pairs (reg a) { return _mm512_shuffle_ps(a, a, 0xB1); }
+};
+
+template<> struct vec<double>
+{
+   typedef __m512d reg;
+   static const unsigned long width = 8;
+   static BTAS_SIMD_AVX512_INLINE reg load (const double* p) { return _mm512_loadu_pd(p); }
+   static BTAS_SIMD_AVX512_INLINE void store (double* p, reg v) { _mm512_storeu_pd(p, v); }
+   static BTAS_SIMD_AVX512_INLINE reg set1 (double a) { return _mm512_set1_pd(a); }
+   static BTAS_SIMD_AVX512_INLINE reg zero () { return _mm512_setzero_pd(); }
+   static BTAS_SIMD_AVX512_INLINE reg add (reg a, reg b) { return _mm512_add_pd(a, b); }
+   static BTAS_SIMD_AVX512_INLINE reg mul (reg a, reg b) { return _mm512_mul_pd(a, b); }
+   static BTAS_SIMD_AVX512_INLINE reg fmadd (reg a, reg b, reg c) { return _mm512_fmadd_pd(a, b, c); }
+   static BTAS_SIMD_AVX512_INLINE reg swap_pairs (reg a) { return _mm512_shuffle_pd(a, a, 0x55); }
+};
+
+BTAS_SIMD_LEVEL1_KERNELS(BTAS_SIMD_AVX512)
+
+} // namespace avx512
+
+#define BTAS_SIMD_DISPATCH(...) \
+   if (isa() == isa_avx512) return avx512::__VA_ARGS__; \
+   if (isa() == isa_avx2)   return avx2::__VA_ARGS__;
+
+#elif defined(_HAS_SIMD_NEON)
+
+namespace neon {
+
+template<typename T> struct vec { };
+
+template<> struct vec<float>
+{
+   typedef float32x4_t reg;
+   static const unsigned long width = 4;
+   static inline reg load (const float* p) { return vld1q_f32(p); }
+   static inline void store (float* p, reg v) { vst1q_f32(p, v); }
+   static inline reg set1 (float a) { return vdupq_n_f32(a); }
+   static inline reg zero () { return vdupq_n_f32(0.0f); }
+   static inline reg add (reg a, reg b) { return vaddq_f32(a, b); }
+   static inline reg mul (reg a, reg b) { return vmulq_f32(a, b); }
+   static inline reg fmadd (reg a, reg b, reg c) { return vfmaq_f32(c, a, b); }
+   static inline reg swap_pairs (reg a) { return vrev64q_f32(a); }
+};
+
+template<> struct vec<double>
+{
+   typedef float64x2_t reg;
+   static const unsigned long width = 2;
+   static inline reg load (const double* p) { return vld1q_f64(p); }
+   static inline void store (double* p, reg v) { vst1q_f64(p, v); }
+   static inline reg set1 (double a) { return vdupq_n_f64(a); }
+   static inline reg zero () { return vdupq_n_f64(0.0); }
+   static inline reg add (reg a, reg b) { return vaddq_f64(a, b); }
+   static inline reg mul (reg a, reg b) { return vmulq_f64(a, b); }
+   static inline reg fmadd (reg a, reg b, reg c) { return vfmaq_f64(c, a, b); }
+   static inline reg swap_pairs (reg a) { return vextq_f64(a, a, 1); }
+};
+
+BTAS_SIMD_LEVEL1_KERNELS()
+
+} // namespace neon
+
+#define BTAS_SIMD_DISPATCH(...) \
+   return neon::__VA_ARGS__;
+
+#else
+
+#define BTAS_SIMD_DISPATCH(...)
+
+#endif
+
+//  ================================================================================================
+
+/// x *= alpha for contiguous x
+template<typename _T>
+void scal (const unsigned long& Nsize, const _T& alpha, _T* x)
+{
+   BTAS_SIMD_DISPATCH(scal(Nsize, alpha, x))
+   for (unsigned long i = 0; i < Nsize; ++i) x[i] *= alpha;
+}
+
+template<typename _T>
+void scal (const unsigned long& Nsize, const std::complex<_T>& alpha, std::complex<_T>* x)
+{
+   BTAS_SIMD_DISPATCH(scal_c(Nsize, alpha.real(), alpha.imag(), reinterpret_cast<_T*>(x)))
+   for (unsigned long i = 0; i < Nsize; ++i) x[i] *= alpha;
+}
+
+/// y += alpha * x for contiguous x and y
+template<typename _T>
+void axpy (const unsigned long& Nsize, const _T& alpha, const _T* x, _T* y)
+{
+   BTAS_SIMD_DISPATCH(axpy(Nsize, alpha, x, y))
+   for (unsigned long i = 0; i < Nsize; ++i) y[i] += alpha * x[i];
+}
+
+template<typename _T>
+void axpy (const unsigned long& Nsize, const std::complex<_T>& alpha, const std::complex<_T>* x, std::complex<_T>* y)
+{
+   BTAS_SIMD_DISPATCH(axpy_c(Nsize, alpha.real(), alpha.imag(), reinterpret_cast<const _T*>(x), reinterpret_cast<_T*>(y)))
+   for (unsigned long i = 0; i < Nsize; ++i) y[i] += alpha * x[i];
+}
+
+/// \return x . y for contiguous x and y
+template<typename _T>
+_T dot (const unsigned long& Nsize, const _T* x, const _T* y)
+{
+   BTAS_SIMD_DISPATCH(dot(Nsize, x, y))
+   _T val = 0;
+   for (unsigned long i = 0; i < Nsize; ++i) val += x[i] * y[i];
+   return val;
+}
+
+/// \return conj(x) . y for contiguous x and y
+template<typename _T>
+std::complex<_T> dotc (const unsigned long& Nsize, const std::complex<_T>* x, const std::complex<_T>* y)
+{
+   BTAS_SIMD_DISPATCH(dot_c(Nsize, reinterpret_cast<const _T*>(x), reinterpret_cast<const _T*>(y), true))
+   std::complex<_T> val = 0;
+   for (unsigned long i = 0; i < Nsize; ++i) val += std::conj(x[i]) * y[i];
+   return val;
+}
+
+/// \return x . y for contiguous complex x and y
+template<typename _T>
+std::complex<_T> dotu (const unsigned long& Nsize, const std::complex<_T>* x, const std::complex<_T>* y)
+{
+   BTAS_SIMD_DISPATCH(dot_c(Nsize, reinterpret_cast<const _T*>(x), reinterpret_cast<const _T*>(y), false))
+   std::complex<_T> val = 0;
+   for (unsigned long i = 0; i < Nsize; ++i) val += x[i] * y[i];
+   return val;
+}
+
+/// C[0:mr,0:nr] += alpha * Ap * Bp for packed panels, as in the GEMM micro-kernel of gemm_blocked.h,
+/// with the accumulators in vector registers; \return false if there is no vector kernel for _T on this CPU
+template<unsigned long MR, unsigned long NR, typename _T>
+typename std::enable_if<std::is_same<_T, float>::value || std::is_same<_T, double>::value, bool>::type
+gemm_tile (const unsigned long& kc, const _T& alpha, const _T* Ap, const _T* Bp, _T* C, const unsigned long& LDC,
+           const unsigned long& mr, const unsigned long& nr)
+{
+   BTAS_SIMD_DISPATCH(gemm_tile<MR, NR>(kc, alpha, Ap, Bp, C, LDC, mr, nr))
+   return false;
+}
+
+template<unsigned long MR, unsigned long NR, typename _T>
+typename std::enable_if<!std::is_same<_T, float>::value && !std::is_same<_T, double>::value, bool>::type
+gemm_tile (const unsigned long&, const _T&, const _T*, const _T*, _T*, const unsigned long&,
+           const unsigned long&, const unsigned long&)
+{
+   return false;
+}
+
+} // namespace simd
+
+} // namespace btas
+
+#endif // __BTAS_SIMD_H
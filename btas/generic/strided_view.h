@@ -0,0 +1,130 @@
+#ifndef __BTAS_STRIDED_VIEW_H
+#define __BTAS_STRIDED_VIEW_H 1
+
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <btas/tensor_traits.h>
+#include <btas/tensor.h>
+
+namespace btas {
+
+/// test whether the elements of _Tensor are in one block of memory and found through the strides of its range,
+/// as those of a Tensor and of a TensorView (e.g. a slice) of a Tensor's storage
+template<class _Tensor>
+class has_strided_data {
+   /// true case
+   template<class U>
+   static auto __test(U* p) -> decltype(std::declval<typename std::remove_const<typename U::storage_type>::type&>().data(),
+                                        p->range().ordinal().stride(), std::true_type());
+   /// false case
+   template<class>
+   static std::false_type __test(...);
+public:
+   static constexpr const bool value = std::is_same<std::true_type, decltype(__test<_Tensor>(0))>::value;
+};
+
+/// test whether _Tensor is a view with strided data, i.e. its elements need not be contiguous
+template<class _Tensor>
+struct is_strided_view {
+   static constexpr const bool value = has_strided_data<_Tensor>::value && !has_data<_Tensor>::value;
+};
+
+/// \return pointer to the first element of \c x , the others being at the ordinal offsets given by
+/// x.range().ordinal().stride(); null if \c x is empty
+template<class _Tensor>
+auto strided_data (_Tensor& x) -> decltype(&*std::begin(x.storage()))
+{
+   if (x.empty()) return nullptr;
+   return &*std::begin(x.storage()) + x.range().ordinal(x.range().lobound());
+}
+
+namespace impl {
+
+/// Tensor holding a contiguous copy of a view of type _Tensor
+template<class _Tensor>
+struct dense_type {
+   typedef Tensor<typename _Tensor::value_type, typename _Tensor::range_type> type;
+};
+
+/// \return a reference to \c x , or a contiguous copy of it if it is a view
+template<class _Tensor>
+typename std::conditional<is_strided_view<_Tensor>::value, typename dense_type<_Tensor>::type, const _Tensor&>::type
+dense_operand (const _Tensor& x)
+{
+   return x;
+}
+
+/// copies the elements of \c x to \c y , in the order of their ranges, unless they are the same tensor
+template<class _TensorX, class _TensorY>
+void dense_copy_back (const _TensorX& x, _TensorY& y)
+{
+   std::copy(x.cbegin(), x.cend(), y.begin());
+}
+
+template<class _Tensor>
+void dense_copy_back (const _Tensor& x, _Tensor& y)
+{
+   if (&x != &y) std::copy(x.cbegin(), x.cend(), y.begin());
+}
+
+/// Calls f(offsetX, offsetY, n, incX, incY) for blocks of elements of two tensors of the same extents, so that each
+/// block is n elements apart by incX in X and by incY in Y; the trailing dimensions that are laid out with a
+/// single positive stride in both tensors make one block, the leading ones are looped over
+template<class _Extent, class _StrideX, class _StrideY, class _Function>
+void for_each_strided_block (
+   const _Extent& extent,
+   const _StrideX& strideX,
+   const _StrideY& strideY,
+   _Function f)
+{
+   const long rank = std::distance(std::begin(extent), std::end(extent));
+   unsigned long n = 1;
+   long incX = 1, incY = 1;
+   long d = rank-1;
+   for (; d >= 0; --d)
+   {
+      const unsigned long e = extent[d];
+      const long sx = strideX[d], sy = strideY[d];
+      if (e == 1) continue;
+      if (n == 1)
+      {
+         if (sx <= 0 || sy <= 0) break;
+         incX = sx;
+         incY = sy;
+      }
+      else if (sx != incX*static_cast<long>(n) || sy != incY*static_cast<long>(n))
+         break;
+      n *= e;
+   }
+
+   // odometer over the leading dimensions [0, d]
+   unsigned long nblock = 1;
+   for (long l = 0; l <= d; ++l) nblock *= extent[l];
+   if (n == 0 || nblock == 0) return;
+   std::vector<unsigned long> idx(d+1, 0);
+   long oX = 0, oY = 0;
+   for (unsigned long b = 0; b < nblock; ++b)
+   {
+      f(oX, oY, n, incX, incY);
+      for (long l = d; l >= 0; --l)
+      {
+         oX += strideX[l];
+         oY += strideY[l];
+         if (++idx[l] < static_cast<unsigned long>(extent[l])) break;
+         const long e = extent[l];
+         oX -= strideX[l]*e;
+         oY -= strideY[l]*e;
+         idx[l] = 0;
+      }
+   }
+}
+
+} // namespace impl
+
+} // namespace btas
+
+#endif // __BTAS_STRIDED_VIEW_H
@@ -0,0 +1,196 @@
+#ifndef __BTAS_TRANSPOSE_H
+#define __BTAS_TRANSPOSE_H 1
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include <btas/util/parallel.h>
+
+namespace btas {
+
+/// below this many elements a transpose runs on the calling thread only
+const unsigned long transpose_parallel_min_size = 1ul << 15;
+
+/// Base tile edge of the blocked transpose,
+/// a BS x BS tile of the source and of the target should both fit comfortably in L1
+template<typename _T>
+struct transpose_blocking
+{
+   static const unsigned long BS = (128/sizeof(_T) > 4) ? 128/sizeof(_T) : 4;
+};
+
+namespace impl {
+
+/// Cache-oblivious 2D strided copy, y[i*iy + j*jy] = x[i*ix + j*jx] for i < ni, j < nj
+/// the block is halved along its longer edge until it fits the base tile,
+/// j is meant to be the fastest-varying index of y so that the innermost loop writes contiguously
+template<unsigned long BS, typename _TX, typename _TY>
+void transpose_2d (
+   const unsigned long& ni,
+   const unsigned long& nj,
+   const _TX* x,
+   const long& ix,
+   const long& jx,
+         _TY* y,
+   const long& iy,
+   const long& jy)
+{
+   if (ni <= BS && nj <= BS)
+   {
+      for (unsigned long i = 0; i < ni; ++i)
+      {
+         const _TX* xi = x + i*ix;
+               _TY* yi = y + i*iy;
+         for (unsigned long j = 0; j < nj; ++j) yi[j*jy] = xi[j*jx];
+      }
+   }
+   else if (ni >= nj)
+   {
+      const unsigned long h = ni/2;
+      transpose_2d<BS>(h,    nj, x,      ix, jx, y,      iy, jy);
+      transpose_2d<BS>(ni-h, nj, x+h*ix, ix, jx, y+h*iy, iy, jy);
+   }
+   else
+   {
+      const unsigned long h = nj/2;
+      transpose_2d<BS>(ni, h,    x,      ix, jx, y,      iy, jy);
+      transpose_2d<BS>(ni, nj-h, x+h*jx, ix, jx, y+h*jy, iy, jy);
+   }
+}
+
+/// Strided copy over a box whose unit dimensions are dropped and contiguous neighbours fused, see transpose
+template<typename _TX, typename _TY>
+void transpose_box (
+   const std::vector<unsigned long>& e,
+   const _TX* x,
+   const std::vector<long>& sx,
+         _TY* y,
+   const std::vector<long>& sy)
+{
+   const unsigned long n = e.size();
+
+   // a : fastest-varying dimension of Y, b : fastest-varying among the other dimensions of X
+   unsigned long a = 0;
+   for (unsigned long d = 1; d < n; ++d)
+      if (std::labs(sy[d]) < std::labs(sy[a])) a = d;
+   unsigned long b = (a == 0 && n > 1) ? 1 : 0;
+   for (unsigned long d = 0; d < n; ++d)
+      if (d != a && std::labs(sx[d]) < std::labs(sx[b])) b = d;
+   const bool tiled = (n > 1 && std::labs(sx[b]) < std::labs(sx[a]));
+
+   // outer dimensions, walked as an odometer in the order of Y
+   std::vector<unsigned long> outer;
+   for (unsigned long d = 0; d < n; ++d)
+      if (d != a && (!tiled || d != b)) outer.push_back(d);
+   std::vector<unsigned long> idx(outer.size(), 0);
+
+   const unsigned long BS = transpose_blocking<_TY>::BS;
+   long ox = 0, oy = 0;
+   while (true)
+   {
+      if (tiled)
+      {
+         transpose_2d<BS>(e[b], e[a], x+ox, sx[b], sx[a], y+oy, sy[b], sy[a]);
+      }
+      else if (sx[a] == 1 && sy[a] == 1)
+      {
+         std::copy(x+ox, x+ox+e[a], y+oy);
+      }
+      else
+      {
+         const _TX* xa = x+ox;
+               _TY* ya = y+oy;
+         for (unsigned long t = 0; t < e[a]; ++t, xa += sx[a], ya += sy[a]) *ya = *xa;
+      }
+
+      long o = static_cast<long>(outer.size())-1;
+      for (; o >= 0; --o)
+      {
+         const unsigned long d = outer[o];
+         ox += sx[d];
+         oy += sy[d];
+         if (++idx[o] < e[d]) break;
+         ox -= sx[d]*static_cast<long>(e[d]);
+         oy -= sy[d]*static_cast<long>(e[d]);
+         idx[o] = 0;
+      }
+      if (o < 0) break;
+   }
+}
+
+/// Strided copy over a box of arbitrary rank, Y(j) = X(j) for all j < extent,
+/// where X(j) = x[sum_d j[d]*strideX[d]] and Y(j) = y[sum_d j[d]*strideY[d]]
+///
+/// Dimensions of extent 1 are dropped and adjacent dimensions that are contiguous with each other
+/// in both X and Y are fused. If X and Y share the fastest-varying dimension it is copied by a plain
+/// inner loop, otherwise the plane spanned by the fastest dimensions of X and Y is tiled recursively.
+/// The remaining dimensions are walked with incrementally updated offsets.
+/// Large boxes are cut along their longest dimension into slabs handled by separate threads.
+template<typename _TX, typename _TY, typename _Extent, typename _StrideX, typename _StrideY>
+void transpose (
+   const _Extent& extent,
+   const _TX* x,
+   const _StrideX& strideX,
+         _TY* y,
+   const _StrideY& strideY)
+{
+   const unsigned long rank = std::distance(std::begin(extent), std::end(extent));
+
+   // drop unit dimensions and fuse contiguous neighbours, keeping the order of Y
+   std::vector<unsigned long> e; e.reserve(rank);
+   std::vector<long> sx; sx.reserve(rank);
+   std::vector<long> sy; sy.reserve(rank);
+   for (unsigned long d = 0; d < rank; ++d)
+   {
+      const unsigned long ed = *(std::begin(extent)+d);
+      const long sxd = *(std::begin(strideX)+d);
+      const long syd = *(std::begin(strideY)+d);
+      if (ed == 0) return;
+      if (ed == 1) continue;
+      if (!e.empty() && sx.back() == sxd*static_cast<long>(ed) && sy.back() == syd*static_cast<long>(ed))
+      {
+         e.back() *= ed;
+         sx.back() = sxd;
+         sy.back() = syd;
+      }
+      else
+      {
+         e.push_back(ed);
+         sx.push_back(sxd);
+         sy.push_back(syd);
+      }
+   }
+
+   const unsigned long n = e.size();
+   if (n == 0)
+   {
+      *y = *x;
+      return;
+   }
+
+   // split the longest dimension between threads
+   unsigned long volume = 1, dp = 0;
+   for (unsigned long d = 0; d < n; ++d)
+   {
+      volume *= e[d];
+      if (e[d] > e[dp]) dp = d;
+   }
+   if (volume < transpose_parallel_min_size || parallel_width() == 1)
+   {
+      transpose_box(e, x, sx, y, sy);
+      return;
+   }
+   parallel_for(e[dp], 1, [&](unsigned long first, unsigned long last)
+   {
+      std::vector<unsigned long> ep(e);
+      ep[dp] = last-first;
+      transpose_box(ep, x+first*sx[dp], sx, y+first*sy[dp], sy);
+   });
+}
+
+} // namespace impl
+
+} // namespace btas
+
+#endif // __BTAS_TRANSPOSE_H
@@ -0,0 +1,175 @@
+#ifndef __BTAS_HALF_H
+#define __BTAS_HALF_H 1
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <ostream>
+#include <type_traits>
+
+namespace btas {
+
+  namespace impl {
+
+    inline std::uint32_t float_bits(float x) {
+      std::uint32_t u;
+      std::memcpy(&u, &x, sizeof(u));
+      return u;
+    }
+
+    inline float bits_float(std::uint32_t u) {
+      float x;
+      std::memcpy(&x, &u, sizeof(x));
+      return x;
+    }
+
+    /// \return IEEE binary16 nearest to \c x , ties to even
+    inline std::uint16_t float_to_half(float x) {
+      const std::uint32_t u = float_bits(x);
+      const std::uint16_t sign = static_cast<std::uint16_t>((u >> 16) & 0x8000u);
+      const std::uint32_t a = u & 0x7fffffffu;
+      if (a >= 0x7f800000u)                                     // Inf and NaN, which stays quiet
+        return sign | 0x7c00u | (a > 0x7f800000u ? 0x0200u | ((a >> 13) & 0x3ffu) : 0u);
+      if (a >= 0x477ff000u) return sign | 0x7c00u;              // rounds to above 65504
+      if (a >= 0x38800000u) {                                   // normal
+        const std::uint32_t m = a + 0xfffu + ((a >> 13) & 1u) - 0x38000000u;
+        return sign | static_cast<std::uint16_t>(m >> 13);
+      }
+      if (a <= 0x33000000u) return sign;                        // rounds to zero
+      // subnormal: shift the mantissa, with its implicit bit, right and round
+      const std::uint32_t e = a >> 23;
+      const std::uint32_t m = (a & 0x7fffffu) | 0x800000u;
+      const std::uint32_t shift = 126u - e;
+      const std::uint32_t half_ulp = 1u << (shift - 1);
+      std::uint32_t r = m >> shift;
+      const std::uint32_t rest = m & ((1u << shift) - 1u);
+      if (rest > half_ulp || (rest == half_ulp && (r & 1u))) ++r;
+      return sign | static_cast<std::uint16_t>(r);
+    }
+
+    inline float half_to_float(std::uint16_t h) {
+      const std::uint32_t sign = static_cast<std::uint32_t>(h & 0x8000u) << 16;
+      const std::uint32_t e = (h >> 10) & 0x1fu;
+      const std::uint32_t m = h & 0x3ffu;
+      if (e == 0x1fu) return bits_float(sign | 0x7f800000u | (m << 13));
+      if (e != 0) return bits_float(sign | ((e + 112u) << 23) | (m << 13));
+      if (m == 0) return bits_float(sign);
+      // subnormal: m * 2^-24
+      const float x = static_cast<float>(m) * 5.9604644775390625e-8f;
+      return sign ? -x : x;
+    }
+
+    /// \return bfloat16, the upper half of the float nearest to \c x , ties to even
+    inline std::uint16_t float_to_bfloat16(float x) {
+      const std::uint32_t u = float_bits(x);
+      if ((u & 0x7fffffffu) > 0x7f800000u) return static_cast<std::uint16_t>((u >> 16) | 0x40u);
+      return static_cast<std::uint16_t>((u + 0x7fffu + ((u >> 16) & 1u)) >> 16);
+    }
+
+    inline float bfloat16_to_float(std::uint16_t b) {
+      return bits_float(static_cast<std::uint32_t>(b) << 16);
+    }
+
+  } // namespace impl
+
+  /// 16-bit floating point storage type
+  ///
+  /// Values are stored in 16 bits and are floats in arithmetic: a reduced_float converts implicitly to
+  /// float, from which it is rounded back on assignment, so that an expression of reduced_floats is
+  /// evaluated in float and rounded once. The generic kernels (gemm, dot, axpy, scal) accumulate in
+  /// float as well, see accumulate_type.
+  /// \tparam _Format tag of the bit layout, which provides encode(float) and decode(bits)
+  template <class _Format>
+  class reduced_float {
+    public:
+      reduced_float() : bits_(0) { }
+
+      template <typename _U,
+                class = typename std::enable_if<std::is_arithmetic<_U>::value>::type>
+      reduced_float(const _U& x) : bits_(_Format::encode(static_cast<float>(x))) { }
+
+      operator float() const { return _Format::decode(bits_); }
+
+      template <typename _U> reduced_float& operator+= (const _U& x) { return *this = static_cast<float>(*this) + x; }
+      template <typename _U> reduced_float& operator-= (const _U& x) { return *this = static_cast<float>(*this) - x; }
+      template <typename _U> reduced_float& operator*= (const _U& x) { return *this = static_cast<float>(*this) * x; }
+      template <typename _U> reduced_float& operator/= (const _U& x) { return *this = static_cast<float>(*this) / x; }
+
+      reduced_float operator- () const { return from_bits(bits_ ^ 0x8000u); }
+
+      std::uint16_t bits() const { return bits_; }
+
+      static reduced_float from_bits(std::uint16_t b) {
+        reduced_float x;
+        x.bits_ = b;
+        return x;
+      }
+
+    private:
+      std::uint16_t bits_;
+  };
+
+  struct half_format {
+    static std::uint16_t encode(float x) { return impl::float_to_half(x); }
+    static float decode(std::uint16_t b) { return impl::half_to_float(b); }
+  };
+
+  struct bfloat16_format {
+    static std::uint16_t encode(float x) { return impl::float_to_bfloat16(x); }
+    static float decode(std::uint16_t b) { return impl::bfloat16_to_float(b); }
+  };
+
+  /// IEEE 754 binary16: 11-bit significand, range 6e-8 to 65504
+  typedef reduced_float<half_format> half;
+
+  /// bfloat16: 8-bit significand and the range of float
+  typedef reduced_float<bfloat16_format> bfloat16;
+
+  template <class _Format>
+  std::ostream& operator<< (std::ostream& os, const reduced_float<_Format>& x) {
+    return os << static_cast<float>(x);
+  }
+
+  /// test whether _T is a 16-bit storage type
+  template <typename _T>
+  struct is_reduced_float {
+    static constexpr const bool value = false;
+  };
+
+  template <class _Format>
+  struct is_reduced_float<reduced_float<_Format>> {
+    static constexpr const bool value = true;
+  };
+
+  /// type in which the generic kernels compute and accumulate elements of type _T: float for 16-bit
+  /// storage types, _T itself otherwise
+  template <typename _T>
+  struct accumulate_type {
+    typedef _T type;
+  };
+
+  template <class _Format>
+  struct accumulate_type<reduced_float<_Format>> {
+    typedef float type;
+  };
+
+} // namespace btas
+
+namespace std {
+
+  template <class _Format>
+  class numeric_limits<btas::reduced_float<_Format>> : public numeric_limits<float> {
+    public:
+      static constexpr int digits = std::is_same<_Format, btas::half_format>::value ? 11 : 8;
+      static btas::reduced_float<_Format> epsilon() {
+        return btas::reduced_float<_Format>(1.0f / (1 << (digits - 1)));
+      }
+      static btas::reduced_float<_Format> max() {
+        return btas::reduced_float<_Format>::from_bits(std::is_same<_Format, btas::half_format>::value ? 0x7bffu : 0x7f7fu);
+      }
+      static btas::reduced_float<_Format> lowest() { return -max(); }
+  };
+
+} // namespace std
+
+#endif // __BTAS_HALF_H
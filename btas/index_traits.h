@@ -1,6 +1,8 @@
 #ifndef __BTAS_INDEX_TRAITS_H
 #define __BTAS_INDEX_TRAITS_H 1
 
+#include <array>
+#include <cstddef>
 #include <iterator>
 #include <type_traits>
 
@@ -32,6 +34,19 @@ public:
            is_container<_Index>::value;
 };
 
+/// rank of _Index, if it is fixed at compile time
+template<class _Index>
+struct index_rank_traits {
+   static constexpr const bool fixed = false;     ///< true if every _Index has the same rank
+   static constexpr const std::size_t rank = 0;  ///< that rank, if fixed
+};
+
+template<class _T, std::size_t _N>
+struct index_rank_traits<std::array<_T,_N>> {
+   static constexpr const bool fixed = true;
+   static constexpr const std::size_t rank = _N;
+};
+
 } // namespace btas
 
 #endif // __BTAS_INDEX_TRAITS_H
@@ -0,0 +1,287 @@
+/*
+ * mmap_storage.h
+ *
+ *  Memory-mapped storage for Tensor, POSIX only
+ */
+
+#ifndef BTAS_MMAP_STORAGE_H_
+#define BTAS_MMAP_STORAGE_H_
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace btas {
+
+  /// how mmap_storage maps its file
+  enum class mmap_mode {
+    read_only,     ///< the data may not be modified
+    private_copy,  ///< modifications are private to this process (copy-on-write), the file is not changed
+    shared         ///< modifications are written to the file, resize() grows or shrinks the file
+  };
+
+  /// access pattern hints for mmap_storage::advise, see madvise(2)
+  enum class mmap_advice {
+    normal,
+    sequential,
+    random,
+    willneed,
+    dontneed
+  };
+
+  /// Contiguous array of trivially copyable \c _T in a memory mapping, usable as \c _Storage of Tensor
+
+  /// Constructed from a file, the data are mapped from it and paged in on demand; constructed
+  /// otherwise, or when copied, the data live in an anonymous mapping and behave like \c std::vector .
+  /// The mapping is not resized in place: resize() of a file mapping in \c shared mode resizes the
+  /// file and maps it again, other mappings are copied into anonymous memory. A \c read_only mapping
+  /// is mapped without write permission, so it cannot be resized and writes to it are fatal.
+  template <typename _T>
+  class mmap_storage {
+      static_assert(std::is_trivially_copyable<_T>::value, "mmap_storage requires a trivially copyable value type");
+    public:
+      typedef _T value_type;
+      typedef value_type& reference;
+      typedef const value_type& const_reference;
+      typedef value_type* pointer;
+      typedef const value_type* const_pointer;
+      typedef pointer iterator;
+      typedef const_pointer const_iterator;
+      typedef std::size_t size_type;
+      typedef std::ptrdiff_t difference_type;
+
+      mmap_storage() : base_(nullptr), length_(0), data_(nullptr), size_(0), fd_(-1), offset_(0), mode_(mmap_mode::private_copy) { }
+
+      explicit
+      mmap_storage(size_type n) : mmap_storage() {
+        map_anonymous(n);
+      }
+
+      mmap_storage(size_type n, const value_type& val) : mmap_storage(n) {
+        std::fill(begin(), end(), val);
+      }
+
+      template <typename InputIterator,
+                class = typename std::enable_if<not std::is_integral<InputIterator>::value>::type>
+      mmap_storage(InputIterator first, InputIterator last) : mmap_storage() {
+        map_anonymous(std::distance(first, last));
+        std::copy(first, last, begin());
+      }
+
+      /// Maps the array that starts \c offset bytes into file \c path
+
+      /// \param n number of elements; by default, all that fit in the rest of the file.
+      ///          In \c shared mode a file shorter than that is extended (and created if needed)
+      mmap_storage(const std::string& path, mmap_mode mode, size_type n = npos, std::size_t offset = 0) : mmap_storage() {
+        const int flags = (mode == mmap_mode::shared) ? O_RDWR | O_CREAT : O_RDONLY;
+        fd_ = ::open(path.c_str(), flags, 0644);
+        if (fd_ < 0) throw_errno("mmap_storage: cannot open " + path);
+        mode_ = mode;
+        offset_ = offset;
+
+        const std::size_t fsize = file_size();
+        if (n == npos)
+          n = fsize > offset ? (fsize - offset) / sizeof(value_type) : 0;
+        if (offset + n * sizeof(value_type) > fsize) {
+          if (mode != mmap_mode::shared) {
+            close();
+            throw std::length_error("mmap_storage: " + path + " is too short");
+          }
+          truncate(n);
+        }
+        map_file(n);
+      }
+
+      mmap_storage(const mmap_storage& other) : mmap_storage(other.cbegin(), other.cend()) { }
+
+      mmap_storage(mmap_storage&& other) : mmap_storage() {
+        swap(other);
+      }
+
+      ~mmap_storage() {
+        unmap();
+        close();
+      }
+
+      /// copies the elements of \c other, into the current mapping if it is writable and has the same size
+      mmap_storage& operator=(const mmap_storage& other) {
+        if (this != &other) {
+          if (other.size() == size() && mode_ != mmap_mode::read_only)
+            std::copy(other.cbegin(), other.cend(), begin());
+          else {
+            mmap_storage tmp(other);
+            swap(tmp);
+          }
+        }
+        return *this;
+      }
+
+      mmap_storage& operator=(mmap_storage&& other) {
+        swap(other);
+        return *this;
+      }
+
+      void swap(mmap_storage& other) {
+        std::swap(base_, other.base_);
+        std::swap(length_, other.length_);
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(fd_, other.fd_);
+        std::swap(offset_, other.offset_);
+        std::swap(mode_, other.mode_);
+      }
+
+      size_type size() const { return size_; }
+      bool empty() const { return size_ == 0; }
+
+      iterator begin() { return data_; }
+      iterator end() { return data_ + size_; }
+      const_iterator begin() const { return data_; }
+      const_iterator end() const { return data_ + size_; }
+      const_iterator cbegin() const { return data_; }
+      const_iterator cend() const { return data_ + size_; }
+
+      pointer data() { return data_; }
+      const_pointer data() const { return data_; }
+
+      reference operator[](size_type i) { return data_[i]; }
+      const_reference operator[](size_type i) const { return data_[i]; }
+
+      /// \return the mode of the file mapping, \c private_copy if no file is mapped
+      mmap_mode mode() const { return mode_; }
+
+      /// \return true if the data are mapped from a file
+      bool file_backed() const { return fd_ >= 0; }
+
+      /// Resizes to \c n elements, keeping the first min(n, size()) of them
+      void resize(size_type n) {
+        if (n == size_) return;
+        if (mode_ == mmap_mode::read_only && fd_ >= 0)
+          throw std::logic_error("mmap_storage: cannot resize a read-only mapping");
+        if (mode_ == mmap_mode::shared && fd_ >= 0) {
+          unmap();
+          truncate(n);
+          map_file(n);
+          return;
+        }
+        mmap_storage tmp(n);
+        std::copy(begin(), begin() + std::min(n, size_), tmp.begin());
+        swap(tmp);
+      }
+
+      void resize(size_type n, const value_type& val) {
+        const size_type n0 = size_;
+        resize(n);
+        if (n > n0) std::fill(begin() + n0, end(), val);
+      }
+
+      /// Tells the kernel how the data will be accessed
+      void advise(mmap_advice advice) const {
+        if (base_ == nullptr) return;
+        int a = MADV_NORMAL;
+        switch (advice) {
+          case mmap_advice::normal:     a = MADV_NORMAL; break;
+          case mmap_advice::sequential: a = MADV_SEQUENTIAL; break;
+          case mmap_advice::random:     a = MADV_RANDOM; break;
+          case mmap_advice::willneed:   a = MADV_WILLNEED; break;
+          case mmap_advice::dontneed:   a = MADV_DONTNEED; break;
+        }
+        if (::madvise(base_, length_, a) != 0) throw_errno("mmap_storage: madvise failed");
+      }
+
+      /// Writes modifications of a \c shared file mapping back to the file
+      void sync() const {
+        if (base_ != nullptr && fd_ >= 0 && mode_ == mmap_mode::shared)
+          if (::msync(base_, length_, MS_SYNC) != 0) throw_errno("mmap_storage: msync failed");
+      }
+
+      static constexpr const size_type npos = static_cast<size_type>(-1);
+
+    private:
+      void* base_;            //!< start of the mapping, page aligned
+      std::size_t length_;    //!< length of the mapping in bytes
+      pointer data_;          //!< first element
+      size_type size_;        //!< number of elements
+      int fd_;                //!< mapped file, -1 for anonymous memory
+      std::size_t offset_;    //!< byte offset of the first element in the file
+      mmap_mode mode_;
+
+      static void throw_errno(const std::string& what) {
+        throw std::system_error(errno, std::generic_category(), what);
+      }
+
+      std::size_t file_size() const {
+        struct stat st;
+        if (::fstat(fd_, &st) != 0) throw_errno("mmap_storage: fstat failed");
+        return st.st_size;
+      }
+
+      void truncate(size_type n) {
+        if (::ftruncate(fd_, offset_ + n * sizeof(value_type)) != 0) throw_errno("mmap_storage: ftruncate failed");
+      }
+
+      void map_anonymous(size_type n) {
+        if (n == 0) return;
+        length_ = n * sizeof(value_type);
+        base_ = ::mmap(nullptr, length_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base_ == MAP_FAILED) {
+          base_ = nullptr;
+          throw std::bad_alloc();
+        }
+        data_ = static_cast<pointer>(base_);
+        size_ = n;
+      }
+
+      void map_file(size_type n) {
+        if (n == 0) return;
+        // mmap offsets must be multiples of the page size
+        const std::size_t page = ::sysconf(_SC_PAGESIZE);
+        const std::size_t skip = offset_ % page;
+        length_ = skip + n * sizeof(value_type);
+        const int prot = (mode_ == mmap_mode::read_only) ? PROT_READ : PROT_READ | PROT_WRITE;
+        const int flags = (mode_ == mmap_mode::shared) ? MAP_SHARED : MAP_PRIVATE;
+        base_ = ::mmap(nullptr, length_, prot, flags, fd_, offset_ - skip);
+        if (base_ == MAP_FAILED) {
+          base_ = nullptr;
+          throw_errno("mmap_storage: mmap failed");
+        }
+        data_ = reinterpret_cast<pointer>(static_cast<char*>(base_) + skip);
+        size_ = n;
+      }
+
+      void unmap() {
+        if (base_ != nullptr) ::munmap(base_, length_);
+        base_ = nullptr;
+        length_ = 0;
+        data_ = nullptr;
+        size_ = 0;
+      }
+
+      void close() {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+      }
+  };
+
+  template <typename _T>
+  constexpr const typename mmap_storage<_T>::size_type mmap_storage<_T>::npos;
+
+  template <typename _T>
+  void swap(mmap_storage<_T>& x, mmap_storage<_T>& y) {
+    x.swap(y);
+  }
+
+} // namespace btas
+
+#endif /* BTAS_MMAP_STORAGE_H_ */
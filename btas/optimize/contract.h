@@ -2,148 +2,141 @@
 #ifndef BTAS_OPTIMIZE_CONTRACT_H
 #define BTAS_OPTIMIZE_CONTRACT_H
 
+#include <algorithm>
 #include <stdexcept>
 #include <cassert>
+#include <vector>
 #include <btas/generic/gemm_impl.h>
-#include <btas/generic/scal_impl.h>
+#include <btas/generic/transpose.h>
+#include <btas/generic/contract_strided.h>
 
 namespace btas {
 
+namespace impl {
+
+/// Operand of contract_colmajor permuted into a column-major buffer in the order of another annotation
+struct colmajor_permuted {
+  std::vector<unsigned long> extent; //!< extents in the new order
+  std::vector<long> stride;          //!< strides of the buffer
+  std::vector<long> source_stride;   //!< strides of the tensor, in the new order
+};
+
+template<class _AnnotationX, class _AnnotationY, class _Extent, class _Stride>
+colmajor_permuted make_colmajor_permuted(const _AnnotationX& aX, const _Extent& ext, const _Stride& str, const _AnnotationY& cX) {
+  colmajor_permuted op;
+  long s = 1;
+  for (size_t i = 0; i != cX.size(); ++i) {
+    const size_t p = std::distance(aX.begin(), std::find(aX.begin(), aX.end(), cX[i]));
+    op.extent.push_back(ext[p]);
+    op.source_stride.push_back(str[p]);
+    op.stride.push_back(s);
+    s *= ext[p];
+  }
+  return op;
+}
+
+} // namespace impl
+
+/// Contracts contiguous column-major tensors of any rank by GEMMs that address A, B and C in place.
+/// Indices are grouped into the M, N and K dimensions of a matrix product; when a group is not one
+/// contiguous block, its slowest indices are looped over, i.e. A, B and C are viewed as batches of matrices.
+/// Only if that fails are the operands that need it permuted into the order (M,K) x (K,N) -> (M,N).
 template<typename _T, class _TensorA, class _TensorB, class _TensorC,
          typename _UA, typename _UB, typename _UC
         >
-void contract_222(const _T& alpha, const _TensorA& A, const btas::varray<_UA>& aA, const _TensorB& B, const btas::varray<_UB>& aB,
-                  const _T& beta, _TensorC& C, const btas::varray<_UC>& aC) {
-  // TODO we do not consider complex matrixces yet.
-  assert(aA.size() == 2 && aB.size() == 2 && aC.size() == 2);
+void contract_colmajor(const _T& alpha, const _TensorA& A, const btas::varray<_UA>& aA, const _TensorB& B, const btas::varray<_UB>& aB,
+                       const _T& beta, _TensorC& C, const btas::varray<_UC>& aC) {
+  typedef typename _TensorC::value_type value_type;
   assert(A.range().ordinal().contiguous() && B.range().ordinal().contiguous() && C.range().ordinal().contiguous());
-  if (std::find(aA.begin(), aA.end(), aC.front()) != aA.end()) {
-    // then multiply A * B -> C
-    const bool notrans  = aA.front() == aC.front();
-    const auto   cA     = notrans ? CblasNoTrans : CblasTrans;
-    const size_t condim = notrans ? A.extent(1) : A.extent(0);
-    assert(std::find(aB.begin(), aB.end(), aC.back()) != aB.end());
-    const auto   cB     = aB.front() == aC.back() ? CblasTrans : CblasNoTrans;
-    assert((cA == CblasNoTrans ? aA.back() : aA.front()) == (cB == CblasTrans ? aB.back() : aB.front()));
-
-    gemm_impl<true>::call(CblasColMajor, cA, cB, C.extent(0), C.extent(1), condim,
-                          alpha, &*A.begin(), A.extent(0), &*B.begin(), B.extent(0), beta, &*C.begin(), C.extent(0));
-  } else {
-    contract_222(alpha, B, aB, A, aA, beta, C, aC);
+
+  const auto extA = extent(A);
+  const auto extB = extent(B);
+  const auto extC = extent(C);
+  const auto& strA = A.range().ordinal().stride();
+  const auto& strB = B.range().ordinal().stride();
+  const auto& strC = C.range().ordinal().stride();
+  const value_type a = alpha;
+  const value_type b = beta;
+
+  impl::strided_gemm_plan plan;
+  if (impl::make_strided_gemm_plan(extA, strA, aA, extB, strB, aB, extC, strC, aC, plan, 0)) {
+    impl::strided_gemm(plan, a, &*A.begin(), &*B.begin(), b, &*C.begin());
+    return;
+  }
+
+  // no fusion exists: free indices in the order of C, contracted indices in the order of A
+  btas::varray<_UA> cA;
+  btas::varray<_UB> cB;
+  btas::varray<_UC> cC(aC);
+  std::vector<_UA> m, k;
+  std::vector<_UB> n;
+  for (auto x : aC) {
+    if (std::find(aA.begin(), aA.end(), x) != aA.end())
+      m.push_back(x);
+    else
+      n.push_back(x);
   }
+  for (auto x : aA)
+    if (std::find(aC.begin(), aC.end(), x) == aC.end()) k.push_back(x);
+  if (m.size()+k.size() != aA.size() || k.size()+n.size() != aB.size())
+    throw std::logic_error("contract_colmajor: every index must be free in one operand or contracted between A and B");
+  cA = btas::varray<_UA>(m.size()+k.size());
+  cB = btas::varray<_UB>(k.size()+n.size());
+  std::copy(m.begin(), m.end(), cA.begin());
+  std::copy(k.begin(), k.end(), cA.begin()+m.size());
+  std::copy(k.begin(), k.end(), cB.begin());
+  std::copy(n.begin(), n.end(), cB.begin()+k.size());
+  std::copy(m.begin(), m.end(), cC.begin());
+  std::copy(n.begin(), n.end(), cC.begin()+m.size());
+
+  const bool permA = !std::equal(aA.begin(), aA.end(), cA.begin());
+  const bool permB = !std::equal(aB.begin(), aB.end(), cB.begin());
+  const bool permC = !std::equal(aC.begin(), aC.end(), cC.begin());
+  const impl::colmajor_permuted pA = impl::make_colmajor_permuted(aA, extA, strA, cA);
+  const impl::colmajor_permuted pB = impl::make_colmajor_permuted(aB, extB, strB, cB);
+  const impl::colmajor_permuted pC = impl::make_colmajor_permuted(aC, extC, strC, cC);
+  std::vector<value_type> bufA(permA ? A.size() : 0), bufB(permB ? B.size() : 0), bufC(permC ? C.size() : 0);
+  if (permA) impl::transpose(pA.extent, &*A.begin(), pA.source_stride, bufA.data(), pA.stride);
+  if (permB) impl::transpose(pB.extent, &*B.begin(), pB.source_stride, bufB.data(), pB.stride);
+  if (permC && beta != static_cast<_T>(0)) impl::transpose(pC.extent, const_cast<const value_type*>(&*C.begin()), pC.source_stride, bufC.data(), pC.stride);
+
+  // the permuted operands have contiguous groups, so this always fuses
+  const bool fused = impl::make_strided_gemm_plan(pA.extent, pA.stride, cA, pB.extent, pB.stride, cB, pC.extent, pC.stride, cC, plan, 0);
+  assert(fused);
+  (void)fused;
+  impl::strided_gemm(plan, a, permA ? bufA.data() : &*A.begin(), permB ? bufB.data() : &*B.begin(), b, permC ? bufC.data() : &*C.begin());
+
+  if (permC) impl::transpose(pC.extent, const_cast<const value_type*>(bufC.data()), pC.stride, &*C.begin(), pC.source_stride);
 }
 
+/// matrix x matrix -> matrix contraction, kept for existing callers; forwards to contract_colmajor
+template<typename _T, class _TensorA, class _TensorB, class _TensorC,
+         typename _UA, typename _UB, typename _UC
+        >
+inline void contract_222(const _T& alpha, const _TensorA& A, const btas::varray<_UA>& aA, const _TensorB& B, const btas::varray<_UB>& aB,
+                         const _T& beta, _TensorC& C, const btas::varray<_UC>& aC) {
+  assert(aA.size() == 2 && aB.size() == 2 && aC.size() == 2);
+  contract_colmajor(alpha, A, aA, B, aB, beta, C, aC);
+}
 
+/// rank-3 x matrix -> rank-3 contraction, kept for existing callers; forwards to contract_colmajor
 template<typename _T, class _TensorA, class _TensorB, class _TensorC,
          typename _UA, typename _UB, typename _UC
         >
-void contract_323(const _T& alpha, const _TensorA& A, const btas::varray<_UA>& aA, const _TensorB& B, const btas::varray<_UB>& aB,
-                  const _T& beta, _TensorC& C, const btas::varray<_UC>& aC) {
+inline void contract_323(const _T& alpha, const _TensorA& A, const btas::varray<_UA>& aA, const _TensorB& B, const btas::varray<_UB>& aB,
+                         const _T& beta, _TensorC& C, const btas::varray<_UC>& aC) {
   assert(aA.size() == 3 && aB.size() == 2 && aC.size() == 3);
-  assert(A.range().ordinal().contiguous() && B.range().ordinal().contiguous() && C.range().ordinal().contiguous());
-
-  // TODO this function is limited to special cases where one of three indices of A will be replaced in C. Permuation is not considered so far.
-  // first idenfity which indices to be rotated
-  int irot = -1;
-  for (int i = 0; i != 3; ++i)
-    if (aA[i] != aC[i]) {
-      assert(irot < 0);
-      irot = i;
-    } else
-      assert(A.extent(i) == C.extent(i));
-
-  if (irot == 0) {
-    // in this case multiply from front
-    const bool notrans = aB.back() == aA.front();
-    assert(notrans || aB.front() == aA.front());
-    const auto cA = CblasNoTrans;
-    const auto cB = notrans ? CblasNoTrans : CblasTrans;
-    assert(notrans ? B.extent(1) : B.extent(0) == A.extent(0));
-
-    gemm_impl<true>::call(CblasColMajor, cB, cA, C.extent(0), C.extent(1)*C.extent(2), A.extent(0),
-                          alpha, &*B.begin(), B.extent(0), &*A.begin(), A.extent(0), beta, &*C.begin(), C.extent(0));
-  } else if (irot == 1) {
-    // in this case we loop over the last index of A
-    const bool notrans = aB.front() == aA[1];
-    assert(notrans || aB.back() == aA[1]);
-    const auto cA = CblasNoTrans;
-    const auto cB = notrans ? CblasNoTrans : CblasTrans;
-    assert(notrans ? B.extent(0) : B.extent(1) == A.extent(1));
-    const size_t ablock = A.extent(0)*A.extent(1);
-    const size_t cblock = C.extent(0)*C.extent(1);
-
-    for (int i = 0; i != A.extent(2); ++i)
-      gemm_impl<true>::call(CblasColMajor, cA, cB, C.extent(0), C.extent(1), A.extent(1),
-                            alpha, &*A.begin()+i*ablock, A.extent(0), &*B.begin(), B.extent(0), beta, &*C.begin()+i*cblock, C.extent(0));
-  } else if (irot == 2) {
-    // in this case multiply from back
-    const bool notrans = aB.front() == aA[2];
-    assert(notrans || aB.back() == aA[2]);
-    const auto cA = CblasNoTrans;
-    const auto cB = notrans ? CblasNoTrans : CblasTrans;
-    assert(notrans ? B.extent(0) : B.extent(1) == A.extent(2));
-    gemm_impl<true>::call(CblasColMajor, cA, cB, C.extent(0)*C.extent(1), C.extent(2), A.extent(2),
-                          alpha, &*A.begin(), A.extent(0)*A.extent(1), &*B.begin(), B.extent(0), beta, &*C.begin(), C.extent(0)*C.extent(1));
-  } else {
-    assert(false);
-  }
+  contract_colmajor(alpha, A, aA, B, aB, beta, C, aC);
 }
 
-
+/// rank-3 x rank-3 -> matrix contraction, kept for existing callers; forwards to contract_colmajor
 template<typename _T, class _TensorA, class _TensorB, class _TensorC,
          typename _UA, typename _UB, typename _UC
         >
-void contract_332(const _T& alpha, const _TensorA& A, const btas::varray<_UA>& aA, const _TensorB& B, const btas::varray<_UB>& aB,
-                  const _T& beta, _TensorC& C, const btas::varray<_UC>& aC) {
+inline void contract_332(const _T& alpha, const _TensorA& A, const btas::varray<_UA>& aA, const _TensorB& B, const btas::varray<_UB>& aB,
+                         const _T& beta, _TensorC& C, const btas::varray<_UC>& aC) {
   assert(aA.size() == 3 && aB.size() == 3 && aC.size() == 2);
-  assert(A.range().ordinal().contiguous() && B.range().ordinal().contiguous() && C.range().ordinal().contiguous());
-
-  const bool back2  = aA[0] == aB[0] && aA[1] == aB[1];
-  const bool front2 = aA[1] == aB[1] && aA[2] == aB[2];
-  const bool mid2   = aA[0] == aB[0] && aA[2] == aB[2];
-  if (back2) {
-    const bool swap = aC[0] == aB[2];
-    assert(swap || aC[0] == aA[2]);
-    if (!swap) {
-      assert(A.extent(0)*A.extent(1) == B.extent(0)*B.extent(1) && A.extent(2) == C.extent(0) && B.extent(2) == C.extent(1));
-      gemm_impl<true>::call(CblasColMajor, CblasTrans, CblasNoTrans, C.extent(0), C.extent(1), A.extent(0)*A.extent(1),
-                            alpha, &*A.begin(), A.extent(0)*A.extent(1), &*B.begin(), B.extent(0)*B.extent(1), beta, &*C.begin(), C.extent(0));
-    } else {
-      assert(A.extent(0)*A.extent(1) == B.extent(0)*B.extent(1) && B.extent(2) == C.extent(0) && A.extent(2) == C.extent(1));
-      gemm_impl<true>::call(CblasColMajor, CblasTrans, CblasNoTrans, C.extent(0), C.extent(1), A.extent(0)*A.extent(1),
-                            alpha, &*B.begin(), B.extent(0)*B.extent(1), &*A.begin(), A.extent(0)*A.extent(1), beta, &*C.begin(), C.extent(0));
-    }
-  } else if (front2) {
-    const bool swap = aC[0] == aB[0];
-    assert(swap || aC[0] == aA[0]);
-    if (!swap) {
-      assert(A.extent(1)*A.extent(2) == B.extent(1)*B.extent(2) && A.extent(0) == C.extent(0) && B.extent(0) == C.extent(1));
-      gemm_impl<true>::call(CblasColMajor, CblasNoTrans, CblasTrans, C.extent(0), C.extent(1), A.extent(1)*A.extent(2),
-                            alpha, &*A.begin(), A.extent(0), &*B.begin(), B.extent(0), beta, &*C.begin(), C.extent(0));
-    } else {
-      assert(A.extent(1)*A.extent(2) == B.extent(1)*B.extent(2) && B.extent(0) == C.extent(0) && A.extent(0) == C.extent(1));
-      gemm_impl<true>::call(CblasColMajor, CblasNoTrans, CblasTrans, C.extent(0), C.extent(1), A.extent(1)*A.extent(2),
-                            alpha, &*B.begin(), B.extent(0), &*A.begin(), A.extent(0), beta, &*C.begin(), C.extent(0));
-    }
-  } else if (mid2) {
-    const bool swap = aC[0] == aB[1];
-    assert(swap || aC[0] == aA[1]);
-    const size_t ablock = A.extent(0)*A.extent(1);
-    const size_t bblock = B.extent(0)*B.extent(1);
-    scal(C.size(), beta, &*C.begin(), 1);
-    if (!swap) {
-      assert(A.extent(0) == B.extent(0) && A.extent(2) == B.extent(2) && A.extent(1) == C.extent(0) && B.extent(1) == C.extent(1));
-      for (int i = 0; i != A.extent(2); ++i)
-        gemm_impl<true>::call(CblasColMajor, CblasTrans, CblasNoTrans, C.extent(0), C.extent(1), A.extent(0),
-                              alpha, &*A.begin()+i*ablock, A.extent(0), &*B.begin()+i*bblock, B.extent(0), 1.0, &*C.begin(), C.extent(0));
-    } else {
-      assert(A.extent(0) == B.extent(0) && A.extent(2) == B.extent(2) && B.extent(1) == C.extent(0) && A.extent(1) == C.extent(1));
-      for (int i = 0; i != A.extent(2); ++i)
-        gemm_impl<true>::call(CblasColMajor, CblasTrans, CblasNoTrans, C.extent(0), C.extent(1), A.extent(0),
-                              alpha, &*B.begin()+i*bblock, B.extent(0), &*A.begin()+i*ablock, A.extent(0), 1.0, &*C.begin(), C.extent(0));
-    }
-  } else
-    throw std::logic_error("not yet implemented");
+  contract_colmajor(alpha, A, aA, B, aB, beta, C, aC);
 }
 
 
@@ -169,17 +162,7 @@ void contract(
   const _T& beta,
         _TensorC& C, std::initializer_list<_UC> aC) {
 
-  if (A.rank() == 2 && B.rank() == 2 && C.rank() == 2) {
-    contract_222(alpha, A, btas::varray<_UA>(aA), B, btas::varray<_UB>(aB), beta, C, btas::varray<_UC>(aC));
-  } else if (A.rank() == 3 && B.rank() == 2 && C.rank() == 3) {
-    contract_323(alpha, A, btas::varray<_UA>(aA), B, btas::varray<_UB>(aB), beta, C, btas::varray<_UC>(aC));
-  } else if (A.rank() == 2 && B.rank() == 3 && C.rank() == 3) {
-    contract_323(alpha, B, btas::varray<_UA>(aB), A, btas::varray<_UB>(aA), beta, C, btas::varray<_UC>(aC));
-  } else if (A.rank() == 3 && B.rank() == 3 && C.rank() == 2) {
-    contract_332(alpha, A, btas::varray<_UA>(aA), B, btas::varray<_UB>(aB), beta, C, btas::varray<_UC>(aC));
-  } else {
-    throw std::logic_error("not yet implemented");
-  }
+  contract_colmajor(alpha, A, btas::varray<_UA>(aA), B, btas::varray<_UB>(aB), beta, C, btas::varray<_UC>(aC));
 }
 
 } //namespace btas
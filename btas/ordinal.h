@@ -15,6 +15,27 @@
 
 namespace btas {
 
+  namespace impl {
+
+    /// sum_d index[d] * stride[d] over the dimensions _D, ..., _Rank-1, unrolled at compile time
+    template <std::size_t _Rank, std::size_t _D = 0>
+    struct index_dot {
+      template <typename Index, typename Stride>
+      static int64_t call(const Index& index, const Stride& stride) {
+        return *(std::begin(index) + _D) * stride[_D] + index_dot<_Rank, _D+1>::call(index, stride);
+      }
+    };
+
+    template <std::size_t _Rank>
+    struct index_dot<_Rank, _Rank> {
+      template <typename Index, typename Stride>
+      static int64_t call(const Index&, const Stride&) {
+        return 0;
+      }
+    };
+
+  } // namespace impl
+
   /// BoxOrdinal is an implementation detail of BoxRange.
   /// It maps the index to its ordinal value. It also knows whether
   /// the map is contiguous (i.e. whether adjacent indices have adjacent ordinal
@@ -107,12 +128,7 @@ namespace btas {
       template <typename Index>
       typename std::enable_if<btas::is_index<Index>::value, value_type>::type
       operator()(const Index& index) const {
-        value_type o = 0;
-        const auto end = this->rank();
-        for(auto i = 0ul; i != end; ++i)
-          o += *(std::begin(index) + i) * *(std::begin(this->stride_) + i);
-
-        return o - offset_;
+        return dot(index, std::integral_constant<bool, btas::index_rank_traits<stride_type>::fixed>()) - offset_;
       }
 
       /// Does ordinal value belong to this ordinal range?
@@ -124,6 +140,23 @@ namespace btas {
 
     private:
 
+      /// index . stride, unrolled if the rank is fixed at compile time
+      template <typename Index>
+      value_type dot(const Index& index, std::true_type) const {
+        return impl::index_dot<btas::index_rank_traits<stride_type>::rank>::call(index, stride_);
+      }
+
+      template <typename Index>
+      value_type dot(const Index& index, std::false_type) const {
+        value_type o = 0;
+        const auto end = this->rank();
+        auto i = std::begin(index);
+        auto s = std::begin(stride_);
+        for(auto d = 0ul; d != end; ++d, ++i, ++s)
+          o += *i * *s;
+        return o;
+      }
+
       template <typename Index1,
                 typename Index2,
                 class = typename std::enable_if<btas::is_index<Index1>::value && btas::is_index<Index2>::value>::type
@@ -149,7 +182,7 @@ namespace btas {
           }
         }
         else {
-          for(auto i = 0; i != n; ++i) {
+          for(decltype(n) i = 0; i != n; ++i) {
             stride_[i] = volume;
             auto li = *(std::begin(lobound) + i);
             auto ui = *(std::begin(upbound) + i);
@@ -194,7 +227,7 @@ namespace btas {
           }
         }
         else {
-          for(auto i = 0; i != n; ++i) {
+          for(decltype(n) i = 0; i != n; ++i) {
             tmpstride[i] = volume;
             contiguous_ &= (tmpstride[i] == stride_[i]);
             auto li = *(std::begin(lobound) + i);
@@ -9,6 +9,8 @@
 #define BTAS_RANGE_H_
 
 #include <algorithm>
+#include <iterator>
+#include <utility>
 #include <vector>
 #include <functional>
 #include <numeric>
@@ -150,7 +152,8 @@ namespace btas {
 
         /// Size of Range1d is the number of elements encountered in iteration rom begin to end.
         size_t size() const {
-          return (upbound_ - lobound_) / stride_;
+          const index_type n = (upbound_ - lobound_ + stride_ - (stride_ > 0 ? 1 : -1)) / stride_;
+          return n > 0 ? n : 0;
         }
 
         /// Index iterator factory
@@ -180,7 +183,31 @@ namespace btas {
           i = upbound_;
         }
 
+        /// Advance the coordinate index \c i by \c n in this range
+
+        /// \param[in,out] i The coordinate index to be advanced
+        /// \param n The distance to advance \c i
+        void advance(index_type& i, std::ptrdiff_t n) const {
+          const std::ptrdiff_t o = position(i) + n;
+          assert(o >= 0 && o <= static_cast<std::ptrdiff_t>(size()));
+          i = (o == static_cast<std::ptrdiff_t>(size())) ? upbound_ : lobound_ + o * stride_;
+        }
+
+        /// Compute the distance between the coordinate indices \c first and \c last
+
+        /// \param first The starting position in the range
+        /// \param last The ending position in the range
+        /// \return The difference between first and last, in terms of range positions
+        std::ptrdiff_t distance_to(const index_type& first, const index_type& last) const {
+          return position(last) - position(first);
+        }
+
       private:
+        /// \return The number of increments from lobound to \c i , size() for upbound
+        std::ptrdiff_t position(const index_type& i) const {
+          return (i == upbound_) ? size() : (i - lobound_) / stride_;
+        }
+
         index_type lobound_;
         index_type upbound_;
         index_type stride_;
@@ -229,6 +256,86 @@ namespace btas {
       assert(false); // unreachable
     }
 
+    namespace impl {
+
+      /// Increments an index of a box, dimension by dimension in the order \c _Order,
+      /// fully unrolled for indices whose rank \c _Rank is known at compile time.
+      /// \c _Step counts the dimensions already carried over.
+      template <CBLAS_ORDER _Order, std::size_t _Rank, std::size_t _Step = 0>
+      struct box_increment {
+        static constexpr const std::size_t d = (_Order == CblasRowMajor) ? _Rank-1-_Step : _Step;
+
+        /// \return false if \c i fell off the end of the box, then \c i holds the lobound
+        template <typename Index, typename Bound>
+        static bool call(Index& i, const Bound& lobound, const Bound& upbound) {
+          if(++i[d] < upbound[d]) return true;
+          i[d] = lobound[d];
+          return box_increment<_Order, _Rank, _Step+1>::call(i, lobound, upbound);
+        }
+
+        /// Same, also updating the ordinal \c ord of \c i
+        template <typename Index, typename Ordinal, typename Bound, typename Stride>
+        static bool call(Index& i, Ordinal& ord, const Bound& lobound, const Bound& upbound, const Stride& stride) {
+          if(++i[d] < upbound[d]) {
+            ord += stride[d];
+            return true;
+          }
+          ord -= (upbound[d] - lobound[d] - 1) * stride[d];
+          i[d] = lobound[d];
+          return box_increment<_Order, _Rank, _Step+1>::call(i, ord, lobound, upbound, stride);
+        }
+      };
+
+      template <CBLAS_ORDER _Order, std::size_t _Rank>
+      struct box_increment<_Order, _Rank, _Rank> {
+        template <typename Index, typename Bound>
+        static bool call(Index&, const Bound&, const Bound&) {
+          return false;
+        }
+        template <typename Index, typename Ordinal, typename Bound, typename Stride>
+        static bool call(Index&, Ordinal&, const Bound&, const Bound&, const Stride&) {
+          return false;
+        }
+      };
+
+      /// box_increment for indices whose rank is only known at runtime
+      template <CBLAS_ORDER _Order>
+      struct box_increment_dynamic {
+        template <typename Index, typename Bound>
+        static bool call(Index& i, const Bound& lobound, const Bound& upbound) {
+          const long n = std::end(lobound) - std::begin(lobound);
+          for(long s = 0; s != n; ++s) {
+            const long d = (_Order == CblasRowMajor) ? n-1-s : s;
+            if(++i[d] < upbound[d]) return true;
+            i[d] = lobound[d];
+          }
+          return false;
+        }
+        template <typename Index, typename Ordinal, typename Bound, typename Stride>
+        static bool call(Index& i, Ordinal& ord, const Bound& lobound, const Bound& upbound, const Stride& stride) {
+          const long n = std::end(lobound) - std::begin(lobound);
+          for(long s = 0; s != n; ++s) {
+            const long d = (_Order == CblasRowMajor) ? n-1-s : s;
+            if(++i[d] < upbound[d]) {
+              ord += stride[d];
+              return true;
+            }
+            ord -= (upbound[d] - lobound[d] - 1) * stride[d];
+            i[d] = lobound[d];
+          }
+          return false;
+        }
+      };
+
+      /// box_increment if the rank of \c _Index is fixed, box_increment_dynamic otherwise
+      template <CBLAS_ORDER _Order, typename _Index>
+      using box_increment_t = typename std::conditional<btas::index_rank_traits<_Index>::fixed,
+                                                        box_increment<_Order, btas::index_rank_traits<_Index>::rank>,
+                                                        box_increment_dynamic<_Order>
+                                                       >::type;
+
+    } // namespace impl
+
     /// BaseRangeNd is a <a href="http://en.wikipedia.org/wiki/Curiously_recurring_template_pattern">CRTP</a>
     /// base for implementations of N-dimensional Ranges.
 
@@ -504,43 +611,62 @@ namespace btas {
       /// \param[in,out] i The coordinate index to be incremented
       void increment(index_type& i) const {
 
-        for(auto d: dim_range<order>(rank())) {
-          // increment coordinate
-          ++i[d];
-
-          // break if done
-          if(i[d] < upbound_[d])
-            return;
-
-          // Reset current index to lobound value.
-          i[d] = lobound_[d];
-        }
+        if(impl::box_increment_t<order, index_type>::call(i, lobound_, upbound_))
+          return;
 
         // if the current location is outside the range, make it equal to range end iterator
         std::copy(std::begin(upbound_), std::end(upbound_), std::begin(i));
       }
 
-#if 0
       /// Advance the coordinate index \c i by \c n in this range
 
+      /// The index is decoded from its position in the order of iteration, at O(rank) cost.
       /// \param[in,out] i The coordinate index to be advanced
       /// \param n The distance to advance \c i
-      void advance(index& i, std::ptrdiff_t n) const {
-        const size_type o = ord(i) + n;
-        i = idx(o);
+      void advance(index_type& i, std::ptrdiff_t n) const {
+        const std::ptrdiff_t o = position(i) + n;
+        const std::ptrdiff_t a = area();
+        assert(o >= 0 && o <= a);
+        if (o == a) {
+          std::copy(std::begin(upbound_), std::end(upbound_), std::begin(i));
+          return;
+        }
+        std::ptrdiff_t r = o;
+        const auto end = this->rank();
+        for(auto d = 0ul; d != end; ++d) {
+          const auto dd = (order == CblasRowMajor) ? end - 1 - d : d;
+          const std::ptrdiff_t e = upbound_[dd] - lobound_[dd];
+          i[dd] = lobound_[dd] + r % e;
+          r /= e;
+        }
       }
 
       /// Compute the distance between the coordinate indices \c first and \c last
 
-      /// \param first The lobounding position in the range
+      /// \param first The starting position in the range
       /// \param last The ending position in the range
       /// \return The difference between first and last, in terms of range positions
-      std::ptrdiff_t distance_to(const index& first, const index& last) const {
-        TA_ASSERT(includes(first));
-        TA_ASSERT(includes(last));
-        return ord(last) - ord(first);
+      std::ptrdiff_t distance_to(const index_type& first, const index_type& last) const {
+        return position(last) - position(first);
       }
-#endif
+
+    private:
+      /// \return The number of increments from lobound to \c i , area() for upbound
+      std::ptrdiff_t position(const index_type& i) const {
+        if (std::equal(std::begin(upbound_), std::end(upbound_), std::begin(i)))
+          return area();
+        std::ptrdiff_t o = 0;
+        std::ptrdiff_t volume = 1;
+        const auto end = this->rank();
+        for(auto d = 0ul; d != end; ++d) {
+          const auto dd = (order == CblasRowMajor) ? end - 1 - d : d;
+          o += (i[dd] - lobound_[dd]) * volume;
+          volume *= upbound_[dd] - lobound_[dd];
+        }
+        return o;
+      }
+
+    public:
 
       /// Check the index to make sure it is within the range.
 
@@ -859,27 +985,53 @@ namespace btas {
       typename std::enable_if<btas::is_index<Index1>::value && btas::is_index<Index2>::value, RangeNd>::type
       slice(const Index1& lobound, const Index2& upbound) const
       {
-        return RangeNd(lobound, upbound, _Ordinal(this->lobound(), this->upbound(), this->ordinal().stride()));
+        using btas::rank;
+        index_type lb = array_adaptor<index_type>::construct(rank(lobound));
+        index_type ub = array_adaptor<index_type>::construct(rank(upbound));
+        std::copy(std::begin(lobound), std::end(lobound), std::begin(lb));
+        std::copy(std::begin(upbound), std::end(upbound), std::begin(ub));
+        return RangeNd(std::move(lb), std::move(ub), _Ordinal(this->lobound(), this->upbound(), this->ordinal().stride()));
       }
 
       /// Constructs a Range slice defined by a subrange for each dimension
+
+      /// A subrange may have a non-unit stride, negative to reverse the dimension. Dimension \c d of the slice
+      /// then spans [range1s[d].lobound(), range1s[d].lobound() + range1s[d].size()), its index \c i standing for
+      /// index lobound + (i - lobound) * stride of this Range. The steps are folded into the strides and the offset
+      /// of the ordinal, so that the slice addresses the elements of this Range in place.
       template <typename U>
       RangeNd
       slice(std::initializer_list<Range1d<U>> range1s) const
       {
-        for(auto i: range1s)
-          assert(i.stride() == 1);
-
-        btas::varray<long> lb(range1s.size());
-        btas::varray<long> ub(range1s.size());
+        typedef typename _Ordinal::stride_type stride_type;
+        typedef typename _Ordinal::value_type ordinal_value_type;
+        const auto n = range1s.size();
+        assert(n == this->rank());
+
+        index_type lb = array_adaptor<index_type>::construct(n);
+        index_type ub = array_adaptor<index_type>::construct(n);
+        stride_type stride = array_adaptor<stride_type>::construct(n);
+        ordinal_value_type offset = this->ordinal().offset();
         int c=0;
         for(auto i: range1s) {
+          const ordinal_value_type s = this->ordinal().stride()[c];
           lb[c] = i.lobound();
-          ub[c] = i.upbound();
+          ub[c] = i.lobound() + static_cast<ordinal_value_type>(i.size());
+          stride[c] = s * i.stride();
+          offset += s * i.lobound() * (i.stride() - 1);
           ++c;
         }
 
-        return RangeNd(std::move(lb), std::move(ub), _Ordinal(this->lobound(), this->upbound(), this->ordinal().stride()));
+        // contiguous if the strides are those of a dense Range of the extents of the slice
+        bool contiguous = true;
+        ordinal_value_type volume = 1;
+        for(size_t d = 0; d != n; ++d) {
+          const size_t dd = (order == CblasRowMajor) ? n - 1 - d : d;
+          contiguous &= (ub[dd] - lb[dd] == 1 || stride[dd] == volume);
+          volume *= ub[dd] - lb[dd];
+        }
+
+        return RangeNd(std::move(lb), std::move(ub), _Ordinal(std::move(stride), std::move(offset), contiguous));
       }
 
       using base_type::includes;
@@ -900,26 +1052,27 @@ namespace btas {
       /// \param[in,out] pair<index,ordinal> to be incremented
       void increment(subiter_value_type& i) const {
 
-        for(auto d: dim_range<order>(this->rank())) {
-          // increment subindex
-          ++i.first[d];
-
-          // break if done
-          if(i.first[d] < this->upbound_[d]) {
-            i.second += ordinal_.stride()[d];
-            return;
-          }
-
-          // Reset current subindex to lobound value and move to the next
-          i.second -= (this->upbound_[d] - this->lobound_[d] - 1) * ordinal_.stride()[d];
-          i.first[d] = this->lobound_[d];
-        }
+        // the ordinal is updated along with the index, O(1) amortized per step
+        if(impl::box_increment_t<order, index_type>::call(i.first, i.second, this->lobound_, this->upbound_, ordinal_.stride()))
+          return;
 
         // if outside the range, point to the upper bound ... Range::end() will evaluate to upbound also! Range will use this
         std::copy(std::begin(this->upbound_), std::end(this->upbound_), std::begin(i.first));
         i.second = ordinal(i.first);
       }
 
+      using base_type::advance;
+      /// Advances <index,ordinal> pair by \c n , the ordinal being recomputed from the index
+      void advance(subiter_value_type& i, std::ptrdiff_t n) const {
+        this->base_type::advance(i.first, n);
+        i.second = ordinal(i.first);
+      }
+
+      using base_type::distance_to;
+      std::ptrdiff_t distance_to(const subiter_value_type& first, const subiter_value_type& last) const {
+        return this->base_type::distance_to(first.first, last.first);
+      }
+
     private:
       /// The Ordinal object
       _Ordinal ordinal_;
@@ -1229,6 +1382,34 @@ namespace btas {
         }
 
 
+    /// Splits a range into consecutive chunks for parallel loops
+
+    /// The chunks have nearly equal numbers of indices, and each starts at its own offset in the order of
+    /// iteration, which the range iterator reaches in O(rank) steps; e.g. chunk \c c of \c partition(r, n) can be
+    /// given to thread \c c of a parallel_for, which may build iterators of a TensorView from it.
+    /// \param r The range to be split
+    /// \param nchunks The number of chunks
+    /// \return The [begin,end) iterators of the chunks, min(nchunks, number of indices) of them
+    template <typename _Range>
+    std::vector<std::pair<typename _Range::const_iterator, typename _Range::const_iterator>>
+    partition(const _Range& r, size_t nchunks) {
+      typedef typename _Range::const_iterator iterator;
+      const auto first = r.begin();
+      const std::size_t n = std::distance(first, r.end());
+      nchunks = std::min(nchunks, n);
+      std::vector<std::pair<iterator, iterator>> chunks;
+      chunks.reserve(nchunks);
+      if (nchunks == 0) return chunks;
+      const std::size_t len = n / nchunks, rem = n % nchunks;
+      iterator it = first;
+      for(std::size_t c = 0; c != nchunks; ++c) {
+        const iterator begin = it;
+        it += len + (c < rem ? 1 : 0);
+        chunks.emplace_back(begin, it);
+      }
+      return chunks;
+    }
+
     template <CBLAS_ORDER _Order,
               typename _Index,
               typename _Ordinal>
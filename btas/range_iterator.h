@@ -20,6 +20,7 @@
 #ifndef BTAS_RANGE_ITERATOR_H__INCLUDED
 #define BTAS_RANGE_ITERATOR_H__INCLUDED
 
+#include <cassert>
 #include <iterator>
 
 namespace btas {
@@ -45,12 +46,13 @@ namespace btas {
 
     /// Iterates over a Range of Values
 
-    /// This is an input iterator that is used to iterate over elements of a \c Range.
+    /// This is a random-access iterator that is used to iterate over elements of a \c Range.
     /// \tparam Value The value type of the iterator
     /// \tparam Range The range that the iterator references
-    /// \note The range object must define the function
-    /// \c Range::increment(Value&) \c const, and be accessible to
-    /// \c RangeIterator.
+    /// \note The range object must define the functions
+    /// \c Range::increment(Value&) \c const, \c Range::advance(Value&,difference_type) \c const, and
+    /// \c Range::distance_to(const Value&,const Value&) \c const, and be accessible to
+    /// \c RangeIterator. Only \c increment is needed to iterate forward one step at a time.
     template <typename Value,
               typename Range>
     class RangeIterator {
@@ -60,12 +62,15 @@ namespace btas {
       typedef Value value_type;                                    ///< Iterator value type
       typedef const value_type& reference;                         ///< Iterator reference type
       typedef const value_type* pointer;                           ///< Iterator pointer type
-      typedef std::input_iterator_tag iterator_category;           ///< Iterator category tag
+      typedef std::random_access_iterator_tag iterator_category;   ///< Iterator category tag
       typedef std::ptrdiff_t difference_type;                      ///< Iterator difference type
 
       // additional typedefs
       typedef Range range_type;                                    ///< Range type
 
+      /// Default constructor, the iterator references no range
+      RangeIterator() : range_(nullptr), current_() { }
+
       /// Copy constructor
 
       /// \param other The other iterator to be copied
@@ -123,12 +128,59 @@ namespace btas {
       /// \return A \c pointer to the current data
       pointer operator->() const { return & current_; }
 
+      /// Decrement operator
+
+      /// \return The modified iterator
+      RangeIterator& operator--() {
+        range_->advance(current_, -1);
+        return *this;
+      }
+
+      /// Decrement operator
+
+      /// \return An unmodified copy of the iterator
+      RangeIterator operator--(int) {
+        RangeIterator temp(*this);
+        range_->advance(current_, -1);
+        return temp;
+      }
+
+      RangeIterator& operator+=(difference_type n) {
+        range_->advance(current_, n);
+        return *this;
+      }
+
+      RangeIterator& operator-=(difference_type n) {
+        range_->advance(current_, -n);
+        return *this;
+      }
+
+      RangeIterator operator+(difference_type n) const {
+        RangeIterator temp(*this);
+        return temp += n;
+      }
+
+      RangeIterator operator-(difference_type n) const {
+        RangeIterator temp(*this);
+        return temp -= n;
+      }
+
+      /// \return The number of increments from \c other to this iterator
+      difference_type operator-(const RangeIterator& other) const {
+        return other.distance_to(*this);
+      }
+
+      /// \return The value \c n steps from the current one, by value since it is not stored
+      value_type operator[](difference_type n) const {
+        return *(*this + n);
+      }
+
       void advance(difference_type n) {
         range_->advance(current_, n);
       }
 
       difference_type distance_to(const RangeIterator& other) const {
-        TA_ASSERT(range_ == other.range_);
+        assert(range_ == other.range_);
         return range_->distance_to(current_, other.current_);
       }
 
@@ -169,6 +221,33 @@ namespace btas {
           (left_it.range() != right_it.range());
     }
 
+    /// Ordering operators, by the position of the iterators in the range they reference
+    template <typename Value, typename Range>
+    bool operator<(const RangeIterator<Value, Range>& left_it, const RangeIterator<Value, Range>& right_it) {
+      return left_it.distance_to(right_it) > 0;
+    }
+
+    template <typename Value, typename Range>
+    bool operator>(const RangeIterator<Value, Range>& left_it, const RangeIterator<Value, Range>& right_it) {
+      return right_it < left_it;
+    }
+
+    template <typename Value, typename Range>
+    bool operator<=(const RangeIterator<Value, Range>& left_it, const RangeIterator<Value, Range>& right_it) {
+      return not (right_it < left_it);
+    }
+
+    template <typename Value, typename Range>
+    bool operator>=(const RangeIterator<Value, Range>& left_it, const RangeIterator<Value, Range>& right_it) {
+      return not (left_it < right_it);
+    }
+
+    template <typename Value, typename Range>
+    RangeIterator<Value, Range> operator+(typename RangeIterator<Value, Range>::difference_type n,
+                                          const RangeIterator<Value, Range>& it) {
+      return it + n;
+    }
+
 } // namespace btas
 
 namespace std {
@@ -0,0 +1,193 @@
+#ifndef __BTAS_SPARSE_TENSOR_H
+#define __BTAS_SPARSE_TENSOR_H 1
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <btas/defaults.h>
+#include <btas/array_adaptor.h>
+#include <btas/tensor.h>
+#include <btas/generic/numeric_type.h>
+
+namespace btas {
+
+  /// Element-sparse tensor in coordinate (COO) format: the nonzero elements and their ordinals in a box range
+
+  /// The coordinates of a nonzero are stored linearized, as its ordinal in \c range() , which for the
+  /// contiguous range of a SparseTensor is \f$ \sum_d (i_d - lobound_d) \, stride_d \f$. After compress()
+  /// the nonzeros are sorted by ordinal, i.e. in the iteration order of the range, and unique.
+  /// \tparam _T element type
+  /// \tparam _Range range type, see Tensor
+  template <typename _T, class _Range = btas::DEFAULT::range>
+  class SparseTensor {
+    public:
+      typedef _T value_type;
+      typedef _Range range_type;
+      typedef typename _Range::index_type index_type;
+      typedef std::int64_t ordinal_type;
+
+      SparseTensor() : compressed_(true) { }
+
+      /// empty, i.e. zero, tensor of range \c range , made contiguous
+      explicit
+      SparseTensor(const range_type& range) : range_(range.lobound(), range.upbound()), compressed_(true) { }
+
+      /// nonzero elements of the dense tensor \c x , those whose magnitude exceeds \c threshold
+      template <class _Tensor,
+                class = typename std::enable_if<is_boxtensor<_Tensor>::value>::type>
+      explicit
+      SparseTensor(const _Tensor& x, double threshold = 0.0) :
+        range_(x.range().lobound(), x.range().upbound()), compressed_(true) {
+        ordinal_type o = 0;
+        for (auto it = x.cbegin(); it != x.cend(); ++it, ++o) {
+          if (std::abs(*it) > threshold) {
+            ord_.push_back(o);
+            val_.push_back(*it);
+          }
+        }
+      }
+
+      const range_type& range() const { return range_; }
+
+      std::size_t rank() const { return range_.rank(); }
+
+      /// \return the number of elements, zeros included
+      std::size_t size() const { return range_.area(); }
+
+      /// \return the number of stored elements
+      std::size_t nnz() const { return ord_.size(); }
+
+      /// \return the fraction of elements that are stored
+      double density() const { return size() == 0 ? 0.0 : static_cast<double>(nnz()) / size(); }
+
+      /// stores \c val at \c index ; repeated indices are summed by compress()
+      template <typename _Index,
+                class = typename std::enable_if<is_index<_Index>::value>::type>
+      void insert(const _Index& index, const value_type& val) {
+        insert_ordinal(range_.ordinal(index), val);
+      }
+
+      void insert(std::initializer_list<long> index, const value_type& val) {
+        insert(btas::varray<long>(index), val);
+      }
+
+      /// stores \c val at ordinal \c o ; repeated ordinals are summed by compress()
+      void insert_ordinal(ordinal_type o, const value_type& val) {
+        assert(o >= 0 && static_cast<std::size_t>(o) < size());
+        if (!ord_.empty() && o <= ord_.back()) compressed_ = false;
+        ord_.push_back(o);
+        val_.push_back(val);
+      }
+
+      /// sorts the nonzeros by ordinal and sums those with the same ordinal
+      void compress() {
+        if (compressed_) return;
+        std::vector<std::size_t> p(ord_.size());
+        std::iota(p.begin(), p.end(), 0);
+        std::stable_sort(p.begin(), p.end(), [this](std::size_t i, std::size_t j) { return ord_[i] < ord_[j]; });
+        std::vector<ordinal_type> ord;
+        std::vector<value_type> val;
+        ord.reserve(p.size());
+        val.reserve(p.size());
+        for (auto i : p) {
+          if (!ord.empty() && ord.back() == ord_[i])
+            val.back() += val_[i];
+          else {
+            ord.push_back(ord_[i]);
+            val.push_back(val_[i]);
+          }
+        }
+        ord_.swap(ord);
+        val_.swap(val);
+        compressed_ = true;
+      }
+
+      bool compressed() const { return compressed_; }
+
+      /// sets the tensor to zero
+      void clear() {
+        ord_.clear();
+        val_.clear();
+        compressed_ = true;
+      }
+
+      /// \return the ordinal of the n-th nonzero
+      ordinal_type ordinal(std::size_t n) const { return ord_[n]; }
+
+      /// \return the index of the n-th nonzero
+      index_type index(std::size_t n) const {
+        const auto r = rank();
+        index_type i = array_adaptor<index_type>::construct(r);
+        const auto& stride = range_.ordinal().stride();
+        const auto lo = std::begin(range_.lobound());
+        for (std::size_t d = 0; d != r; ++d)
+          i[d] = lo[d] + (ord_[n] / stride[d]) % range_.extent(d);
+        return i;
+      }
+
+      const value_type& value(std::size_t n) const { return val_[n]; }
+      value_type& value(std::size_t n) { return val_[n]; }
+
+      const std::vector<ordinal_type>& ordinals() const { return ord_; }
+      const std::vector<value_type>& values() const { return val_; }
+      std::vector<value_type>& values() { return val_; }
+
+      /// \return the element at \c index , zero if it is not stored
+      /// \note requires compressed()
+      template <typename _Index,
+                class = typename std::enable_if<is_index<_Index>::value>::type>
+      value_type operator() (const _Index& index) const {
+        assert(compressed_);
+        const ordinal_type o = range_.ordinal(index);
+        auto it = std::lower_bound(ord_.begin(), ord_.end(), o);
+        return (it != ord_.end() && *it == o) ? val_[it - ord_.begin()] : NumericType<value_type>::zero();
+      }
+
+      value_type operator() (std::initializer_list<long> index) const {
+        return (*this)(btas::varray<long>(index));
+      }
+
+      /// \return the dense tensor
+      template <class _Tensor = btas::Tensor<_T, _Range>>
+      _Tensor dense() const {
+        _Tensor x(range_);
+        x.fill(NumericType<value_type>::zero());
+        auto data = x.data();
+        for (std::size_t n = 0; n != nnz(); ++n)
+          data[ord_[n]] += val_[n];
+        return x;
+      }
+
+    private:
+      range_type range_;
+      std::vector<ordinal_type> ord_;
+      std::vector<value_type> val_;
+      bool compressed_;   //!< nonzeros are sorted by ordinal and unique
+  };
+
+  /// test T is a SparseTensor
+  template <class _T>
+  class is_sparse_tensor {
+    public:
+      static constexpr const bool value = false;
+  };
+
+  template <typename _T, class _Range>
+  class is_sparse_tensor<SparseTensor<_T, _Range>> {
+    public:
+      static constexpr const bool value = true;
+  };
+
+} // namespace btas
+
+#endif // __BTAS_SPARSE_TENSOR_H
@@ -4,48 +4,24 @@
 #include <array>
 #include <type_traits>
 
-namespace btas {
-
-/// NDloop class for Reindex
-template<size_type _I, size_type _N>
-struct __NDloop_reindex
-{
-   /// loop upon construction
-   /// NOTE: pX and pY are passed as a reference of pointer to the next loop
-   /// NOTE: on the other hand, addrX is passed as a value so that offset position (by addrX) is kept in this scope
-   template<typename _T, class = typename std::enable_if<(_I < _N)>::type>
-   __NDloop_reindex (const _T*& pX, _T*& pY, size_type addrX, const std::array<size_type, _N>& strX, const std::array<size_type, _N>& shapeY)
-   {
-      for (size_type i = 0; i < shapeY[_I-1]; ++i)
-      {
-         __NDloop_reindex<_I+1, _N> loop(pX, pY, addrX+i*strX[_I-1], strX, shapeY);
-      }
-   }
-};
+#include <btas/types.h>
+#include <btas/generic/transpose.h>
 
-/// NDloop class for Reindex, specialized for the last index
-template<size_type _N>
-struct __NDloop_reindex<_N, _N>
-{
-   /// loop upon construction
-   template<typename _T>
-   __NDloop_reindex (const _T*& pX, _T*& pY, size_type addrX, const std::array<size_type, _N>& strX, const std::array<size_type, _N>& shapeY)
-   {
-      for (size_type i = 0; i < shapeY[_N-1]; ++i, ++pY)
-      {
-         *pY = pX[addrX+i*strX[_N-1]];
-      }
-   }
-};
+namespace btas {
 
-/// reindex (i.e. permute) for "any-rank" tensor
-/// multiple loop is expanded at compile time
-/// FIXME: how slower than explicit looping?
-/// if considerably slower, should be specialized for small ranks (_N = 1 ~ 8?)
+/// reindex (i.e. permute) for "any-rank" tensor, y is filled contiguously in the order of shapeY
+/// done by the blocked transpose engine, see impl::transpose
 template<typename _T, size_type _N>
 void Reindex (const _T* pX, _T* pY, const std::array<size_type, _N>& strX, const std::array<size_type, _N>& shapeY)
 {
-   __NDloop_reindex<1, _N> loop(pX, pY, 0, strX, shapeY);
+   std::array<size_type, _N> strY;
+   size_type volume = 1;
+   for (size_type i = _N; i > 0; --i)
+   {
+      strY[i-1] = volume;
+      volume *= shapeY[i-1];
+   }
+   impl::transpose(shapeY, pX, strX, pY, strY);
 }
 
 } // namespace btas
@@ -5,13 +5,16 @@
 #include <algorithm>
 #include <functional>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <btas/types.h>
 #include <btas/defaults.h>
 #include <btas/tensor_traits.h>
 #include <btas/tensorview.h>
+#include <btas/tensor_expr.h>
 #include <btas/array_adaptor.h>
+#include <btas/util/parallel.h>
 
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/vector.hpp>
@@ -136,7 +139,7 @@ namespace btas {
       explicit
       Tensor (const range_type& range, storage_type&& storage) :
       range_(range.ordinal(*range.begin()) == 0 ? range : range_type(range.lobound(), range.upbound())),
-      storage_(storage)
+      storage_(std::move(storage))
       {
         if (storage_.size() != range_.area())
           array_adaptor<storage_type>::resize(storage_, range_.area());
@@ -146,7 +149,7 @@ namespace btas {
       explicit
       Tensor (range_type&& range, storage_type&& storage) :
       range_(range.ordinal(*range.begin()) == 0 ? range : range_type(range.lobound(), range.upbound())),
-      storage_(storage)
+      storage_(std::move(storage))
       {
         if (storage_.size() != range_.area())
           array_adaptor<storage_type>::resize(storage_, range_.area());
@@ -184,6 +187,16 @@ namespace btas {
       {
       }
 
+      /// construct by evaluating a tensor expression, in one pass over its operands
+      template<class _Expr>
+      Tensor (const TensorExpr<_Expr>& x)
+        :
+        range_ (x.derived().range().lobound(), x.derived().range().upbound())
+      {
+        array_adaptor<storage_type>::resize(storage_, range_.area());
+        impl::eval_expr(std::begin(storage_), x.derived(), impl::expr_assign());
+      }
+
       /// copy constructor
       explicit
       Tensor (const Tensor& x)
@@ -191,10 +204,12 @@ namespace btas {
       {
       }
 
-      /// move constructor
+      /// move constructor, leaves \c x empty
       Tensor (Tensor&& x)
-      : range_ (x.range()), storage_(x.storage_)
+      : range_ (std::move(x.range_)), storage_(std::move(x.storage_))
       {
+        x.range_ = range_type();
+        x.storage_ = storage_type();
       }
 
       /// copy assignment operator
@@ -218,6 +233,32 @@ namespace btas {
           return *this;
       }
 
+      /// assign the value of a tensor expression, which may refer to this
+
+      /// The expression is evaluated in place if its operands that share storage with this are contiguous
+      /// and of the same size, otherwise it is evaluated into a temporary first. The temporary is copied
+      /// back if the size is unchanged, so that views of this remain valid, and swapped with this otherwise.
+      template<class _Expr>
+      Tensor&
+      operator= (const TensorExpr<_Expr>& x)
+      {
+          range_type range(x.derived().range().lobound(), x.derived().range().upbound());
+          if ((!_Expr::random_access || range.area() != size()) &&
+              x.derived().aliases(impl::expr_storage_bounds(storage_))) {
+            Tensor tmp(x);
+            if (tmp.size() == size())
+              std::copy(std::begin(tmp.storage_), std::end(tmp.storage_), std::begin(storage_));
+            else
+              std::swap(storage_, tmp.storage_);
+            range_ = std::move(tmp.range_);
+            return *this;
+          }
+          array_adaptor<storage_type>::resize(storage_, range.area());
+          impl::eval_expr(std::begin(storage_), x.derived(), impl::expr_assign());
+          range_ = std::move(range);
+          return *this;
+      }
+
       /// copy assignment
       Tensor&
       operator= (const Tensor& x)
@@ -551,16 +592,24 @@ namespace btas {
       operator+= (const Tensor& x)
       {
         assert( std::equal(range_.begin(), range_.end(), x.range_.begin()) );
-        std::transform(std::begin(storage_), std::end(storage_), std::begin(x.storage_), std::begin(storage_), std::plus<value_type>());
+        auto itrX = std::begin(x.storage_);
+        auto itrY = std::begin(storage_);
+        parallel_for(size(), elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) {
+          std::transform(itrY+i0, itrY+i1, itrX+i0, itrY+i0, std::plus<value_type>());
+        });
         return *this;
       }
 
-      /// addition of tensors
-      Tensor
-      operator+ (const Tensor& x) const
+      /// addition assignment of a tensor expression
+      template<class _Expr>
+      Tensor&
+      operator+= (const TensorExpr<_Expr>& x)
       {
-        Tensor y(*this); y += x;
-        return y; /* automatically called move semantics */
+        assert(impl::expr_congruent(x.derived().range(), range_));
+        if (!_Expr::random_access && x.derived().aliases(impl::expr_storage_bounds(storage_)))
+          return *this += Tensor(x);
+        impl::eval_expr(std::begin(storage_), x.derived(), impl::expr_add_to());
+        return *this;
       }
 
       /// subtraction assignment
@@ -569,16 +618,24 @@ namespace btas {
       {
         assert(
             std::equal(range_.begin(), range_.end(), x.range_.begin()));
-        std::transform(std::begin(storage_), std::end(storage_), std::begin(x.storage_), std::begin(storage_), std::minus<value_type>());
+        auto itrX = std::begin(x.storage_);
+        auto itrY = std::begin(storage_);
+        parallel_for(size(), elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) {
+          std::transform(itrY+i0, itrY+i1, itrX+i0, itrY+i0, std::minus<value_type>());
+        });
         return *this;
       }
 
-      /// subtraction of tensors
-      Tensor
-      operator- (const Tensor& x) const
+      /// subtraction assignment of a tensor expression
+      template<class _Expr>
+      Tensor&
+      operator-= (const TensorExpr<_Expr>& x)
       {
-        Tensor y(*this); y -= x;
-        return y; /* automatically called move semantics */
+        assert(impl::expr_congruent(x.derived().range(), range_));
+        if (!_Expr::random_access && x.derived().aliases(impl::expr_storage_bounds(storage_)))
+          return *this -= Tensor(x);
+        impl::eval_expr(std::begin(storage_), x.derived(), impl::expr_subtract_from());
+        return *this;
       }
 
       /// \return bare const pointer to the first element of data_
@@ -601,7 +658,10 @@ namespace btas {
       void
       fill (const value_type& val)
       {
-        std::fill(std::begin(storage_), std::end(storage_), val);
+        auto itr = std::begin(storage_);
+        parallel_for(size(), elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) {
+          std::fill(itr+i0, itr+i1, val);
+        });
       }
 
       /// generate all elements by gen()
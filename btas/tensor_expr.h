@@ -0,0 +1,317 @@
+#ifndef __BTAS_TENSOR_EXPR_H
+#define __BTAS_TENSOR_EXPR_H 1
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include <btas/tensor_traits.h>
+#include <btas/util/parallel.h>
+
+namespace btas {
+
+  /// CRTP base of lazily evaluated element-wise tensor expressions, such as \c a*A+B-C
+
+  /// An expression only refers to its operands, it is evaluated when it is assigned to a Tensor,
+  /// in a single pass over all operands and without temporaries.
+  /// Every expression \c E provides
+  /// - \c value_type, \c range_type, \c range() and \c size()
+  /// - \c const_iterator and \c cbegin(), to visit the elements in the iteration order of the range
+  /// - \c random_access and \c operator[], to access the i-th element directly if all operands are contiguous
+  /// - \c aliases(), to detect operands that share storage with the tensor the expression is assigned to
+  template <class _Derived>
+  class TensorExpr {
+    public:
+      const _Derived& derived() const { return static_cast<const _Derived&>(*this); }
+  };
+
+  /// test T is a tensor expression
+  template <class _T>
+  class is_tensor_expr {
+    public:
+      static constexpr const bool value = std::is_base_of<TensorExpr<_T>, _T>::value;
+  };
+
+  /// test T can be an operand of a tensor expression, i.e. is a box tensor or an expression
+  template <class _T>
+  class is_tensor_expr_operand {
+    public:
+      static constexpr const bool value = is_boxtensor<_T>::value || is_tensor_expr<_T>::value;
+  };
+
+  namespace impl {
+
+    template <class _Tensor>
+    const typename _Tensor::value_type* expr_data(const _Tensor& x, std::true_type) { return x.data(); }
+
+    template <class _Tensor>
+    const typename _Tensor::value_type* expr_data(const _Tensor&, std::false_type) { return nullptr; }
+
+    /// \return the addresses of the first and past-the-last elements of contiguous storage \c s
+    template <class _Storage>
+    std::pair<const void*, const void*> expr_storage_bounds(const _Storage& s) {
+      auto first = std::begin(s);
+      auto last = std::end(s);
+      if (first == last) return std::make_pair(nullptr, nullptr);
+      auto p = std::addressof(*first);
+      return std::make_pair(static_cast<const void*>(p), static_cast<const void*>(p + std::distance(first, last)));
+    }
+
+    /// \return true if the element ranges \c x and \c y overlap
+    inline bool expr_overlaps(const std::pair<const void*, const void*>& x, const std::pair<const void*, const void*>& y) {
+      std::less<const void*> less;
+      return less(x.first, y.second) && less(y.first, x.second);
+    }
+
+    /// \return true if ranges \c r1 and \c r2 have the same rank and the same extent in every dimension
+    template <class _Range1, class _Range2>
+    bool expr_congruent(const _Range1& r1, const _Range2& r2) {
+      if (r1.rank() != r2.rank()) return false;
+      for (std::size_t n = 0; n < r1.rank(); ++n)
+        if (r1.extent(n) != r2.extent(n)) return false;
+      return true;
+    }
+
+    /// multiplication by a fixed scalar
+    template <typename _T>
+    struct expr_scale {
+      _T alpha;
+      _T operator() (const _T& x) const { return alpha * x; }
+    };
+
+    /// y = x
+    struct expr_assign {
+      template <typename _T, typename _U>
+      void operator() (_T& y, const _U& x) const { y = x; }
+    };
+
+    /// y += x
+    struct expr_add_to {
+      template <typename _T, typename _U>
+      void operator() (_T& y, const _U& x) const { y += x; }
+    };
+
+    /// y -= x
+    struct expr_subtract_from {
+      template <typename _T, typename _U>
+      void operator() (_T& y, const _U& x) const { y -= x; }
+    };
+
+  } // namespace impl
+
+  /// Tensor or TensorView operand of an expression, held by reference
+  template <class _Tensor>
+  class TensorExprLeaf : public TensorExpr<TensorExprLeaf<_Tensor>> {
+    public:
+      typedef typename _Tensor::value_type value_type;
+      typedef typename _Tensor::range_type range_type;
+      typedef typename _Tensor::const_iterator const_iterator;
+
+      /// the elements of tensors with contiguous storage can be addressed by their position
+      static constexpr const bool random_access = has_data<_Tensor>::value;
+
+      explicit
+      TensorExprLeaf (const _Tensor& x) :
+        x_(x), data_(impl::expr_data(x, std::integral_constant<bool, random_access>())) { }
+
+      const range_type& range() const { return x_.range(); }
+
+      std::size_t size() const { return x_.range().area(); }
+
+      const_iterator cbegin() const { return x_.cbegin(); }
+
+      value_type operator[] (std::size_t i) const { return data_[i]; }
+
+      /// \return true if the storage of the operand overlaps the elements in \c bounds
+      bool aliases(const std::pair<const void*, const void*>& bounds) const {
+        return impl::expr_overlaps(impl::expr_storage_bounds(x_.storage()), bounds);
+      }
+
+    private:
+      const _Tensor& x_;
+      const value_type* data_;
+  };
+
+  /// op(x) for every element x of an expression
+  template <class _Arg, class _Op>
+  class TensorExprUnary : public TensorExpr<TensorExprUnary<_Arg, _Op>> {
+    public:
+      typedef typename _Arg::value_type value_type;
+      typedef typename _Arg::range_type range_type;
+
+      static constexpr const bool random_access = _Arg::random_access;
+
+      class const_iterator {
+        public:
+          const_iterator (const typename _Arg::const_iterator& x, const _Op& op) : x_(x), op_(op) { }
+          value_type operator* () const { return op_(*x_); }
+          const_iterator& operator++ () { ++x_; return *this; }
+        private:
+          typename _Arg::const_iterator x_;
+          _Op op_;
+      };
+
+      TensorExprUnary (const _Arg& x, const _Op& op) : x_(x), op_(op) { }
+
+      const range_type& range() const { return x_.range(); }
+
+      std::size_t size() const { return x_.size(); }
+
+      const_iterator cbegin() const { return const_iterator(x_.cbegin(), op_); }
+
+      value_type operator[] (std::size_t i) const { return op_(x_[i]); }
+
+      bool aliases(const std::pair<const void*, const void*>& bounds) const { return x_.aliases(bounds); }
+
+    private:
+      _Arg x_;
+      _Op op_;
+  };
+
+  /// op(x, y) for every pair of elements x and y of two expressions of the same extents
+  template <class _Left, class _Right, class _Op>
+  class TensorExprBinary : public TensorExpr<TensorExprBinary<_Left, _Right, _Op>> {
+    public:
+      typedef typename _Left::value_type value_type;
+      typedef typename _Left::range_type range_type;
+
+      static_assert(std::is_same<value_type, typename _Right::value_type>::value,
+                    "operands of a tensor expression must have the same value_type");
+
+      static constexpr const bool random_access = _Left::random_access && _Right::random_access;
+
+      class const_iterator {
+        public:
+          const_iterator (const typename _Left::const_iterator& x, const typename _Right::const_iterator& y, const _Op& op) :
+            x_(x), y_(y), op_(op) { }
+          value_type operator* () const { return op_(*x_, *y_); }
+          const_iterator& operator++ () { ++x_; ++y_; return *this; }
+        private:
+          typename _Left::const_iterator x_;
+          typename _Right::const_iterator y_;
+          _Op op_;
+      };
+
+      TensorExprBinary (const _Left& x, const _Right& y) : x_(x), y_(y) {
+        assert(impl::expr_congruent(x_.range(), y_.range()));
+      }
+
+      const range_type& range() const { return x_.range(); }
+
+      std::size_t size() const { return x_.size(); }
+
+      const_iterator cbegin() const { return const_iterator(x_.cbegin(), y_.cbegin(), op_); }
+
+      value_type operator[] (std::size_t i) const { return op_(x_[i], y_[i]); }
+
+      bool aliases(const std::pair<const void*, const void*>& bounds) const {
+        return x_.aliases(bounds) || y_.aliases(bounds);
+      }
+
+    private:
+      _Left x_;
+      _Right y_;
+      _Op op_;
+  };
+
+  /// expression node type of a tensor expression operand
+  template <class _T, class = void>
+  struct tensor_expr_of { };
+
+  template <class _T>
+  struct tensor_expr_of<_T, typename std::enable_if<is_tensor_expr<_T>::value>::type> {
+    typedef _T type;
+    static const type& make(const _T& x) { return x; }
+  };
+
+  template <class _T>
+  struct tensor_expr_of<_T, typename std::enable_if<is_boxtensor<_T>::value && !is_tensor_expr<_T>::value>::type> {
+    typedef TensorExprLeaf<_T> type;
+    static type make(const _T& x) { return type(x); }
+  };
+
+  namespace impl {
+
+    template <class _Iterator, class _Expr, class _Assign>
+    void eval_expr(_Iterator y, const _Expr& e, _Assign assign, std::true_type) {
+      parallel_for(e.size(), elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) {
+        for (unsigned long i = i0; i < i1; ++i)
+          assign(y[i], e[i]);
+      });
+    }
+
+    template <class _Iterator, class _Expr, class _Assign>
+    void eval_expr(_Iterator y, const _Expr& e, _Assign assign, std::false_type) {
+      auto x = e.cbegin();
+      for (std::size_t i = e.size(); i != 0; --i, ++y, ++x)
+        assign(*y, *x);
+    }
+
+    /// assign(y[i], e[i]) for all elements of \c e, in one pass; in parallel if all operands of \c e are contiguous
+    template <class _Iterator, class _Expr, class _Assign>
+    void eval_expr(_Iterator y, const _Expr& e, _Assign assign) {
+      eval_expr(y, e, assign, std::integral_constant<bool, _Expr::random_access>());
+    }
+
+  } // namespace impl
+
+  /// lazy element-wise sum of tensors or expressions
+  template <class _Left, class _Right,
+            class = typename std::enable_if<is_tensor_expr_operand<_Left>::value && is_tensor_expr_operand<_Right>::value>::type>
+  TensorExprBinary<typename tensor_expr_of<_Left>::type, typename tensor_expr_of<_Right>::type,
+                   std::plus<typename _Left::value_type>>
+  operator+ (const _Left& x, const _Right& y) {
+    typedef TensorExprBinary<typename tensor_expr_of<_Left>::type, typename tensor_expr_of<_Right>::type,
+                             std::plus<typename _Left::value_type>> expr_type;
+    return expr_type(tensor_expr_of<_Left>::make(x), tensor_expr_of<_Right>::make(y));
+  }
+
+  /// lazy element-wise difference of tensors or expressions
+  template <class _Left, class _Right,
+            class = typename std::enable_if<is_tensor_expr_operand<_Left>::value && is_tensor_expr_operand<_Right>::value>::type>
+  TensorExprBinary<typename tensor_expr_of<_Left>::type, typename tensor_expr_of<_Right>::type,
+                   std::minus<typename _Left::value_type>>
+  operator- (const _Left& x, const _Right& y) {
+    typedef TensorExprBinary<typename tensor_expr_of<_Left>::type, typename tensor_expr_of<_Right>::type,
+                             std::minus<typename _Left::value_type>> expr_type;
+    return expr_type(tensor_expr_of<_Left>::make(x), tensor_expr_of<_Right>::make(y));
+  }
+
+  /// lazy element-wise negation of a tensor or expression
+  template <class _Arg,
+            class = typename std::enable_if<is_tensor_expr_operand<_Arg>::value>::type>
+  TensorExprUnary<typename tensor_expr_of<_Arg>::type, std::negate<typename _Arg::value_type>>
+  operator- (const _Arg& x) {
+    typedef TensorExprUnary<typename tensor_expr_of<_Arg>::type, std::negate<typename _Arg::value_type>> expr_type;
+    return expr_type(tensor_expr_of<_Arg>::make(x), std::negate<typename _Arg::value_type>());
+  }
+
+  /// lazy scaling of a tensor or expression by a scalar
+  template <typename _Scalar, class _Arg,
+            class = typename std::enable_if<is_tensor_expr_operand<_Arg>::value &&
+                                            !is_tensor_expr_operand<_Scalar>::value &&
+                                            std::is_convertible<_Scalar, typename _Arg::value_type>::value>::type>
+  TensorExprUnary<typename tensor_expr_of<_Arg>::type, impl::expr_scale<typename _Arg::value_type>>
+  operator* (const _Scalar& alpha, const _Arg& x) {
+    typedef impl::expr_scale<typename _Arg::value_type> op_type;
+    typedef TensorExprUnary<typename tensor_expr_of<_Arg>::type, op_type> expr_type;
+    return expr_type(tensor_expr_of<_Arg>::make(x), op_type{static_cast<typename _Arg::value_type>(alpha)});
+  }
+
+  /// lazy scaling of a tensor or expression by a scalar
+  template <class _Arg, typename _Scalar,
+            class = typename std::enable_if<is_tensor_expr_operand<_Arg>::value &&
+                                            !is_tensor_expr_operand<_Scalar>::value &&
+                                            std::is_convertible<_Scalar, typename _Arg::value_type>::value>::type>
+  TensorExprUnary<typename tensor_expr_of<_Arg>::type, impl::expr_scale<typename _Arg::value_type>>
+  operator* (const _Arg& x, const _Scalar& alpha) {
+    return alpha * x;
+  }
+
+} // namespace btas
+
+#endif // __BTAS_TENSOR_EXPR_H
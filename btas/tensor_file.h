@@ -0,0 +1,294 @@
+/*
+ * tensor_file.h
+ *
+ *  Native binary file format for dense tensors
+ */
+
+#ifndef BTAS_TENSOR_FILE_H_
+#define BTAS_TENSOR_FILE_H_
+
+#include <algorithm>
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <btas/types.h>
+#include <btas/half.h>
+#include <btas/array_adaptor.h>
+#include <btas/tensor.h>
+#include <btas/mmap_storage.h>
+
+namespace btas {
+
+  /**
+    A tensor file holds one dense tensor, its elements stored raw in the order of their ordinals,
+    so that they can be mapped into memory in place (see mmap_tensor_file()).
+    All numbers are in the byte order of the machine that wrote the file.
+
+    \verbatim
+    offset   bytes         content
+    0        8             magic "BTASTENS"
+    8        4             format version, 1
+    12       4             byte order mark 0x01020304
+    16       4             value type code, see tensor_file_value_code
+    20       4             value size in bytes
+    24       4             order of the range, CblasRowMajor or CblasColMajor
+    28       4             rank r
+    32       8             number of elements n
+    40       8             data offset d, a multiple of tensor_file_alignment
+    48       8r, 8r, 8r    lobound, upbound and strides of the range
+    ...                    zero padding
+    d        n*value size  elements
+    \endverbatim
+  */
+  const std::size_t tensor_file_alignment = 64;
+
+  /// code of the value type recorded in tensor files; only the types below can be stored
+  template <typename _T> struct tensor_file_value_code {
+    static_assert(sizeof(_T) == 0, "tensor file: no value type code for this type");
+  };
+  template <> struct tensor_file_value_code<float> { static constexpr const std::uint32_t value = 1; };
+  template <> struct tensor_file_value_code<double> { static constexpr const std::uint32_t value = 2; };
+  template <> struct tensor_file_value_code<std::complex<float>> { static constexpr const std::uint32_t value = 3; };
+  template <> struct tensor_file_value_code<std::complex<double>> { static constexpr const std::uint32_t value = 4; };
+  template <> struct tensor_file_value_code<std::int32_t> { static constexpr const std::uint32_t value = 5; };
+  template <> struct tensor_file_value_code<std::int64_t> { static constexpr const std::uint32_t value = 6; };
+  template <> struct tensor_file_value_code<half> { static constexpr const std::uint32_t value = 7; };
+  template <> struct tensor_file_value_code<bfloat16> { static constexpr const std::uint32_t value = 8; };
+  template <> struct tensor_file_value_code<std::int8_t> { static constexpr const std::uint32_t value = 9; };
+  template <> struct tensor_file_value_code<std::int16_t> { static constexpr const std::uint32_t value = 10; };
+  template <> struct tensor_file_value_code<std::uint8_t> { static constexpr const std::uint32_t value = 11; };
+  template <> struct tensor_file_value_code<std::uint16_t> { static constexpr const std::uint32_t value = 12; };
+  template <> struct tensor_file_value_code<std::uint32_t> { static constexpr const std::uint32_t value = 13; };
+  template <> struct tensor_file_value_code<std::uint64_t> { static constexpr const std::uint32_t value = 14; };
+
+  /// Header of a tensor file
+  struct tensor_file_header {
+    std::uint32_t value_code;
+    std::uint32_t value_size;
+    CBLAS_ORDER order;
+    std::vector<std::int64_t> lobound;
+    std::vector<std::int64_t> upbound;
+    std::vector<std::int64_t> stride;
+    std::uint64_t size;         //!< number of elements
+    std::uint64_t data_offset;  //!< position of the first element in the file, in bytes
+
+    /// Header for elements of type \c _T in the storage order of \c range
+    template <typename _T, typename _Range>
+    static tensor_file_header make(const _Range& range) {
+      tensor_file_header h;
+      h.value_code = tensor_file_value_code<_T>::value;
+      h.value_size = sizeof(_T);
+      h.order = _Range::order;
+      h.lobound.assign(std::begin(range.lobound()), std::end(range.lobound()));
+      h.upbound.assign(std::begin(range.upbound()), std::end(range.upbound()));
+      h.stride.assign(std::begin(range.ordinal().stride()), std::end(range.ordinal().stride()));
+      h.size = range.area();
+      const std::size_t hsize = 48 + 24 * h.lobound.size();
+      h.data_offset = (hsize + tensor_file_alignment - 1) / tensor_file_alignment * tensor_file_alignment;
+      return h;
+    }
+
+    /// \return the range described by the header
+    template <typename _Range>
+    _Range range() const {
+      typedef typename _Range::index_type index_type;
+      typedef typename _Range::extent_type extent_type;
+      if (order != _Range::order) throw std::runtime_error("tensor file: range has a different order");
+      const auto n = lobound.size();
+      index_type lo = array_adaptor<index_type>::construct(n);
+      index_type up = array_adaptor<index_type>::construct(n);
+      extent_type st = array_adaptor<extent_type>::construct(n);
+      std::copy(lobound.begin(), lobound.end(), std::begin(lo));
+      std::copy(upbound.begin(), upbound.end(), std::begin(up));
+      std::copy(stride.begin(), stride.end(), std::begin(st));
+      return _Range(lo, up, st);
+    }
+
+    /// throws unless the elements are of type \c _T
+    template <typename _T>
+    void check_value_type() const {
+      if (value_size != sizeof(_T) || value_code != tensor_file_value_code<_T>::value)
+        throw std::runtime_error("tensor file: elements are of a different type");
+    }
+
+    void write(std::ostream& os) const {
+      const std::uint32_t version = 1, bom = 0x01020304, ord = order, rank = lobound.size();
+      os.write("BTASTENS", 8);
+      put(os, version); put(os, bom); put(os, value_code); put(os, value_size); put(os, ord); put(os, rank);
+      put(os, size); put(os, data_offset);
+      for (auto x : lobound) put(os, x);
+      for (auto x : upbound) put(os, x);
+      for (auto x : stride) put(os, x);
+      const std::vector<char> padding(data_offset - 48 - 24 * rank, 0);
+      os.write(padding.data(), padding.size());
+      if (!os) throw std::runtime_error("tensor file: cannot write header");
+    }
+
+    static tensor_file_header read(std::istream& is) {
+      tensor_file_header h;
+      char magic[8];
+      std::uint32_t version, bom, ord, rank;
+      is.read(magic, 8);
+      if (!is || std::memcmp(magic, "BTASTENS", 8) != 0) throw std::runtime_error("tensor file: not a tensor file");
+      get(is, version); get(is, bom);
+      if (version != 1) throw std::runtime_error("tensor file: unsupported version");
+      if (bom != 0x01020304) throw std::runtime_error("tensor file: written with a different byte order");
+      get(is, h.value_code); get(is, h.value_size); get(is, ord); get(is, rank);
+      get(is, h.size); get(is, h.data_offset);
+      h.order = static_cast<CBLAS_ORDER>(ord);
+      h.lobound.resize(rank); h.upbound.resize(rank); h.stride.resize(rank);
+      for (auto& x : h.lobound) get(is, x);
+      for (auto& x : h.upbound) get(is, x);
+      for (auto& x : h.stride) get(is, x);
+      if (!is) throw std::runtime_error("tensor file: truncated header");
+      is.seekg(h.data_offset);
+      return h;
+    }
+
+  private:
+    template <typename _U> static void put(std::ostream& os, const _U& x) { os.write(reinterpret_cast<const char*>(&x), sizeof(_U)); }
+    template <typename _U> static void get(std::istream& is, _U& x) { is.read(reinterpret_cast<char*>(&x), sizeof(_U)); }
+  };
+
+  /// Streams the elements of a tensor into a tensor file, chunk by chunk, so that it need not fit in memory
+  template <typename _T>
+  class tensor_file_writer {
+      static_assert(std::is_trivially_copyable<_T>::value, "tensor file: elements are written as raw bytes");
+
+    public:
+      /// writes the header of a file for a tensor of range \c range , whose elements are to be written in the order of their ordinals
+      template <typename _Range>
+      tensor_file_writer(const std::string& path, const _Range& range) :
+        os_(path, std::ios::binary | std::ios::trunc), header_(tensor_file_header::make<_T>(range)), written_(0) {
+        if (!os_) throw std::runtime_error("tensor file: cannot open " + path);
+        header_.write(os_);
+      }
+
+      /// appends the next \c n elements
+      void write(const _T* data, std::size_t n) {
+        if (written_ + n > header_.size) throw std::length_error("tensor file: too many elements");
+        os_.write(reinterpret_cast<const char*>(data), n * sizeof(_T));
+        if (!os_) throw std::runtime_error("tensor file: write failed");
+        written_ += n;
+      }
+
+      /// closes the file, throws unless all elements were written
+      void close() {
+        if (written_ != header_.size) throw std::length_error("tensor file: not all elements were written");
+        os_.close();
+      }
+
+      const tensor_file_header& header() const { return header_; }
+
+    private:
+      std::ofstream os_;
+      tensor_file_header header_;
+      std::uint64_t written_;
+  };
+
+  /// Reads the elements of a tensor file chunk by chunk, so that it need not fit in memory
+  template <typename _T>
+  class tensor_file_reader {
+      static_assert(std::is_trivially_copyable<_T>::value, "tensor file: elements are read as raw bytes");
+
+    public:
+      explicit tensor_file_reader(const std::string& path) : is_(path, std::ios::binary), read_(0) {
+        if (!is_) throw std::runtime_error("tensor file: cannot open " + path);
+        header_ = tensor_file_header::read(is_);
+        header_.check_value_type<_T>();
+      }
+
+      /// reads the next at most \c n elements into \c data
+      /// \return the number of elements read, 0 at the end
+      std::size_t read(_T* data, std::size_t n) {
+        n = std::min<std::uint64_t>(n, remaining());
+        is_.read(reinterpret_cast<char*>(data), n * sizeof(_T));
+        if (!is_) throw std::runtime_error("tensor file: truncated data");
+        read_ += n;
+        return n;
+      }
+
+      /// \return the number of elements not read yet
+      std::uint64_t remaining() const { return header_.size - read_; }
+
+      const tensor_file_header& header() const { return header_; }
+
+    private:
+      std::ifstream is_;
+      tensor_file_header header_;
+      std::uint64_t read_;
+  };
+
+  namespace impl {
+
+    template <class _Tensor>
+    void write_tensor_file(const std::string& path, const _Tensor& x, std::true_type) {
+      tensor_file_writer<typename _Tensor::value_type> w(path, x.range());
+      w.write(x.data(), x.range().area());
+      w.close();
+    }
+
+    /// tensors without contiguous storage are written in the order of their range, in chunks
+    template <class _Tensor>
+    void write_tensor_file(const std::string& path, const _Tensor& x, std::false_type) {
+      typedef typename _Tensor::value_type value_type;
+      const typename _Tensor::range_type range(x.range().lobound(), x.range().upbound());
+      tensor_file_writer<value_type> w(path, range);
+      std::vector<value_type> buf(std::min<std::size_t>(range.area(), 1 << 16));
+      auto it = x.cbegin();
+      for (std::size_t n = range.area(); n != 0; ) {
+        const std::size_t m = std::min(n, buf.size());
+        for (std::size_t i = 0; i != m; ++i, ++it) buf[i] = *it;
+        w.write(buf.data(), m);
+        n -= m;
+      }
+      w.close();
+    }
+
+  } // namespace impl
+
+  /// Writes a Tensor or TensorView to a tensor file
+  template <class _Tensor,
+            class = typename std::enable_if<is_boxtensor<_Tensor>::value>::type>
+  void write_tensor_file(const std::string& path, const _Tensor& x) {
+    impl::write_tensor_file(path, x, std::integral_constant<bool, has_data<_Tensor>::value>());
+  }
+
+  /// Reads a tensor file into a new tensor of type \c _Tensor , which must have contiguous storage
+  template <class _Tensor>
+  _Tensor read_tensor_file(const std::string& path) {
+    typedef typename _Tensor::range_type range_type;
+    typedef typename _Tensor::storage_type storage_type;
+    tensor_file_reader<typename _Tensor::value_type> r(path);
+    storage_type storage(r.remaining());
+    if (!storage.empty()) r.read(&*std::begin(storage), r.remaining());
+    return _Tensor(r.header().template range<range_type>(), std::move(storage));
+  }
+
+  /// Maps the elements of a tensor file in place, they are read on demand
+
+  /// A TensorView of the file is made from the result \c t as
+  /// \c TensorView<_T,_Range,const mmap_storage<_T>>(t.range(), t.storage())
+  /// \param mode \c mmap_mode::shared writes modifications back to the file
+  template <typename _T, class _Range = btas::DEFAULT::range>
+  Tensor<_T, _Range, mmap_storage<_T>> mmap_tensor_file(const std::string& path, mmap_mode mode = mmap_mode::read_only) {
+    static_assert(std::is_trivially_copyable<_T>::value, "tensor file: elements are mapped as raw bytes");
+    tensor_file_header h;
+    {
+      std::ifstream is(path, std::ios::binary);
+      if (!is) throw std::runtime_error("tensor file: cannot open " + path);
+      h = tensor_file_header::read(is);
+    }
+    h.check_value_type<_T>();
+    return Tensor<_T, _Range, mmap_storage<_T>>(h.range<_Range>(), mmap_storage<_T>(path, mode, h.size, h.data_offset));
+  }
+
+} // namespace btas
+
+#endif /* BTAS_TENSOR_FILE_H_ */
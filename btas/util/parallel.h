@@ -0,0 +1,287 @@
+#ifndef __BTAS_UTIL_PARALLEL_H
+#define __BTAS_UTIL_PARALLEL_H 1
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+
+//
+//  Thread pool for the generic kernels (gemm, permute, element-wise ops).
+//  The pool has a single thread, i.e. everything runs on the calling thread, unless more are requested
+//  through BTAS_NUM_THREADS or set_num_threads(). Loops over BLAS calls are split between the threads only
+//  after set_parallel_blas_loops(true) or with BTAS_PARALLEL_BLAS_LOOPS=1, since a threaded BLAS
+//  threads each call itself. Define _NO_THREADS to run everything on the calling thread.
+//  Calls of parallel_for from inside a parallel region run serially.
+//
+
+#ifndef _NO_THREADS
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif
+
+namespace btas {
+
+namespace impl {
+
+#ifndef _NO_THREADS
+
+/// Persistent pool of worker threads; the calling thread takes part in every job
+class thread_pool
+{
+public:
+
+   static thread_pool& instance ()
+   {
+      static thread_pool pool;
+      return pool;
+   }
+
+   /// \return number of threads a job is spread over, including the calling thread
+   unsigned long size () const { return nthreads_; }
+
+   void resize (unsigned long n)
+   {
+      std::lock_guard<std::mutex> job_lock(job_mutex_);
+      stop();
+      nthreads_ = std::max(n, 1ul);
+      start();
+   }
+
+   /// \return true on threads of this pool, and on the calling thread while it runs a job
+   static bool& in_parallel ()
+   {
+      static thread_local bool flag = false;
+      return flag;
+   }
+
+   /// calls f(0), f(1), ..., f(nchunks-1) on the threads of the pool, returns when all are done
+   void run (const unsigned long& nchunks, const std::function<void(unsigned long)>& f)
+   {
+      std::unique_lock<std::mutex> job_lock(job_mutex_, std::try_to_lock);
+      if (!job_lock.owns_lock() || workers_.empty() || in_parallel())
+      {
+         // pool busy with another caller: run here
+         for (unsigned long c = 0; c < nchunks; ++c) f(c);
+         return;
+      }
+
+      {
+         std::lock_guard<std::mutex> lock(mutex_);
+         job_ = &f;
+         nchunks_ = nchunks;
+         next_ = 0;
+         active_ = workers_.size();
+         error_ = nullptr;
+         ++generation_;
+      }
+      wake_.notify_all();
+
+      in_parallel() = true;
+      work();
+      in_parallel() = false;
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_.wait(lock, [this]{ return active_ == 0; });
+      job_ = nullptr;
+      if (error_) std::rethrow_exception(error_);
+   }
+
+   ~thread_pool () { stop(); }
+
+private:
+
+   thread_pool () : nthreads_(1), job_(nullptr), nchunks_(0), next_(0), active_(0), generation_(0), stop_(false)
+   {
+      unsigned long n = 1;
+      if (const char* env = std::getenv("BTAS_NUM_THREADS")) n = std::strtoul(env, nullptr, 10);
+      nthreads_ = std::max(n, 1ul);
+      start();
+   }
+
+   thread_pool (const thread_pool&) = delete;
+   thread_pool& operator= (const thread_pool&) = delete;
+
+   void start ()
+   {
+      stop_ = false;
+      for (unsigned long i = 1; i < nthreads_; ++i)
+         workers_.emplace_back([this]{ loop(); });
+   }
+
+   void stop ()
+   {
+      {
+         std::lock_guard<std::mutex> lock(mutex_);
+         stop_ = true;
+      }
+      wake_.notify_all();
+      for (auto& w : workers_) w.join();
+      workers_.clear();
+   }
+
+   /// takes chunks of the current job until none are left
+   void work ()
+   {
+      for (unsigned long c = next_++; c < nchunks_; c = next_++)
+      {
+         try
+         {
+            (*job_)(c);
+         }
+         catch (...)
+         {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_) error_ = std::current_exception();
+         }
+      }
+   }
+
+   void loop ()
+   {
+      in_parallel() = true;
+      unsigned long generation = 0;
+      while (true)
+      {
+         {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&]{ return stop_ || generation_ != generation; });
+            if (stop_) return;
+            generation = generation_;
+         }
+         work();
+         std::lock_guard<std::mutex> lock(mutex_);
+         if (--active_ == 0) done_.notify_one();
+      }
+   }
+
+   unsigned long nthreads_;
+   std::vector<std::thread> workers_;
+
+   std::mutex job_mutex_; //!< held by the caller of run() for the whole job
+   std::mutex mutex_;
+   std::condition_variable wake_;
+   std::condition_variable done_;
+
+   const std::function<void(unsigned long)>* job_;
+   unsigned long nchunks_;
+   std::atomic<unsigned long> next_;
+   unsigned long active_;
+   unsigned long generation_;
+   bool stop_;
+   std::exception_ptr error_;
+};
+
+#endif // _NO_THREADS
+
+} // namespace impl
+
+/// element-wise operations on fewer than twice this many elements are not split between threads
+const unsigned long elementwise_parallel_grain = 1ul << 15;
+
+/// \return number of threads used by the generic kernels
+inline unsigned long get_num_threads ()
+{
+#ifndef _NO_THREADS
+   return impl::thread_pool::instance().size();
+#else
+   return 1;
+#endif
+}
+
+/// sets the number of threads used by the generic kernels, 1 runs everything on the calling thread
+inline void set_num_threads (const unsigned long& n)
+{
+#ifndef _NO_THREADS
+   impl::thread_pool::instance().resize(n);
+#endif
+}
+
+namespace impl {
+
+inline bool& parallel_blas_loops ()
+{
+   static bool flag = []{
+      const char* env = std::getenv("BTAS_PARALLEL_BLAS_LOOPS");
+      return env && std::strtoul(env, nullptr, 10) != 0;
+   }();
+   return flag;
+}
+
+} // namespace impl
+
+/// \return true if loops over BLAS calls are split between the threads of the pool
+inline bool get_parallel_blas_loops ()
+{
+   return impl::parallel_blas_loops();
+}
+
+/// lets loops over BLAS calls (batched and strided GEMM) be split between threads; off by default,
+/// since a threaded BLAS already threads each call
+inline void set_parallel_blas_loops (const bool& flag)
+{
+   impl::parallel_blas_loops() = flag;
+}
+
+/// \return number of threads available to a parallel_for called from here, 1 inside a parallel region
+inline unsigned long parallel_width ()
+{
+#ifndef _NO_THREADS
+   return impl::thread_pool::in_parallel() ? 1 : get_num_threads();
+#else
+   return 1;
+#endif
+}
+
+/// Calls f(first, last) on disjoint sub-ranges covering [0, n), in parallel
+/// \param grain minimum length of a sub-range; ranges shorter than 2*grain are not split
+template<class _Function>
+void parallel_for (const unsigned long& n, const unsigned long& grain, _Function f)
+{
+   const unsigned long nt = parallel_width();
+   const unsigned long nchunks = std::min(nt, n / std::max(grain, 1ul));
+   if (nchunks <= 1)
+   {
+      if (n > 0) f(0ul, n);
+      return;
+   }
+#ifndef _NO_THREADS
+   const unsigned long len = n / nchunks, rem = n % nchunks;
+   impl::thread_pool::instance().run(nchunks, [&](unsigned long c)
+   {
+      const unsigned long first = c*len + std::min(c, rem);
+      f(first, first + len + (c < rem ? 1 : 0));
+   });
+#endif
+}
+
+/// \return f(0, n), evaluated as the sum of f(first, last) over disjoint sub-ranges covering [0, n) in parallel
+/// \param grain minimum length of a sub-range; ranges shorter than 2*grain are not split
+template<typename _T, class _Function>
+_T parallel_sum (const unsigned long& n, const unsigned long& grain, _Function f)
+{
+   const unsigned long nt = parallel_width();
+   const unsigned long nchunks = std::min(nt, n / std::max(grain, 1ul));
+   if (nchunks <= 1) return f(0ul, n);
+#ifndef _NO_THREADS
+   std::vector<_T> partial(nchunks);
+   const unsigned long len = n / nchunks, rem = n % nchunks;
+   impl::thread_pool::instance().run(nchunks, [&](unsigned long c)
+   {
+      const unsigned long first = c*len + std::min(c, rem);
+      partial[c] = f(first, first + len + (c < rem ? 1 : 0));
+   });
+   _T val = partial[0];
+   for (unsigned long c = 1; c < nchunks; ++c) val += partial[c];
+   return val;
+#else
+   return f(0ul, n);
+#endif
+}
+
+} // namespace btas
+
+#endif // __BTAS_UTIL_PARALLEL_H
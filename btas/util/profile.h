@@ -0,0 +1,384 @@
+#ifndef __BTAS_UTIL_PROFILE_H
+#define __BTAS_UTIL_PROFILE_H 1
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//
+//  Profiler of contract(): times the phases of each call (index checks, permutation of A, B and C into
+//  temporaries, scaling of C, the BLAS kernel, permutation of C back), counts its flops and the bytes the
+//  phases move, and aggregates them per contraction signature, i.e. annotations and extents of A and B.
+//  Results are written as a table by profile_report() or as Chrome trace JSON (chrome://tracing, Perfetto)
+//  by profile_write_chrome_trace().
+//  Profiling is off unless BTAS_PROFILE is set to a non-zero value or profile_enable() is called; while it
+//  is off, a contract() costs one atomic load more. Define _NO_PROFILE to compile it out.
+//
+
+namespace btas {
+
+/// phases of a contract() call, in the order they run
+enum class contract_phase { check, permute_A, permute_B, permute_C, scale, kernel, permute_back, count };
+
+inline const char* contract_phase_name (contract_phase p)
+{
+   static const char* names[] = { "check", "permute A", "permute B", "permute C", "scale C", "kernel", "permute back" };
+   return names[static_cast<int>(p)];
+}
+
+/// Totals of the contract() calls with the same signature
+struct contract_stats
+{
+   std::string signature;
+   unsigned long calls = 0;
+   double seconds[static_cast<int>(contract_phase::count)] = { }; //!< time spent in each phase
+   double total = 0;                                              //!< seconds from entry to return
+   double flops = 0;
+   double bytes = 0;                                              //!< read plus written by all phases
+};
+
+namespace impl {
+
+/// Collects the calls recorded by contract_profile; thread safe
+class contract_profiler
+{
+public:
+
+   typedef std::chrono::steady_clock clock;
+
+   /// one phase of a call, or the whole call if phase is count
+   struct trace_event
+   {
+      std::size_t signature; //!< position in the stats
+      contract_phase phase;
+      unsigned long thread;
+      double begin;          //!< seconds since the profiler started
+      double duration;
+   };
+
+   /// trace events kept, later calls are only aggregated
+   static const std::size_t max_trace_events = 1ul << 20;
+
+   static contract_profiler& instance ()
+   {
+      static contract_profiler profiler;
+      return profiler;
+   }
+
+   bool enabled () const { return enabled_.load(std::memory_order_relaxed); }
+
+   void enable (bool on) { enabled_.store(on, std::memory_order_relaxed); }
+
+   double since_start (clock::time_point t) const { return std::chrono::duration<double>(t - start_).count(); }
+
+   /// adds one call; phases holds (phase, begin, end) in seconds since the profiler started
+   void record (const std::string& signature, double begin, double end, double flops, double bytes,
+                const std::vector<std::pair<contract_phase, std::pair<double, double>>>& phases)
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = index_.find(signature);
+      if (it == index_.end())
+      {
+         it = index_.insert(std::make_pair(signature, stats_.size())).first;
+         stats_.push_back(contract_stats());
+         stats_.back().signature = signature;
+      }
+      contract_stats& s = stats_[it->second];
+      ++s.calls;
+      s.total += end - begin;
+      s.flops += flops;
+      s.bytes += bytes;
+      for (const auto& p : phases)
+         s.seconds[static_cast<int>(p.first)] += p.second.second - p.second.first;
+
+      if (trace_.size() + phases.size() + 1 > max_trace_events) return;
+      const unsigned long tid = thread_index();
+      trace_.push_back(trace_event{it->second, contract_phase::count, tid, begin, end - begin});
+      for (const auto& p : phases)
+         trace_.push_back(trace_event{it->second, p.first, tid, p.second.first, p.second.second - p.second.first});
+   }
+
+   void reset ()
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      index_.clear();
+      stats_.clear();
+      trace_.clear();
+   }
+
+   std::vector<contract_stats> stats () const
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return stats_;
+   }
+
+   std::vector<trace_event> trace () const
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return trace_;
+   }
+
+private:
+
+   contract_profiler () : start_(clock::now())
+   {
+      const char* env = std::getenv("BTAS_PROFILE");
+      enabled_ = env && std::strtol(env, nullptr, 10) != 0;
+   }
+
+   contract_profiler (const contract_profiler&) = delete;
+   contract_profiler& operator= (const contract_profiler&) = delete;
+
+   /// small number for the calling thread, in the order threads first record a call
+   unsigned long thread_index ()
+   {
+      const auto id = std::this_thread::get_id();
+      auto it = threads_.find(id);
+      if (it == threads_.end()) it = threads_.insert(std::make_pair(id, threads_.size())).first;
+      return it->second;
+   }
+
+   std::atomic<bool> enabled_;
+   const clock::time_point start_;
+   mutable std::mutex mutex_;
+   std::map<std::string, std::size_t> index_;
+   std::vector<contract_stats> stats_;
+   std::vector<trace_event> trace_;
+   std::map<std::thread::id, unsigned long> threads_;
+};
+
+inline std::string json_escape (const std::string& s)
+{
+   std::string x;
+   for (char c : s)
+   {
+      if (c == '"' || c == '\\') x += '\\';
+      if (static_cast<unsigned char>(c) < 0x20) { x += ' '; continue; }
+      x += c;
+   }
+   return x;
+}
+
+} // namespace impl
+
+/// \return true if contract() calls are recorded
+inline bool profile_enabled ()
+{
+#ifndef _NO_PROFILE
+   return impl::contract_profiler::instance().enabled();
+#else
+   return false;
+#endif
+}
+
+/// starts (or stops) recording contract() calls
+inline void profile_enable (bool on = true)
+{
+#ifndef _NO_PROFILE
+   impl::contract_profiler::instance().enable(on);
+#endif
+}
+
+/// discards all recorded calls
+inline void profile_reset ()
+{
+   impl::contract_profiler::instance().reset();
+}
+
+/// \return totals per signature, in the order the signatures were first seen
+inline std::vector<contract_stats> profile_stats ()
+{
+   return impl::contract_profiler::instance().stats();
+}
+
+/// Writes a table of the recorded calls, one line per signature, most expensive first:
+/// calls, total milliseconds, milliseconds in each phase, GFLOP/s and GB/s over the whole call
+inline void profile_report (std::ostream& os)
+{
+   auto stats = profile_stats();
+   std::sort(stats.begin(), stats.end(), [](const contract_stats& x, const contract_stats& y) { return x.total > y.total; });
+
+   const int nphase = static_cast<int>(contract_phase::count);
+   std::ostringstream x;
+   x << std::left << std::setw(48) << "signature" << std::right << std::setw(8) << "calls" << std::setw(11) << "total ms";
+   for (int p = 0; p != nphase; ++p) x << std::setw(14) << contract_phase_name(static_cast<contract_phase>(p));
+   x << std::setw(10) << "GFLOP/s" << std::setw(10) << "GB/s" << "\n";
+
+   x << std::fixed << std::setprecision(3);
+   for (const auto& s : stats)
+   {
+      x << std::left << std::setw(48) << s.signature << std::right << std::setw(8) << s.calls << std::setw(11) << 1e3 * s.total;
+      for (int p = 0; p != nphase; ++p) x << std::setw(14) << 1e3 * s.seconds[p];
+      const double t = s.total > 0 ? s.total : 1;
+      x << std::setw(10) << 1e-9 * s.flops / t << std::setw(10) << 1e-9 * s.bytes / t << "\n";
+   }
+   os << x.str();
+}
+
+/// Writes the recorded calls in the Chrome trace event format: one complete event per call, named by its
+/// signature, and nested in it one per phase, on a track per thread
+inline void profile_write_chrome_trace (std::ostream& os)
+{
+   const auto& profiler = impl::contract_profiler::instance();
+   const auto stats = profiler.stats();
+   const auto trace = profiler.trace();
+
+   std::ostringstream x;
+   x << std::fixed << std::setprecision(3);
+   x << "{\"traceEvents\":[";
+   bool first = true;
+   for (const auto& e : trace)
+   {
+      const std::string sig = impl::json_escape(stats[e.signature].signature);
+      x << (first ? "\n" : ",\n");
+      first = false;
+      x << "{\"name\":\"" << (e.phase == contract_phase::count ? sig : contract_phase_name(e.phase))
+        << "\",\"cat\":\"contract\",\"ph\":\"X\",\"pid\":0,\"tid\":" << e.thread
+        << ",\"ts\":" << 1e6 * e.begin << ",\"dur\":" << 1e6 * e.duration
+        << ",\"args\":{\"signature\":\"" << sig << "\"}}";
+   }
+   x << "\n],\"displayTimeUnit\":\"ms\"}\n";
+   os << x.str();
+}
+
+/// Records one contract() call if profiling is enabled, and does nothing otherwise
+///
+/// Made at entry with the operands; phase() then marks the start of each phase, which ends the previous
+/// one and adds the bytes the new phase moves, and the call is recorded on destruction.
+class contract_profile
+{
+public:
+
+   template<typename _T, class _TensorA, class _AnnotationA, class _TensorB, class _AnnotationB, class _TensorC, class _AnnotationC>
+   contract_profile (
+      const _T& beta,
+      const _TensorA& A, const _AnnotationA& aA,
+      const _TensorB& B, const _AnnotationB& aB,
+      const _TensorC&, const _AnnotationC& aC) : active_(profile_enabled())
+   {
+      if (!active_) return;
+      current_ = contract_phase::count;
+      bytes_ = 0;
+
+      // extents of the labels of A and B; each label is a free or a contracted index, or a Hadamard
+      // index, so the number of multiply-adds is the product of the extents of all labels
+      typedef typename std::decay<decltype(*std::begin(aA))>::type label_type;
+      std::vector<std::pair<label_type, double>> extents;
+      std::ostringstream sig;
+      describe(sig, 'A', A, aA, extents);
+      sig << " * ";
+      describe(sig, 'B', B, aB, extents);
+      sig << " -> C(";
+      for (auto it = std::begin(aC); it != std::end(aC); ++it) sig << (it == std::begin(aC) ? "" : ",") << *it;
+      sig << ")";
+      signature_ = sig.str();
+
+      double fma = 1, sizeC = 1;
+      for (const auto& e : extents)
+      {
+         fma *= e.second;
+         if (std::find(std::begin(aC), std::end(aC), e.first) != std::end(aC)) sizeC *= e.second;
+      }
+      flops_ = 2 * fma;
+      typedef typename _TensorC::value_type value_type;
+      elem_[0] = sizeof(typename _TensorA::value_type) * static_cast<double>(A.size());
+      elem_[1] = sizeof(typename _TensorB::value_type) * static_cast<double>(B.size());
+      elem_[2] = sizeof(value_type) * sizeC;
+      read_C_ = !(beta == static_cast<_T>(0));
+      kernel_ = false;
+
+      // the call is timed from here, without the signature
+      phase(contract_phase::check);
+      begin_ = mark_;
+   }
+
+   ~contract_profile ()
+   {
+      if (!active_) return;
+      const auto end = impl::contract_profiler::clock::now();
+      auto& profiler = impl::contract_profiler::instance();
+      if (current_ != contract_phase::count)
+         phases_.push_back(std::make_pair(current_, std::make_pair(profiler.since_start(mark_), profiler.since_start(end))));
+      profiler.record(signature_, profiler.since_start(begin_), profiler.since_start(end), flops_, bytes_, phases_);
+   }
+
+   bool active () const { return active_; }
+
+   /// ends the current phase and starts phase p, unless p is the current phase
+   void phase (contract_phase p)
+   {
+      if (!active_ || p == current_) return;
+      const auto now = impl::contract_profiler::clock::now();
+      if (current_ != contract_phase::count)
+      {
+         auto& profiler = impl::contract_profiler::instance();
+         phases_.push_back(std::make_pair(current_, std::make_pair(profiler.since_start(mark_), profiler.since_start(now))));
+      }
+      current_ = p;
+      mark_ = now;
+      switch (p)
+      {
+         case contract_phase::permute_A: bytes_ += 2 * elem_[0]; break;
+         case contract_phase::permute_B: bytes_ += 2 * elem_[1]; break;
+         case contract_phase::permute_C:
+         case contract_phase::scale:
+         case contract_phase::permute_back: bytes_ += 2 * elem_[2]; break;
+         case contract_phase::kernel:
+            // the in-place attempt and the BLAS call after permutations are one kernel
+            if (!kernel_) bytes_ += elem_[0] + elem_[1] + (read_C_ ? 2 : 1) * elem_[2];
+            kernel_ = true;
+            break;
+         default: break;
+      }
+   }
+
+private:
+
+   contract_profile (const contract_profile&) = delete;
+   contract_profile& operator= (const contract_profile&) = delete;
+
+   /// writes X(label:extent,...) and adds the labels not seen yet to extents
+   template<class _Tensor, class _Annotation, class _Extents>
+   static void describe (std::ostringstream& sig, char name, const _Tensor& X, const _Annotation& aX, _Extents& extents)
+   {
+      sig << name << "(";
+      size_t d = 0;
+      for (auto it = std::begin(aX); it != std::end(aX); ++it, ++d)
+      {
+         const double e = X.rank() > d ? static_cast<double>(X.range().extent(d)) : 0;
+         sig << (d == 0 ? "" : ",") << *it << ":" << e;
+         auto same = [&](const typename _Extents::value_type& x) { return x.first == *it; };
+         if (std::find_if(extents.begin(), extents.end(), same) == extents.end()) extents.push_back(std::make_pair(*it, e));
+      }
+      sig << ")";
+   }
+
+   bool active_;
+   impl::contract_profiler::clock::time_point begin_;
+   impl::contract_profiler::clock::time_point mark_;
+   contract_phase current_;
+   std::string signature_;
+   double flops_;
+   double bytes_;
+   double elem_[3]; //!< bytes of A, B and C
+   bool read_C_;
+   bool kernel_;   //!< the bytes of the kernel are counted
+   std::vector<std::pair<contract_phase, std::pair<double, double>>> phases_;
+};
+
+} // namespace btas
+
+#endif // __BTAS_UTIL_PROFILE_H
@@ -9,12 +9,26 @@
 #define BTAS_VARRAY_ALLOCATORS_H_
 
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
 #include <algorithm>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
 #include <vector>
 #include <stdexcept>
 #include <iostream>
 #include <iomanip>
+#include <limits>
+#include <type_traits>
+
+#include <btas/util/parallel.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
 
 namespace btas {
 
@@ -122,6 +136,403 @@ namespace btas {
       }
   };
 
+  namespace impl {
+
+    inline std::atomic<bool>& huge_pages_flag() {
+      static std::atomic<bool> flag(std::getenv("BTAS_HUGE_PAGES") != nullptr &&
+                                    std::strtol(std::getenv("BTAS_HUGE_PAGES"), nullptr, 10) != 0);
+      return flag;
+    }
+
+    /// \return \c bytes of memory aligned to \c align , a power of 2, to be released by aligned_free()
+    inline void* aligned_malloc(std::size_t bytes, std::size_t align) {
+      // over-allocate and keep the address of the block in front of the aligned pointer
+      char* block = static_cast<char*>(std::malloc(bytes + align + sizeof(void*)));
+      if (block == nullptr) throw std::bad_alloc();
+      const std::uintptr_t first = reinterpret_cast<std::uintptr_t>(block + sizeof(void*));
+      char* p = reinterpret_cast<char*>((first + align - 1) & ~(std::uintptr_t(align) - 1));
+      reinterpret_cast<void**>(p)[-1] = block;
+      return p;
+    }
+
+    inline void aligned_free(void* p) noexcept {
+      if (p != nullptr) std::free(static_cast<void**>(p)[-1]);
+    }
+
+    /// construct() and destroy() of allocators whose elements are default-initialized,
+    /// so that containers do not fill trivial elements with zeros
+    struct default_init_allocator_base {
+      template <typename U>
+      void construct(U* p) noexcept(std::is_nothrow_default_constructible<U>::value) {
+        ::new(static_cast<void*>(p)) U;
+      }
+
+      template <typename U, typename... Args>
+      void construct(U* p, Args&&... args) {
+        ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+      }
+
+      template <typename U>
+      void destroy(U* p) {
+        p->~U();
+      }
+    };
+
+  } // namespace impl
+
+  /// \return true if large blocks of aligned_allocator are backed by transparent huge pages
+  inline bool get_huge_pages() {
+    return impl::huge_pages_flag();
+  }
+
+  /// requests transparent huge pages for blocks of aligned_allocator of at least huge_page_size bytes
+  /// (Linux only); initially set if the environment variable BTAS_HUGE_PAGES is nonzero
+  inline void set_huge_pages(bool enable) {
+    impl::huge_pages_flag() = enable;
+  }
+
+  /// size of a huge page, blocks that may use huge pages are aligned to it
+  const std::size_t huge_page_size = 1ul << 21;
+
+  /// Allocator of aligned memory whose elements are default-initialized, i.e. left uninitialized if trivial.
+
+  /// Blocks large enough to be filled in parallel are first touched under parallel_for, in the same
+  /// partition as the element-wise kernels, so that on NUMA machines their pages are placed near the
+  /// threads that use them. Blocks of at least huge_page_size bytes can use huge pages, see set_huge_pages().
+  template <typename T, std::size_t Alignment = 64>
+  class aligned_allocator : public impl::default_init_allocator_base {
+      static_assert(Alignment >= alignof(T) && (Alignment & (Alignment - 1)) == 0,
+                    "aligned_allocator: Alignment must be a power of 2 and at least alignof(T)");
+    public:
+      typedef T value_type;
+      typedef T* pointer;
+      typedef const T* const_pointer;
+      typedef T& reference;
+      typedef const T& const_reference;
+      typedef std::size_t size_type;
+      typedef std::ptrdiff_t difference_type;
+
+      template <typename U>
+      struct rebind {
+          typedef aligned_allocator<U, Alignment> other;
+      };
+
+      aligned_allocator() noexcept { }
+
+      template <typename U>
+      aligned_allocator(const aligned_allocator<U, Alignment>&) noexcept { }
+
+      pointer allocate(size_type n, const void* = 0) {
+        if (n == 0) return nullptr;
+        if (n > max_size()) throw std::bad_alloc();
+        const std::size_t bytes = n * sizeof(T);
+        const bool huge = bytes >= huge_page_size && get_huge_pages();
+        char* p = static_cast<char*>(impl::aligned_malloc(bytes, huge ? huge_page_size : Alignment));
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        if (huge) ::madvise(p, bytes / huge_page_size * huge_page_size, MADV_HUGEPAGE);
+#endif
+        first_touch(p, n);
+        return reinterpret_cast<pointer>(p);
+      }
+
+      void deallocate(pointer p, size_type) noexcept {
+        impl::aligned_free(p);
+      }
+
+      size_type max_size() const noexcept {
+        return (std::numeric_limits<size_type>::max() - huge_page_size) / sizeof(T);
+      }
+
+    private:
+      /// writes to every page of a block of n elements, in parallel if the element-wise kernels would be
+      static void first_touch(char* p, size_type n) {
+        if (n < 2 * elementwise_parallel_grain || parallel_width() == 1) return;
+        const std::size_t page = 4096;
+        parallel_for(n, elementwise_parallel_grain, [&](unsigned long i0, unsigned long i1) {
+          volatile char* first = p + i0 * sizeof(T);
+          volatile char* last = p + i1 * sizeof(T);
+          for (volatile char* x = first; x < last; x += page) *x = 0;
+        });
+      }
+  };
+
+  template <typename T, typename U, std::size_t Alignment>
+  bool operator==(const aligned_allocator<T, Alignment>&, const aligned_allocator<U, Alignment>&) noexcept {
+    return true;
+  }
+
+  template <typename T, typename U, std::size_t Alignment>
+  bool operator!=(const aligned_allocator<T, Alignment>&, const aligned_allocator<U, Alignment>&) noexcept {
+    return false;
+  }
+
+  /// counters of the memory pool behind pool_allocator
+  struct pool_statistics {
+    std::size_t requests;      //!< number of allocations
+    std::size_t hits;          //!< allocations served by a cached block
+    std::size_t live_blocks;   //!< blocks allocated and not yet deallocated
+    std::size_t live_bytes;    //!< bytes in live blocks, rounded up to their size classes
+    std::size_t peak_bytes;    //!< maximum of live_bytes
+    std::size_t cached_bytes;  //!< bytes in free blocks kept for reuse
+
+    double hit_rate() const { return requests == 0 ? 0. : double(hits) / requests; }
+  };
+
+  /// a thread keeps at most this many bytes of free blocks for itself, the rest go back to the shared pool
+  const std::size_t pool_thread_cache_bytes = 1ul << 25;
+
+  /// blocks larger than this are not pooled
+  const std::size_t pool_max_block_bytes = 1ul << 30;
+
+  namespace impl {
+
+    /// Pool of 64-byte aligned blocks in size classes 64, 96, 128, 192, 256, ... bytes.
+
+    /// Freed blocks are cached by the thread that frees them, up to pool_thread_cache_bytes,
+    /// and otherwise returned to lists shared by all threads; they are released to the system
+    /// only by release(). Cached blocks of a thread go to the shared lists when it exits.
+    class memory_pool {
+      public:
+        static const std::size_t nclasses = 49;  // up to pool_max_block_bytes
+
+        static memory_pool& instance() {
+          // never destroyed: worker threads may return their caches during static destruction
+          static memory_pool* pool = new memory_pool;
+          return *pool;
+        }
+
+        void* allocate(std::size_t bytes) {
+          const std::size_t c = size_class(bytes);
+          requests_.fetch_add(1, std::memory_order_relaxed);
+          if (c == nclasses) {
+            count_live(1, static_cast<long>(bytes));
+            return aligned_malloc(bytes, 64);
+          }
+          const std::size_t size = class_size(c);
+          count_live(1, static_cast<long>(size));
+
+          thread_cache* local = cache();
+          if (local != nullptr && !local->free[c].empty()) {
+            void* p = local->free[c].back();
+            local->free[c].pop_back();
+            local->bytes -= size;
+            hit(size);
+            return p;
+          }
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!free_[c].empty()) {
+              void* p = free_[c].back();
+              free_[c].pop_back();
+              hit(size);
+              return p;
+            }
+          }
+          return aligned_malloc(size, 64);
+        }
+
+        void deallocate(void* p, std::size_t bytes) noexcept {
+          if (p == nullptr) return;
+          const std::size_t c = size_class(bytes);
+          if (c == nclasses) {
+            count_live(-1, -static_cast<long>(bytes));
+            aligned_free(p);
+            return;
+          }
+          const std::size_t size = class_size(c);
+          count_live(-1, -static_cast<long>(size));
+          try {
+            thread_cache* local = cache();
+            if (local != nullptr && local->bytes + size <= pool_thread_cache_bytes) {
+              local->free[c].push_back(p);
+              local->bytes += size;
+            }
+            else {
+              std::lock_guard<std::mutex> lock(mutex_);
+              free_[c].push_back(p);
+            }
+            cached_bytes_.fetch_add(size, std::memory_order_relaxed);
+          }
+          catch (...) {
+            // no room in the lists: give the block back
+            aligned_free(p);
+          }
+        }
+
+        /// releases the free blocks of the shared lists and of the calling thread to the system
+        void release() {
+          if (thread_cache* local = cache()) local->flush(*this);
+          std::lock_guard<std::mutex> lock(mutex_);
+          for (std::size_t c = 0; c != nclasses; ++c) {
+            for (void* p : free_[c]) aligned_free(p);
+            cached_bytes_.fetch_sub(free_[c].size() * class_size(c), std::memory_order_relaxed);
+            free_[c].clear();
+          }
+        }
+
+        pool_statistics statistics() const {
+          pool_statistics s;
+          s.requests = requests_.load(std::memory_order_relaxed);
+          s.hits = hits_.load(std::memory_order_relaxed);
+          s.live_blocks = live_blocks_.load(std::memory_order_relaxed);
+          s.live_bytes = live_bytes_.load(std::memory_order_relaxed);
+          s.peak_bytes = peak_bytes_.load(std::memory_order_relaxed);
+          s.cached_bytes = cached_bytes_.load(std::memory_order_relaxed);
+          return s;
+        }
+
+        /// sets requests and hits to zero and the peak to the bytes now live
+        void reset_statistics() {
+          requests_ = 0;
+          hits_ = 0;
+          peak_bytes_ = live_bytes_.load();
+        }
+
+        /// \return the size class of a block of \c bytes , nclasses if it is not pooled
+        static std::size_t size_class(std::size_t bytes) {
+          if (bytes <= 64) return 0;
+          if (bytes > pool_max_block_bytes) return nclasses;
+          // 2^k < bytes <= 2^(k+1), classes 2^k, 1.5*2^k, 2^(k+1) are 2(k-6), 2(k-6)+1, 2(k-6)+2
+          std::size_t k = 6;
+          while ((std::size_t(1) << (k+1)) < bytes) ++k;
+          return 2*(k-6) + (bytes <= 3*(std::size_t(1) << (k-1)) ? 1 : 2);
+        }
+
+        static std::size_t class_size(std::size_t c) {
+          return (c % 2 == 0 ? 64ul : 96ul) << (c / 2);
+        }
+
+      private:
+        struct thread_cache {
+          std::vector<void*> free[nclasses];
+          std::size_t bytes = 0;
+
+          /// moves all blocks to the shared lists
+          void flush(memory_pool& pool) {
+            std::lock_guard<std::mutex> lock(pool.mutex_);
+            for (std::size_t c = 0; c != nclasses; ++c) {
+              pool.free_[c].insert(pool.free_[c].end(), free[c].begin(), free[c].end());
+              free[c].clear();
+            }
+            bytes = 0;
+          }
+
+          ~thread_cache() {
+            flush(memory_pool::instance());
+            cache_destroyed() = true;
+          }
+        };
+
+        /// set when the cache of the calling thread has been destroyed, e.g. during static destruction
+        /// of the main thread; containers that are destroyed later use the shared lists
+        static bool& cache_destroyed() {
+          static thread_local bool destroyed = false;
+          return destroyed;
+        }
+
+        /// \return the cache of the calling thread, nullptr if it has already been destroyed
+        static thread_cache* cache() {
+          if (cache_destroyed()) return nullptr;
+          static thread_local thread_cache local;
+          return &local;
+        }
+
+        memory_pool() : requests_(0), hits_(0), live_blocks_(0), live_bytes_(0), peak_bytes_(0), cached_bytes_(0) { }
+
+        void hit(std::size_t size) {
+          hits_.fetch_add(1, std::memory_order_relaxed);
+          cached_bytes_.fetch_sub(size, std::memory_order_relaxed);
+        }
+
+        void count_live(long blocks, long bytes) {
+          live_blocks_.fetch_add(blocks, std::memory_order_relaxed);
+          const std::size_t live = live_bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+          std::size_t peak = peak_bytes_.load(std::memory_order_relaxed);
+          while (live > peak && !peak_bytes_.compare_exchange_weak(peak, live, std::memory_order_relaxed)) { }
+        }
+
+        std::mutex mutex_;
+        std::vector<void*> free_[nclasses];
+
+        std::atomic<std::size_t> requests_;
+        std::atomic<std::size_t> hits_;
+        std::atomic<std::size_t> live_blocks_;
+        std::atomic<std::size_t> live_bytes_;
+        std::atomic<std::size_t> peak_bytes_;
+        std::atomic<std::size_t> cached_bytes_;
+    };
+
+  } // namespace impl
+
+  /// \return the counters of the memory pool behind pool_allocator
+  inline pool_statistics get_pool_statistics() {
+    return impl::memory_pool::instance().statistics();
+  }
+
+  /// sets the request and hit counters to zero and the peak to the bytes now live
+  inline void reset_pool_statistics() {
+    impl::memory_pool::instance().reset_statistics();
+  }
+
+  /// releases the free blocks of the memory pool kept for reuse, except those cached by other threads
+  inline void release_pool_memory() {
+    impl::memory_pool::instance().release();
+  }
+
+  /// Thread-safe allocator that recycles blocks through a process-wide pool with per-thread caches.
+
+  /// Blocks are 64-byte aligned and rounded up to size classes of at most 1.5 times their size,
+  /// elements are default-initialized. It can be used in place of \c std::allocator , e.g. in
+  /// \c varray<T,pool_allocator<T>> or as \c Tensor storage \c std::vector<T,pool_allocator<T>> ,
+  /// to avoid repeated system allocations of temporaries; see get_pool_statistics().
+  template <typename T>
+  class pool_allocator : public impl::default_init_allocator_base {
+      static_assert(alignof(T) <= 64, "pool_allocator: alignment of T exceeds 64 bytes");
+    public:
+      typedef T value_type;
+      typedef T* pointer;
+      typedef const T* const_pointer;
+      typedef T& reference;
+      typedef const T& const_reference;
+      typedef std::size_t size_type;
+      typedef std::ptrdiff_t difference_type;
+
+      template <typename U>
+      struct rebind {
+          typedef pool_allocator<U> other;
+      };
+
+      pool_allocator() noexcept { }
+
+      template <typename U>
+      pool_allocator(const pool_allocator<U>&) noexcept { }
+
+      pointer allocate(size_type n, const void* = 0) {
+        if (n == 0) return nullptr;
+        if (n > max_size()) throw std::bad_alloc();
+        return static_cast<pointer>(impl::memory_pool::instance().allocate(n * sizeof(T)));
+      }
+
+      void deallocate(pointer p, size_type n) noexcept {
+        impl::memory_pool::instance().deallocate(p, n * sizeof(T));
+      }
+
+      size_type max_size() const noexcept {
+        return (std::numeric_limits<size_type>::max() / 2) / sizeof(T);
+      }
+  };
+
+  template <typename T, typename U>
+  bool operator==(const pool_allocator<T>&, const pool_allocator<U>&) noexcept {
+    return true;
+  }
+
+  template <typename T, typename U>
+  bool operator!=(const pool_allocator<T>&, const pool_allocator<U>&) noexcept {
+    return false;
+  }
+
 }
 
 
@@ -1,6 +1,16 @@
 #include "test.h"
 #include "btas/tensor.h"
 #include "btas/generic/contract.h"
+#include "btas/generic/axpy_impl.h"
+#include "btas/generic/contraction_plan.h"
+#include "btas/generic/contract_block_sparse.h"
+#include "btas/generic/contract_sparse.h"
+#include "btas/generic/contract_diagonal.h"
+#include "btas/tensor_func.h"
+#include <map>
+#include <random>
+#include <sstream>
+#include <vector>
 
 using std::cout;
 using std::endl;
@@ -79,3 +89,661 @@ TEST_CASE("Tensor Contract")
 
 
     }
+
+// C(aC) = alpha * A(aA) * B(aB) + beta * C(aC) by an explicit sum over all index values
+template <typename _Tensor>
+void static
+refContract(double alpha, const _Tensor& A, const std::vector<int>& aA,
+            const _Tensor& B, const std::vector<int>& aB,
+            double beta, _Tensor& C, const std::vector<int>& aC)
+    {
+    std::map<int,long> ext;
+    for(size_t d = 0; d < aA.size(); ++d) ext[aA[d]] = A.extent(d);
+    for(size_t d = 0; d < aB.size(); ++d) ext[aB[d]] = B.extent(d);
+    for(auto& x : C) x *= beta;
+    std::map<int,long> val;
+    for(auto& e : ext) val[e.first] = 0;
+    btas::varray<long> iA(aA.size()), iB(aB.size()), iC(aC.size());
+    while(true)
+        {
+        for(size_t d = 0; d < aA.size(); ++d) iA[d] = val[aA[d]];
+        for(size_t d = 0; d < aB.size(); ++d) iB[d] = val[aB[d]];
+        for(size_t d = 0; d < aC.size(); ++d) iC[d] = val[aC[d]];
+        C(iC) += alpha*A(iA)*B(iB);
+        auto it = val.begin();
+        for(; it != val.end(); ++it)
+            {
+            if(++it->second < ext[it->first]) break;
+            it->second = 0;
+            }
+        if(it == val.end()) break;
+        }
+    }
+
+// contracts into an empty and into a filled C, and compares with refContract
+template <typename _Tensor>
+double static
+checkContract(const std::vector<long>& extA, const std::vector<int>& aA,
+              const std::vector<long>& extB, const std::vector<int>& aB,
+              const std::vector<int>& aC)
+    {
+    _Tensor A, B;
+    A.resize(btas::varray<long>(extA.begin(),extA.end()));
+    B.resize(btas::varray<long>(extB.begin(),extB.end()));
+    A.generate([](){ static double v = 0; v += 0.37; return std::sin(v); });
+    B.generate([](){ static double v = 0; v += 0.61; return std::cos(v); });
+
+    _Tensor C;
+    contract(1.0,A,btas::varray<int>(aA.begin(),aA.end()),B,btas::varray<int>(aB.begin(),aB.end()),0.0,C,btas::varray<int>(aC.begin(),aC.end()));
+    _Tensor R(C.range());
+    R.fill(0.0);
+    refContract(1.0,A,aA,B,aB,0.0,R,aC);
+    double d = 0;
+    for(auto i : C.range()) d = std::max(d,double(std::abs(C(i)-R(i))));
+
+    C.generate([](){ static double v = 0; v += 0.11; return std::sin(v); });
+    R = C;
+    contract(0.7,A,btas::varray<int>(aA.begin(),aA.end()),B,btas::varray<int>(aB.begin(),aB.end()),-0.5,C,btas::varray<int>(aC.begin(),aC.end()));
+    refContract(0.7,A,aA,B,aB,-0.5,R,aC);
+    for(auto i : C.range()) d = std::max(d,double(std::abs(C(i)-R(i))));
+    return d;
+    }
+
+TEST_CASE("Strided Contract")
+    {
+    enum {i,j,k,l,m};
+
+    SECTION("Matrix")
+        {
+        CHECK(checkContract<DTensor>({3,4},{i,j},{4,5},{j,k},{i,k}) < 1E-12);
+        CHECK(checkContract<DTensor>({4,3},{j,i},{4,5},{j,k},{i,k}) < 1E-12);
+        CHECK(checkContract<DTensor>({3,4},{i,j},{5,4},{k,j},{k,i}) < 1E-12);
+        CHECK(checkContract<DTensor>({4,3},{j,i},{5,4},{k,j},{k,i}) < 1E-12);
+        }
+
+    SECTION("Fused Groups")
+        {
+        CHECK(checkContract<DTensor>({3,4,5},{i,j,k},{5,6},{k,l},{i,j,l}) < 1E-12);
+        CHECK(checkContract<DTensor>({5,3,4},{k,i,j},{6,5},{l,k},{l,i,j}) < 1E-12);
+        CHECK(checkContract<DTensor>({3,4,5},{i,j,k},{4,5,6},{j,k,l},{l,i}) < 1E-12);
+        CHECK(checkContract<DTensor>({3,4},{i,j},{6},{l},{i,j,l}) < 1E-12);
+        CHECK(checkContract<DTensor>({3,4},{i,j},{4},{j},{i}) < 1E-12);
+        CHECK(checkContract<DTensor>({4},{j},{4,3},{j,i},{i}) < 1E-12);
+        }
+
+    SECTION("Looped Groups")
+        {
+        // the free indices {i,k} of A are not adjacent, i is looped over
+        CHECK(checkContract<DTensor>({3,20,20},{i,j,k},{20,20},{j,l},{i,l,k}) < 1E-11);
+        CHECK(checkContract<DTensor>({20,20},{j,l},{3,20,20},{i,j,k},{i,k,l}) < 1E-11);
+        // too small to be looped over, permuted instead
+        CHECK(checkContract<DTensor>({3,2,4},{i,j,k},{2,5},{j,l},{i,l,k}) < 1E-12);
+        }
+
+    SECTION("Permuted")
+        {
+        // contracted indices in different orders in A and B
+        CHECK(checkContract<DTensor>({3,4,2,5},{i,j,k,l},{5,4,6},{l,j,m},{k,i,m}) < 1E-12);
+        CHECK(checkContract<DTensor>({3,4,5},{i,j,k},{5,4,6},{k,j,l},{l,i}) < 1E-12);
+        }
+
+    SECTION("Hadamard")
+        {
+        // i is a batch index of A, B and C
+        CHECK(checkContract<DTensor>({3,4,5},{i,j,k},{3,5,6},{i,k,l},{i,j,l}) < 1E-12);
+        CHECK(checkContract<DTensor>({4,5,3},{j,k,i},{5,6,3},{k,l,i},{j,l,i}) < 1E-12);
+        CHECK(checkContract<DTensor>({4,3},{j,i},{3,4},{i,j},{i}) < 1E-12);
+        // contracted indices in different orders in A and B, permuted first
+        CHECK(checkContract<DTensor>({3,4,5,2},{i,j,k,m},{2,5,3,6},{m,k,i,l},{l,j,i}) < 1E-12);
+        }
+
+    SECTION("Column Major")
+        {
+        typedef btas::Tensor<double,btas::RangeNd<CblasColMajor>> CTensor;
+        CHECK(checkContract<CTensor>({3,4},{i,j},{4,5},{j,k},{i,k}) < 1E-12);
+        CHECK(checkContract<CTensor>({3,4,5},{i,j,k},{4,5,6},{j,k,l},{l,i}) < 1E-12);
+        CHECK(checkContract<CTensor>({3,20,20},{i,j,k},{20,20},{j,l},{i,l,k}) < 1E-11);
+        // Hadamard indices are the slowest in column-major order
+        CHECK(checkContract<CTensor>({3,4,5},{i,j,k},{3,5,6},{i,k,l},{i,j,l}) < 1E-12);
+        CHECK(checkContract<CTensor>({4,5,3},{j,k,i},{5,6,3},{k,l,i},{j,l,i}) < 1E-12);
+        CHECK(checkContract<CTensor>({4,3},{j,i},{3,4},{i,j},{i}) < 1E-12);
+        CHECK(checkContract<CTensor>({3,4,5,2},{i,j,k,m},{2,5,3,6},{m,k,i,l},{l,j,i}) < 1E-12);
+        CHECK(checkContract<CTensor>({20,30,3},{j,k,i},{30,20,3},{k,l,i},{j,l,i}) < 1E-11);
+        }
+
+    SECTION("Hadamard without BLAS")
+        {
+        // value types without a strided GEMM take one generic GEMM per Hadamard index
+        typedef btas::Tensor<btas::half> HTensor;
+        typedef btas::Tensor<btas::half,btas::RangeNd<CblasColMajor>> HCTensor;
+        CHECK(checkContract<HTensor>({3,4,5},{i,j,k},{3,5,6},{i,k,l},{i,j,l}) < 2E-2);
+        CHECK(checkContract<HTensor>({3,4,5,2},{i,j,k,m},{2,5,3,6},{m,k,i,l},{l,j,i}) < 2E-2);
+        CHECK(checkContract<HCTensor>({4,5,3},{j,k,i},{5,6,3},{k,l,i},{j,l,i}) < 2E-2);
+        CHECK(checkContract<HCTensor>({4,3},{j,i},{3,4},{i,j},{i}) < 2E-2);
+        }
+
+    }
+
+typedef btas::TensorConstView<double> DConstView;
+typedef btas::TensorView<double> DView;
+
+// the block [1,ext+1) of a tensor padded by pad in each dimension
+btas::varray<long> static
+blockLo(const std::vector<long>& ext) { return btas::varray<long>(ext.size(),1); }
+
+btas::varray<long> static
+blockUp(const std::vector<long>& ext, long pad = 0)
+    {
+    btas::varray<long> up(ext.size());
+    for(size_t d = 0; d < ext.size(); ++d) up[d] = ext[d]+1+pad;
+    return up;
+    }
+
+// a contiguous copy of a view, with 0-based indices
+DTensor static
+denseCopy(const DConstView& X)
+    {
+    DTensor T(btas::Range(btas::extent(X)));
+    std::copy(X.cbegin(),X.cend(),T.begin());
+    return T;
+    }
+
+// contracts blocks of padded A and B into a block of padded C, and compares with refContract on copies of
+// the blocks; C must be untouched outside of its block
+double static
+checkViewContract(const std::vector<long>& extA, const std::vector<int>& aA,
+                  const std::vector<long>& extB, const std::vector<int>& aB,
+                  const std::vector<int>& aC)
+    {
+    std::map<int,long> ext;
+    for(size_t d = 0; d < aA.size(); ++d) ext[aA[d]] = extA[d];
+    for(size_t d = 0; d < aB.size(); ++d) ext[aB[d]] = extB[d];
+    std::vector<long> extC;
+    for(auto c : aC) extC.push_back(ext[c]);
+
+    DTensor PA(btas::Range(blockUp(extA,2))), PB(btas::Range(blockUp(extB,1))), PC(btas::Range(blockUp(extC,2)));
+    PA.generate([](){ static double v = 0; v += 0.37; return std::sin(v); });
+    PB.generate([](){ static double v = 0; v += 0.61; return std::cos(v); });
+    PC.generate([](){ static double v = 0; v += 0.11; return std::sin(v); });
+    const DTensor PC0(PC);
+
+    DConstView A(PA.range().slice(blockLo(extA),blockUp(extA)),PA.storage()),
+               B(PB.range().slice(blockLo(extB),blockUp(extB)),PB.storage());
+    DView C(PC.range().slice(blockLo(extC),blockUp(extC)),PC.storage());
+    auto RA = denseCopy(A), RB = denseCopy(B), RC = denseCopy(DConstView(C.range(),PC.storage()));
+
+    contract(0.7,A,btas::varray<int>(aA.begin(),aA.end()),B,btas::varray<int>(aB.begin(),aB.end()),-0.5,C,btas::varray<int>(aC.begin(),aC.end()));
+    refContract(0.7,RA,aA,RB,aB,-0.5,RC,aC);
+
+    double d = 0;
+    auto c = C.cbegin();
+    for(auto r = RC.cbegin(); r != RC.cend(); ++r, ++c) d = std::max(d,std::abs(*c-*r));
+    for(auto i : PC.range())
+        {
+        if(!C.range().includes(i) && PC(i) != PC0(i)) d = 1;
+        }
+    return d;
+    }
+
+TEST_CASE("View Contract")
+    {
+    enum {i,j,k,l,m};
+
+    SECTION("In Place")
+        {
+        static_assert(btas::is_contract_strided_call<DConstView,DConstView,DView>::value, "views of Tensors are addressed in place");
+        DTensor PA(10,12), PB(12,8), PC(10,8);
+        PA.fill(1.0);
+        PB.fill(2.0);
+        PC.fill(-1.0);
+        auto A = PA.slice({btas::Range1(2,6),btas::Range1(1,9)});
+        auto B = PB.slice({btas::Range1(0,8),btas::Range1(2,7)});
+        DView C(PC.range().slice(btas::varray<long>{3,1},btas::varray<long>{7,6}),PC.storage());
+        CHECK(btas::contract_strided_dispatch<true>::call(1.0,A,btas::varray<int>{i,j},B,btas::varray<int>{j,k},0.0,C,btas::varray<int>{i,k}));
+        CHECK(PC(3,1) == 16.0);
+        CHECK(PC(6,5) == 16.0);
+        CHECK(PC(2,1) == -1.0);
+        CHECK(PC(3,6) == -1.0);
+        }
+
+    SECTION("Matrix Blocks")
+        {
+        CHECK(checkViewContract({3,4},{i,j},{4,5},{j,k},{i,k}) < 1E-12);
+        CHECK(checkViewContract({4,3},{j,i},{4,5},{j,k},{i,k}) < 1E-12);
+        CHECK(checkViewContract({3,4},{i,j},{5,4},{k,j},{k,i}) < 1E-12);
+        CHECK(checkViewContract({3,4},{i,j},{4},{j},{i}) < 1E-12);
+        }
+
+    SECTION("Batch of Blocks")
+        {
+        // the rows of each block are not fused with the leading index, which is looped over
+        CHECK(checkViewContract({3,20,30},{i,j,k},{30,20},{k,l},{i,j,l}) < 1E-11);
+        CHECK(checkViewContract({3,20,30},{i,j,k},{3,30,20},{i,k,l},{i,l,j}) < 1E-11);
+        }
+
+    SECTION("Copied")
+        {
+        // too small to loop over GEMMs, or indices to be permuted: the blocks are copied
+        CHECK(checkViewContract({3,4,5},{i,j,k},{5,6},{k,l},{i,j,l}) < 1E-12);
+        CHECK(checkViewContract({3,4,2,5},{i,j,k,l},{5,4,6},{l,j,m},{k,i,m}) < 1E-12);
+        }
+
+    SECTION("Strided and Reversed")
+        {
+        DTensor PA(12,9), PB(8,10), PC(6,10);
+        PA.generate([](){ static double v = 0; v += 0.37; return std::sin(v); });
+        PB.generate([](){ static double v = 0; v += 0.61; return std::cos(v); });
+        PC.fill(0.0);
+        // every other row of A is a matrix with LDA = 18, in place
+        auto A = PA.slice({btas::Range1(0,12,2),btas::Range1(1,9)});  // 6 x 8
+        auto B = PB.slice({btas::Range1(0,8),btas::Range1(0,10)});    // 8 x 10
+        DView C(PC.range(),PC.storage());
+        CHECK(btas::contract_strided_dispatch<true>::call(1.0,A,btas::varray<int>{i,j},B,btas::varray<int>{j,k},0.0,C,btas::varray<int>{i,k}));
+        double d = 0;
+        for(long r = 0; r < 6; ++r)
+        for(long c = 0; c < 10; ++c)
+            {
+            double val = 0;
+            for(long q = 0; q < 8; ++q) val += PA(2*r,1+q)*PB(q,c);
+            d = std::max(d,std::abs(val-PC(r,c)));
+            }
+        CHECK(d < 1E-12);
+
+        // the rows of B reversed, and every third column, into C with its columns reversed
+        auto Br = PB.slice({btas::Range1(7,-1,-1),btas::Range1(0,10,3)});  // 8 x 4
+        DView Cr(PC.range().slice({btas::Range1(0,6),btas::Range1(9,5,-1)}),PC.storage());  // 6 x 4
+        contract(1.0,A,btas::varray<int>{i,j},Br,btas::varray<int>{j,k},0.0,Cr,btas::varray<int>{i,k});
+        d = 0;
+        for(long r = 0; r < 6; ++r)
+        for(long c = 0; c < 4; ++c)
+            {
+            double val = 0;
+            for(long q = 0; q < 8; ++q) val += PA(2*r,1+q)*PB(7-q,3*c);
+            d = std::max(d,std::abs(val-PC(r,9-c)));
+            }
+        CHECK(d < 1E-12);
+        }
+
+    SECTION("Gemm Gemv Axpy Scal")
+        {
+        DTensor PA(9,11), PB(10,12), PC(8,8);
+        PA.generate([](){ static double v = 0; v += 0.37; return std::sin(v); });
+        PB.generate([](){ static double v = 0; v += 0.61; return std::cos(v); });
+        PC.fill(0.0);
+        auto A = PA.slice({btas::Range1(1,6),btas::Range1(2,9)});  // 5 x 7
+        auto B = PB.slice({btas::Range1(3,7),btas::Range1(0,7)});  // 4 x 7
+        DView C(PC.range().slice(btas::varray<long>{2,2},btas::varray<long>{7,6}),PC.storage());  // 5 x 4
+        gemm(CblasNoTrans,CblasTrans,1.0,A,B,0.0,C);
+        double d = 0;
+        for(long r = 0; r < 5; ++r)
+        for(long c = 0; c < 4; ++c)
+            {
+            double val = 0;
+            for(long q = 0; q < 7; ++q) val += PA(1+r,2+q)*PB(3+c,q);
+            d = std::max(d,std::abs(val-PC(2+r,2+c)));
+            }
+        CHECK(d < 1E-12);
+        CHECK(PC(1,2) == 0.0);
+
+        // y = A^T x, x and y being parts of vectors
+        DTensor Px(12), Py(10);
+        Px.generate([](){ static double v = 0; v += 0.23; return std::sin(v); });
+        Py.fill(0.0);
+        auto x = Px.slice({btas::Range1(4,9)});
+        DView y(Py.range().slice(btas::varray<long>{2},btas::varray<long>{9}),Py.storage());
+        gemv(CblasTrans,1.0,A,x,0.0,y);
+        d = 0;
+        for(long q = 0; q < 7; ++q)
+            {
+            double val = 0;
+            for(long r = 0; r < 5; ++r) val += PA(1+r,2+q)*Px(4+r);
+            d = std::max(d,std::abs(val-Py(2+q)));
+            }
+        CHECK(d < 1E-12);
+        CHECK(Py(1) == 0.0);
+
+        // C block += 2 * A block, then halved
+        DTensor P0(PC);
+        auto A54 = PA.slice({btas::Range1(0,5),btas::Range1(3,7)});
+        axpy(2.0,A54,C);
+        scal(0.5,C);
+        d = 0;
+        for(auto I : PC.range())
+            {
+            const bool in = C.range().includes(I);
+            const double ref = in ? 0.5*(P0(I)+2*PA(I[0]-2,I[1]+1)) : P0(I);
+            d = std::max(d,std::abs(PC(I)-ref));
+            }
+        CHECK(d < 1E-12);
+        }
+
+    }
+
+// executes a ContractionPlan twice, into an empty and into a filled C, and compares with refContract
+template <typename _Tensor>
+double static
+checkPlan(const std::vector<long>& extA, const std::vector<int>& aA,
+          const std::vector<long>& extB, const std::vector<int>& aB,
+          const std::vector<int>& aC,
+          bool permA, bool permB, bool permC)
+    {
+    _Tensor A, B;
+    A.resize(btas::varray<long>(extA.begin(),extA.end()));
+    B.resize(btas::varray<long>(extB.begin(),extB.end()));
+    A.generate([](){ static double v = 0; v += 0.37; return std::sin(v); });
+    B.generate([](){ static double v = 0; v += 0.61; return std::cos(v); });
+
+    btas::ContractionPlan<_Tensor> plan(A,aA,B,aB,aC);
+    CHECK(plan.strided());
+    CHECK(plan.permutes_A() == permA);
+    CHECK(plan.permutes_B() == permB);
+    CHECK(plan.permutes_C() == permC);
+
+    _Tensor C;
+    plan(1.0,A,B,0.0,C);
+    _Tensor R(C.range());
+    R.fill(0.0);
+    refContract(1.0,A,aA,B,aB,0.0,R,aC);
+    double d = 0;
+    for(auto i : C.range()) d = std::max(d,std::abs(C(i)-R(i)));
+
+    for(int rep = 0; rep < 2; ++rep)
+        {
+        C.generate([](){ static double v = 0; v += 0.11; return std::sin(v); });
+        R = C;
+        plan(0.7,A,B,-0.5,C);
+        refContract(0.7,A,aA,B,aB,-0.5,R,aC);
+        for(auto i : C.range()) d = std::max(d,std::abs(C(i)-R(i)));
+        }
+    return d;
+    }
+
+TEST_CASE("Contraction Plan")
+    {
+    enum {i,j,k,l,m};
+
+    SECTION("In Place")
+        {
+        CHECK(checkPlan<DTensor>({3,4},{i,j},{5,4},{k,j},{k,i},false,false,false) < 1E-12);
+        CHECK(checkPlan<DTensor>({3,4,5},{i,j,k},{4,5,6},{j,k,l},{l,i},false,false,false) < 1E-12);
+        }
+
+    SECTION("Permuted Operands")
+        {
+        // only B has its contracted indices out of order
+        CHECK(checkPlan<DTensor>({3,4,5},{i,j,k},{5,4,6},{k,j,l},{l,i},false,true,false) < 1E-12);
+        // the contracted indices {j,l} are not adjacent in A, the order of {k,i} in C is followed
+        CHECK(checkPlan<DTensor>({3,4,2,5},{i,j,k,l},{5,4,6},{l,j,m},{k,i,m},true,true,false) < 1E-12);
+        // the free indices of A and B are interleaved in C, and looping over GEMMs is not worth it
+        CHECK(checkPlan<DTensor>({2,3,4},{i,k,j},{4,5},{j,l},{i,l,k},false,false,true) < 1E-12);
+        CHECK(checkPlan<DTensor>({3,2,4},{i,j,k},{2,5},{j,l},{i,l,k},true,false,true) < 1E-12);
+        }
+
+    SECTION("Column Major")
+        {
+        typedef btas::Tensor<double,btas::RangeNd<CblasColMajor>> CTensor;
+        CHECK(checkPlan<CTensor>({3,4,5},{i,j,k},{5,4,6},{k,j,l},{l,i},false,true,false) < 1E-12);
+        }
+
+    SECTION("Initializer List")
+        {
+        DTensor A(3,4,5), B(5,4,6), C, R;
+        A.generate([](){ static double v = 0; v += 0.37; return std::sin(v); });
+        B.generate([](){ static double v = 0; v += 0.61; return std::cos(v); });
+        btas::ContractionPlan<DTensor> plan(A,{i,j,k},B,{k,j,l},{i,l});
+        CHECK(plan.extent_C() == std::vector<size_t>({3,6}));
+        plan(1.0,A,B,0.0,C);
+        contract(1.0,A,{i,j,k},B,{k,j,l},0.0,R,{i,l});
+        double d = 0;
+        for(auto x : C.range()) d = std::max(d,std::abs(C(x)-R(x)));
+        CHECK(d < 1E-12);
+        }
+
+    }
+
+TEST_CASE("Block-sparse Contract")
+    {
+    typedef btas::QNIndex<int> Index;
+    typedef btas::BlockSparseTensor<double> BSTensor;
+    const Index i({{-1,2},{0,3},{1,1}}, +1);
+    const Index j({{0,2},{1,2},{2,1}}, -1);
+    const Index k({{0,1},{1,2}}, -1);
+    const Index l({{-1,2},{1,3}}, -1);
+
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> dist(-1.,1.);
+    auto randomize = [&](BSTensor& X)
+        {
+        X.allocate();
+        for(auto& b : X) b.second.generate([&](){ return dist(gen); });
+        };
+
+    // A(i,k,l) with flux 1, B(l,j,k) with flux 0
+    BSTensor A({i, k, l}, 1);
+    BSTensor B({l.conj(), j, k.conj()}, 0);
+    randomize(A);
+    randomize(B);
+    CHECK(A.nblocks() < 3*2*2);
+    CHECK(!A.allowed({0,0,0}));
+    CHECK_THROWS(A.block({0,0,0}));
+
+    enum {I, J, K, L};
+    DTensor Cref;
+    contract(1.0, A.dense(), {I,K,L}, B.dense(), {L,J,K}, 0.0, Cref, {I,J});
+
+    BSTensor C;
+    contract(1.0, A, {I,K,L}, B, {L,J,K}, 0.0, C, {I,J});
+    CHECK(C.rank() == 2);
+    CHECK(C.flux() == 1);
+    CHECK(C.index(0) == i);
+    CHECK(C.index(1) == j);
+    DTensor Cd = C.dense();
+    for(auto x : Cref.range()) CHECK(Cd(x) == Approx(Cref(x)));
+
+    // accumulate, with C in the other order
+    BSTensor D;
+    contract(1.0, A, {I,K,L}, B, {L,J,K}, 0.0, D, {J,I});
+    contract(-0.5, B, {L,J,K}, A, {I,K,L}, 2.0, D, {J,I});
+    DTensor Dd = D.dense();
+    for(auto x : Cref.range()) CHECK(Dd(x[1],x[0]) == Approx(1.5*Cref(x)));
+
+    BSTensor E({i, j.conj()});
+    CHECK_THROWS(contract(1.0, A, {I,K,L}, B, {L,J,K}, 0.0, E, {I,J}));
+    }
+
+TEST_CASE("Sparse Contract")
+    {
+    typedef btas::SparseTensor<double> STensor;
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<double> dist(-1.,1.);
+    auto sparsify = [&](DTensor& X)
+        {
+        X.generate([&](){ double x = dist(gen); return std::abs(x) < 0.7 ? 0.0 : x; });
+        };
+
+    DTensor Ad(5,4,3), Bd(3,6,4);
+    sparsify(Ad);
+    sparsify(Bd);
+
+    STensor A(Ad), B(Bd);
+    CHECK(A.nnz() < A.size());
+    CHECK(A.compressed());
+    DTensor Ax = A.dense();
+    for(auto x : Ad.range()) CHECK(Ax(x) == Ad(x));
+    for(size_t n = 0; n < A.nnz(); ++n) CHECK(Ad(A.index(n)) == A.value(n));
+
+    enum {I, J, K, L};
+    DTensor Cref;
+    contract(1.0, Ad, {I,K,L}, Bd, {L,J,K}, 0.0, Cref, {I,J});
+
+    SECTION("Sparse x Dense")
+        {
+        DTensor C;
+        contract(1.0, A, {I,K,L}, Bd, {L,J,K}, 0.0, C, {I,J});
+        for(auto x : Cref.range()) CHECK(C(x) == Approx(Cref(x)));
+
+        // dense x sparse, accumulating into C in the other order
+        DTensor D;
+        contract(1.0, Ad, {I,K,L}, B, {L,J,K}, 0.0, D, {J,I});
+        contract(-0.5, B, {L,J,K}, Ad, {I,K,L}, 2.0, D, {J,I});
+        for(auto x : Cref.range()) CHECK(D(x[1],x[0]) == Approx(1.5*Cref(x)));
+
+        // a given C must have the rank and extents of its annotation
+        DTensor E(5,6,1), F(6,5);
+        CHECK_THROWS((contract(1.0, A, {I,K,L}, Bd, {L,J,K}, 0.0, E, {I,J})));
+        CHECK_THROWS((contract(1.0, A, {I,K,L}, Bd, {L,J,K}, 0.0, F, {I,J})));
+
+        // Hadamard index
+        DTensor Hd(5,4), H;
+        Hd.generate([&](){ return dist(gen); });
+        contract(1.0, A, {I,K,L}, Hd, {I,K}, 0.0, H, {I,L});
+        for(auto x : H.range())
+            {
+            double h = 0;
+            for(long k = 0; k < 4; ++k) h += Ad(x[0],k,x[1])*Hd(x[0],k);
+            CHECK(H(x) == Approx(h));
+            }
+        }
+
+    SECTION("Sparse x Sparse")
+        {
+        STensor C;
+        contract(1.0, A, {I,K,L}, B, {L,J,K}, 0.0, C, {I,J});
+        CHECK(C.compressed());
+        DTensor Cd = C.dense();
+        for(auto x : Cref.range()) CHECK(Cd(x) == Approx(Cref(x)));
+
+        contract(2.0, B, {L,J,K}, A, {I,K,L}, -1.0, C, {I,J});
+        Cd = C.dense();
+        for(auto x : Cref.range()) CHECK(Cd(x) == Approx(Cref(x)));
+
+        // a given C must have the rank and extents of its annotation
+        STensor E(Range(5)), F(Range(6,5));
+        CHECK_THROWS((contract(1.0, A, {I,K,L}, B, {L,J,K}, 0.0, E, {I,J})));
+        CHECK_THROWS((contract(1.0, A, {I,K,L}, B, {L,J,K}, 0.0, F, {I,J})));
+        }
+
+    SECTION("Insert")
+        {
+        STensor X(Range(2,3));
+        X.insert({1,2}, 1.0);
+        X.insert({0,1}, 2.0);
+        X.insert({1,2}, 0.5);
+        CHECK(!X.compressed());
+        X.compress();
+        CHECK(X.nnz() == 2);
+        CHECK(X({1,2}) == 1.5);
+        CHECK(X({0,0}) == 0.0);
+        }
+    }
+
+TEST_CASE("Diagonal Contract")
+    {
+    typedef btas::DiagonalTensor<double> Diagonal;
+    std::mt19937 gen(13);
+    std::uniform_real_distribution<double> dist(-1.,1.);
+    auto random = [&](){ return dist(gen); };
+
+    DTensor S(4,4), U(5,4), B(4,3,6);
+    S.generate(random);
+    U.generate(random);
+    B.generate(random);
+
+    Diagonal D(btas::diag(S));
+    CHECK(D.extent() == 4);
+    CHECK(D.value(2) == S(2,2));
+    DTensor Dd = D.dense();
+
+    enum {I, J, K, L};
+    SECTION("Scale an index")
+        {
+        DTensor Cref, C;
+        contract(1.0, U, {I,J}, Dd, {J,K}, 0.0, Cref, {I,K});
+        contract(1.0, U, {I,J}, D, {J,K}, 0.0, C, {I,K});
+        for(auto x : Cref.range()) CHECK(C(x) == Approx(Cref(x)));
+
+        // accumulate, with the diagonal in front and C permuted
+        DTensor Eref, E;
+        contract(1.0, Dd, {J,K}, B, {J,L,I}, 0.0, Eref, {I,K,L});
+        contract(1.0, D, {J,K}, B, {J,L,I}, 0.0, E, {I,K,L});
+        contract(-0.5, B, {J,L,I}, D, {J,K}, 2.0, E, {I,K,L});
+        for(auto x : Eref.range()) CHECK(E(x) == Approx(1.5*Eref(x)));
+        }
+
+    SECTION("Hadamard and summed indices")
+        {
+        DTensor C;
+        contract(1.0, D, {I,J}, U, {K,I}, 0.0, C, {I,J,K});
+        for(auto x : C.range()) CHECK(C(x) == Approx(x[0] == x[1] ? S(x[0],x[0])*U(x[2],x[0]) : 0.0));
+
+        DTensor E;
+        contract(1.0, D, {I,J}, U, {K,I}, 0.0, E, {K});
+        for(auto x : E.range())
+            {
+            double e = 0;
+            for(long i = 0; i < 4; ++i) e += S(i,i)*U(x[0],i);
+            CHECK(E(x) == Approx(e));
+            }
+        }
+
+    SECTION("Identity")
+        {
+        Diagonal Id = Diagonal::identity(4, 3.0);
+        CHECK(Id.is_identity());
+        DTensor C;
+        contract(1.0, Id, {I,J}, B, {J,K,L}, 0.0, C, {K,I,L});
+        CHECK(C.extent(1) == 4);
+        for(auto x : C.range()) CHECK(C(x) == Approx(3.0*B(x[1],x[0],x[2])));
+
+        DTensor Ref, E;
+        contract(1.0, Id.dense(), {I,J}, U, {K,J}, 0.0, Ref, {K,I});
+        contract(1.0, U, {K,J}, Id, {I,J}, 0.0, E, {K,I});
+        for(auto x : Ref.range()) CHECK(E(x) == Approx(Ref(x)));
+        }
+
+    CHECK_THROWS((contract(1.0, D, {I,J}, U, {J,K}, 0.0, Dd, {I,K})));
+
+    // a given C must have the extents of the diagonal and of B
+    DTensor W(5,3), X(4,4);
+    CHECK_THROWS((contract(1.0, U, {I,J}, D, {J,K}, 0.0, W, {I,K})));
+    CHECK_THROWS((contract(1.0, U, {I,J}, D, {J,K}, 0.0, X, {I,K})));
+
+    // so must every index of a given C appear in A or B
+    DTensor Y(5,4);
+    CHECK_THROWS((contract(1.0, U, {I,J}, D, {J,K}, 0.0, Y, {I,L})));
+    }
+
+TEST_CASE("Contract Profile")
+    {
+    btas::profile_reset();
+    btas::profile_enable();
+
+    DTensor A(3,4,5), B(6,4), C;
+    fillEls(A);
+    fillEls(B);
+    enum {I, J, K, L};
+    for(int n = 0; n < 3; ++n) contract(1.0, A, {I,K,J}, B, {L,K}, 0.0, C, {J,L,I});
+    contract(1.0, A, {I,K,J}, B, {L,K}, 0.0, C, {J,L,I});
+    btas::profile_enable(false);
+    contract(1.0, A, {I,K,J}, B, {L,K}, 0.0, C, {J,L,I});
+
+    auto stats = btas::profile_stats();
+    REQUIRE(stats.size() == 1);
+    const auto& s = stats[0];
+    CHECK(s.signature == "A(0:3,2:4,1:5) * B(3:6,2:4) -> C(1,3,0)");
+    CHECK(s.calls == 4);
+    CHECK(s.flops == 4*2.*3*4*5*6);
+    CHECK(s.bytes > 0);
+    double phases = 0;
+    for(auto t : s.seconds) phases += t;
+    CHECK(phases <= s.total);
+
+    std::ostringstream report, trace;
+    btas::profile_report(report);
+    btas::profile_write_chrome_trace(trace);
+    CHECK(report.str().find(s.signature) != std::string::npos);
+    CHECK(trace.str().find("\"traceEvents\"") != std::string::npos);
+
+    btas::profile_reset();
+    CHECK(btas::profile_stats().empty());
+    }
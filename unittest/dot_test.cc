@@ -52,7 +52,7 @@ TEST_CASE("Tensor Dot")
         const auto fres = dot(Tf,Tf);
         float fcheck = 0.;
         for(const auto& el : Tf) fcheck += el*el;
-        CHECK(fabs(fcheck-fres) < 1E-10);
+        CHECK(fabs(fcheck-fres) < 1E-5*fabs(fcheck));
 
         Tensor<float> Uf(7,2,9);
         REQUIRE(Uf.size() == Tf.size());
@@ -63,7 +63,7 @@ TEST_CASE("Tensor Dot")
             {
             fcheck += Tf[i]*Uf[i];
             }
-        CHECK(fabs(fcheck-res) < 1E-10);
+        CHECK(fabs(fcheck-res) < 1E-5*fabs(fcheck));
         }
 
     SECTION("Complex Double Dot")
@@ -83,7 +83,7 @@ TEST_CASE("Tensor Dot")
         const auto cres = dot(Tc,Tc);
         std::complex<float> ccheck = 0.;
         for(const auto& el : Tc) ccheck += std::conj(el)*el;
-        CHECK(std::abs(ccheck-cres) < 1E-10);
+        CHECK(std::abs(ccheck-cres) < 1E-5*std::abs(ccheck));
         }
 
     }
@@ -0,0 +1,155 @@
+#include "test.h"
+#include <complex>
+#include <random>
+#include <vector>
+
+#include "btas/tensor.h"
+#include "btas/generic/contract.h"
+#include "btas/generic/contract_diagonal.h"
+#include "btas/generic/factorize.h"
+
+using std::cout;
+using std::endl;
+using namespace btas;
+
+using DTensor = Tensor<double>;
+using ZTensor = Tensor<std::complex<double>>;
+
+static void
+fillRandom(DTensor& T, unsigned seed)
+    {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> dist(-1.,1.);
+    T.generate([&](){ return dist(gen); });
+    }
+
+static double
+maxDiff(const DTensor& X, const DTensor& Y)
+    {
+    double d = 0;
+    for(auto i : X.range()) d = std::max(d,std::abs(X(i)-Y(i)));
+    return d;
+    }
+
+enum {i,j,k,l,b,c};
+
+// U(i,k,b) * S(b) * V(b,j)
+static DTensor
+svdProduct(const DTensor& U, const DTensor& S, const DTensor& V)
+    {
+    DTensor US, R;
+    contract(1.0,U,{i,k,b},DiagonalTensor<double>(S),{b,c},0.0,US,{i,k,c});
+    contract(1.0,US,{i,k,c},V,{c,j},0.0,R,{i,j,k});
+    return R;
+    }
+
+TEST_CASE("Tensor Factorization")
+    {
+    DTensor A(4,7,3);
+    fillRandom(A,1);
+
+    SECTION("SVD")
+        {
+        DTensor U, S, V;
+        svd(A,{i,j,k},U,{i,k,b},S,V,{b,j});
+        CHECK(U.extent(0) == 4);
+        CHECK(U.extent(1) == 3);
+        CHECK(U.extent(2) == 7);
+        CHECK(S.size() == 7);
+        for(size_t n = 1; n < S.size(); ++n) CHECK(S(n-1) >= S(n));
+        CHECK(maxDiff(svdProduct(U,S,V),A) < 1e-12);
+
+        DTensor UU, VV;
+        contract(1.0,U,{i,k,b},U,{i,k,c},0.0,UU,{b,c});
+        contract(1.0,V,{b,j},V,{c,j},0.0,VV,{b,c});
+        for(auto x : UU.range()) CHECK(std::abs(UU(x) - (x[0] == x[1] ? 1.0 : 0.0)) < 1e-12);
+        for(auto x : VV.range()) CHECK(std::abs(VV(x) - (x[0] == x[1] ? 1.0 : 0.0)) < 1e-12);
+        }
+
+    SECTION("Truncated SVD")
+        {
+        // A of rank 2
+        DTensor X(4,3,2), Y(2,7), Ar;
+        fillRandom(X,2);
+        fillRandom(Y,3);
+        contract(1.0,X,{i,k,b},Y,{b,j},0.0,Ar,{i,j,k});
+
+        DTensor U, S, V;
+        double err = truncated_svd(Ar,{i,j,k},U,{i,k,b},S,V,{b,j},svd_truncation(1e-10));
+        CHECK(S.size() == 2);
+        CHECK(err < 1e-20);
+        CHECK(maxDiff(svdProduct(U,S,V),Ar) < 1e-12);
+
+        DTensor Sall, U1, S1, V1;
+        svd(A,{i,j,k},U,{i,k,b},Sall,V,{b,j});
+        err = truncated_svd(A,{i,j,k},U1,{i,k,b},S1,V1,{b,j},svd_truncation(0.0,3));
+        CHECK(S1.size() == 3);
+        double discarded = 0;
+        for(size_t n = 3; n < Sall.size(); ++n) discarded += Sall(n)*Sall(n);
+        CHECK(err == Approx(discarded));
+        }
+
+    SECTION("Randomized SVD")
+        {
+        DTensor X(20,10,3), Y(3,30), Ar;
+        fillRandom(X,4);
+        fillRandom(Y,5);
+        contract(1.0,X,{i,k,b},Y,{b,j},0.0,Ar,{i,j,k});
+
+        DTensor U, S, V;
+        randomized_svd(Ar,{i,j,k},U,{i,k,b},S,V,{b,j},3);
+        CHECK(S.size() == 3);
+        CHECK(maxDiff(svdProduct(U,S,V),Ar) < 1e-10);
+        }
+
+    SECTION("QR")
+        {
+        DTensor Q, R, QR;
+        qr(A,{i,j,k},Q,{i,k,b},R,{b,j});
+        CHECK(Q.extent(2) == 7);
+        contract(1.0,Q,{i,k,b},R,{b,j},0.0,QR,{i,j,k});
+        CHECK(maxDiff(QR,A) < 1e-12);
+        for(auto x : R.range()) if(x[1] < x[0]) CHECK(R(x) == 0.0);
+
+        // more columns than rows, with the bond first in Q
+        DTensor Q2, R2, QR2;
+        qr(A,{i,j,k},Q2,{b,i},R2,{j,b,k});
+        CHECK(Q2.extent(0) == 4);
+        contract(1.0,Q2,{b,i},R2,{j,b,k},0.0,QR2,{i,j,k});
+        CHECK(maxDiff(QR2,A) < 1e-12);
+        }
+
+    SECTION("Hermitian eigenproblem")
+        {
+        // H((i,j),(k,l)) = X * X^T
+        DTensor X(3,2,5), H, W, V, HV, VW;
+        fillRandom(X,6);
+        contract(1.0,X,{i,j,b},X,{k,l,b},0.0,H,{i,j,k,l});
+        eigh(H,{i,j,k,l},W,V,{i,j,c});
+        CHECK(W.size() == 6);
+        for(size_t n = 1; n < W.size(); ++n) CHECK(W(n-1) <= W(n));
+        contract(1.0,H,{i,j,k,l},V,{k,l,c},0.0,HV,{i,j,c});
+        contract(1.0,V,{i,j,c},DiagonalTensor<double>(W),{c,b},0.0,VW,{i,j,b});
+        CHECK(maxDiff(HV,VW) < 1e-12);
+        }
+
+    SECTION("Complex SVD")
+        {
+        ZTensor Z(5,3);
+        std::mt19937 gen(7);
+        std::uniform_real_distribution<double> dist(-1.,1.);
+        Z.generate([&](){ return std::complex<double>(dist(gen),dist(gen)); });
+        ZTensor U, V;
+        DTensor S;
+        svd(Z,{i,j},U,{i,b},S,V,{b,j});
+        CHECK(S.size() == 3);
+        for(auto x : Z.range())
+            {
+            std::complex<double> z = 0;
+            for(long n = 0; n < 3; ++n) z += U(x[0],n)*S(n)*V(n,x[1]);
+            CHECK(std::abs(z-Z(x)) < 1e-12);
+            }
+        }
+
+    CHECK_THROWS(svd(A,{i,j,k},A,{i,b},A,A,{b,j}));
+    }
@@ -0,0 +1,287 @@
+#include "test.h"
+#include <random>
+#include <vector>
+
+#include "btas/tensor.h"
+#include "btas/generic/gemm_impl.h"
+#include "btas/generic/gemm_batch.h"
+#include "btas/generic/dot_impl.h"
+#include "btas/generic/axpy_impl.h"
+#include "btas/generic/scal_impl.h"
+#include "btas/generic/gemv_impl.h"
+
+using std::cout;
+using std::endl;
+using namespace btas;
+
+template <typename T>
+T
+randomValue()
+    {
+    static std::mt19937 rng(std::time(NULL));
+    static auto dist = std::uniform_real_distribution<double>{-1., 1.};
+    return T(dist(rng));
+    }
+
+template <>
+std::complex<double>
+randomValue()
+    {
+    return std::complex<double>(randomValue<double>(),randomValue<double>());
+    }
+
+// element (i,j) of op(X), X row-major with leading dimension ld
+template <typename T>
+T
+opElem(CBLAS_TRANSPOSE t, const std::vector<T>& X, size_t ld, size_t i, size_t j)
+    {
+    if(t == CblasNoTrans) return X[i*ld+j];
+    if(t == CblasTrans) return X[j*ld+i];
+    return impl::conj(X[j*ld+i]);
+    }
+
+// checks gemm_impl against a naive triple loop for all nine op(A),op(B) combinations
+template <typename T>
+void
+checkGemm(size_t M, size_t N, size_t K, double tol)
+    {
+    const CBLAS_TRANSPOSE ops[] = { CblasNoTrans, CblasTrans, CblasConjTrans };
+    const T alpha = randomValue<T>(),
+            beta = randomValue<T>();
+    for(auto ta : ops)
+    for(auto tb : ops)
+        {
+        // pad leading dimensions to check that they are honored
+        const size_t lda = (ta == CblasNoTrans ? K : M) + 3,
+                     ldb = (tb == CblasNoTrans ? N : K) + 1,
+                     ldc = N + 2;
+        std::vector<T> A((ta == CblasNoTrans ? M : K)*lda),
+                       B((tb == CblasNoTrans ? K : N)*ldb),
+                       C(M*ldc);
+        for(auto& x : A) x = randomValue<T>();
+        for(auto& x : B) x = randomValue<T>();
+        for(auto& x : C) x = randomValue<T>();
+        auto Cref = C;
+
+        gemm_impl<true>::call(CblasRowMajor, ta, tb, M, N, K, alpha, A.data(), lda, B.data(), ldb, beta, C.data(), ldc);
+
+        double maxdiff = 0;
+        for(size_t i = 0; i < M; ++i)
+        for(size_t j = 0; j < N; ++j)
+            {
+            T val = 0;
+            for(size_t k = 0; k < K; ++k) val += opElem(ta,A,lda,i,k)*opElem(tb,B,ldb,k,j);
+            val = alpha*val + beta*Cref[i*ldc+j];
+            maxdiff = std::max(maxdiff,double(std::abs(val-C[i*ldc+j])));
+            }
+        CHECK(maxdiff < tol);
+        // padding of C must stay untouched
+        for(size_t i = 0; i < M; ++i)
+        for(size_t j = N; j < ldc; ++j)
+            {
+            CHECK(C[i*ldc+j] == Cref[i*ldc+j]);
+            }
+        }
+    }
+
+TEST_CASE("Blocked Gemm")
+    {
+
+    SECTION("Double")
+        {
+        checkGemm<double>(7,5,3,1E-12);
+        checkGemm<double>(131,45,300,1E-10);
+        }
+
+    SECTION("Float")
+        {
+        checkGemm<float>(150,70,270,1E-2);
+        }
+
+    SECTION("Complex Double")
+        {
+        checkGemm<std::complex<double>>(67,33,140,1E-10);
+        }
+
+    SECTION("Tensor Gemm")
+        {
+        Tensor<double> A(4,5,6), B(6,7), C(4,5,7);
+        A.generate([](){ return randomValue<double>(); });
+        B.generate([](){ return randomValue<double>(); });
+        gemm(CblasNoTrans,CblasNoTrans,1.0,A,B,0.0,C);
+        REQUIRE(C.rank() == 3);
+        double maxdiff = 0;
+        for(size_t i = 0; i < 4; ++i)
+        for(size_t j = 0; j < 5; ++j)
+        for(size_t l = 0; l < 7; ++l)
+            {
+            double val = 0;
+            for(size_t k = 0; k < 6; ++k) val += A(i,j,k)*B(k,l);
+            maxdiff = std::max(maxdiff,std::abs(val-C(i,j,l)));
+            }
+        CHECK(maxdiff < 1E-12);
+        }
+
+    }
+
+// checks gemm_batch against one gemm_impl call per matrix, for all nine op(A),op(B) combinations
+template <typename T>
+void
+checkGemmBatch(CBLAS_ORDER order, size_t M, size_t N, size_t K, size_t batch, double tol)
+    {
+    const CBLAS_TRANSPOSE ops[] = { CblasNoTrans, CblasTrans, CblasConjTrans };
+    const T alpha = randomValue<T>(),
+            beta = randomValue<T>();
+    const bool row = (order == CblasRowMajor);
+    for(auto ta : ops)
+    for(auto tb : ops)
+        {
+        const size_t lda = (row == (ta == CblasNoTrans) ? K : M) + 1,
+                     ldb = (row == (tb == CblasNoTrans) ? N : K) + 2,
+                     ldc = (row ? N : M) + 1;
+        // matrices of the batch are apart by more than their size
+        const long sa = lda*std::max(M,K) + 3,
+                   sb = ldb*std::max(N,K) + 1,
+                   sc = ldc*std::max(M,N) + 2;
+        std::vector<T> A(sa*batch), B(sb*batch), C(sc*batch);
+        for(auto& x : A) x = randomValue<T>();
+        for(auto& x : B) x = randomValue<T>();
+        for(auto& x : C) x = randomValue<T>();
+        auto Cref = C;
+
+        gemm_batch(order, ta, tb, M, N, K, alpha, A.data(), lda, sa, B.data(), ldb, sb, beta, C.data(), ldc, sc, batch);
+        for(size_t b = 0; b < batch; ++b)
+            gemm_impl<true>::call(order, ta, tb, M, N, K, alpha, A.data()+b*sa, lda, B.data()+b*sb, ldb, beta, Cref.data()+b*sc, ldc);
+
+        double maxdiff = 0;
+        for(size_t i = 0; i < C.size(); ++i) maxdiff = std::max(maxdiff,double(std::abs(C[i]-Cref[i])));
+        CHECK(maxdiff < tol);
+        }
+    }
+
+TEST_CASE("Batched Gemm")
+    {
+
+    SECTION("Small")
+        {
+        checkGemmBatch<double>(CblasRowMajor,3,4,2,7,1E-12);
+        checkGemmBatch<double>(CblasColMajor,3,4,2,7,1E-12);
+        checkGemmBatch<std::complex<double>>(CblasRowMajor,5,3,4,6,1E-12);
+        checkGemmBatch<float>(CblasRowMajor,1,6,3,4,1E-5);
+        }
+
+    SECTION("Large")
+        {
+        checkGemmBatch<double>(CblasRowMajor,20,30,10,3,1E-11);
+        checkGemmBatch<double>(CblasColMajor,20,30,10,3,1E-11);
+        }
+
+    }
+
+// gemm of 16-bit data must match a float reference computed from the same rounded inputs, up to the
+// rounding of the result, i.e. products are summed in float rather than in T
+template <typename T>
+void
+checkReducedGemm(CBLAS_TRANSPOSE ta, size_t M, size_t N, size_t K)
+    {
+    const size_t lda = (ta == CblasNoTrans ? K : M);
+    std::vector<T> A(M*K), B(K*N), C(M*N);
+    for(auto& x : A) x = randomValue<float>();
+    for(auto& x : B) x = randomValue<float>();
+    for(auto& x : C) x = randomValue<float>();
+    std::vector<float> Af(A.begin(),A.end()), Bf(B.begin(),B.end()), Cf(C.begin(),C.end());
+
+    gemm_impl<true>::call(CblasRowMajor, ta, CblasNoTrans, M, N, K, 0.5f, A.data(), lda, B.data(), N, 2.0f, C.data(), N);
+    gemm_impl<true>::call(CblasRowMajor, ta, CblasNoTrans, M, N, K, 0.5f, Af.data(), lda, Bf.data(), N, 2.0f, Cf.data(), N);
+
+    const double eps = std::numeric_limits<T>::epsilon();
+    double maxdiff = 0;
+    for(size_t i = 0; i < C.size(); ++i) maxdiff = std::max(maxdiff,std::abs(double(C[i])-Cf[i])/(std::abs(Cf[i])+1));
+    CHECK(maxdiff <= eps);
+    }
+
+TEST_CASE("Half Precision")
+    {
+    // CBLAS headers of OpenBLAS declare a ::bfloat16 of their own
+    typedef btas::bfloat16 bfloat16;
+
+    SECTION("Conversion")
+        {
+        // exactly representable values, ties to even, overflow, subnormals
+        CHECK(float(half(1.5f)) == 1.5f);
+        CHECK(float(half(-2048.f)) == -2048.f);
+        CHECK(float(half(2049.f)) == 2048.f);
+        CHECK(float(half(2051.f)) == 2052.f);
+        CHECK(float(half(65504.f)) == 65504.f);
+        CHECK(std::isinf(float(half(1E6f))));
+        CHECK(std::isnan(float(half(std::nanf("")))));
+        CHECK(float(half(std::ldexp(1.f,-24))) == std::ldexp(1.f,-24));
+        CHECK(float(half(std::ldexp(1.f,-26))) == 0.f);
+        CHECK(half(65504.f).bits() == std::numeric_limits<half>::max().bits());
+        CHECK(float(bfloat16(1.5f)) == 1.5f);
+        CHECK(float(bfloat16(257.f)) == 256.f);
+        CHECK(float(bfloat16(1E30f)) == Approx(1E30f).epsilon(1E-2));
+        CHECK(float(-bfloat16(3.f)) == -3.f);
+        half h = 1.f;
+        h += 0.5;
+        h *= 2;
+        CHECK(float(h) == 3.f);
+        }
+
+    SECTION("Gemm")
+        {
+        checkReducedGemm<half>(CblasNoTrans,5,7,3);
+        checkReducedGemm<half>(CblasNoTrans,70,90,600);
+        checkReducedGemm<half>(CblasTrans,33,45,200);
+        checkReducedGemm<bfloat16>(CblasNoTrans,70,90,600);
+        }
+
+    SECTION("Level1")
+        {
+        // sum of 4096 ones is exact in float, but stalls at 2048 if accumulated in half
+        std::vector<half> X(4096,half(1.f)), Y(4096,half(1.f));
+        CHECK(dot(X.size(),X.data(),1,Y.data(),1) == 4096.f);
+        CHECK(dot(X.size()/2,X.data(),2,Y.data(),2) == 2048.f);
+
+        Tensor<bfloat16> U(3,40), V(3,40);
+        U.generate([](){ return bfloat16(randomValue<float>()); });
+        V.generate([](){ return bfloat16(randomValue<float>()); });
+        Tensor<bfloat16> W(V);
+        axpy(0.75,U,W);
+        scal(2,W);
+        double maxdiff = 0;
+        for(size_t i = 0; i < U.size(); ++i)
+            {
+            const float ref = 2*(float(V[i])+0.75f*float(U[i]));
+            maxdiff = std::max(maxdiff,double(std::abs(float(W[i])-ref)));
+            }
+        CHECK(maxdiff < 4*std::numeric_limits<bfloat16>::epsilon());
+
+        Tensor<half> P(4,6), Q(6,5), R(4,5);
+        P.generate([](){ return half(randomValue<float>()); });
+        Q.generate([](){ return half(randomValue<float>()); });
+        gemm(CblasNoTrans,CblasNoTrans,1.0,P,Q,0.0,R);
+        REQUIRE(R.rank() == 2);
+        for(size_t i = 0; i < 4; ++i)
+        for(size_t j = 0; j < 5; ++j)
+            {
+            float val = 0;
+            for(size_t k = 0; k < 6; ++k) val += float(P(i,k))*float(Q(k,j));
+            CHECK(std::abs(float(R(i,j))-val) <= std::numeric_limits<half>::epsilon()*std::abs(val));
+            }
+
+        // transposed GEMV: y = P^T x, summed in float
+        Tensor<half> x(4), y(6);
+        x.generate([](){ return half(randomValue<float>()); });
+        y.generate([](){ return half(randomValue<float>()); });
+        Tensor<half> y0(y);
+        gemv(CblasTrans,2.0,P,x,-1.0,y);
+        for(size_t j = 0; j < 6; ++j)
+            {
+            float val = -float(y0(j));
+            for(size_t i = 0; i < 4; ++i) val += 2*float(P(i,j))*float(x(i));
+            CHECK(std::abs(float(y(j))-val) <= std::numeric_limits<half>::epsilon()*std::abs(val));
+            }
+        }
+
+    }
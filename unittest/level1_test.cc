@@ -0,0 +1,117 @@
+#include "test.h"
+#include <random>
+#include <vector>
+
+#include "btas/tensor.h"
+#include "btas/generic/scal_impl.h"
+#include "btas/generic/axpy_impl.h"
+#include "btas/generic/dot_impl.h"
+#include "btas/generic/gemm_blocked.h"
+
+using std::cout;
+using std::endl;
+using namespace btas;
+
+template <typename T>
+struct Random
+    {
+    static T
+    get()
+        {
+        static std::mt19937 rng(std::time(NULL));
+        static auto dist = std::uniform_real_distribution<double>{-1., 1.};
+        return T(dist(rng));
+        }
+    };
+
+template <typename T>
+struct Random<std::complex<T>>
+    {
+    static std::complex<T>
+    get() { return std::complex<T>(Random<T>::get(),Random<T>::get()); }
+    };
+
+template <typename T>
+double
+maxDiff(const std::vector<T>& x, const std::vector<T>& y)
+    {
+    double d = 0;
+    for(size_t i = 0; i < x.size(); ++i) d = std::max(d,double(std::abs(x[i]-y[i])));
+    return d;
+    }
+
+// compares scal, axpy, dotc and dotu against plain loops for
+// lengths covering the vector tails, with unit and non-unit strides
+template <typename T>
+void
+checkLevel1(double tol)
+    {
+    for(long inc = 1; inc <= 2; ++inc)
+    for(unsigned long n = 0; n < 70; n += (n < 20 ? 1 : 7))
+        {
+        std::vector<T> x(n*inc), y(n*inc);
+        for(auto& v : x) v = Random<T>::get();
+        for(auto& v : y) v = Random<T>::get();
+        const T alpha = Random<T>::get();
+
+        auto xs = x;
+        scal(n,alpha,xs.data(),inc);
+        auto xr = x;
+        for(unsigned long i = 0; i < n; ++i) xr[i*inc] *= alpha;
+        CHECK(maxDiff(xs,xr) < tol);
+
+        auto ys = y;
+        axpy(n,alpha,const_cast<const T*>(x.data()),inc,ys.data(),inc);
+        auto yr = y;
+        for(unsigned long i = 0; i < n; ++i) yr[i*inc] += alpha*x[i*inc];
+        CHECK(maxDiff(ys,yr) < tol);
+
+        if(n == 0) continue;
+        T dc = 0, du = 0;
+        for(unsigned long i = 0; i < n; ++i)
+            {
+            dc += impl::conj(x[i*inc])*y[i*inc];
+            du += x[i*inc]*y[i*inc];
+            }
+        CHECK(std::abs(dotc(n,const_cast<const T*>(x.data()),inc,y.data(),inc)-dc) < tol);
+        CHECK(std::abs(dotu(n,const_cast<const T*>(x.data()),inc,y.data(),inc)-du) < tol);
+        }
+    }
+
+TEST_CASE("Level1 Kernels")
+    {
+
+    SECTION("Float")
+        {
+        checkLevel1<float>(1E-4);
+        }
+
+    SECTION("Double")
+        {
+        checkLevel1<double>(1E-12);
+        }
+
+    SECTION("Complex Float")
+        {
+        checkLevel1<std::complex<float>>(1E-4);
+        }
+
+    SECTION("Complex Double")
+        {
+        checkLevel1<std::complex<double>>(1E-12);
+        }
+
+    SECTION("Tensor Scal Axpy")
+        {
+        Tensor<double> X(3,5,7), Y(3,5,7);
+        X.generate([](){ return Random<double>::get(); });
+        Y.generate([](){ return Random<double>::get(); });
+        Tensor<double> Z(Y);
+        axpy(2.0,X,Z);
+        scal(0.5,Z);
+        double d = 0;
+        for(unsigned long i = 0; i < X.size(); ++i) d = std::max(d,std::abs(Z[i]-0.5*(Y[i]+2.0*X[i])));
+        CHECK(d < 1E-12);
+        }
+
+    }
@@ -0,0 +1,107 @@
+#include "test.h"
+#include <vector>
+
+#include "btas/tensor.h"
+#include "btas/generic/contract_network.h"
+
+using std::cout;
+using std::endl;
+using namespace btas;
+
+using DTensor = Tensor<double>;
+
+static void
+fillRandom(DTensor& T, double seed)
+    {
+    double v = seed;
+    T.generate([&](){ v += 0.731; return std::sin(v); });
+    }
+
+static double
+maxDiff(const DTensor& X, const DTensor& Y)
+    {
+    double d = 0;
+    for(auto i : X.range()) d = std::max(d,std::abs(X(i)-Y(i)));
+    return d;
+    }
+
+TEST_CASE("Contract Network")
+    {
+    enum {i,j,k,l,m,n};
+
+    DTensor A(4,30), B(30,30), C(30,5), D(5,6);
+    fillRandom(A,0.1);
+    fillRandom(B,0.2);
+    fillRandom(C,0.3);
+    fillRandom(D,0.4);
+
+    // reference by pairwise contractions from the left
+    DTensor AB, ABC, R;
+    contract(1.0,A,{i,j},B,{j,k},0.0,AB,{i,k});
+    contract(1.0,AB,{i,k},C,{k,l},0.0,ABC,{i,l});
+    contract(1.0,ABC,{i,l},D,{l,m},0.0,R,{i,m});
+
+    SECTION("Chain")
+        {
+        DTensor X;
+        contract_network(1.0,{&A,&B,&C,&D},{{i,j},{j,k},{k,l},{l,m}},0.0,X,{i,m});
+        CHECK(maxDiff(X,R) < 1E-10);
+
+        DTensor Y;
+        contract_network(1.0,{&A,&B,&C,&D},{{i,j},{j,k},{k,l},{l,m}},0.0,Y,{m,i},path_greedy);
+        for(long a = 0; a < 4; ++a)
+        for(long b = 0; b < 6; ++b)
+            {
+            CHECK(std::abs(Y(b,a)-R(a,b)) < 1E-10);
+            }
+
+        // alpha and beta apply to the result
+        DTensor Z(R);
+        contract_network(2.0,{&A,&B,&C,&D},{{i,j},{j,k},{k,l},{l,m}},-1.0,Z,{i,m});
+        CHECK(maxDiff(Z,R) < 1E-10);
+        }
+
+    SECTION("Path Search")
+        {
+        std::vector<varray<int>> a = {{i,j},{j,k},{k,l},{l,m}};
+        std::vector<varray<size_t>> e = {{4,30},{30,30},{30,5},{5,6}};
+        const varray<int> out = {i,m};
+        const auto optimal = find_contraction_path(e,a,out,path_optimal);
+        const auto greedy  = find_contraction_path(e,a,out,path_greedy);
+        REQUIRE(optimal.steps.size() == 3);
+        REQUIRE(greedy.steps.size() == 3);
+        // the cheapest order contracts A into B first: 4*30*30 + 4*30*5 + 4*5*6
+        CHECK(optimal.flops == 4*30*30+4*30*5+4*5*6);
+        CHECK(optimal.flops <= greedy.flops);
+        CHECK(optimal.steps.back().first >= 4);
+
+        // the intermediates of the order chosen under a memory limit stay below it
+        const auto limited = find_contraction_path(e,a,out,path_optimal,125.0);
+        CHECK(limited.peak_size <= 125.0);
+        CHECK(limited.steps.size() == 3);
+        }
+
+    SECTION("Explicit Path")
+        {
+        // ((A (B C)) D)
+        contraction_path p;
+        p.steps = {{1,2},{0,4},{5,3}};
+        std::vector<const DTensor*> t = {&A,&B,&C,&D};
+        std::vector<varray<int>> a = {{i,j},{j,k},{k,l},{l,m}};
+        DTensor X;
+        contract_network(1.0,t,a,0.0,X,varray<int>{i,m},p);
+        CHECK(maxDiff(X,R) < 1E-10);
+        }
+
+    SECTION("Single Tensor")
+        {
+        DTensor X;
+        contract_network(3.0,{&A},{{i,j}},0.0,X,{j,i});
+        for(long a = 0; a < 4; ++a)
+        for(long b = 0; b < 30; ++b)
+            {
+            CHECK(X(b,a) == 3.0*A(a,b));
+            }
+        }
+
+    }
@@ -0,0 +1,133 @@
+#include "test.h"
+#include <map>
+#include <vector>
+
+#include "btas/tensor.h"
+#include "btas/optimize/contract.h"
+
+using CTensor = btas::Tensor<double,btas::RangeNd<CblasColMajor>>;
+
+// C(aC) = alpha * A(aA) * B(aB) + beta * C(aC) by an explicit sum over all index values
+static void
+refColContract(double alpha, const CTensor& A, const std::vector<int>& aA,
+               const CTensor& B, const std::vector<int>& aB,
+               double beta, CTensor& C, const std::vector<int>& aC)
+    {
+    std::map<int,long> ext;
+    for(size_t d = 0; d < aA.size(); ++d) ext[aA[d]] = A.extent(d);
+    for(size_t d = 0; d < aB.size(); ++d) ext[aB[d]] = B.extent(d);
+    for(auto& x : C) x *= beta;
+    std::map<int,long> val;
+    for(auto& e : ext) val[e.first] = 0;
+    btas::varray<long> iA(aA.size()), iB(aB.size()), iC(aC.size());
+    while(true)
+        {
+        for(size_t d = 0; d < aA.size(); ++d) iA[d] = val[aA[d]];
+        for(size_t d = 0; d < aB.size(); ++d) iB[d] = val[aB[d]];
+        for(size_t d = 0; d < aC.size(); ++d) iC[d] = val[aC[d]];
+        C(iC) += alpha*A(iA)*B(iB);
+        auto it = val.begin();
+        for(; it != val.end(); ++it)
+            {
+            if(++it->second < ext[it->first]) break;
+            it->second = 0;
+            }
+        if(it == val.end()) break;
+        }
+    }
+
+// contracts by contract_colmajor into a filled C and compares with refColContract
+static double
+checkColContract(const std::vector<long>& extA, const std::vector<int>& aA,
+                 const std::vector<long>& extB, const std::vector<int>& aB,
+                 const std::vector<int>& aC)
+    {
+    std::map<int,long> ext;
+    for(size_t d = 0; d < aA.size(); ++d) ext[aA[d]] = extA[d];
+    for(size_t d = 0; d < aB.size(); ++d) ext[aB[d]] = extB[d];
+    btas::varray<long> extC(aC.size());
+    for(size_t d = 0; d < aC.size(); ++d) extC[d] = ext[aC[d]];
+
+    CTensor A, B, C;
+    A.resize(btas::varray<long>(extA.begin(),extA.end()));
+    B.resize(btas::varray<long>(extB.begin(),extB.end()));
+    C.resize(extC);
+    A.generate([](){ static double v = 0; v += 0.37; return std::sin(v); });
+    B.generate([](){ static double v = 0; v += 0.61; return std::cos(v); });
+    C.generate([](){ static double v = 0; v += 0.11; return std::sin(v); });
+    CTensor R(C);
+
+    btas::contract_colmajor(0.7,A,btas::varray<int>(aA.begin(),aA.end()),B,btas::varray<int>(aB.begin(),aB.end()),
+                            -0.5,C,btas::varray<int>(aC.begin(),aC.end()));
+    refColContract(0.7,A,aA,B,aB,-0.5,R,aC);
+    double d = 0;
+    for(auto i : C.range()) d = std::max(d,std::abs(C(i)-R(i)));
+    return d;
+    }
+
+TEST_CASE("Column Major Contract")
+    {
+    enum {a,b,c,d,e,f};
+
+    SECTION("Rank 2 and 3")
+        {
+        CHECK(checkColContract({3,4},{a,b},{4,5},{b,c},{a,c}) < 1E-12);
+        CHECK(checkColContract({4,3},{b,a},{5,4},{c,b},{c,a}) < 1E-12);
+        CHECK(checkColContract({3,4,5},{a,b,c},{4,6},{b,d},{a,d,c}) < 1E-12);
+        CHECK(checkColContract({3,4,5},{a,b,c},{6,5},{d,c},{a,b,d}) < 1E-12);
+        CHECK(checkColContract({3,4,5},{a,b,c},{3,6,5},{a,d,c},{b,d}) < 1E-12);
+        }
+
+    SECTION("Rank 4 and 5")
+        {
+        // DMRG-like environment updates
+        CHECK(checkColContract({3,4,5,2},{a,b,c,d},{5,2,6},{c,d,e},{a,b,e}) < 1E-12);
+        CHECK(checkColContract({3,4,5,2},{a,b,c,d},{4,5,6,3},{b,c,e,f},{a,d,e,f}) < 1E-12);
+        CHECK(checkColContract({3,4,2,5,2},{a,b,c,d,e},{5,4,6},{d,b,f},{a,f,c,e}) < 1E-12);
+        CHECK(checkColContract({2,3,4,5},{a,b,c,d},{5,3},{d,b},{c,a}) < 1E-12);
+        }
+
+    SECTION("Operators")
+        {
+        CTensor A(3,4,5), B(4,6), C(3,6,5), R(3,6,5);
+        A.generate([](){ static double v = 0; v += 0.37; return std::sin(v); });
+        B.generate([](){ static double v = 0; v += 0.61; return std::cos(v); });
+        R.fill(0.0);
+        contract(1.0,A,{a,b,c},B,{b,d},0.0,C,{a,d,c});
+        refColContract(1.0,A,{a,b,c},B,{b,d},0.0,R,{a,d,c});
+        double x = 0;
+        for(auto i : C.range()) x = std::max(x,std::abs(C(i)-R(i)));
+        CHECK(x < 1E-12);
+        }
+
+    SECTION("Rank-specific entry points")
+        {
+        CTensor A(3,4,5), B(4,6), M(3,4), C(3,6,5), R(3,6,5), D(4,4), S(4,4);
+        A.generate([](){ static double v = 0; v += 0.37; return std::sin(v); });
+        B.generate([](){ static double v = 0; v += 0.61; return std::cos(v); });
+        M.generate([](){ static double v = 0; v += 0.23; return std::cos(v); });
+        R.fill(0.0);
+        S.fill(0.0);
+        const btas::varray<int> abc = {a,b,c}, bd = {b,d}, adc = {a,d,c}, ab = {a,b}, ae = {a,e}, be = {b,e};
+        btas::contract_323(1.0,A,abc,B,bd,0.0,C,adc);
+        refColContract(1.0,A,{a,b,c},B,{b,d},0.0,R,{a,d,c});
+        double x = 0;
+        for(auto i : C.range()) x = std::max(x,std::abs(C(i)-R(i)));
+        CHECK(x < 1E-12);
+
+        btas::contract_222(1.0,M,ab,M,ae,0.0,D,be);
+        refColContract(1.0,M,{a,b},M,{a,e},0.0,S,{b,e});
+        x = 0;
+        for(auto i : D.range()) x = std::max(x,std::abs(D(i)-S(i)));
+        CHECK(x < 1E-12);
+
+        CTensor E(4,4), T(4,4);
+        T.fill(0.0);
+        btas::contract_332(1.0,A,abc,A,adc,0.0,E,bd);
+        refColContract(1.0,A,{a,b,c},A,{a,d,c},0.0,T,{b,d});
+        x = 0;
+        for(auto i : E.range()) x = std::max(x,std::abs(E(i)-T(i)));
+        CHECK(x < 1E-12);
+        }
+
+    }
@@ -0,0 +1,99 @@
+#include "test.h"
+#include <atomic>
+#include <vector>
+
+#include "btas/tensor.h"
+#include "btas/util/parallel.h"
+#include "btas/generic/gemm_impl.h"
+#include "btas/generic/axpy_impl.h"
+#include "btas/generic/dot_impl.h"
+#include "btas/generic/permute.h"
+
+using std::cout;
+using std::endl;
+using namespace btas;
+
+TEST_CASE("Parallel")
+    {
+    const unsigned long nthreads = get_num_threads();
+    // threading is opt-in
+    if(!std::getenv("BTAS_NUM_THREADS")) CHECK(nthreads == 1);
+    if(!std::getenv("BTAS_PARALLEL_BLAS_LOOPS")) CHECK(!get_parallel_blas_loops());
+    set_num_threads(4);
+#ifndef _NO_THREADS
+    REQUIRE(get_num_threads() == 4);
+#endif
+
+    SECTION("Parallel For")
+        {
+        const unsigned long n = 1000;
+        std::vector<int> hits(n,0);
+        std::atomic<unsigned long> inner(0);
+        parallel_for(n, 10, [&](unsigned long first, unsigned long last)
+            {
+            for(unsigned long i = first; i < last; ++i) ++hits[i];
+            // nested calls run serially on the calling thread
+            parallel_for(100, 1, [&](unsigned long f, unsigned long l) { inner += l-f; });
+            });
+        CHECK(std::count(hits.begin(),hits.end(),1) == long(n));
+        CHECK((inner.load() % 100) == 0);
+
+        const double s = parallel_sum<double>(n, 10, [](unsigned long first, unsigned long last)
+            {
+            double v = 0;
+            for(unsigned long i = first; i < last; ++i) v += i;
+            return v;
+            });
+        CHECK(s == 0.5*n*(n-1));
+        }
+
+    SECTION("Threaded Kernels")
+        {
+        // the same operations on one and on four threads give the same results
+        Tensor<double> A(150,130), B(130,170), C1(150,170), C4(150,170);
+        A.generate([](){ static double v = 0; v += 0.13; return std::sin(v); });
+        B.generate([](){ static double v = 0; v += 0.29; return std::cos(v); });
+        Tensor<double> X(40,50,60);
+        X.generate([](){ static double v = 0; return v += 1; });
+        Tensor<double> P1, P4;
+        const varray<size_t> p = {2,0,1};
+
+        set_num_threads(1);
+        gemm(CblasNoTrans,CblasNoTrans,1.0,A,B,0.0,C1);
+        permute(X,p,P1);
+        Tensor<double> Y1(X);
+        axpy(0.5,X,Y1);
+        const double d1 = dot(X,Y1);
+
+        set_num_threads(4);
+        gemm(CblasNoTrans,CblasNoTrans,1.0,A,B,0.0,C4);
+        permute(X,p,P4);
+        Tensor<double> Y4(X);
+        axpy(0.5,X,Y4);
+        const double d4 = dot(X,Y4);
+
+        CHECK(std::equal(C1.begin(),C1.end(),C4.begin()));
+        CHECK(std::equal(P1.begin(),P1.end(),P4.begin()));
+        CHECK(std::equal(Y1.begin(),Y1.end(),Y4.begin()));
+        CHECK(std::abs(d1-d4) < 1E-10*std::abs(d1));
+
+        Tensor<double> Z(X);
+        Z += X;
+        Z -= Y4;
+        double maxdiff = 0;
+        for(unsigned long i = 0; i < X.size(); ++i) maxdiff = std::max(maxdiff,std::abs(Z[i]-0.5*X[i]));
+        CHECK(maxdiff < 1E-10);
+        }
+
+    SECTION("BLAS Loops")
+        {
+        const bool flag = get_parallel_blas_loops();
+        set_parallel_blas_loops(true);
+        CHECK(get_parallel_blas_loops());
+        set_parallel_blas_loops(false);
+        CHECK(!get_parallel_blas_loops());
+        set_parallel_blas_loops(flag);
+        }
+
+    set_num_threads(nthreads);
+    }
@@ -0,0 +1,97 @@
+#include "test.h"
+#include <algorithm>
+#include <vector>
+
+#include "btas/tensor.h"
+#include "btas/tensorview.h"
+#include "btas/generic/permute.h"
+
+using std::cout;
+using std::endl;
+using namespace btas;
+
+// checks Y(i[p[0]],i[p[1]],...) == X(i) for every index i of X
+template <typename _TensorX, typename _TensorY>
+bool
+isPermuted(const _TensorX& X, const varray<size_t>& p, const _TensorY& Y)
+    {
+    auto j = Y.range().lobound();
+    for(auto i : X.range())
+        {
+        for(size_t d = 0; d < p.size(); ++d) j[d] = i[p[d]];
+        if(!(Y(j) == X(i))) return false;
+        }
+    return true;
+    }
+
+TEST_CASE("Blocked Permute")
+    {
+
+    SECTION("Rank-4 Permutations")
+        {
+        Tensor<double> X(3,4,5,6);
+        X.generate([](){ static double v = 0; return v += 1; });
+        varray<size_t> p = {0,1,2,3};
+        do
+            {
+            Tensor<double> Y;
+            permute(X,p,Y);
+            CHECK(Y.range().ordinal().contiguous());
+            CHECK(isPermuted(X,p,Y));
+            }
+        while(std::next_permutation(p.begin(),p.end()));
+        }
+
+    SECTION("Tiled Transpose")
+        {
+        // large enough to be split into several tiles, with ragged edges
+        Tensor<std::complex<double>> X(37,3,91);
+        X.generate([](){ static double v = 0; v += 1; return std::complex<double>(v,-v); });
+        Tensor<std::complex<double>> Y;
+        const varray<size_t> p = {2,0,1};
+        permute(X,p,Y);
+        CHECK(isPermuted(X,p,Y));
+
+        Tensor<float> A(130,2,2,70);
+        A.generate([](){ static float v = 0; return v += 1; });
+        Tensor<float> B;
+        const varray<size_t> q = {3,0,1,2};
+        permute(A,q,B);
+        CHECK(isPermuted(A,q,B));
+        }
+
+    SECTION("Lower Bounds and Column Major")
+        {
+        typedef RangeNd<CblasColMajor> CRange;
+        Tensor<double,CRange> X(CRange({-1,2,0},{3,5,6}));
+        X.generate([](){ static double v = 0; return v += 1; });
+        Tensor<double,CRange> Y;
+        const varray<size_t> p = {1,2,0};
+        permute(X,p,Y);
+        CHECK(Y.range().lobound()[0] == 2);
+        CHECK(isPermuted(X,p,Y));
+        }
+
+    SECTION("View")
+        {
+        // views have no contiguous data(), these go through the element-wise path
+        Tensor<double> X(5,3,4);
+        X.generate([](){ static double v = 0; return v += 1; });
+        TensorView<double> V(X);
+        Tensor<double> Y;
+        const varray<size_t> p = {2,1,0};
+        permute(V,p,Y);
+        CHECK(isPermuted(X,p,Y));
+        }
+
+    SECTION("Annotated")
+        {
+        Tensor<double> X(4,2,7);
+        X.generate([](){ static double v = 0; return v += 1; });
+        Tensor<double> Y;
+        enum {i,j,k};
+        permute(X,varray<int>{i,j,k},Y,varray<int>{k,i,j});
+        CHECK(isPermuted(X,varray<size_t>{2,0,1},Y));
+        }
+
+    }
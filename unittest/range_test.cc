@@ -16,3 +16,140 @@ TEST_CASE("Range")
         }
 
     }
+
+template <CBLAS_ORDER _Order>
+void checkFixedRankIteration()
+    {
+    typedef btas::RangeNd<_Order, std::array<long,3>> FixedRange;
+    typedef btas::RangeNd<_Order> DynamicRange;
+    const std::array<long,3> perm = {{2,0,1}};
+    const FixedRange f = permute(FixedRange({-1,0,2},{2,4,5}), perm);
+    const DynamicRange d = permute(DynamicRange({-1,0,2},{2,4,5}), perm);
+
+    // same indices, in the same order
+    auto fi = f.begin();
+    auto di = d.begin();
+    for(; fi != f.end(); ++fi, ++di)
+        {
+        REQUIRE(di != d.end());
+        CHECK(std::equal(std::begin(*fi), std::end(*fi), std::begin(*di)));
+        CHECK(f.ordinal(*fi) == d.ordinal(*di));
+        }
+    CHECK(di == d.end());
+
+    // the incrementally updated ordinals match the ordinals of the indices
+    typedef typename FixedRange::ordinal_subiterator subiterator;
+    const subiterator end(std::make_pair(*f.end(), f.ordinal(*f.end())), &f);
+    long n = 0;
+    for(subiterator i(std::make_pair(*f.begin(), f.ordinal(*f.begin())), &f); i != end; ++i, ++n)
+        CHECK(i->second == f.ordinal(i->first));
+    CHECK(n == long(f.area()));
+    }
+
+TEST_CASE("Fixed-rank Range iteration")
+    {
+    SECTION("RowMajor") { checkFixedRankIteration<CblasRowMajor>(); }
+    SECTION("ColMajor") { checkFixedRankIteration<CblasColMajor>(); }
+    }
+
+template <CBLAS_ORDER _Order>
+void checkStridedSlice()
+    {
+    typedef btas::RangeNd<_Order> DynamicRange;
+    const DynamicRange r({-1,0,2},{7,6,5});
+
+    // every other index of the first dimension, the second reversed
+    const DynamicRange s = r.slice({btas::Range1(0,7,2), btas::Range1(4,-1,-1), btas::Range1(2,5)});
+    CHECK(s.extent(0) == 4);
+    CHECK(s.extent(1) == 5);
+    CHECK(s.extent(2) == 3);
+    CHECK(!s.ordinal().contiguous());
+
+    long n = 0;
+    for(auto i : s)
+        {
+        btas::varray<long> j(3);
+        j[0] = 2 * i[0];
+        j[1] = 4 - (i[1] - 4);
+        j[2] = i[2];
+        CHECK(s.ordinal(i) == r.ordinal(j));
+        ++n;
+        }
+    CHECK(n == long(s.area()));
+
+    // a unit-stride slice of whole dimensions is contiguous
+    CHECK(r.slice({btas::Range1(-1,7), btas::Range1(0,6), btas::Range1(2,5)}).ordinal().contiguous());
+    }
+
+TEST_CASE("Strided Range slice")
+    {
+    CHECK(btas::Range1(0,7,2).size() == 4);
+    CHECK(btas::Range1(4,-1,-1).size() == 5);
+    CHECK(btas::Range1(3,3,2).size() == 0);
+
+    SECTION("RowMajor") { checkStridedSlice<CblasRowMajor>(); }
+    SECTION("ColMajor") { checkStridedSlice<CblasColMajor>(); }
+    }
+
+template <CBLAS_ORDER _Order>
+void checkRandomAccess()
+    {
+    typedef btas::RangeNd<_Order> DynamicRange;
+    const DynamicRange p({-1,0,2},{7,6,5});
+    const DynamicRange r = p.slice({btas::Range1(0,7,2), btas::Range1(4,-1,-1), btas::Range1(2,5)});
+    const long area = r.area();
+
+    // jumps land where the serial walk does
+    long k = 0;
+    for(auto i = r.begin(); i != r.end(); ++i, ++k)
+        {
+        CHECK((r.begin() + k == i));
+        CHECK((i - r.begin() == k));
+        CHECK((r.end() - i == area - k));
+        const auto ik = r.begin()[k];
+        CHECK(std::equal(std::begin(ik), std::end(ik), std::begin(*i)));
+        }
+    CHECK(k == area);
+    CHECK((r.begin() + area == r.end()));
+    auto last = r.end();
+    --last;
+    CHECK((last - r.begin() == area - 1));
+    CHECK(r.begin() < last);
+
+    // the ordinals follow the indices
+    typedef typename DynamicRange::ordinal_subiterator subiterator;
+    subiterator s(std::make_pair(*r.begin(), r.ordinal(*r.begin())), &r);
+    s += 17;
+    CHECK((s->second == r.ordinal(s->first)));
+    CHECK((s->second == r.ordinal(*(r.begin() + 17))));
+
+    // the chunks cover the range in order, with sizes differing by at most one
+    const auto chunks = btas::partition(r, 7);
+    REQUIRE(chunks.size() == 7);
+    CHECK(chunks.front().first == r.begin());
+    CHECK(chunks.back().second == r.end());
+    for(size_t c = 0; c < chunks.size(); ++c)
+        {
+        const long n = chunks[c].second - chunks[c].first;
+        CHECK((n == area / 7 || n == area / 7 + 1));
+        if(c > 0) CHECK((chunks[c].first == chunks[c-1].second));
+        }
+    }
+
+TEST_CASE("Range random access")
+    {
+    SECTION("RowMajor") { checkRandomAccess<CblasRowMajor>(); }
+    SECTION("ColMajor") { checkRandomAccess<CblasColMajor>(); }
+
+    SECTION("Range1d")
+        {
+        const btas::Range1 r(9,-2,-3);
+        CHECK(std::distance(r.begin(), r.end()) == 4);
+        CHECK((*(r.begin() + 2) == 3));
+        const auto chunks = btas::partition(r, 3);
+        REQUIRE(chunks.size() == 3);
+        CHECK((*chunks[1].first == 3));
+        CHECK((chunks[2].second == r.end()));
+        CHECK(btas::partition(r, 10).size() == 4);
+        }
+    }
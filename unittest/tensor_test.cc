@@ -1,6 +1,14 @@
 #include "test.h"
 #include <random>
 #include "btas/tensor.h"
+#include "btas/mmap_storage.h"
+#include "btas/tensor_file.h"
+#include "btas/varray/allocators.h"
+#include "btas/generic/gemv_impl.h"
+
+#include <thread>
+#include <cstdlib>
+#include <unistd.h>
 
 using std::cout;
 using std::endl;
@@ -18,6 +26,14 @@ rng()
     return dist(rng);
     }
 
+// a path for a temporary file of this test run, outside the working directory
+static std::string
+tempPath(const std::string& name)
+    {
+    const char* dir = std::getenv("TMPDIR");
+    return std::string(dir && *dir ? dir : "/tmp") + "/btas_" + std::to_string(getpid()) + "_" + name;
+    }
+
 static
 std::ostream& 
 operator<<(std::ostream& s, const DTensor& X)
@@ -115,6 +131,19 @@ TEST_CASE("Tensor Constructors")
         DTensor T1(r1);
         CHECK(T1.rank() == 6);
         }
+
+    SECTION("Move Constructor")
+        {
+        DTensor T0(2,3,4);
+        fillEls(T0);
+        const DTensor R(T0);
+        DTensor T1(std::move(T0));
+        CHECK(T1.range() == R.range());
+        CHECK(std::equal(R.begin(), R.end(), T1.begin()));
+        CHECK(T0.empty());
+        CHECK(T0.range().area() == 0);
+        CHECK(T0.storage().size() == 0);
+        }
     }
 
 TEST_CASE("Tensor")
@@ -146,4 +175,270 @@ TEST_CASE("Tensor")
             CHECK(*it == data[j]);
             }
         }
+
+    SECTION("Default storage")
+        {
+        DTensor Z(4,3);
+        for(auto x : Z) CHECK(x == 0);
+        }
+
+    SECTION("Aligned storage")
+        {
+        typedef Tensor<double, Range, btas::DEFAULT::aligned_storage<double>> ATensor;
+        ATensor A3(3,2,4);
+        CHECK((reinterpret_cast<std::uintptr_t>(A3.data()) % 64) == 0);
+
+        btas::set_huge_pages(true);
+        ATensor L(4, btas::huge_page_size / sizeof(double));
+        btas::set_huge_pages(false);
+        CHECK((reinterpret_cast<std::uintptr_t>(L.data()) % btas::huge_page_size) == 0);
+        L.fill(2.);
+        ATensor M(L);
+        CHECK(std::equal(L.begin(), L.end(), M.begin()));
+
+        // beta == 0 overwrites whatever uninitialized outputs hold
+        ATensor A(4,2), x(2), y(4);
+        A.fill(1.);
+        x.fill(2.5);
+        y.fill(std::numeric_limits<double>::quiet_NaN());
+        gemv(CblasNoTrans,1.0,A,x,0.0,y);
+        for(auto v : y) CHECK(v == 5.);
+        y.fill(std::numeric_limits<double>::quiet_NaN());
+        scal(0.0,y);
+        for(auto v : y) CHECK(v == 0.);
+        }
+
+    SECTION("Expressions")
+        {
+        DTensor B(3,2,4);
+        fillEls(B);
+
+        DTensor D = 2*T3 + B - T3*0.5;
+        for(size_t i = 0; i < D.size(); ++i)
+            CHECK(D.data()[i] == Approx(1.5*T3.data()[i] + B.data()[i]));
+
+        D -= -B + T3;
+        D += D;
+        for(size_t i = 0; i < D.size(); ++i)
+            CHECK(D.data()[i] == Approx(1.0*T3.data()[i] + 4*B.data()[i]));
+
+        // TensorView operands are visited in the order of their range
+        const std::array<long,3> perm = {{2,0,1}};
+        btas::TensorView<double, Range, const DTensor::storage_type> V(permute(T3.range(), perm), T3.storage());
+        DTensor P(V);
+        DTensor Q(4,3,2);
+        Q = 3*P - V + P;
+        CHECK(Q.range() == P.range());
+        for(size_t i = 0; i < Q.size(); ++i)
+            CHECK(Q.data()[i] == Approx(3*P.data()[i]));
+
+        // operands that alias the result through a view
+        DTensor A(3,3);
+        fillEls(A);
+        DTensor E(3,3);
+        fillEls(E);
+        const std::array<long,2> transpose = {{1,0}};
+        btas::TensorView<double, Range, const DTensor::storage_type> At(permute(A.range(), transpose), A.storage());
+        DTensor R = At + E;
+        A = At + E;
+        for(size_t i = 0; i < A.size(); ++i)
+            CHECK(A.data()[i] == R.data()[i]);
+        R = At + R;
+        A += At;
+        for(size_t i = 0; i < A.size(); ++i)
+            CHECK(A.data()[i] == R.data()[i]);
+
+        // operands that alias the result and change its size
+        DTensor S(2,2);
+        fillEls(S);
+        DTensor W(3,3);
+        fillEls(W);
+        const auto Wv = W.slice({btas::Range1(0,2),btas::Range1(1,3)});
+        const DTensor Ref = Wv + S;
+        W = Wv + S;
+        CHECK(W.range() == Ref.range());
+        for(size_t i = 0; i < W.size(); ++i)
+            CHECK(W.data()[i] == Ref.data()[i]);
+        }
+    }
+
+TEST_CASE("Parallel loop over a view")
+    {
+    DTensor T(12,10,8);
+    T.generate([](){ static double v = 0; v += 1; return v; });
+    const auto V = T.slice({btas::Range1(1,12,3),btas::Range1(9,-1,-1),btas::Range1(0,8,2)});
+    const double ref = std::accumulate(V.cbegin(),V.cend(),0.0);
+
+    // each thread starts at its own chunk of the view
+    typedef decltype(V.cbegin()) iterator;
+    const auto chunks = btas::partition(V.range(), 4);
+    std::vector<double> sum(chunks.size(), 0.0);
+    btas::parallel_for(chunks.size(), 1, [&](unsigned long c0, unsigned long c1)
+        {
+        for(auto c = c0; c < c1; ++c)
+            sum[c] = std::accumulate(iterator(chunks[c].first, V.storage()), iterator(chunks[c].second, V.storage()), 0.0);
+        });
+    CHECK(std::accumulate(sum.begin(),sum.end(),0.0) == ref);
+    }
+
+TEST_CASE("Memory-mapped Tensor")
+    {
+    typedef btas::mmap_storage<double> Storage;
+    typedef Tensor<double, Range, Storage> MTensor;
+    const std::string path = tempPath("mmap_storage_test.tmp");
+    std::remove(path.c_str());
+
+    DTensor T(3,2,4);
+    fillEls(T);
+
+        {
+        // shared mappings create and write through to the file
+        MTensor S(T.range(), Storage(path, btas::mmap_mode::shared, T.size()));
+        CHECK(S.storage().file_backed());
+        std::copy(T.begin(), T.end(), S.begin());
+        S.storage().sync();
+        }
+
+    SECTION("Read-only")
+        {
+        MTensor R(T.range(), Storage(path, btas::mmap_mode::read_only));
+        R.storage().advise(btas::mmap_advice::sequential);
+        CHECK(std::equal(T.begin(), T.end(), R.begin()));
+        CHECK_THROWS(R.storage().resize(1));
+
+        // copies are anonymous and writable
+        MTensor C(R);
+        C.fill(0.);
+        CHECK(!C.storage().file_backed());
+        CHECK(std::equal(T.begin(), T.end(), R.begin()));
+        }
+
+    SECTION("Private copy")
+        {
+        MTensor P(T.range(), Storage(path, btas::mmap_mode::private_copy));
+        P.fill(1.);
+        MTensor R(T.range(), Storage(path, btas::mmap_mode::read_only));
+        CHECK(std::equal(T.begin(), T.end(), R.begin()));
+        }
+
+    SECTION("Offset and resize")
+        {
+        Storage S(path, btas::mmap_mode::shared, 2, 3*sizeof(double));
+        CHECK(S[0] == T.data()[3]);
+        S.resize(T.size()+5);
+        CHECK(S[T.size()-4] == T.data()[T.size()-1]);
+        CHECK(S[T.size()+4] == 0.);
+        CHECK(Storage(path, btas::mmap_mode::read_only).size() == T.size()+8);
+        }
+
+    std::remove(path.c_str());
+    }
+
+TEST_CASE("Tensor file")
+    {
+    const std::string path = tempPath("tensor_file_test.tmp");
+    typedef btas::RangeNd<CblasColMajor> CRange;
+    Tensor<double, CRange> T(CRange({-1,0,2},{2,4,5}));
+    double x = 0;
+    T.generate([&](){ return x += 1.5; });
+
+    SECTION("Tensor")
+        {
+        btas::write_tensor_file(path, T);
+        auto R = btas::read_tensor_file<Tensor<double, CRange>>(path);
+        CHECK(R.range() == T.range());
+        CHECK(std::equal(T.begin(), T.end(), R.begin()));
+
+        auto M = btas::mmap_tensor_file<double, CRange>(path);
+        CHECK(M.range() == T.range());
+        const auto address = reinterpret_cast<std::uintptr_t>(M.data());
+        CHECK((address % btas::tensor_file_alignment) == 0);
+        CHECK(std::equal(T.begin(), T.end(), M.begin()));
+
+        CHECK_THROWS((btas::read_tensor_file<Tensor<float, CRange>>(path)));
+        CHECK_THROWS(btas::read_tensor_file<DTensor>(path));
+        }
+
+    SECTION("TensorView and chunks")
+        {
+        const std::array<long,3> perm = {{2,0,1}};
+        btas::TensorView<double, CRange, const DTensor::storage_type> V(permute(T.range(), perm), T.storage());
+        btas::write_tensor_file(path, V);
+
+        btas::tensor_file_reader<double> r(path);
+        CHECK(r.header().range<CRange>() == CRange(V.range().lobound(), V.range().upbound()));
+        std::vector<double> data;
+        double chunk[5];
+        while(size_t n = r.read(chunk, 5)) data.insert(data.end(), chunk, chunk+n);
+        CHECK(std::equal(V.begin(), V.end(), data.begin()));
+        CHECK(data.size() == V.range().area());
+        }
+
+    SECTION("Value types")
+        {
+        // half and bfloat16 have the same size but different codes
+        Tensor<btas::half, CRange> H(T.range());
+        std::copy(T.begin(), T.end(), H.begin());
+        btas::write_tensor_file(path, H);
+        auto R = btas::read_tensor_file<Tensor<btas::half, CRange>>(path);
+        CHECK(std::equal(H.begin(), H.end(), R.begin(), [](btas::half a, btas::half b){ return a.bits() == b.bits(); }));
+        CHECK_THROWS((btas::read_tensor_file<Tensor<btas::bfloat16, CRange>>(path)));
+        CHECK_THROWS((btas::read_tensor_file<Tensor<std::int16_t, CRange>>(path)));
+        }
+
+    std::remove(path.c_str());
+    }
+
+TEST_CASE("Pool allocator")
+    {
+    typedef btas::pool_allocator<double> Alloc;
+    typedef Tensor<double, Range, std::vector<double, Alloc>> PTensor;
+    CHECK(btas::impl::memory_pool::size_class(64) == 0);
+    CHECK(btas::impl::memory_pool::class_size(btas::impl::memory_pool::size_class(100)) == 128);
+    CHECK(btas::impl::memory_pool::class_size(btas::impl::memory_pool::size_class(129)) == 192);
+
+    btas::release_pool_memory();
+    btas::reset_pool_statistics();
+    const auto live0 = btas::get_pool_statistics().live_blocks;
+
+        {
+        btas::varray<double, Alloc> v(100, 1.);
+        PTensor T(10, 10);
+        T.fill(2.);
+        CHECK((reinterpret_cast<std::uintptr_t>(T.data()) % 64) == 0);
+        CHECK(btas::get_pool_statistics().live_blocks == live0 + 2);
+        }
+    auto stats = btas::get_pool_statistics();
+    CHECK(stats.live_blocks == live0);
+    CHECK(stats.cached_bytes >= 2*1024);
+    CHECK(stats.hits == 0);
+
+    // another thread misses once, the blocks freed by this thread stay in its cache
+    std::thread t([]()
+        {
+        for(int i = 0; i < 10; ++i)
+            {
+            PTensor T(10, 10);
+            T.fill(1.);
+            }
+        });
+    t.join();
+    PTensor U(10, 10);
+    stats = btas::get_pool_statistics();
+    CHECK(stats.requests == 13);
+    CHECK(stats.hits == 10);
+    CHECK(stats.live_blocks == live0 + 1);
+    CHECK(stats.peak_bytes >= 2*1024);
+
+    // a thread-local container constructed before the thread's cache is destroyed after it
+    const auto cached0 = stats.cached_bytes;
+    std::thread t2([]()
+        {
+        static thread_local std::vector<double, Alloc> v;
+        v.resize(100);
+        });
+    t2.join();
+    stats = btas::get_pool_statistics();
+    CHECK(stats.live_blocks == live0 + 1);
+    CHECK(stats.cached_bytes == cached0);
     }